@@ -70,9 +70,11 @@
 #define configMESSAGE_BUFFER_LENGTH_TYPE size_t
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION 0
+/* every kernel object is static, sized in kernel_objects.h. The heap is left for anything
+   the SDK port creates on its own */
+#define configSUPPORT_STATIC_ALLOCATION 1
 #define configSUPPORT_DYNAMIC_ALLOCATION 1
-#define configTOTAL_HEAP_SIZE (128 * 1024)
+#define configTOTAL_HEAP_SIZE (4 * 1024)
 #define configAPPLICATION_ALLOCATED_HEAP 0
 
 /* Hook function related definitions. */
@@ -138,5 +140,6 @@ to exclude the API function. */
 #define INCLUDE_xQueueGetMutexHolder 1
 
 /* A header file that defines trace macro can be included here. */
+#include "trace.h"
 
 #endif /* FREERTOS_CONFIG_H */
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alerts.h"
+#include "publish_queue.h"
+#include "buffer_pool.h"
+#include "timebase.h"
+#include "log.h"
+
+#define ALERT_TOPIC 4
+
+#define ALERT_GUST_MPH 40.0f
+#define ALERT_PRESSURE_JUMP_PA 100.0f        // 1hPa
+#define ALERT_PRESSURE_WINDOW_MS (5 * 60000) // between samples no further apart than this
+#define ALERT_RAIN_IN_HR 2.0f
+#define ALERT_RAIN_TIPS 5          // the rate is measured over this many tips
+#define ALERT_INCHES_PER_TIP 0.011f
+#define ALERT_CLEAR_FRACTION 0.8f  // a detector re-arms once the value falls below this part of the limit
+#define ALERT_HOLDOFF_MS (10 * 60000)
+
+struct detector_s
+{
+    bool armed;
+    TickType_t lastAlert;
+};
+
+static struct detector_s detectors[ALERT_TYPES];
+static struct alert_stats_s alertStats;
+static char alertThingName[50];
+
+// pressure jump state
+static bool havePressure;
+static float lastPressure;
+static TickType_t lastPressureTick;
+
+// rain rate state, the tick of each of the last tips
+static TickType_t tipTicks[ALERT_RAIN_TIPS + 1];
+static uint32_t tipCount;
+static bool haveTips;
+static uint32_t lastTips;
+
+const char *alerts_typeName(enum alert_type_e type)
+{
+    static const char *const names[ALERT_TYPES] = {"gust", "pressure_jump", "rain_rate"};
+    return type < ALERT_TYPES ? names[type] : "unknown";
+}
+
+/** raise once per excursion: the value has to clear and the holdoff pass before the next alert */
+static void alerts_detect(enum alert_type_e type, float value, float magnitude, float limit)
+{
+    struct detector_s *detector = &detectors[type];
+    TickType_t now = xTaskGetTickCount();
+
+    if (magnitude < limit * ALERT_CLEAR_FRACTION)
+    {
+        if (now - detector->lastAlert >= pdMS_TO_TICKS(ALERT_HOLDOFF_MS))
+            detector->armed = true;
+        return;
+    }
+    if (magnitude < limit || !detector->armed)
+        return;
+
+    detector->armed = false;
+    detector->lastAlert = now;
+    alertStats.raised++;
+
+    // the alert lane of the publish queue sends it ahead of any report
+    bool queued = false;
+    struct pool_block_s *block = pool_alloc();
+    if (block != NULL)
+    {
+        snprintf(block->data, POOL_BLOCK_SIZE, "{\"ID\":\"%s\",\"ALERT\":\"%s\",\"value\":%.2f,\"utc_ms\":%lld}",
+                 alertThingName, alerts_typeName(type), value, (long long)timebase_nowMs());
+        block->length = strlen(block->data); // what fitted, snprintf returns what it wanted to write
+        queued = publish_enqueue(PUBLISH_ALERT, ALERT_TOPIC, block);
+        pool_release(block);
+    }
+    if (!queued)
+    {
+        alertStats.dropped++;
+    }
+    LOG_WARN("Alert %s %.2f raised", alerts_typeName(type), value);
+}
+
+void alerts_checkGust(float speedMph)
+{
+    alerts_detect(ALERT_GUST, speedMph, speedMph, ALERT_GUST_MPH);
+}
+
+void alerts_checkPressure(float pascal)
+{
+    TickType_t now = xTaskGetTickCount();
+    if (havePressure && now - lastPressureTick <= pdMS_TO_TICKS(ALERT_PRESSURE_WINDOW_MS))
+    {
+        float jump = pascal - lastPressure;
+        alerts_detect(ALERT_PRESSURE_JUMP, jump, jump < 0 ? -jump : jump, ALERT_PRESSURE_JUMP_PA);
+    }
+    havePressure = true;
+    lastPressure = pascal;
+    lastPressureTick = now;
+}
+
+void alerts_checkRainTips(uint32_t tips)
+{
+    TickType_t now = xTaskGetTickCount();
+    if (!haveTips)
+    {
+        haveTips = true;
+        lastTips = tips;
+        return;
+    }
+    uint32_t newTips = tips - lastTips;
+    lastTips = tips;
+    if (newTips == 0)
+        return;
+    // several tips in one call came from coalesced FIFO words or a dropped queue send, and when
+    // they fell is not known. The rate starts again from the last of them
+    if (newTips > 1)
+        tipCount = 0;
+    tipTicks[tipCount % (ALERT_RAIN_TIPS + 1)] = now;
+    tipCount++;
+    if (tipCount <= ALERT_RAIN_TIPS)
+        return;
+
+    // the ring holds one more tick than tips so the oldest is ALERT_RAIN_TIPS tips ago
+    TickType_t elapsed = now - tipTicks[tipCount % (ALERT_RAIN_TIPS + 1)];
+    if (elapsed == 0)
+        elapsed = 1;
+    float inchesPerHour = ALERT_RAIN_TIPS * ALERT_INCHES_PER_TIP * 3600000.0f / (elapsed * portTICK_PERIOD_MS);
+    alerts_detect(ALERT_RAIN_RATE, inchesPerHour, inchesPerHour, ALERT_RAIN_IN_HR);
+}
+
+void init_alerts(void)
+{
+    for (int i = 0; i < ALERT_TYPES; i++)
+    {
+        detectors[i].armed = true;
+    }
+}
+
+void alerts_setThingName(const char *thingName)
+{
+    strncpy(alertThingName, thingName, sizeof(alertThingName) - 1);
+}
+
+void alerts_getStats(struct alert_stats_s *stats)
+{
+    struct publish_stats_s published;
+    publish_getStats(PUBLISH_ALERT, &published);
+    *stats = alertStats;
+    stats->sent = published.sent;
+    stats->lastLatencyMs = published.lastLatencyMs;
+    stats->maxLatencyMs = published.maxLatencyMs;
+}
@@ -0,0 +1,40 @@
+#ifndef _ALERTS_
+#define _ALERTS_
+
+#include "FreeRTOS.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Dangerous conditions are detected in the sensor pipelines and published at once
+ * on their own topic instead of waiting for the next report.
+ */
+enum alert_type_e
+{
+    ALERT_GUST,          // a one second wind speed above the limit
+    ALERT_PRESSURE_JUMP, // a pressure step between two samples
+    ALERT_RAIN_RATE,     // torrential rain over the last few tips
+    ALERT_TYPES,
+};
+
+struct alert_stats_s
+{
+    uint32_t raised;
+    uint32_t sent;
+    uint32_t dropped;       // the publish queue had no room for it
+    uint32_t lastLatencyMs; // detection to send complete
+    uint32_t maxLatencyMs;
+};
+
+void init_alerts(void);
+/** the ID of the alert messages, alerts raised before it is known go out without one */
+void alerts_setThingName(const char *thingName);
+
+/** detectors, each called from one sensor task */
+void alerts_checkGust(float speedMph);
+void alerts_checkPressure(float pascal);
+void alerts_checkRainTips(uint32_t tips);
+
+void alerts_getStats(struct alert_stats_s *stats);
+const char *alerts_typeName(enum alert_type_e type);
+
+#endif // _ALERTS_
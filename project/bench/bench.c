@@ -0,0 +1,454 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gps.h"
+
+#include "bmp388_compensation.h"
+#include "buffer_pool.h"
+#include "log.h"
+#include "nmea_filter.h"
+#include "publish_policy.h"
+#include "report_format.h"
+#include "timebase.h"
+#include "ubx.h"
+#include "wind_average.h"
+
+#include "gps_trace.h"
+
+/** Microbenchmarks of the compute kernels over fixed inputs.
+ * Each kernel is calibrated until one round takes BENCH_ROUND_US, then timed over
+ * BENCH_ROUNDS rounds and the median is reported. Every result is also printed as
+ *   BENCH,<kernel>,<value>,<unit>
+ * so a USB capture or a host run can be kept and compared with --compare on the host.
+ * The target has no cycle counter on the M0+ and SysTick belongs to FreeRTOS, so cycles
+ * are the microsecond timer scaled by clk_sys.
+ */
+#ifndef BENCH_ON_TARGET
+#define BENCH_ON_TARGET 0 // 1 for the RP2040 build, 0 for the host
+#endif
+
+#define BENCH_ROUNDS 5
+#define BENCH_ROUND_US 20000
+#define BENCH_REGRESSION_PERCENT 10 // --compare fails when a kernel is this much slower
+
+#if BENCH_ON_TARGET
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+#define BENCH_UNIT "cycles"
+
+static uint64_t bench_nowUs(void)
+{
+    return time_us_64();
+}
+
+static double bench_perOp(uint64_t elapsedUs, uint32_t iterations)
+{
+    return (double)elapsedUs * (clock_get_hz(clk_sys) / 1000000) / iterations;
+}
+#else
+#include <time.h>
+
+#define BENCH_UNIT "ns"
+
+static uint64_t bench_nowUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static double bench_perOp(uint64_t elapsedUs, uint32_t iterations)
+{
+    return (double)elapsedUs * 1000.0 / iterations;
+}
+#endif
+
+/*********************************************************************************
+ * fixed inputs
+ *********************************************************************************/
+#define BENCH_WIND_SETS 3
+static struct wind_data windSets[BENCH_WIND_SETS][WIND_AVERAGE_SAMPLES];
+
+static const uint32_t vaneCounts[] = {4400, 1390, 430, 610, 850, 2390, 12500, 7950, 3000, 9800, 0, 16000};
+
+static struct bmp388_float_coefficients_s floatCoefficients;
+static struct bmp388_integer_coefficients_s integerCoefficients;
+
+/** a real BMP388 trim so every term of the compensation is exercised */
+static const struct bmp388_trim_s trim = {27570, 19045, -7, 3289, 1650, 37, 0, 25340, 30620, 5, -6, 11740, 32, -61};
+
+static const char *const nmeaSentences[] = {
+    "$GPGGA,172814.00,4158.6740,N,09139.9360,W,1,08,0.9,250.3,M,-32.1,M,,*5C\r\n",
+    "$GPRMC,172814.00,A,4158.6740,N,09139.9360,W,0.2,54.7,190626,,,A*78\r\n",
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.8,0.9,1.5*39\r\n",
+};
+
+static const struct report_scaled_s scaledReport = {
+    4.12f, 23.41f, 98731.25f, 101622.37f, -120, "falling", 0, 22.87f,
+    "\"GPS\":{\"latitude\":41.97790,\"longitude\":-91.66560, \"altitude\":250.3},",
+    7.21f, 247, 18.64f, 262, 0.13f, 0.57f, 123456789, "2026-06-19T17:28:14.000Z"};
+
+static void bench_inputs(void)
+{
+    uint32_t seed = 12345;
+    for (int i = 0; i < WIND_AVERAGE_SAMPLES; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        windSets[0][i] = (struct wind_data){225, 3.0f + (seed >> 28) / 8.0f};                    // steady
+        windSets[1][i] = (struct wind_data){(i * 45 / 20 + 315) % 360, 8.0f + (seed >> 27) / 4.0f}; // veering through north
+        windSets[2][i] = (struct wind_data){(int)(seed >> 24) % 8 * 45, (float)(seed >> 26)};     // gusty and shifting
+    }
+    bmp388_floatCoefficients(&trim, &floatCoefficients);
+    bmp388_integerCoefficients(&trim, &integerCoefficients);
+}
+
+/*********************************************************************************
+ * kernels
+ *********************************************************************************/
+static volatile int sinkInt;
+static volatile float sinkFloat;
+static volatile uint64_t sinkInteger;
+
+static void kernel_windAverage(uint32_t i)
+{
+    struct wind_data average;
+    wind_average(windSets[i % BENCH_WIND_SETS], WIND_AVERAGE_SAMPLES, &average);
+    sinkInt = average.direction;
+}
+
+static void kernel_windDirection(uint32_t i)
+{
+    sinkInt = wind_directionFromCounts(vaneCounts[i % (sizeof(vaneCounts) / sizeof(*vaneCounts))]);
+}
+
+static void kernel_bmp388Float(uint32_t i)
+{
+    float t = bmp388_compensateTemperatureFloat(&floatCoefficients, 8000000 + (i & 1023) * 97);
+    sinkFloat = bmp388_compensatePressureFloat(&floatCoefficients, 6000000 + (i & 1023) * 131, t);
+}
+
+static void kernel_bmp388Integer(uint32_t i)
+{
+    int64_t t_lin;
+    (void)bmp388_compensateTemperatureInteger(&integerCoefficients, 8000000 + (i & 1023) * 97, &t_lin);
+    sinkInteger = bmp388_compensatePressureInteger(&integerCoefficients, 6000000 + (i & 1023) * 131, t_lin);
+}
+
+static void kernel_reportJson(uint32_t i)
+{
+    static char buffer[1024];
+    sinkInt = report_formatScaled(buffer, sizeof(buffer), "weather-bench", &scaledReport);
+}
+
+/** what the GPS task does with each queued sentence */
+static void kernel_gpsDecode(uint32_t i)
+{
+    static struct gps_tpv tpv;
+    char sentence[90];
+    strcpy(sentence, nmeaSentences[i % (sizeof(nmeaSentences) / sizeof(*nmeaSentences))]);
+    if (i == 0)
+        gps_init_tpv(&tpv);
+    int error = gps_decode(&tpv, sentence);
+    struct utc_time_s utc;
+    sinkInt = error + timebase_parseIso8601(tpv.time, &utc);
+}
+
+/** one epoch of the NMEA trace as the GPS task takes it when every sentence is queued: each
+ * line through gps_decode
+ */
+static uint32_t nmeaReplayBytes;
+
+static void kernel_nmeaReplay(uint32_t i)
+{
+    static struct gps_tpv tpv;
+    const char *epoch = gpsTraceNmea[i % GPS_TRACE_EPOCHS];
+    char sentence[90];
+    if (i == 0)
+        gps_init_tpv(&tpv);
+    nmeaReplayBytes = 0;
+    while (*epoch)
+    {
+        size_t length = strcspn(epoch, "\n") + 1;
+        memcpy(sentence, epoch, length);
+        sentence[length] = 0;
+        sinkInt = gps_decode(&tpv, sentence);
+        nmeaReplayBytes += length;
+        epoch += length;
+    }
+}
+
+/** one epoch of the NMEA trace through the receive interrupt's filter. What it copies is the
+ * queue entry of each sentence it passes on
+ */
+static uint32_t nmeaFilterBytes;
+static uint32_t nmeaFilterQueued;
+
+static void kernel_nmeaFilter(uint32_t i)
+{
+    static struct nmea_filter_s filter;
+    const char *epoch = gpsTraceNmea[i % GPS_TRACE_EPOCHS];
+    nmeaFilterBytes = 0;
+    nmeaFilterQueued = 0;
+    for (; *epoch; epoch++)
+    {
+        nmeaFilterBytes++;
+        if (nmea_filterByte(&filter, *epoch))
+            nmeaFilterQueued += NMEA_SENTENCE_MAX;
+    }
+    sinkInt = filter.length;
+}
+
+/** one epoch of the NAV-PVT trace through the UBX receive interrupt and the decode in the task */
+static uint32_t ubxReplayBytes;
+
+static void kernel_ubxReplay(uint32_t i)
+{
+    static struct ubx_parser_s parser;
+    const uint8_t *frame = gpsTraceUbx[i % GPS_TRACE_EPOCHS];
+    ubxReplayBytes = sizeof(*gpsTraceUbx);
+    for (size_t at = 0; at < sizeof(*gpsTraceUbx); at++)
+    {
+        if (ubx_parse(&parser, frame[at]))
+        {
+            struct ubx_nav_pvt_s pvt;
+            ubx_decodeNavPvt(parser.payload, parser.length, &pvt);
+            sinkInt = pvt.second;
+        }
+    }
+}
+
+/** a log call as the hot paths make it. The ring is emptied every 16 calls so no record is
+ * dropped, the share of that copy in the result is small
+ */
+static void kernel_logRecord(uint32_t i)
+{
+    static uint8_t records[1024];
+    uint64_t time;
+    LOG_AT("\003", "el_read: %s %d %.2f", "OK 1 connected", (int)i, (double)sinkFloat);
+    if ((i & 15) == 15)
+        sinkInt = log_take(get_core_num(), records, sizeof(records), &time);
+}
+
+/** the same line formatted on the spot, without the USB write printf adds */
+static void kernel_logSnprintf(uint32_t i)
+{
+    static char text[LOG_RECORD_MAX];
+    sinkInt = snprintf(text, sizeof(text), "el_read: %s %d %.2f\n", "OK 1 connected", (int)i, (double)sinkFloat);
+}
+
+#if !BENCH_ON_TARGET
+/** the scaled report from the formatter to the UART as the firmware takes it: formatted into a
+ * pool block, queued for both topics through the publish policy, and each send taken from the
+ * policy with a reference of its own and the AT+SEND command put in the headroom the way
+ * expresslinkPublish() does. Only the mutexes and the UART are left out. The pool's critical
+ * section leaves the interrupts off on the target until a scheduler runs, so this is host only
+ */
+static struct publish_policy_s benchPolicy;
+static uint32_t reportPublishBytes;
+
+static void kernel_reportPublish(uint32_t i)
+{
+    struct pool_block_s *block = pool_alloc();
+    block->length = report_formatScaled(block->data, POOL_BLOCK_SIZE, "weather-bench", &scaledReport);
+    for (int topic = 2; topic <= 3; topic++)
+    {
+        struct pool_block_s *evicted;
+        if (publish_policyEnqueue(&benchPolicy, PUBLISH_LIVE, topic, block, i, &evicted) >= 0)
+            pool_retain(block);
+        if (evicted != NULL)
+            pool_release(evicted);
+    }
+    pool_release(block); // the reporter's own
+
+    reportPublishBytes = 0;
+    uint32_t waitMs;
+    int slot;
+    while ((slot = publish_policyNextDue(&benchPolicy, i, &waitMs)) >= 0)
+    {
+        struct publish_slot_s entry = benchPolicy.slots[slot];
+        pool_retain(entry.block);
+        char prefix[POOL_HEADROOM + 1];
+        int prefixLength = snprintf(prefix, sizeof(prefix), "AT+SEND%d ", entry.topic);
+        const char *command = pool_prepend(entry.block, prefix, prefixLength);
+        sinkInt = command[0];
+        reportPublishBytes += entry.block->data - command;
+        struct pool_block_s *done = publish_policySent(&benchPolicy, slot, &entry, true, i);
+        if (done != NULL)
+            pool_release(done);
+        pool_release(entry.block);
+    }
+}
+#endif
+
+struct bench_kernel_s
+{
+    const char *name;
+    void (*run)(uint32_t i);
+    const uint32_t *copied; // bytes one call copied after formatting, also kept as <name>_copied
+    const uint32_t *uart;   // bytes one call took from the UART, also kept as <name>_uart
+};
+
+static const struct bench_kernel_s kernels[] = {
+    {"wind_average", kernel_windAverage},
+    {"wind_direction", kernel_windDirection},
+    {"bmp388_float", kernel_bmp388Float},
+    {"bmp388_integer", kernel_bmp388Integer},
+    {"report_json", kernel_reportJson},
+    {"gps_decode", kernel_gpsDecode},
+    {"nmea_replay", kernel_nmeaReplay, NULL, &nmeaReplayBytes},
+    {"nmea_filter", kernel_nmeaFilter, &nmeaFilterQueued, &nmeaFilterBytes},
+    {"ubx_replay", kernel_ubxReplay, NULL, &ubxReplayBytes},
+    {"log_record", kernel_logRecord},
+    {"log_snprintf", kernel_logSnprintf},
+#if !BENCH_ON_TARGET
+    {"report_publish", kernel_reportPublish, &reportPublishBytes},
+#endif
+};
+
+/*********************************************************************************
+ * runner
+ *********************************************************************************/
+static uint64_t bench_round(const struct bench_kernel_s *kernel, uint32_t iterations)
+{
+    uint64_t start = bench_nowUs();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        kernel->run(i);
+    }
+    return bench_nowUs() - start;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_run(void)
+{
+    double results[sizeof(kernels) / sizeof(*kernels)];
+    printf("%-16s %10s %12s\n", "kernel", "iterations", BENCH_UNIT "/op");
+    for (int k = 0; k < sizeof(kernels) / sizeof(*kernels); k++)
+    {
+        uint32_t iterations = 16;
+        while (bench_round(&kernels[k], iterations) < BENCH_ROUND_US && iterations < (1u << 30))
+        {
+            iterations *= 2;
+        }
+        double perOp[BENCH_ROUNDS];
+        for (int round = 0; round < BENCH_ROUNDS; round++)
+        {
+            perOp[round] = bench_perOp(bench_round(&kernels[k], iterations), iterations);
+        }
+        qsort(perOp, BENCH_ROUNDS, sizeof(*perOp), compareDouble);
+        results[k] = perOp[BENCH_ROUNDS / 2];
+        printf("%-16s %10lu %12.1f\n", kernels[k].name, (unsigned long)iterations, results[k]);
+    }
+    // the table is for reading, these lines are for keeping
+    for (int k = 0; k < sizeof(kernels) / sizeof(*kernels); k++)
+    {
+        printf("BENCH,%s,%.1f,%s\n", kernels[k].name, results[k], BENCH_UNIT);
+        if (kernels[k].copied != NULL)
+            printf("BENCH,%s_copied,%lu,bytes\n", kernels[k].name, (unsigned long)*kernels[k].copied);
+        if (kernels[k].uart != NULL)
+            printf("BENCH,%s_uart,%lu,bytes\n", kernels[k].name, (unsigned long)*kernels[k].uart);
+    }
+}
+
+#if BENCH_ON_TARGET
+int main()
+{
+    stdio_init_all();
+    bench_inputs();
+    // repeat so a terminal that connects late still sees a run
+    for (;;)
+    {
+        bench_run();
+        sleep_ms(10000);
+    }
+}
+#else
+#define BENCH_MAX_RESULTS 32
+
+struct bench_result_s
+{
+    char name[32];
+    char unit[8];
+    double value;
+};
+
+/** the BENCH lines of a saved run, anything else in the file is skipped */
+static int bench_load(const char *path, struct bench_result_s *results)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        exit(2);
+    }
+    char line[256];
+    int count = 0;
+    while (fgets(line, sizeof(line), file) && count < BENCH_MAX_RESULTS)
+    {
+        struct bench_result_s *result = &results[count];
+        if (sscanf(line, "BENCH,%31[^,],%lf,%7s", result->name, &result->value, result->unit) == 3)
+            count++;
+    }
+    fclose(file);
+    return count;
+}
+
+/** returns 1 when any kernel in both runs got slower by more than the threshold */
+static int bench_compare(const char *oldPath, const char *newPath, double thresholdPercent)
+{
+    struct bench_result_s before[BENCH_MAX_RESULTS];
+    struct bench_result_s after[BENCH_MAX_RESULTS];
+    int beforeCount = bench_load(oldPath, before);
+    int afterCount = bench_load(newPath, after);
+    int regressions = 0;
+
+    printf("%-16s %12s %12s %8s\n", "kernel", "before", "after", "change");
+    for (int a = 0; a < afterCount; a++)
+    {
+        const struct bench_result_s *old = NULL;
+        for (int b = 0; b < beforeCount; b++)
+        {
+            if (strcmp(before[b].name, after[a].name) == 0 && strcmp(before[b].unit, after[a].unit) == 0)
+                old = &before[b];
+        }
+        if (old == NULL)
+        {
+            printf("%-16s %12s %12.1f %8s\n", after[a].name, "-", after[a].value, "new");
+            continue;
+        }
+        double change = old->value > 0 ? 100.0 * (after[a].value - old->value) / old->value : 0;
+        bool regressed = change > thresholdPercent;
+        regressions += regressed;
+        printf("%-16s %12.1f %12.1f %+7.1f%%%s\n", after[a].name, old->value, after[a].value, change, regressed ? " SLOWER" : "");
+    }
+    return regressions ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && strcmp(argv[1], "--compare") == 0)
+    {
+        return bench_compare(argv[2], argv[3], argc >= 5 ? atof(argv[4]) : BENCH_REGRESSION_PERCENT);
+    }
+    if (argc > 1)
+    {
+        fprintf(stderr, "usage: %s [--compare BEFORE AFTER [PERCENT]]\n", argv[0]);
+        return 2;
+    }
+    bench_inputs();
+    publish_policyInit(&benchPolicy);
+    bench_run();
+    return 0;
+}
+#endif
@@ -0,0 +1,151 @@
+#ifndef _GPS_TRACE_
+#define _GPS_TRACE_
+
+#include <stdint.h>
+
+/** Ten one second epochs of the receiver output at the station, both ways it can be set up.
+ * gpsTraceNmea is what a NEO-M8 sends with its default NMEA set (RMC, VTG, GGA, GSA, three GSV
+ * and GLL) and gpsTraceUbx the NAV-PVT frame for the same solution in GPS_UBX_MODE, so a replay
+ * of either through the receive path costs what a fix costs on the UART. The station cannot
+ * record the raw stream, capture.c keeps only the sentences the ISR queues, so the sentences
+ * were written out from the receiver description with the fields of a 3D fix at the station.
+ */
+#define GPS_TRACE_EPOCHS 10
+
+static const char *const gpsTraceNmea[GPS_TRACE_EPOCHS] = {
+    "$GPRMC,172814.00,A,4158.67280,N,09139.93840,W,0.012,,190626,,,A*65\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172814.00,4158.67280,N,09139.93840,W,1,08,0.92,250.3,M,-32.1,M,,*6A\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67280,N,09139.93840,W,172814.00,A,A*75\r\n",
+    "$GPRMC,172815.00,A,4158.67400,N,09139.93600,W,0.012,,190626,,,A*60\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172815.00,4158.67400,N,09139.93600,W,1,08,0.92,250.3,M,-32.1,M,,*6F\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67400,N,09139.93600,W,172815.00,A,A*70\r\n",
+    "$GPRMC,172816.00,A,4158.67520,N,09139.93360,W,0.012,,190626,,,A*63\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172816.00,4158.67520,N,09139.93360,W,1,08,0.92,250.3,M,-32.1,M,,*6C\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67520,N,09139.93360,W,172816.00,A,A*73\r\n",
+    "$GPRMC,172817.00,A,4158.67280,N,09139.93720,W,0.012,,190626,,,A*6F\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172817.00,4158.67280,N,09139.93720,W,1,08,0.92,250.3,M,-32.1,M,,*60\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67280,N,09139.93720,W,172817.00,A,A*7F\r\n",
+    "$GPRMC,172818.00,A,4158.67400,N,09139.93480,W,0.012,,190626,,,A*67\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172818.00,4158.67400,N,09139.93480,W,1,08,0.92,250.3,M,-32.1,M,,*68\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67400,N,09139.93480,W,172818.00,A,A*77\r\n",
+    "$GPRMC,172819.00,A,4158.67520,N,09139.93840,W,0.012,,190626,,,A*65\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172819.00,4158.67520,N,09139.93840,W,1,08,0.92,250.3,M,-32.1,M,,*6A\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67520,N,09139.93840,W,172819.00,A,A*75\r\n",
+    "$GPRMC,172820.00,A,4158.67280,N,09139.93600,W,0.012,,190626,,,A*68\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172820.00,4158.67280,N,09139.93600,W,1,08,0.92,250.3,M,-32.1,M,,*67\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67280,N,09139.93600,W,172820.00,A,A*78\r\n",
+    "$GPRMC,172821.00,A,4158.67400,N,09139.93360,W,0.012,,190626,,,A*64\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172821.00,4158.67400,N,09139.93360,W,1,08,0.92,250.3,M,-32.1,M,,*6B\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67400,N,09139.93360,W,172821.00,A,A*74\r\n",
+    "$GPRMC,172822.00,A,4158.67520,N,09139.93720,W,0.012,,190626,,,A*64\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172822.00,4158.67520,N,09139.93720,W,1,08,0.92,250.3,M,-32.1,M,,*6B\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67520,N,09139.93720,W,172822.00,A,A*74\r\n",
+    "$GPRMC,172823.00,A,4158.67280,N,09139.93480,W,0.012,,190626,,,A*61\r\n"
+    "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+    "$GPGGA,172823.00,4158.67280,N,09139.93480,W,1,08,0.92,250.3,M,-32.1,M,,*6E\r\n"
+    "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n"
+    "$GPGSV,3,1,10,01,62,287,43,03,41,058,38,06,18,144,31,11,71,202,45*7E\r\n"
+    "$GPGSV,3,2,10,14,27,315,33,17,35,092,36,19,12,255,24,22,54,021,40*79\r\n"
+    "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+    "$GPGLL,4158.67280,N,09139.93480,W,172823.00,A,A*71\r\n",
+};
+
+static const uint8_t gpsTraceUbx[GPS_TRACE_EPOCHS][100] = {
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0xB0, 0x1F, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x0E, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0xC9, 0xF7, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0xF0, 0xEE, 0x5C, 0xC9, 0xF0, 0x50, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD0, 0x1C},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x98, 0x23, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x0F, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0xDA, 0xF7, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0x80, 0xF0, 0x5C, 0xC9, 0xB8, 0x51, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x29, 0x4B},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x80, 0x27, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x10, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0xEB, 0xF7, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0x10, 0xF2, 0x5C, 0xC9, 0x80, 0x52, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x82, 0x7A},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x68, 0x2B, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x11, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0xFC, 0xF7, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0xB8, 0xEF, 0x5C, 0xC9, 0xF0, 0x50, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x93, 0xFD},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x50, 0x2F, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x12, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0x0D, 0xF8, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0x48, 0xF1, 0x5C, 0xC9, 0xB8, 0x51, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xED, 0x77},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x38, 0x33, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x13, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0x1E, 0xF8, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0xF0, 0xEE, 0x5C, 0xC9, 0x80, 0x52, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x59, 0xB7},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x20, 0x37, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x14, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0x2F, 0xF8, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0x80, 0xF0, 0x5C, 0xC9, 0xF0, 0x50, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x57, 0x29},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x08, 0x3B, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x15, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0x40, 0xF8, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0x10, 0xF2, 0x5C, 0xC9, 0xB8, 0x51, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xB0, 0x58},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0xF0, 0x3E, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x16, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0x51, 0xF8, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0xB8, 0xEF, 0x5C, 0xC9, 0x80, 0x52, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1B, 0x3D},
+    {0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0xD8, 0x42, 0x59, 0x18, 0xEA, 0x07, 0x06, 0x13, 0x11, 0x1C, 0x17, 0x37, 0x19, 0x00,
+     0x00, 0x00, 0x62, 0xF8, 0xFF, 0xFF, 0x03, 0x01, 0xEA, 0x08, 0x48, 0xF1, 0x5C, 0xC9, 0xF0, 0x50, 0x05, 0x19, 0x58, 0x54,
+     0x03, 0x00, 0xBC, 0xD1, 0x03, 0x00, 0x3A, 0x07, 0x00, 0x00, 0x46, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xB2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x19, 0xAF},
+};
+
+#endif // _GPS_TRACE_
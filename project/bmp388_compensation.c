@@ -0,0 +1,133 @@
+#include "bmp388_compensation.h"
+
+/** BMP388 compensation math.
+ * Both paths are reentrant. The coefficients are computed once when the trim is read
+ * and the linearized temperature is handed to the pressure compensation by the caller.
+ */
+
+void bmp388_floatCoefficients(const struct bmp388_trim_s *trim, struct bmp388_float_coefficients_s *coefficients)
+{
+    // the datasheet divides by powers of 2. These are exact as float constants so no powf is needed.
+    coefficients->param_T1 = (float)trim->param_T1 * 0x1p8f;
+    coefficients->param_T2 = (float)trim->param_T2 * 0x1p-30f;
+    coefficients->param_T3 = (float)trim->param_T3 * 0x1p-48f;
+    coefficients->param_P1 = ((float)trim->param_P1 - 0x1p14f) * 0x1p-20f;
+    coefficients->param_P2 = ((float)trim->param_P2 - 0x1p14f) * 0x1p-29f;
+    coefficients->param_P3 = (float)trim->param_P3 * 0x1p-32f;
+    coefficients->param_P4 = (float)trim->param_P4 * 0x1p-37f;
+    coefficients->param_P5 = (float)trim->param_P5 * 0x1p3f;
+    coefficients->param_P6 = (float)trim->param_P6 * 0x1p-6f;
+    coefficients->param_P7 = (float)trim->param_P7 * 0x1p-8f;
+    coefficients->param_P8 = (float)trim->param_P8 * 0x1p-15f;
+    coefficients->param_P9 = (float)trim->param_P9 * 0x1p-48f;
+    coefficients->param_P10 = (float)trim->param_P10 * 0x1p-48f;
+    coefficients->param_P11 = (float)trim->param_P11 * 0x1p-65f;
+}
+
+void bmp388_integerCoefficients(const struct bmp388_trim_s *trim, struct bmp388_integer_coefficients_s *coefficients)
+{
+    coefficients->t1 = (int64_t)trim->param_T1 * 256;
+    coefficients->t2 = (int64_t)trim->param_T2 * 262144;
+    coefficients->t3 = trim->param_T3;
+    coefficients->p1 = ((int64_t)trim->param_P1 - 16384) * 70368744177664;
+    coefficients->p2 = ((int64_t)trim->param_P2 - 16384) * 2097152;
+    coefficients->p3 = (int64_t)trim->param_P3 * 4;
+    coefficients->p4 = trim->param_P4;
+    coefficients->p5 = (int64_t)trim->param_P5 * 140737488355328;
+    coefficients->p6 = (int64_t)trim->param_P6 * 4194304;
+    coefficients->p7 = (int64_t)trim->param_P7 * 16;
+    coefficients->p8 = trim->param_P8;
+    coefficients->p9 = (int64_t)trim->param_P9 * 65536;
+    coefficients->p10 = trim->param_P10;
+    coefficients->p11 = trim->param_P11;
+}
+
+float bmp388_compensateTemperatureFloat(const struct bmp388_float_coefficients_s *coefficients, uint32_t temperature_raw)
+{
+    // use the datasheet compensation formula
+    float partial_data1;
+    float partial_data2;
+
+    partial_data1 = (float)temperature_raw - coefficients->param_T1;
+    partial_data2 = partial_data1 * coefficients->param_T2;
+    return partial_data2 + partial_data1 * partial_data1 * coefficients->param_T3;
+}
+
+float bmp388_compensatePressureFloat(const struct bmp388_float_coefficients_s *coefficients, uint32_t pressure_raw, float temperature)
+{
+    float pressure = (float)pressure_raw;
+    float temperature2 = temperature * temperature;
+    float temperature3 = temperature2 * temperature;
+    float partial_data1;
+    float partial_data2;
+    float partial_data3;
+    float partial_data4;
+    float partial_out1;
+    float partial_out2;
+
+    partial_data1 = coefficients->param_P6 * temperature;
+    partial_data2 = coefficients->param_P7 * temperature2;
+    partial_data3 = coefficients->param_P8 * temperature3;
+    partial_out1 = coefficients->param_P5 + partial_data1 + partial_data2 + partial_data3;
+
+    partial_data1 = coefficients->param_P2 * temperature;
+    partial_data2 = coefficients->param_P3 * temperature2;
+    partial_data3 = coefficients->param_P4 * temperature3;
+    partial_out2 = pressure * (coefficients->param_P1 + partial_data1 + partial_data2 + partial_data3);
+
+    partial_data1 = pressure * pressure;
+    partial_data2 = coefficients->param_P9 + coefficients->param_P10 * temperature;
+    partial_data3 = partial_data1 * partial_data2;
+    partial_data4 = partial_data3 + partial_data1 * pressure * coefficients->param_P11;
+
+    return partial_out1 + partial_out2 + partial_data4;
+}
+
+int64_t bmp388_compensateTemperatureInteger(const struct bmp388_integer_coefficients_s *coefficients, uint32_t temperature_raw, int64_t *t_lin)
+{
+    int64_t partial_data1;
+    int64_t partial_data2;
+    int64_t partial_data3;
+
+    partial_data1 = (int64_t)temperature_raw - coefficients->t1;
+    partial_data2 = coefficients->t2 * partial_data1;
+    partial_data3 = partial_data1 * partial_data1 * coefficients->t3;
+    *t_lin = (partial_data2 + partial_data3) / 4294967296;
+
+    return (*t_lin * 25) / 16384;
+}
+
+uint64_t bmp388_compensatePressureInteger(const struct bmp388_integer_coefficients_s *coefficients, uint32_t pressure_raw, int64_t t_lin)
+{
+    int64_t pressure = pressure_raw;
+    int64_t partial_data1;
+    int64_t partial_data2;
+    int64_t partial_data3;
+    int64_t partial_data4;
+    int64_t partial_data5;
+    int64_t offset;
+    int64_t sensitivity;
+
+    partial_data1 = t_lin * t_lin;
+    partial_data2 = partial_data1 / 64;
+    partial_data3 = (partial_data2 * t_lin) / 256;
+    partial_data4 = (coefficients->p8 * partial_data3) / 32;
+    partial_data5 = coefficients->p7 * partial_data1;
+    offset = coefficients->p5 + partial_data4 + partial_data5 + coefficients->p6 * t_lin;
+
+    partial_data2 = (coefficients->p4 * partial_data3) / 32;
+    partial_data4 = coefficients->p3 * partial_data1;
+    partial_data5 = coefficients->p2 * t_lin;
+    sensitivity = coefficients->p1 + partial_data2 + partial_data4 + partial_data5;
+
+    partial_data1 = (sensitivity / 16777216) * pressure;
+    partial_data3 = coefficients->p10 * t_lin + coefficients->p9;
+    partial_data4 = (partial_data3 * pressure) / 8192;
+    // dividing by 10 and multiplying by 10 again avoids overflowing pressure * partial_data4
+    partial_data5 = ((pressure * (partial_data4 / 10)) / 512) * 10;
+    partial_data2 = (coefficients->p11 * (pressure * pressure)) / 65536;
+    partial_data3 = (partial_data2 * pressure) / 128;
+    partial_data4 = (offset / 4) + partial_data1 + partial_data5 + partial_data3;
+
+    return ((uint64_t)partial_data4 * 25) / 1099511627776ULL;
+}
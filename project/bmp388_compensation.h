@@ -0,0 +1,79 @@
+#ifndef _BMP388_COMPENSATION_
+#define _BMP388_COMPENSATION_
+
+#include <stdint.h>
+
+/** The BMP388 compensation trim parameters exactly as they are stored in the NVM (datasheet 3.11.1) */
+struct bmp388_trim_s
+{
+    uint16_t param_T1;
+    uint16_t param_T2;
+    int8_t param_T3;
+    int16_t param_P1;
+    int16_t param_P2;
+    int8_t param_P3;
+    int8_t param_P4;
+    uint16_t param_P5;
+    uint16_t param_P6;
+    int8_t param_P7;
+    int8_t param_P8;
+    int16_t param_P9;
+    int8_t param_P10;
+    int8_t param_P11;
+} __attribute__((packed));
+
+/** floating point trim coefficients (datasheet 8.4) */
+struct bmp388_float_coefficients_s
+{
+    float param_T1;
+    float param_T2;
+    float param_T3;
+    float param_P1;
+    float param_P2;
+    float param_P3;
+    float param_P4;
+    float param_P5;
+    float param_P6;
+    float param_P7;
+    float param_P8;
+    float param_P9;
+    float param_P10;
+    float param_P11;
+};
+
+/** integer trim coefficients for the 64 bit compensation (BMP3 reference driver)
+ * Every constant multiplier that the reference code applies to a trim value is
+ * folded in here once so the per-sample path is only the data dependent math.
+ */
+struct bmp388_integer_coefficients_s
+{
+    int64_t t1; // par_t1 * 2^8
+    int64_t t2; // par_t2 * 2^18
+    int64_t t3;
+    int64_t p1; // (par_p1 - 2^14) * 2^46
+    int64_t p2; // (par_p2 - 2^14) * 2^21
+    int64_t p3; // par_p3 * 2^2
+    int64_t p4;
+    int64_t p5; // par_p5 * 2^47
+    int64_t p6; // par_p6 * 2^22
+    int64_t p7; // par_p7 * 2^4
+    int64_t p8;
+    int64_t p9; // par_p9 * 2^16
+    int64_t p10;
+    int64_t p11;
+};
+
+void bmp388_floatCoefficients(const struct bmp388_trim_s *trim, struct bmp388_float_coefficients_s *coefficients);
+void bmp388_integerCoefficients(const struct bmp388_trim_s *trim, struct bmp388_integer_coefficients_s *coefficients);
+
+/** returns the temperature in C. This is also the linearized temperature needed for the pressure */
+float bmp388_compensateTemperatureFloat(const struct bmp388_float_coefficients_s *coefficients, uint32_t temperature_raw);
+/** returns the pressure in Pa */
+float bmp388_compensatePressureFloat(const struct bmp388_float_coefficients_s *coefficients, uint32_t pressure_raw, float temperature);
+
+/** returns the temperature in 0.01C and the linearized temperature for the pressure in t_lin */
+int64_t bmp388_compensateTemperatureInteger(const struct bmp388_integer_coefficients_s *coefficients, uint32_t temperature_raw, int64_t *t_lin);
+/** returns the pressure in 0.01Pa */
+uint64_t bmp388_compensatePressureInteger(const struct bmp388_integer_coefficients_s *coefficients, uint32_t pressure_raw, int64_t t_lin);
+
+#endif // _BMP388_COMPENSATION_
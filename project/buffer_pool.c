@@ -0,0 +1,88 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "buffer_pool.h"
+#include "log.h"
+
+/** the blocks are few and taken a few times a report, a search for a free one is cheap */
+static struct pool_block_s blocks[POOL_BLOCKS];
+static struct pool_stats_s poolStats;
+
+struct pool_block_s *pool_alloc(void)
+{
+    struct pool_block_s *block = NULL;
+    taskENTER_CRITICAL();
+    for (int i = 0; i < POOL_BLOCKS; i++)
+    {
+        if (blocks[i].references == 0)
+        {
+            block = &blocks[i];
+            block->references = 1;
+            break;
+        }
+    }
+    if (block != NULL)
+    {
+        poolStats.allocations++;
+        if (++poolStats.used > poolStats.highWater)
+            poolStats.highWater = poolStats.used;
+    }
+    else
+    {
+        poolStats.failures++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (block == NULL)
+    {
+        LOG_WARN("Buffer pool empty");
+        return NULL;
+    }
+    block->length = 0;
+    block->data[0] = 0;
+    return block;
+}
+
+void pool_retain(struct pool_block_s *block)
+{
+    taskENTER_CRITICAL();
+    configASSERT(block->references > 0);
+    block->references++;
+    taskEXIT_CRITICAL();
+}
+
+void pool_release(struct pool_block_s *block)
+{
+    taskENTER_CRITICAL();
+    configASSERT(block->references > 0);
+    if (--block->references == 0)
+        poolStats.used--;
+    taskEXIT_CRITICAL();
+}
+
+char *pool_prepend(struct pool_block_s *block, const char *prefix, size_t length)
+{
+    if (length > POOL_HEADROOM)
+        return NULL;
+    char *start = block->data - length;
+    memcpy(start, prefix, length);
+    return start;
+}
+
+void pool_getStats(struct pool_stats_s *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = poolStats;
+    taskEXIT_CRITICAL();
+}
+
+void pool_print(void)
+{
+    struct pool_stats_s stats;
+    pool_getStats(&stats);
+    printf("%u blocks of %u bytes, %u used, high water %u\n", POOL_BLOCKS, POOL_BLOCK_SIZE, stats.used, stats.highWater);
+    printf("%lu allocations, %lu failures\n", (unsigned long)stats.allocations, (unsigned long)stats.failures);
+}
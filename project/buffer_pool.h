@@ -0,0 +1,50 @@
+#ifndef _BUFFER_POOL_
+#define _BUFFER_POOL_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Fixed size blocks for outbound messages, shared by reference count.
+ * The reporter or an alert formats a message straight into a block, the publish queue keeps
+ * a reference for each topic it goes to and the ExpressLink writes its AT+SEND command into
+ * the headroom in front of the message, so the UART is fed from the block the message was
+ * formatted in. Whoever holds a reference may read the block. The message is not changed once
+ * it is queued, the headroom belongs to the one task that sends.
+ * At most 12 blocks are held at once: one in each of the 8 publish slots, one a send still
+ * holds after a newer message evicted it from its slot, the report being formatted and two
+ * alerts.
+ */
+#define POOL_BLOCK_SIZE 1024 // the raw report with a GPS position and the ISR maxima is close to 960
+#define POOL_HEADROOM 12     // "AT+SEND4 " and to spare
+#define POOL_BLOCKS 12       // the most held at once
+
+struct pool_block_s
+{
+    char headroom[POOL_HEADROOM];
+    char data[POOL_BLOCK_SIZE]; // the message, 0 terminated
+    uint16_t length;            // of the message, set by whoever formats it
+    uint8_t references;
+};
+
+struct pool_stats_s
+{
+    uint32_t allocations;
+    uint32_t failures; // no block was free
+    uint16_t used;
+    uint16_t highWater; // the most blocks used at once since boot
+};
+
+/** a block with one reference and an empty message, or NULL when all are used */
+struct pool_block_s *pool_alloc(void);
+void pool_retain(struct pool_block_s *block);
+/** the last release frees the block */
+void pool_release(struct pool_block_s *block);
+/** put length bytes in front of the message and return where they start, the message is not
+ * moved. NULL if they do not fit the headroom
+ */
+char *pool_prepend(struct pool_block_s *block, const char *prefix, size_t length);
+void pool_getStats(struct pool_stats_s *stats);
+/** the stats as console text */
+void pool_print(void);
+
+#endif // _BUFFER_POOL_
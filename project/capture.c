@@ -0,0 +1,480 @@
+#include "capture.h"
+
+#include <string.h>
+
+int capture_nmeaFind(const struct capture_nmea_history_s *history, const char *sentence, size_t length)
+{
+    if (length < 6 || length >= CAPTURE_NMEA_LENGTH) // too short for a type, or too long to be remembered
+        return -1;
+    for (int slot = 0; slot < CAPTURE_NMEA_TYPES; slot++)
+    {
+        if (history->length[slot] && memcmp(history->sentence[slot] + 3, sentence + 3, 3) == 0) // $ttsss
+            return slot;
+    }
+    return -1;
+}
+
+void capture_nmeaRemember(struct capture_nmea_history_s *history, int slot, const char *sentence, size_t length)
+{
+    if (length >= CAPTURE_NMEA_LENGTH || length < 6)
+        return;
+    if (slot < 0)
+    {
+        slot = history->next;
+        history->next = (history->next + 1) % CAPTURE_NMEA_TYPES;
+    }
+    memcpy(history->sentence[slot], sentence, length);
+    history->length[slot] = length;
+}
+
+#if CAPTURE_MODE
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdio.h>
+
+#include "pico/stdio.h"
+#include "kernel_objects.h"
+#if CAPTURE_MODE == CAPTURE_FLASH
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "pico/flash.h"
+#endif
+
+#define CAPTURE_PRIORITY 1
+#define CAPTURE_RING_SIZE 4096 // a report's AT+SEND plus a few seconds of NMEA
+#define CAPTURE_DRAIN_MS 500
+#define CAPTURE_FLASH_FLUSH_MS 10000 // program a partly filled page this often, the most a power cut loses
+
+/** the region ends below the sector gps_site.c keeps the site in */
+#ifndef CAPTURE_FLASH_SIZE
+#define CAPTURE_FLASH_SIZE (1024 * 1024)
+#endif
+#define CAPTURE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE - CAPTURE_FLASH_SIZE)
+#define CAPTURE_FLASH_TIMEOUT_MS 100
+
+static uint8_t ring[CAPTURE_RING_SIZE];
+static uint32_t ringHead; // free running, written under the critical section
+static uint32_t ringTail; // only the drain task moves this
+static TickType_t lastTick;
+static uint32_t pendingLost;
+static uint32_t lastPioWord[CAPTURE_PIO_SOURCES];
+static struct capture_nmea_history_s nmeaHistory;
+static struct capture_stats_s captureStats;
+
+static size_t putVarint(uint8_t *out, uint32_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+static void ringWrite(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        ring[ringHead++ % CAPTURE_RING_SIZE] = data[i];
+    }
+}
+
+/** append one record. Called in a critical section so the tick and the order agree. Returns false
+ * when the ring had no room and the record was counted lost
+ */
+static bool capture_put(TickType_t tick, uint8_t type, const uint8_t *fields, size_t fieldsLength, const uint8_t *data, size_t length)
+{
+    uint8_t header[1 + 5];
+    size_t free = CAPTURE_RING_SIZE - (ringHead - ringTail);
+    size_t needed = sizeof(header) + fieldsLength + length;
+    if (pendingLost)
+        needed += 2 * sizeof(header);
+    if (needed > free)
+    {
+        pendingLost++;
+        captureStats.lost++;
+        return false;
+    }
+    if (pendingLost)
+    {
+        uint8_t count[5];
+        header[0] = CAPTURE_LOST;
+        ringWrite(header, 1 + putVarint(header + 1, tick - lastTick));
+        ringWrite(count, putVarint(count, pendingLost));
+        lastTick = tick;
+        pendingLost = 0;
+    }
+    header[0] = type;
+    size_t headerLength = 1 + putVarint(header + 1, tick - lastTick);
+    lastTick = tick;
+    ringWrite(header, headerLength);
+    ringWrite(fields, fieldsLength);
+    ringWrite(data, length);
+    captureStats.records++;
+    captureStats.bytes += headerLength + fieldsLength + length;
+    return true;
+}
+
+static void capture_record(uint8_t type, const uint8_t *fields, size_t fieldsLength, const uint8_t *data, size_t length)
+{
+    taskENTER_CRITICAL();
+    capture_put(xTaskGetTickCount(), type, fields, fieldsLength, data, length);
+    taskEXIT_CRITICAL();
+}
+
+static bool capture_recordFromISR(uint8_t type, const uint8_t *fields, size_t fieldsLength, const uint8_t *data, size_t length)
+{
+    UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+    bool written = capture_put(xTaskGetTickCountFromISR(), type, fields, fieldsLength, data, length);
+    taskEXIT_CRITICAL_FROM_ISR(state);
+    return written;
+}
+
+void capture_pioFromISR(enum capture_pio_e source, uint32_t word)
+{
+    uint8_t fields[5];
+    // the counters only go up so the change is a byte or two. PPS counts are about 2^26 apart
+    int32_t change = (int32_t)(word - lastPioWord[source]);
+    uint32_t zigzag = ((uint32_t)change << 1) ^ (uint32_t)(change >> 31);
+    // the replay only sees the words that were written, the next change is against the last of those
+    if (capture_recordFromISR(CAPTURE_PIO | (source << 4), fields, putVarint(fields, zigzag), NULL, 0))
+        lastPioWord[source] = word;
+}
+
+/** runs of (unchanged, changed, bytes) against the last sentence of the same type and length,
+ * the history slot it is in goes in the record source.
+ * A fixed station repeats most of every sentence, so this is about a third of the text.
+ */
+static size_t nmeaDelta(const char *previous, const char *sentence, size_t length, uint8_t *out, size_t outLength)
+{
+    size_t used = 0;
+    size_t i = 0;
+    while (i < length)
+    {
+        size_t same = 0;
+        while (i + same < length && sentence[i + same] == previous[i + same])
+            same++;
+        size_t changed = 0;
+        while (i + same + changed < length && sentence[i + same + changed] != previous[i + same + changed])
+            changed++;
+        if (used + 4 + changed > outLength)
+            return 0;
+        used += putVarint(out + used, same);
+        used += putVarint(out + used, changed);
+        memcpy(out + used, sentence + i + same, changed);
+        used += changed;
+        i += same + changed;
+    }
+    return used;
+}
+
+void capture_nmeaFromISR(const char *sentence, size_t length)
+{
+    uint8_t fields[5 + CAPTURE_NMEA_LENGTH];
+    size_t fieldsLength = putVarint(fields, length);
+    int slot = capture_nmeaFind(&nmeaHistory, sentence, length);
+    size_t deltaLength = 0;
+    if (slot >= 0 && nmeaHistory.length[slot] == length)
+        deltaLength = nmeaDelta(nmeaHistory.sentence[slot], sentence, length, fields + fieldsLength, length);
+    bool written;
+    if (deltaLength)
+        written = capture_recordFromISR(CAPTURE_NMEA | ((1 + slot) << 4), fields, fieldsLength + deltaLength, NULL, 0);
+    else
+        written = capture_recordFromISR(CAPTURE_NMEA, fields, fieldsLength, (const uint8_t *)sentence, length);
+    // as for the PIO words, the history only keeps what the replay will see
+    if (written)
+        capture_nmeaRemember(&nmeaHistory, slot, sentence, length);
+}
+
+void capture_gpioFromISR(unsigned int gpio, uint32_t events)
+{
+    uint8_t fields[2] = {gpio, events};
+    capture_recordFromISR(CAPTURE_GPIO, fields, sizeof(fields), NULL, 0);
+}
+
+void capture_adc(unsigned int channel, uint32_t sum)
+{
+    uint8_t fields[5];
+    capture_record(CAPTURE_ADC | (channel << 4), fields, putVarint(fields, sum), NULL, 0);
+}
+
+void capture_i2c(uint8_t address, uint8_t reg, const uint8_t *data, size_t length)
+{
+    uint8_t fields[2 + 5] = {address, reg};
+    capture_record(CAPTURE_I2C, fields, 2 + putVarint(fields + 2, length), data, length);
+}
+
+void capture_expresslink(bool command, const char *line, size_t length)
+{
+    uint8_t fields[5];
+    capture_record(command ? CAPTURE_EL_COMMAND : CAPTURE_EL_RESPONSE, fields, putVarint(fields, length), (const uint8_t *)line, length);
+}
+
+void capture_random(uint32_t value)
+{
+    uint8_t fields[5];
+    capture_record(CAPTURE_RANDOM, fields, putVarint(fields, value), NULL, 0);
+}
+
+void capture_getStats(struct capture_stats_s *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = captureStats;
+    taskEXIT_CRITICAL();
+}
+
+/** copy up to length bytes out of the ring */
+static size_t ringRead(uint8_t *out, size_t length)
+{
+    taskENTER_CRITICAL();
+    size_t available = ringHead - ringTail;
+    taskEXIT_CRITICAL();
+    if (length > available)
+        length = available;
+    for (size_t i = 0; i < length; i++)
+    {
+        out[i] = ring[(ringTail + i) % CAPTURE_RING_SIZE];
+    }
+    taskENTER_CRITICAL();
+    ringTail += length;
+    taskEXIT_CRITICAL();
+    return length;
+}
+
+#if CAPTURE_MODE == CAPTURE_USB
+static uint8_t frame[CAPTURE_FRAME_MAX];
+
+static void capture_drain(void)
+{
+    size_t length;
+    while ((length = ringRead(frame + 4, sizeof(frame) - 5)) > 0)
+    {
+        uint8_t sum = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            sum += frame[4 + i];
+        }
+        frame[0] = CAPTURE_FRAME_START;
+        frame[1] = 'W';
+        frame[2] = length & 0xFF;
+        frame[3] = length >> 8;
+        frame[4 + length] = sum;
+        // one write holds the stdio mutex so printf from other tasks cannot split a frame
+        stdio_put_string((const char *)frame, 5 + length, false, false);
+        captureStats.written += length;
+    }
+}
+
+static uint32_t capture_sessionStart(void)
+{
+    return 0;
+}
+
+static void capture_sinkStart(void)
+{
+}
+#else
+/** Sessions are appended after the newest one in the region. At the end of the region a
+ * session goes on at its start, over the older sessions, and stops when the next sector to
+ * erase is the one it started in. The sector after the one being written is kept erased, so
+ * the newest session always ends at a blank page. Read the region back with picotool save -r.
+ */
+static uint8_t page[CAPTURE_PAGE_SIZE];
+static size_t pageFill;       // bytes in the page buffer
+static size_t pageProgrammed; // bytes of those already in flash
+static uint32_t pageOffset;   // flash offset of the page being filled
+static uint32_t sessionSector; // flash offset of the sector this session started in
+static bool regionFull;
+
+#define CAPTURE_FLASH_END (CAPTURE_FLASH_OFFSET + CAPTURE_FLASH_SIZE)
+
+/** the flash offset step bytes after offset, wrapping to the start of the region */
+static uint32_t regionAdvance(uint32_t offset, uint32_t step)
+{
+    offset += step;
+    return offset >= CAPTURE_FLASH_END ? offset - CAPTURE_FLASH_SIZE : offset;
+}
+
+struct capture_program_s
+{
+    uint32_t offset;
+    const uint8_t *data; // NULL erases the sector
+};
+
+static void capture_flashProgram(void *parameter)
+{
+    const struct capture_program_s *program = parameter;
+    if (program->data == NULL)
+        flash_range_erase(program->offset, FLASH_SECTOR_SIZE);
+    else
+        flash_range_program(program->offset, program->data, FLASH_PAGE_SIZE);
+}
+
+static const uint8_t *flashAt(uint32_t offset)
+{
+    return (const uint8_t *)(XIP_BASE + offset);
+}
+
+static bool blank(uint32_t offset, size_t length)
+{
+    const uint8_t *bytes = flashAt(offset);
+    for (size_t i = 0; i < length; i++)
+    {
+        if (bytes[i] != 0xFF)
+            return false;
+    }
+    return true;
+}
+
+/** erase from offset to the end of its sector, if there is anything there */
+static void capture_eraseSector(uint32_t offset)
+{
+    uint32_t sector = offset - offset % FLASH_SECTOR_SIZE;
+    if (offset >= CAPTURE_FLASH_END || blank(offset, sector + FLASH_SECTOR_SIZE - offset))
+        return;
+    struct capture_program_s erase = {sector, NULL};
+    flash_safe_execute(capture_flashProgram, &erase, CAPTURE_FLASH_TIMEOUT_MS);
+}
+
+/** program the bytes added since the last write. Flash only clears bits so the bytes already
+ * programmed are sent as 0xFF and left as they are
+ */
+static void capture_flushPage(void)
+{
+    static uint8_t program[CAPTURE_PAGE_SIZE];
+    if (regionFull || pageFill == pageProgrammed)
+        return;
+    memset(program, 0xFF, sizeof(program));
+    memcpy(program + pageProgrammed, page + pageProgrammed, pageFill - pageProgrammed);
+    struct capture_program_s write = {pageOffset, program};
+    if (flash_safe_execute(capture_flashProgram, &write, CAPTURE_FLASH_TIMEOUT_MS) != PICO_OK)
+        return; // try again on the next flush
+    captureStats.written += pageFill - pageProgrammed;
+    pageProgrammed = pageFill;
+    if (pageFill < CAPTURE_PAGE_SIZE)
+        return;
+
+    pageOffset = regionAdvance(pageOffset, CAPTURE_PAGE_SIZE);
+    pageFill = pageProgrammed = 0;
+    if (pageOffset % FLASH_SECTOR_SIZE == 0)
+    {
+        uint32_t ahead = regionAdvance(pageOffset, FLASH_SECTOR_SIZE);
+        if (ahead == sessionSector)
+        {
+            // this session has been over the whole region, keep its start
+            regionFull = true;
+            captureStats.full++;
+            puts("capture: flash region full, capture stopped");
+        }
+        else
+        {
+            capture_eraseSector(ahead);
+        }
+    }
+}
+
+static void capture_drain(void)
+{
+    static TickType_t lastFlush;
+    size_t length;
+    while (!regionFull && (length = ringRead(page + pageFill, CAPTURE_PAGE_SIZE - pageFill)) > 0)
+    {
+        pageFill += length;
+        if (pageFill == CAPTURE_PAGE_SIZE)
+            capture_flushPage();
+    }
+    if (regionFull)
+    {
+        uint8_t discard[64];
+        while (ringRead(discard, sizeof(discard)))
+            ;
+        return;
+    }
+    if (xTaskGetTickCount() - lastFlush >= pdMS_TO_TICKS(CAPTURE_FLASH_FLUSH_MS))
+    {
+        lastFlush = xTaskGetTickCount();
+        capture_flushPage();
+    }
+}
+
+/** the number of a session that starts on this page, or 0 */
+static uint32_t sessionAt(uint32_t offset)
+{
+    const uint8_t *bytes = flashAt(offset);
+    size_t i = 1;
+    while (i < 6 && (bytes[i] & 0x80)) // the tick delta
+        i++;
+    i++;
+    if (bytes[0] != CAPTURE_SESSION || memcmp(bytes + i, CAPTURE_MAGIC, 5) != 0 || bytes[i + 5] != CAPTURE_VERSION)
+        return 0;
+    i += 5 + 1;
+    uint32_t sequence = 0;
+    for (int shift = 0; shift < 35; shift += 7, i++)
+    {
+        sequence |= (uint32_t)(bytes[i] & 0x7F) << shift;
+        if (!(bytes[i] & 0x80))
+            break;
+    }
+    return sequence;
+}
+
+/** start at the blank page after the newest session, numbering this one after it */
+static uint32_t capture_sessionStart(void)
+{
+    uint32_t newest = 0;
+    uint32_t newestOffset = CAPTURE_FLASH_OFFSET;
+    for (uint32_t offset = CAPTURE_FLASH_OFFSET; offset < CAPTURE_FLASH_END; offset += CAPTURE_PAGE_SIZE)
+    {
+        uint32_t sequence = sessionAt(offset);
+        if (sequence > newest)
+        {
+            newest = sequence;
+            newestOffset = offset;
+        }
+    }
+    // the newest session may have wrapped, it ends at the first blank page after its start
+    pageOffset = newestOffset;
+    for (uint32_t pages = 0; newest && pages < CAPTURE_FLASH_SIZE / CAPTURE_PAGE_SIZE && !blank(pageOffset, CAPTURE_PAGE_SIZE); pages++)
+        pageOffset = regionAdvance(pageOffset, CAPTURE_PAGE_SIZE);
+    sessionSector = pageOffset - pageOffset % FLASH_SECTOR_SIZE;
+    printf("capture: session %lu at flash offset 0x%lx\n", (unsigned long)newest + 1, (unsigned long)pageOffset);
+    return newest + 1;
+}
+
+/** flash can only be erased once the scheduler can park the other core */
+static void capture_sinkStart(void)
+{
+    capture_eraseSector(pageOffset);
+    capture_eraseSector(regionAdvance(sessionSector, FLASH_SECTOR_SIZE));
+}
+#endif
+
+static void capture_task(void *parameter)
+{
+    capture_sinkStart();
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(CAPTURE_DRAIN_MS));
+        capture_drain();
+    }
+}
+
+/** before the tasks start so the session record is the first in the ring */
+static StackType_t captureStack[KERNEL_STACK(CAPTURE_STACK_WORDS)];
+static StaticTask_t captureTaskBuffer;
+
+void init_capture(void)
+{
+    uint8_t fields[5 + 1 + 5 + 5];
+    memcpy(fields, CAPTURE_MAGIC, 5);
+    fields[5] = CAPTURE_VERSION;
+    size_t length = 6 + putVarint(fields + 6, capture_sessionStart());
+    length += putVarint(fields + length, configTICK_RATE_HZ);
+    capture_record(CAPTURE_SESSION, fields, length, NULL, 0);
+
+    kernel_createTask(capture_task, "Capture", captureStack, KERNEL_WORDS(captureStack), NULL, CAPTURE_PRIORITY, &captureTaskBuffer);
+}
+#endif // CAPTURE_MODE
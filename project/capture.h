@@ -0,0 +1,106 @@
+#ifndef _CAPTURE_
+#define _CAPTURE_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Raw input capture for replaying a field station on the host (sim --replay).
+ * Each input is recorded where the firmware first sees it, with the tick it arrived on.
+ * Records go into a RAM ring from tasks and ISRs and a low priority task drains the ring
+ * to USB or to a flash region, so a capture can be left running alongside normal operation.
+ *
+ * The stream is a sequence of records:
+ *   byte     type in the low nibble, source in the high nibble
+ *   varint   ticks since the previous record
+ *   payload  by type, below
+ * varints are LEB128, 7 bits a byte low first. A 0xFF type byte pads to the next
+ * CAPTURE_PAGE_SIZE boundary, a page starting with 0xFF ends the stream.
+ *
+ * Over USB the stream is cut into frames mixed with the console text:
+ *   CAPTURE_FRAME_START 'W' length-lo length-hi data sum-of-data-bytes
+ */
+#ifndef CAPTURE_MODE
+#define CAPTURE_MODE 0 // CAPTURE_USB or CAPTURE_FLASH records the raw inputs for replay
+#endif
+#define CAPTURE_OFF 0
+#define CAPTURE_USB 1
+#define CAPTURE_FLASH 2
+
+#define CAPTURE_VERSION 1
+#define CAPTURE_MAGIC "WXCAP"
+#define CAPTURE_PAGE_SIZE 256 // FLASH_PAGE_SIZE
+#define CAPTURE_FRAME_START 0x1E
+#define CAPTURE_FRAME_MAX 512
+
+enum capture_type_e
+{
+    CAPTURE_SESSION,     // CAPTURE_MAGIC, version byte. The tick delta is the tick at boot
+    CAPTURE_PIO,         // source capture_pio_e, zigzag varint change from the last word of that source
+    CAPTURE_ADC,         // source is the channel, varint sum of the 256 samples convertPin adds up
+    CAPTURE_NMEA,        // varint length, then the text for source 0 or a delta against history slot source - 1
+    CAPTURE_I2C,         // address, register, varint length, data
+    CAPTURE_EL_RESPONSE, // varint length, a line the ExpressLink sent without the \r\n
+    CAPTURE_EL_COMMAND,  // varint length, a line sent to the ExpressLink. Checked, not replayed
+    CAPTURE_GPIO,        // gpio, event mask of an edge interrupt
+    CAPTURE_RANDOM,      // varint get_rand_32 value
+    CAPTURE_LOST,        // varint records dropped because the ring was full
+    CAPTURE_PAD = 0x0F,
+};
+
+enum capture_pio_e
+{
+    CAPTURE_PIO_WIND,
+    CAPTURE_PIO_RAIN,
+    CAPTURE_PIO_PPS,
+    CAPTURE_PIO_SOURCES,
+};
+
+struct capture_stats_s
+{
+    uint32_t records;
+    uint32_t bytes;
+    uint32_t lost;    // ring full
+    uint32_t written; // bytes out of the ring to USB or flash
+    uint32_t full;    // flash region full, capture stopped
+};
+
+#if CAPTURE_MODE
+void init_capture(void);
+void capture_pioFromISR(enum capture_pio_e source, uint32_t word);
+void capture_nmeaFromISR(const char *sentence, size_t length);
+void capture_gpioFromISR(unsigned int gpio, uint32_t events);
+void capture_adc(unsigned int channel, uint32_t sum);
+void capture_i2c(uint8_t address, uint8_t reg, const uint8_t *data, size_t length);
+void capture_expresslink(bool command, const char *line, size_t length);
+void capture_random(uint32_t value);
+void capture_getStats(struct capture_stats_s *stats);
+#else
+#define init_capture()
+#define capture_pioFromISR(source, word)
+#define capture_nmeaFromISR(sentence, length)
+#define capture_gpioFromISR(gpio, events)
+#define capture_adc(channel, sum)
+#define capture_i2c(address, reg, data, length)
+#define capture_expresslink(command, line, length)
+#define capture_random(value)
+#endif
+
+/** the NMEA history, shared with the replay decoder. A sentence with the same type and length
+ * as the last one of its type is sent as runs of (varint unchanged, varint changed, bytes)
+ */
+#define CAPTURE_NMEA_TYPES 4
+#define CAPTURE_NMEA_LENGTH 83
+
+struct capture_nmea_history_s
+{
+    char sentence[CAPTURE_NMEA_TYPES][CAPTURE_NMEA_LENGTH];
+    uint8_t length[CAPTURE_NMEA_TYPES];
+    uint8_t next;
+};
+
+/** the slot holding the last sentence of this type, or -1 */
+int capture_nmeaFind(const struct capture_nmea_history_s *history, const char *sentence, size_t length);
+void capture_nmeaRemember(struct capture_nmea_history_s *history, int slot, const char *sentence, size_t length);
+
+#endif // _CAPTURE_
@@ -0,0 +1,126 @@
+#include "connection_manager.h"
+
+#include <string.h>
+
+static uint32_t nextRandom(struct connection_manager_s *manager)
+{
+    uint32_t x = manager->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    manager->random = x;
+    return x;
+}
+
+/** exponential in the failures, then somewhere in the upper half so stations that lost
+ * the network together do not all come back at once
+ */
+static uint32_t backoffMs(struct connection_manager_s *manager)
+{
+    uint32_t delay = CONNECTION_BACKOFF_MAX_MS;
+    if (manager->failures <= 16)
+    {
+        uint64_t exponential = (uint64_t)CONNECTION_BACKOFF_MS << (manager->failures - 1);
+        if (exponential < CONNECTION_BACKOFF_MAX_MS)
+            delay = exponential;
+    }
+    return delay / 2 + nextRandom(manager) % (delay / 2 + 1);
+}
+
+void connection_managerInit(struct connection_manager_s *manager, uint32_t seed)
+{
+    memset(manager, 0, sizeof(*manager));
+    manager->state = CONNECTION_DOWN;
+    manager->random = seed ? seed : 1;
+}
+
+enum connection_action_e connection_managerNext(struct connection_manager_s *manager, int64_t nowMs, uint32_t *waitMs)
+{
+    switch (manager->state)
+    {
+    case CONNECTION_UP:
+        if (nowMs - manager->lastAliveMs < CONNECTION_IDLE_PROBE_MS)
+            return CONNECTION_READY;
+        return CONNECTION_PROBE;
+    case CONNECTION_SUSPECT:
+        return CONNECTION_PROBE;
+    case CONNECTION_DOWN:
+    default:
+        if (nowMs < manager->nextAttemptMs)
+        {
+            *waitMs = manager->nextAttemptMs - nowMs;
+            return CONNECTION_WAIT;
+        }
+        if (manager->attemptsSinceReset >= CONNECTION_RESET_ATTEMPTS)
+            return CONNECTION_RESET;
+        return CONNECTION_ATTACH;
+    }
+}
+
+void connection_managerResult(struct connection_manager_s *manager, enum connection_action_e action, bool connected, int64_t nowMs)
+{
+    switch (action)
+    {
+    case CONNECTION_PROBE:
+        manager->stats.probes++;
+        if (connected)
+        {
+            connection_managerAlive(manager, nowMs);
+        }
+        else
+        {
+            // attach at once, the backoff only starts when that fails
+            manager->stats.drops++;
+            manager->state = CONNECTION_DOWN;
+            manager->nextAttemptMs = nowMs;
+        }
+        break;
+    case CONNECTION_RESET:
+        manager->stats.resets++;
+        manager->attemptsSinceReset = 0;
+        // fall through, a reset is followed by an attach
+    case CONNECTION_ATTACH:
+        manager->stats.attaches++;
+        manager->attemptsSinceReset++;
+        if (connected)
+        {
+            manager->failures = 0;
+            manager->attemptsSinceReset = 0;
+            connection_managerAlive(manager, nowMs);
+        }
+        else
+        {
+            manager->stats.failedAttaches++;
+            manager->failures++;
+            manager->state = CONNECTION_DOWN;
+            manager->nextAttemptMs = nowMs + backoffMs(manager);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void connection_managerAlive(struct connection_manager_s *manager, int64_t nowMs)
+{
+    manager->state = CONNECTION_UP;
+    manager->lastAliveMs = nowMs;
+}
+
+void connection_managerSuspect(struct connection_manager_s *manager)
+{
+    if (manager->state == CONNECTION_UP)
+        manager->state = CONNECTION_SUSPECT;
+}
+
+void connection_managerOffline(struct connection_manager_s *manager)
+{
+    manager->state = CONNECTION_DOWN;
+    manager->nextAttemptMs = 0;
+}
+
+const char *connection_stateName(enum connection_state_e state)
+{
+    static const char *const names[] = {"down", "up", "suspect"};
+    return state <= CONNECTION_SUSPECT ? names[state] : "unknown";
+}
@@ -0,0 +1,72 @@
+#ifndef _CONNECTION_MANAGER_
+#define _CONNECTION_MANAGER_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Decides when the ExpressLink link is probed, attached or reset.
+ * A successful publish proves the link is up, so it is only probed after an idle period
+ * or a failed send. Failed attaches back off exponentially with jitter so a dead network
+ * does not burn cellular attach attempts.
+ * expresslink.c runs the commands it asks for and passes in the time, test_connection_manager
+ * drives it against a fake modem instead.
+ */
+#ifndef CONNECTION_IDLE_PROBE_MS
+#define CONNECTION_IDLE_PROBE_MS (15 * 60000) // probe with AT+CONNECT? after this long without proof of life
+#endif
+#define CONNECTION_BACKOFF_MS 10000           // the first retry after a failed attach
+#define CONNECTION_BACKOFF_MAX_MS (10 * 60000)
+#define CONNECTION_RESET_ATTEMPTS 4           // failed attaches before the module is reset
+
+enum connection_state_e
+{
+    CONNECTION_DOWN,    // attaching when the backoff allows
+    CONNECTION_UP,      // seen alive recently
+    CONNECTION_SUSPECT, // a send failed, probe before trusting the link
+};
+
+enum connection_action_e
+{
+    CONNECTION_READY,  // publish
+    CONNECTION_WAIT,   // backing off, nothing to do until waitMs has passed
+    CONNECTION_PROBE,  // ask the module whether it is connected
+    CONNECTION_ATTACH, // set up the topics and connect
+    CONNECTION_RESET,  // reset the module, then attach
+};
+
+struct connection_stats_s
+{
+    uint32_t probes;
+    uint32_t attaches; // attach attempts, including the ones after a reset
+    uint32_t failedAttaches;
+    uint32_t resets;
+    uint32_t drops;    // the link was found down after being up
+    uint32_t commands; // AT commands sent, counted by the driver
+};
+
+struct connection_manager_s
+{
+    enum connection_state_e state;
+    int64_t lastAliveMs;
+    int64_t nextAttemptMs;
+    uint32_t failures;          // consecutive failed attaches
+    uint32_t attemptsSinceReset;
+    uint32_t random;            // xorshift state for the jitter
+    struct connection_stats_s stats;
+};
+
+/** seed is any non zero random number */
+void connection_managerInit(struct connection_manager_s *manager, uint32_t seed);
+/** what to do before the next publish. waitMs is set for CONNECTION_WAIT */
+enum connection_action_e connection_managerNext(struct connection_manager_s *manager, int64_t nowMs, uint32_t *waitMs);
+/** the outcome of a probe, attach or reset */
+void connection_managerResult(struct connection_manager_s *manager, enum connection_action_e action, bool connected, int64_t nowMs);
+/** a publish succeeded */
+void connection_managerAlive(struct connection_manager_s *manager, int64_t nowMs);
+/** a publish failed */
+void connection_managerSuspect(struct connection_manager_s *manager);
+/** the link was dropped on purpose, attach on the next publish without a backoff */
+void connection_managerOffline(struct connection_manager_s *manager);
+const char *connection_stateName(enum connection_state_e state);
+
+#endif // _CONNECTION_MANAGER_
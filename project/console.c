@@ -0,0 +1,105 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdio.h"
+#include "pico/stdlib.h"
+
+#include "console.h"
+#include "isr_stats.h"
+#include "deadline.h"
+#include "kernel_objects.h"
+#include "buffer_pool.h"
+
+#define CONSOLE_PRIORITY 2 // above the log and capture drains, it writes to USB the same way
+
+struct console_command_s
+{
+    const char *name;
+    void (*run)(void);
+    const char *help;
+};
+
+static void console_help(void);
+
+static const struct console_command_s commands[] = {
+    {"help", console_help, "this list"},
+#if TRACE_ENABLED
+    {"trace", trace_dump, "kernel trace dump, expand with weather_trace"},
+#endif
+#if ISR_STATS_ENABLED
+    {"isr", isr_print, "interrupt run times and task wake latencies"},
+#endif
+    {"stacks", kernel_printStacks, "stack sizes and high water marks"},
+    {"pool", pool_print, "message blocks in use, high water mark and allocation failures"},
+#if DEADLINE_ENABLED
+    {"deadline", deadline_print, "periodic task overruns, worst case run time and jitter"},
+#endif
+};
+
+static void console_help(void)
+{
+    for (int i = 0; i < sizeof(commands) / sizeof(*commands); i++)
+    {
+        printf("%-8s %s\n", commands[i].name, commands[i].help);
+    }
+}
+
+static void console_run(const char *line)
+{
+    if (*line == 0)
+        return;
+    for (int i = 0; i < sizeof(commands) / sizeof(*commands); i++)
+    {
+        if (strcmp(line, commands[i].name) == 0)
+        {
+            commands[i].run();
+            return;
+        }
+    }
+    printf("unknown command %s, try help\n", line);
+}
+
+static TaskHandle_t consoleTask;
+static StackType_t consoleStack[KERNEL_STACK(CONSOLE_STACK_WORDS)];
+static StaticTask_t consoleTaskBuffer;
+
+/** from the USB interrupt */
+static void console_charsAvailable(void *parameter)
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(consoleTask, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+static void console_task(void *parameter)
+{
+    char line[CONSOLE_LINE_MAX];
+    size_t length = 0;
+    stdio_set_chars_available_callback(console_charsAvailable, NULL);
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int c;
+        while ((c = getchar_timeout_us(0)) >= 0)
+        {
+            if (c == '\r' || c == '\n')
+            {
+                line[length] = 0;
+                console_run(line);
+                length = 0;
+            }
+            else if (length < sizeof(line) - 1)
+            {
+                line[length++] = c;
+            }
+        }
+    }
+}
+
+void init_console(void)
+{
+    consoleTask = kernel_createTask(console_task, "Console", consoleStack, KERNEL_WORDS(consoleStack), NULL, CONSOLE_PRIORITY, &consoleTaskBuffer);
+}
@@ -0,0 +1,11 @@
+#ifndef _CONSOLE_
+#define _CONSOLE_
+
+/** Commands typed on the USB console, one per line. "help" lists them.
+ * The answers go out as console text or, for the binary dumps, in frames like capture.h.
+ */
+#define CONSOLE_LINE_MAX 32
+
+void init_console(void);
+
+#endif // _CONSOLE_
@@ -0,0 +1,98 @@
+#include "deadband.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void deadband_init(struct deadband_s *deadband, struct deadband_field_s *fields, size_t count, uint32_t keyframeMs)
+{
+    memset(deadband, 0, sizeof(*deadband));
+    deadband->fields = fields;
+    deadband->count = count;
+    deadband->keyframeMs = keyframeMs;
+    for (size_t i = 0; i < count; i++)
+    {
+        fields[i].sent = false;
+    }
+}
+
+static bool deadband_sameObject(const char *a, const char *b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static bool deadband_changed(const struct deadband_field_s *field, const struct deadband_value_s *value)
+{
+    float difference;
+    switch (field->kind)
+    {
+    case DEADBAND_TEXT:
+        return value->text != field->text;
+    case DEADBAND_ANGLE:
+        difference = fabsf(fmodf(value->number - field->number, 360.0f));
+        if (difference > 180.0f)
+            difference = 360.0f - difference;
+        return difference >= field->threshold;
+    default:
+        return fabsf(value->number - field->number) >= field->threshold;
+    }
+}
+
+size_t deadband_encode(struct deadband_s *deadband, const struct deadband_value_s *values, int64_t nowMs, char *buffer, size_t bufferLength, bool *keyframe)
+{
+    size_t length = 0;
+    const char *openObject = NULL;
+
+    *keyframe = !deadband->started || nowMs - deadband->keyframeSentMs >= deadband->keyframeMs;
+    if (*keyframe)
+    {
+        deadband->started = true;
+        deadband->keyframeSentMs = nowMs;
+    }
+    if (bufferLength > 0)
+        buffer[0] = 0;
+
+    for (size_t i = 0; i < deadband->count; i++)
+    {
+        struct deadband_field_s *field = &deadband->fields[i];
+        const struct deadband_value_s *value = &values[i];
+        if (!value->present)
+            continue;
+        if (!*keyframe && field->sent && nowMs - field->sentMs < field->maxSilenceMs && !deadband_changed(field, value))
+        {
+            deadband->fieldsSuppressed++;
+            continue;
+        }
+
+        // fields of one object are adjacent in the table so an object is opened once
+        if (!deadband_sameObject(openObject, field->object))
+        {
+            if (openObject)
+                length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, "},");
+            if (field->object)
+                length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, "\"%s\":{", field->object);
+            openObject = field->object;
+        }
+        else if (openObject)
+        {
+            length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, ",");
+        }
+
+        length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, "\"%s\":", field->name);
+        if (field->kind == DEADBAND_TEXT)
+            length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, "\"%s\"", value->text);
+        else
+            length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, field->format, value->number);
+        if (!field->object)
+            length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, ",");
+
+        field->sent = true;
+        field->number = value->number;
+        field->text = value->text;
+        field->sentMs = nowMs;
+        deadband->fieldsSent++;
+    }
+    if (openObject)
+        length += snprintf(buffer + length, length < bufferLength ? bufferLength - length : 0, "},");
+    return length < bufferLength ? length : bufferLength - 1;
+}
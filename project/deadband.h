@@ -0,0 +1,59 @@
+#ifndef _DEADBAND_
+#define _DEADBAND_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Report by exception: a field is only encoded when it moved past its threshold since
+ * it was last sent or it has been silent for maxSilenceMs. Every keyframeMs all fields
+ * are sent so the backend can rebuild the whole state.
+ */
+enum deadband_kind_e
+{
+    DEADBAND_NUMBER,
+    DEADBAND_ANGLE, // degrees, the difference wraps at 360
+    DEADBAND_TEXT,  // static strings, any change is sent
+};
+
+struct deadband_field_s
+{
+    const char *object; // the JSON object the field is in or NULL for the top level
+    const char *name;
+    const char *format; // printf format for a number
+    enum deadband_kind_e kind;
+    float threshold;
+    uint32_t maxSilenceMs;
+    // state of the last value sent
+    bool sent;
+    float number;
+    const char *text;
+    int64_t sentMs;
+};
+
+/** one field value for an encode. absent fields are skipped and keep their state */
+struct deadband_value_s
+{
+    bool present;
+    float number;
+    const char *text;
+};
+
+struct deadband_s
+{
+    struct deadband_field_s *fields;
+    size_t count;
+    uint32_t keyframeMs;
+    int64_t keyframeSentMs;
+    bool started;
+    uint32_t fieldsSent;
+    uint32_t fieldsSuppressed;
+};
+
+void deadband_init(struct deadband_s *deadband, struct deadband_field_s *fields, size_t count, uint32_t keyframeMs);
+/** encode the changed fields as JSON members grouped by object ("A":1,"B":{"c":2},) into buffer.
+ * values has one entry per field. Returns the length written and whether this was a keyframe.
+ */
+size_t deadband_encode(struct deadband_s *deadband, const struct deadband_value_s *values, int64_t nowMs, char *buffer, size_t bufferLength, bool *keyframe);
+
+#endif // _DEADBAND_
@@ -0,0 +1,122 @@
+#include "deadline.h"
+
+#include <stdio.h>
+
+const char *const deadline_taskNames[DEADLINE_TASKS] = {"wind", "rain", "temperature", "pressure", "reporting"};
+
+static uint32_t deadline_clamp(uint64_t us)
+{
+    return us > UINT32_MAX ? UINT32_MAX : us;
+}
+
+void deadline_started(struct deadline_s *deadline, uint64_t nowUs)
+{
+    struct deadline_stats_s *stats = &deadline->stats;
+    uint64_t periodUs = (uint64_t)stats->periodMs * 1000;
+    uint64_t missed = 0;
+    if (deadline->anchored && periodUs != 0)
+    {
+        uint64_t interval = nowUs - deadline->lastStart;
+        // the nearest whole number of periods, more than one left a period without a pass
+        uint64_t periods = (interval + periodUs / 2) / periodUs;
+        if (periods > 1)
+        {
+            missed = periods - 1;
+        }
+        else
+        {
+            uint32_t jitter = deadline_clamp(interval > periodUs ? interval - periodUs : periodUs - interval);
+            if (jitter > stats->jitterUs)
+                stats->jitterUs = jitter;
+        }
+    }
+    // a late pass followed at once by the next one still held that one up
+    if (missed == 0 && deadline->late)
+        missed = 1;
+    stats->overruns += missed;
+    deadline->late = false;
+    deadline->anchored = true;
+    deadline->lastStart = deadline->start = nowUs;
+    deadline->running = true;
+    stats->passes++;
+}
+
+void deadline_ended(struct deadline_s *deadline, uint64_t nowUs)
+{
+    struct deadline_stats_s *stats = &deadline->stats;
+    if (!deadline->running)
+        return;
+    deadline->running = false;
+    uint32_t us = deadline_clamp(nowUs - deadline->start);
+    stats->lastUs = us;
+    if (us > stats->wcetUs)
+        stats->wcetUs = us;
+    if (us > stats->budgetMs * 1000ull)
+        stats->overBudget++;
+    deadline->late = us > stats->periodMs * 1000ull;
+}
+
+int deadline_formatJson(char *text, size_t length, const struct deadline_stats_s stats[DEADLINE_TASKS])
+{
+    int used = snprintf(text, length, "{");
+    for (int i = 0; i < DEADLINE_TASKS && used < (int)length; i++)
+    {
+        used += snprintf(text + used, length - used,
+                         "%s\"%s\":{\"passes\":%lu,\"overruns\":%lu,\"over_budget\":%lu,\"wcet_us\":%lu,\"jitter_us\":%lu}",
+                         i ? "," : "", deadline_taskNames[i], (unsigned long)stats[i].passes, (unsigned long)stats[i].overruns,
+                         (unsigned long)stats[i].overBudget, (unsigned long)stats[i].wcetUs, (unsigned long)stats[i].jitterUs);
+    }
+    if (used < (int)length)
+        used += snprintf(text + used, length - used, "}");
+    return used;
+}
+
+#if DEADLINE_ENABLED
+#include "pico/time.h"
+
+static struct deadline_s deadlines[DEADLINE_TASKS];
+
+void deadline_register(enum deadline_task_e task, uint32_t periodMs, uint32_t budgetMs)
+{
+    deadlines[task].stats.periodMs = periodMs;
+    deadlines[task].stats.budgetMs = budgetMs;
+    deadlines[task].anchored = false;
+}
+
+void deadline_setPeriod(enum deadline_task_e task, uint32_t periodMs)
+{
+    if (deadlines[task].stats.periodMs == periodMs)
+        return;
+    deadlines[task].anchored = false;
+    deadlines[task].stats.periodMs = periodMs;
+}
+
+void deadline_start(enum deadline_task_e task)
+{
+    deadline_started(&deadlines[task], time_us_64());
+}
+
+void deadline_end(enum deadline_task_e task)
+{
+    deadline_ended(&deadlines[task], time_us_64());
+}
+
+void deadline_getStats(enum deadline_task_e task, struct deadline_stats_s *stats)
+{
+    *stats = deadlines[task].stats;
+}
+
+void deadline_print(void)
+{
+    printf("%-12s %9s %9s %8s %8s %11s %10s %10s\n", "task", "period_ms", "budget_ms", "passes", "overruns", "over_budget",
+           "wcet_us", "jitter_us");
+    for (int i = 0; i < DEADLINE_TASKS; i++)
+    {
+        struct deadline_stats_s stats;
+        deadline_getStats(i, &stats);
+        printf("%-12s %9lu %9lu %8lu %8lu %11lu %10lu %10lu\n", deadline_taskNames[i], (unsigned long)stats.periodMs,
+               (unsigned long)stats.budgetMs, (unsigned long)stats.passes, (unsigned long)stats.overruns,
+               (unsigned long)stats.overBudget, (unsigned long)stats.wcetUs, (unsigned long)stats.jitterUs);
+    }
+}
+#endif // DEADLINE_ENABLED
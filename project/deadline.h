@@ -0,0 +1,82 @@
+#ifndef _DEADLINE_
+#define _DEADLINE_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Deadline monitor for the periodic loops. Each task registers its period and the time one
+ * pass should take, then marks the start and the end of every pass. The monitor keeps, per task:
+ *   jitter      how far the time between two starts is from the period
+ *   wcet        the longest pass, start to end
+ *   overBudget  passes longer than the budget
+ *   overruns    passes that ended after the next one was due, and periods that had no pass
+ * Overruns are counted once, at the next start: a long pass is one overrun for each start it
+ * held up, whether the task then catches up at once or waits for its next period.
+ * The starts are measured against each other rather than a schedule, so a task that lines
+ * itself up again after a stall, or a clock servoed to the GPS, does not pile up jitter.
+ * Each entry is written only by its own task.
+ */
+#ifndef DEADLINE_ENABLED
+#define DEADLINE_ENABLED 1 // two timer reads per pass
+#endif
+
+enum deadline_task_e
+{
+    DEADLINE_WIND,
+    DEADLINE_RAIN,
+    DEADLINE_TEMPERATURE,
+    DEADLINE_PRESSURE,
+    DEADLINE_REPORTING,
+    DEADLINE_TASKS,
+};
+
+struct deadline_stats_s
+{
+    uint32_t periodMs;
+    uint32_t budgetMs;
+    uint32_t passes;
+    uint32_t overruns;
+    uint32_t overBudget;
+    uint32_t wcetUs;
+    uint32_t jitterUs; // the largest
+    uint32_t lastUs;   // the last pass
+};
+
+/** a task's entry. Without anchored there is no start to measure the next one from */
+struct deadline_s
+{
+    struct deadline_stats_s stats;
+    uint64_t lastStart;
+    uint64_t start;
+    bool anchored;
+    bool running;
+    bool late; // the last pass ran past its period
+};
+
+extern const char *const deadline_taskNames[DEADLINE_TASKS];
+
+/** the bookkeeping at a start and an end, nowUs from any microsecond clock */
+void deadline_started(struct deadline_s *deadline, uint64_t nowUs);
+void deadline_ended(struct deadline_s *deadline, uint64_t nowUs);
+/** the summary as a JSON object, for the diagnostics report */
+int deadline_formatJson(char *text, size_t length, const struct deadline_stats_s stats[DEADLINE_TASKS]);
+
+#if DEADLINE_ENABLED
+/** call before the task runs its first pass */
+void deadline_register(enum deadline_task_e task, uint32_t periodMs, uint32_t budgetMs);
+/** the next start is not measured against the last one */
+void deadline_setPeriod(enum deadline_task_e task, uint32_t periodMs);
+void deadline_start(enum deadline_task_e task);
+void deadline_end(enum deadline_task_e task);
+void deadline_getStats(enum deadline_task_e task, struct deadline_stats_s *stats);
+/** the table as console text */
+void deadline_print(void);
+#else
+#define deadline_register(task, periodMs, budgetMs)
+#define deadline_setPeriod(task, periodMs)
+#define deadline_start(task)
+#define deadline_end(task)
+#endif
+
+#endif // _DEADLINE_
@@ -1,13 +1,20 @@
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "pinmap.h"
 #include "hardware/gpio.h"
 #include "hardware/uart.h"
+#include "pico/rand.h"
 
 #include "expresslink.h"
+#include "capture.h"
+#include "log.h"
+#include "isr_stats.h"
+#include "kernel_objects.h"
+#include "wake_lead.h"
 
 #define EL_UART uart0
 #define EL_BAUD 115200
@@ -24,31 +31,54 @@
 
 #define EL_RX_BUFFER_SIZE 10240 // 10KB receive buffer to cover the biggest message
 
+/** the reporter and the alert publisher share the module. A command and its response,
+ * and a whole connect sequence, hold this lock. It is recursive because the connect
+ * sequence is made of commands. The waiting task with the highest priority gets it next.
+ */
+static SemaphoreHandle_t elMutex;
+static StaticSemaphore_t elMutexBuffer;
+
+/** the link state, under elMutex */
+static struct connection_manager_s elLink;
+static int64_t linkUptimeMs;
+static TickType_t linkTick;
+
+/** sleep between reports. Waking costs a reattach so the wake-to-ready time is measured
+ * and the module is woken that long, with some spread, ahead of the report window, see wake_lead.h
+ */
+#define EL_WAKE_POLL_MS 100       // AT is repeated this often until the module answers
+#define EL_WAKE_TIMEOUT_MS 10000  // fall back to a reset when it does not
+#define EL_SLEEP_BACKSTOP_S 60    // the module wakes itself this long after the window if the pin was missed
+
+static bool elAsleep;
+static TickType_t wakeStarted;
+static bool wakeTiming;
+static struct wake_lead_s wakeLead;
+static struct expresslink_sleep_stats_s sleepStats;
+
 static void el_waitForEvent()
 {
-    puts("EL: Waiting for Event");
+    TickType_t start = xTaskGetTickCount();
     while (gpio_get(EL_EVENT_PIN) == 0)
     {
-        putchar('.');
         vTaskDelay(pdMS_TO_TICKS(1));
     }
-    puts("EL: Event found");
+    LOG_INFO("EL: Event found after %lu ms", (unsigned long)((xTaskGetTickCount() - start) * portTICK_PERIOD_MS));
 }
 
 static void el_waitForAT()
 {
-    puts("EL: Waiting for AT");
+    TickType_t start = xTaskGetTickCount();
     while (EL_OK != expresslinkSendCommand("AT", NULL, 0))
     {
-        putchar('.');
         vTaskDelay(pdMS_TO_TICKS(1));
     }
-    puts("EL: AT found\n");
+    LOG_INFO("EL: AT found after %lu ms", (unsigned long)((xTaskGetTickCount() - start) * portTICK_PERIOD_MS));
 }
 
 static void el_power()
 {
-    puts("EL: powering");
+    LOG_INFO("EL: powering");
     gpio_put(EL_SARA_PWR_PIN, true);
     vTaskDelay(pdMS_TO_TICKS(500));
     gpio_put(EL_SARA_PWR_PIN, false);
@@ -58,7 +88,7 @@ static void el_power()
 /* HW specific UART functions. */
 static void el_reset()
 {
-    puts("EL: resetting");
+    LOG_INFO("EL: resetting");
 
     gpio_set_dir(EL_RSN_PIN, true);
     gpio_put(EL_RSN_PIN, true);
@@ -73,7 +103,7 @@ static void el_reset()
 
 static void el_flush()
 {
-    puts("el_flush: flushing");
+    LOG_DEBUG("el_flush: flushing");
     while (uart_is_readable_within_us(EL_UART, 2000000)) // wait 2 seconds for any characters
     {
         uart_getc(EL_UART);
@@ -84,7 +114,8 @@ static void el_flush()
 static void el_write(const char *string)
 {
     const char *c = string;
-    printf("el_write: %s\n", string);
+    LOG_DEBUG("el_write: %s", string);
+    capture_expresslink(true, string, strlen(string));
     while (*c)
         uart_putc_raw(EL_UART, *c++);
     uart_putc_raw(EL_UART, '\r');
@@ -96,6 +127,9 @@ static char el_rx_buffer[EL_RX_BUFFER_SIZE];
 static TaskHandle_t readTask;
 static void el_on_uart_rx()
 {
+    TRACE_ISR_ENTER(TRACE_ISR_EL_UART);
+    uint32_t isrStart = isr_enter();
+    bool notified = false;
     BaseType_t higherPriorityTaskWoken = pdFALSE;
     static int buffer_position = 0;
 
@@ -111,6 +145,7 @@ static void el_on_uart_rx()
             xTaskNotifyFromISR(readTask, buffer_position, eSetValueWithOverwrite, &higherPriorityTaskWoken);
             uart_set_irq_enables(EL_UART, false, false); // turn off interrupts
             buffer_position = 0;
+            notified = true;
             break;
         default:
             el_rx_buffer[buffer_position] = ch;
@@ -122,6 +157,8 @@ static void el_on_uart_rx()
             break;
         }
     }
+    isr_exit(ISR_EXPRESSLINK, isrStart, notified);
+    TRACE_ISR_EXIT(TRACE_ISR_EL_UART);
     portYIELD_FROM_ISR(higherPriorityTaskWoken);
 }
 
@@ -132,26 +169,34 @@ static void el_on_uart_rx()
 // return value is the number of received characters
 // if the bufferlen is too small, receive all the data the buffer
 // will hold and then continue receiving until the end of the line
-static int el_read(char *const buffer, size_t bufferLen)
+// with no buffer the line is left in el_rx_buffer for the caller
+static int el_read(char *const buffer, size_t bufferLen, uint32_t timeoutMs)
 {
     uint32_t i = 0;
     bool receivingLine = true;
     char *dst = buffer;
 
-    memset(el_rx_buffer, 0, sizeof(el_rx_buffer));
+    el_rx_buffer[0] = 0; // the interrupt terminates each line it hands over
     readTask = xTaskGetCurrentTaskHandle();
     uart_set_irq_enables(EL_UART, true, false);
     TickType_t startTime = xTaskGetTickCount();
 
-    if (pdTRUE == xTaskNotifyWaitIndexed(0, 0x00, -1, &i, pdMS_TO_TICKS(EL_COMMAND_TIMEOUT)))
+    if (pdTRUE == xTaskNotifyWaitIndexed(0, 0x00, -1, &i, pdMS_TO_TICKS(timeoutMs)))
     {
-        printf("EL Read notification with %d\n", i);
-        memcpy(buffer, el_rx_buffer, i + 1);
-        printf("el_read: %s\n", buffer);
+        isr_taskRunning(ISR_EXPRESSLINK);
+        LOG_DEBUG("EL Read notification with %lu", (unsigned long)i);
+        if (buffer != NULL && bufferLen > 0)
+        {
+            size_t length = i < bufferLen ? i : bufferLen - 1;
+            memcpy(buffer, el_rx_buffer, length);
+            buffer[length] = 0;
+        }
+        capture_expresslink(false, el_rx_buffer, i);
+        LOG_DEBUG("el_read: %s", el_rx_buffer);
     }
     else
     {
-        puts("el_read timeout");
+        LOG_WARN("el_read timeout");
     }
     return i;
 }
@@ -175,24 +220,24 @@ static response_codes_t el_checkResponse(const char *response)
 }
 
 // Send a command and retrieve the response
+// the response is checked where the interrupt left it and only copied out when asked for
 response_codes_t expresslinkSendCommand(const char *command, char *response, size_t responseLength)
 {
-    char buffer[200];
+    response_codes_t value = EL_NORESPONSE;
+    xSemaphoreTakeRecursive(elMutex, portMAX_DELAY);
+    elLink.stats.commands++;
     el_write(command);
-    int l = el_read(buffer, sizeof(buffer));
+    int l = el_read(NULL, 0, EL_COMMAND_TIMEOUT);
     if (l)
     {
-        response_codes_t value = el_checkResponse(buffer);
+        value = el_checkResponse(el_rx_buffer);
         if (response && responseLength > 0)
         {
-            strncpy(response, buffer, responseLength);
+            strncpy(response, el_rx_buffer, responseLength);
         }
-        return value;
-    }
-    else
-    {
-        return EL_NORESPONSE;
     }
+    xSemaphoreGiveRecursive(elMutex);
+    return value;
 }
 
 static bool el_setup()
@@ -204,19 +249,25 @@ static bool el_setup()
     snprintf(topicBuffer, sizeof(topicBuffer), "AT+CONF Topic1=raw_weather_data/%s", thingName);
     if (EL_OK != expresslinkSendCommand(topicBuffer, NULL, 0))
     {
-        puts("Topic 1 set failure");
+        LOG_ERROR("Topic 1 set failure");
         return false;
     }
     snprintf(topicBuffer, sizeof(topicBuffer), "AT+CONF Topic2=scaled_weather_data/%s", thingName);
     if (EL_OK != expresslinkSendCommand(topicBuffer, NULL, 0))
     {
-        puts("Topic 2 set failure");
+        LOG_ERROR("Topic 2 set failure");
         return false;
     }
     snprintf(topicBuffer, sizeof(topicBuffer), "AT+CONF Topic3=scaled_weather_data/all");
     if (EL_OK != expresslinkSendCommand(topicBuffer, NULL, 0))
     {
-        puts("Topic 3 set failure");
+        LOG_ERROR("Topic 3 set failure");
+        return false;
+    }
+    snprintf(topicBuffer, sizeof(topicBuffer), "AT+CONF Topic4=weather_alerts/%s", thingName);
+    if (EL_OK != expresslinkSendCommand(topicBuffer, NULL, 0))
+    {
+        LOG_ERROR("Topic 4 set failure");
         return false;
     }
     return true;
@@ -239,49 +290,170 @@ bool expresslinkIsConnected()
     return returnValue;
 }
 
-void expresslinkConnect()
+// ms since boot for the connection manager, accumulated so it survives the tick rollover. Call with elMutex held
+static int64_t el_nowMs()
 {
-    char responseBuffer[50];
-    bool finished = false;
-    int retryCount = 0;
+    TickType_t tick = xTaskGetTickCount();
+    linkUptimeMs += (int64_t)(TickType_t)(tick - linkTick) * portTICK_PERIOD_MS;
+    linkTick = tick;
+    return linkUptimeMs;
+}
+
+static bool el_attach()
+{
+    char responseBuffer[50] = "";
+    if (!el_setup())
+    {
+        return false;
+    }
+    if (expresslinkSendCommand("AT+CONNECT", responseBuffer, sizeof(responseBuffer)) == EL_OK &&
+        strnstr(responseBuffer, "OK 1", 4) != NULL)
+    {
+        LOG_INFO("Connection Complete");
+        return true;
+    }
+    LOG_ERROR("EL Connection Error : %s", responseBuffer);
+    return false;
+}
 
-    puts("Connecting");
-    printf("Connecting ExpressLink:");
-    do
+// assert WAKE and poll with AT until the module answers. Call with elMutex held
+static void el_wake()
+{
+    char buffer[50];
+    LOG_INFO("EL: waking");
+    wakeStarted = xTaskGetTickCount();
+    wakeTiming = true;
+    elAsleep = false;
+    gpio_put(EL_WAKE_PIN, false);
+    bool awake = false;
+    while (!awake && xTaskGetTickCount() - wakeStarted < pdMS_TO_TICKS(EL_WAKE_TIMEOUT_MS))
     {
-        if ((++retryCount) > 4)
+        elLink.stats.commands++;
+        el_write("AT");
+        awake = el_read(buffer, sizeof(buffer), EL_WAKE_POLL_MS) > 0 && strnstr(buffer, "OK", 2) != NULL;
+    }
+    gpio_put(EL_WAKE_PIN, true);
+    if (!awake)
+    {
+        LOG_WARN("EL: no answer after wake");
+        el_reset();
+        el_waitForEvent();
+        el_waitForAT();
+    }
+    sleepStats.wakes++;
+}
+
+// fold a wake-to-ready time into the lead
+static void el_wakeReady()
+{
+    uint32_t measured = (xTaskGetTickCount() - wakeStarted) * portTICK_PERIOD_MS;
+    wake_leadAdd(&wakeLead, measured);
+    sleepStats.lastWakeMs = measured;
+    wakeTiming = false;
+}
+
+bool expresslinkSleep(uint32_t durationMs)
+{
+    char command[32];
+    bool asleep = false;
+    snprintf(command, sizeof(command), "AT+SLEEP %lu", (unsigned long)(durationMs / 1000 + EL_SLEEP_BACKSTOP_S));
+    xSemaphoreTakeRecursive(elMutex, portMAX_DELAY);
+    if (expresslinkSendCommand(command, NULL, 0) == EL_OK)
+    {
+        // the module drops the connection while it sleeps, the next publish attaches again
+        connection_managerOffline(&elLink);
+        elAsleep = true;
+        asleep = true;
+        sleepStats.sleeps++;
+        sleepStats.sleptMs += durationMs;
+    }
+    xSemaphoreGiveRecursive(elMutex);
+    return asleep;
+}
+
+bool expresslinkIsAsleep()
+{
+    return elAsleep;
+}
+
+uint32_t expresslinkWakeLeadMs()
+{
+    return wake_leadMs(&wakeLead);
+}
+
+void expresslinkGetSleepStats(struct expresslink_sleep_stats_s *stats)
+{
+    xSemaphoreTakeRecursive(elMutex, portMAX_DELAY);
+    *stats = sleepStats;
+    stats->wakeReadyMs = wakeLead.readyMs;
+    xSemaphoreGiveRecursive(elMutex);
+}
+
+bool expresslinkReady(uint32_t *waitMs)
+{
+    bool ready = false;
+    *waitMs = 0;
+    xSemaphoreTakeRecursive(elMutex, portMAX_DELAY);
+    if (elAsleep)
+    {
+        el_wake();
+    }
+    // a failed probe goes straight on to an attach. A failed attach always ends in a wait
+    for (;;)
+    {
+        enum connection_action_e action = connection_managerNext(&elLink, el_nowMs(), waitMs);
+        if (action == CONNECTION_READY)
         {
-            puts("ExpressLink Reset");
+            ready = true;
+            if (wakeTiming)
+            {
+                el_wakeReady();
+            }
+            break;
+        }
+        if (action == CONNECTION_WAIT)
+        {
+            break;
+        }
+        bool connected = false;
+        switch (action)
+        {
+        case CONNECTION_PROBE:
+            connected = expresslinkIsConnected();
+            break;
+        case CONNECTION_RESET:
+            LOG_INFO("ExpressLink Reset");
             el_reset();
             el_waitForEvent();
             el_waitForAT();
+            connected = el_attach();
+            break;
+        default:
+            connected = el_attach();
+            break;
         }
-        if (el_setup())
+        connection_managerResult(&elLink, action, connected, el_nowMs());
+        if (!connected)
         {
-            if (expresslinkSendCommand("AT+CONNECT", responseBuffer, sizeof(responseBuffer)) == EL_OK)
-            {
-                if (strnstr(responseBuffer, "OK 1", 4) != NULL)
-                {
-                    finished = true;
-                    puts("Connection Complete");
-                }
-                else
-                {
-                    printf("EL OK : %s\n", responseBuffer);
-                }
-            }
-            else
-            {
-                printf("EL Connection Error : %s\n", responseBuffer);
-                puts("Reset expresslink");
-                el_reset();
-                el_waitForEvent();
-                el_waitForAT();
-            }
+            wakeTiming = false; // a network problem, not the wake-to-ready time
         }
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    } while (!finished);
-    puts("Expresslink Connected");
+        if (!connected && action != CONNECTION_PROBE)
+        {
+            LOG_WARN("EL: attach failed %lu times", (unsigned long)elLink.failures);
+        }
+    }
+    xSemaphoreGiveRecursive(elMutex);
+    return ready;
+}
+
+void expresslinkConnect()
+{
+    uint32_t waitMs;
+    while (!expresslinkReady(&waitMs))
+    {
+        vTaskDelay(pdMS_TO_TICKS(waitMs));
+    }
+    LOG_INFO("Expresslink Connected");
 }
 
 void expresslinkGetThingName(char *thingName, size_t thingNameLen)
@@ -293,26 +465,52 @@ void expresslinkGetThingName(char *thingName, size_t thingNameLen)
     }
 }
 
-void expresslinkPublish(int topic, char *message, size_t messageLength)
+bool expresslinkPublish(int topic, struct pool_block_s *block)
 {
-    char sendBuffer[500];
-    snprintf(sendBuffer, sizeof(sendBuffer), "AT+SEND%d %.*s", topic, messageLength, message);
-    if (EL_OK != expresslinkSendCommand(sendBuffer, NULL, 0))
+    char prefix[POOL_HEADROOM + 1];
+    int prefixLength = snprintf(prefix, sizeof(prefix), "AT+SEND%d ", topic);
+    bool sent = true;
+    xSemaphoreTakeRecursive(elMutex, portMAX_DELAY);
+    // the command runs on into the message, so it goes to the UART without a copy
+    const char *command = pool_prepend(block, prefix, prefixLength);
+    if (EL_OK != expresslinkSendCommand(command, NULL, 0))
+    {
+        LOG_ERROR("Send Failure %d, %.*s", topic, (int)block->length, block->data);
+        connection_managerSuspect(&elLink);
+        sent = false;
+    }
+    else
     {
-        printf("Send Failure %d, %.*s\n", topic, messageLength, message);
+        // a delivered message is all the proof of life the link needs
+        connection_managerAlive(&elLink, el_nowMs());
     }
+    xSemaphoreGiveRecursive(elMutex);
+    return sent;
+}
+
+void expresslinkGetLinkStats(struct connection_stats_s *stats)
+{
+    xSemaphoreTakeRecursive(elMutex, portMAX_DELAY);
+    *stats = elLink.stats;
+    xSemaphoreGiveRecursive(elMutex);
 }
 
 void expresslinkDisconnect()
 {
     if (EL_OK != expresslinkSendCommand("AT+disconnect", NULL, 0))
     {
-        printf("Disconnect Failed\n");
+        LOG_WARN("Disconnect Failed");
     }
 }
 
 void expresslinkInit()
 {
+    elMutex = xSemaphoreCreateRecursiveMutexStatic(&elMutexBuffer);
+    uint32_t seed = get_rand_32();
+    capture_random(seed);
+    connection_managerInit(&elLink, seed);
+    wake_leadInit(&wakeLead);
+    linkTick = xTaskGetTickCount();
     uart_init(EL_UART, EL_BAUD);
     gpio_set_function(CLICK_TX_PIN, GPIO_FUNC_UART);
     gpio_set_function(CLICK_RX_PIN, GPIO_FUNC_UART);
@@ -1,8 +1,13 @@
 #ifndef _EXPRESSLINK_
 #define _EXPRESSLINK_
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "connection_manager.h"
+#include "buffer_pool.h"
+
 typedef enum response_codes
 {
     EL_NORESPONSE = -1,
@@ -32,12 +37,37 @@ typedef enum response_codes
     EL_INVALID_SIGNATURE
 } response_codes_t;
 
+struct expresslink_sleep_stats_s
+{
+    uint32_t sleeps;
+    uint32_t wakes;
+    uint64_t sleptMs;     // requested sleep time
+    uint32_t lastWakeMs;  // WAKE asserted to connected
+    uint32_t wakeReadyMs; // the running estimate of that
+};
+
 response_codes_t expresslinkSendCommand(const char *command, char *response, size_t responseLength);
 bool expresslinkIsConnected();
+/** probe, attach or reset as the connection manager decides. False while backing off,
+ * waitMs is then how long until the next attempt
+ */
+bool expresslinkReady(uint32_t *waitMs);
+/** block until connected */
 void expresslinkConnect();
 void expresslinkDisconnect();
 void expresslinkInit();
-void expresslinkPublish(int topic, char *message, size_t messageLength);
+/** AT+SEND the block's message, the command is written into its headroom */
+bool expresslinkPublish(int topic, struct pool_block_s *block);
 void expresslinkGetThingName(char *thingName, size_t thingNameLen);
+void expresslinkGetLinkStats(struct connection_stats_s *stats);
+
+/** AT+SLEEP for about durationMs. The connection is lost, the next expresslinkReady wakes
+ * the module through EL_WAKE_PIN and attaches again
+ */
+bool expresslinkSleep(uint32_t durationMs);
+bool expresslinkIsAsleep();
+/** how long before a report window to wake, from the measured wake-to-ready times */
+uint32_t expresslinkWakeLeadMs();
+void expresslinkGetSleepStats(struct expresslink_sleep_stats_s *stats);
 
 #endif //_EXPRESSLINK_
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "gps_site.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "pico/flash.h"
+
+/** The site lives in the last flash sector, well past the end of the program image.
+ * Writing flash stalls XIP on both cores so flash_safe_execute parks the other core
+ * and the scheduler for the few ms it takes. That only happens when a survey completes.
+ */
+#define GPS_SITE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define GPS_SITE_MAGIC 0x53495445 // "SITE"
+#define GPS_SITE_FLASH_TIMEOUT_MS 100
+
+#define METERS_PER_DEGREE 111319.49f
+#define DEGREES_TO_RADIANS 0.017453293f
+
+struct gps_site_record_s
+{
+    uint32_t magic;
+    struct gps_site_s site;
+    uint32_t check; // ~(sum of the site words) so an erased or torn sector is rejected
+};
+
+static uint32_t gps_siteCheck(const struct gps_site_s *site)
+{
+    return ~((uint32_t)site->latitude + (uint32_t)site->longitude + (uint32_t)site->altitude + site->fixes);
+}
+
+void gps_siteAverageInit(struct gps_site_average_s *average)
+{
+    memset(average, 0, sizeof(*average));
+}
+
+void gps_siteAverageAdd(struct gps_site_average_s *average, int32_t latitude, int32_t longitude, int32_t altitude)
+{
+    average->latitude += latitude;
+    average->longitude += longitude;
+    average->altitude += altitude;
+    average->fixes++;
+}
+
+void gps_siteAverageResult(const struct gps_site_average_s *average, struct gps_site_s *site)
+{
+    memset(site, 0, sizeof(*site));
+    if (average->fixes == 0)
+        return;
+    site->latitude = (int32_t)(average->latitude / average->fixes);
+    site->longitude = (int32_t)(average->longitude / average->fixes);
+    site->altitude = (int32_t)(average->altitude / average->fixes);
+    site->fixes = average->fixes;
+}
+
+float gps_siteDistance(const struct gps_site_s *site, int32_t latitude, int32_t longitude)
+{
+    float north = (float)(latitude - site->latitude) * 1e-7f * METERS_PER_DEGREE;
+    float east = (float)(longitude - site->longitude) * 1e-7f * METERS_PER_DEGREE * cosf((float)site->latitude * 1e-7f * DEGREES_TO_RADIANS);
+    return sqrtf(north * north + east * east);
+}
+
+bool gps_siteLoad(struct gps_site_s *site)
+{
+    const struct gps_site_record_s *record = (const struct gps_site_record_s *)(XIP_BASE + GPS_SITE_FLASH_OFFSET);
+    if (record->magic != GPS_SITE_MAGIC || record->check != gps_siteCheck(&record->site))
+        return false;
+    *site = record->site;
+    return true;
+}
+
+static void gps_siteProgram(void *parameter)
+{
+    flash_range_erase(GPS_SITE_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    if (parameter)
+        flash_range_program(GPS_SITE_FLASH_OFFSET, parameter, FLASH_PAGE_SIZE);
+}
+
+bool gps_siteStore(const struct gps_site_s *site)
+{
+    // flash is programmed a whole page at a time
+    static uint8_t page[FLASH_PAGE_SIZE];
+    struct gps_site_record_s record = {GPS_SITE_MAGIC, *site, gps_siteCheck(site)};
+
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, &record, sizeof(record));
+    return flash_safe_execute(gps_siteProgram, page, GPS_SITE_FLASH_TIMEOUT_MS) == PICO_OK;
+}
+
+bool gps_siteErase(void)
+{
+    return flash_safe_execute(gps_siteProgram, NULL, GPS_SITE_FLASH_TIMEOUT_MS) == PICO_OK;
+}
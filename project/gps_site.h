@@ -0,0 +1,39 @@
+#ifndef _GPS_SITE_
+#define _GPS_SITE_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** surveyed position of a fixed station */
+struct gps_site_s
+{
+    int32_t latitude;  // 1e-7 degrees
+    int32_t longitude; // 1e-7 degrees
+    int32_t altitude;  // mm above mean sea level
+    uint32_t fixes;    // number of fixes in the average
+};
+
+/** running sums for the site average. 64 bits holds years of 1Hz fixes */
+struct gps_site_average_s
+{
+    int64_t latitude;
+    int64_t longitude;
+    int64_t altitude;
+    uint32_t fixes;
+};
+
+void gps_siteAverageInit(struct gps_site_average_s *average);
+void gps_siteAverageAdd(struct gps_site_average_s *average, int32_t latitude, int32_t longitude, int32_t altitude);
+void gps_siteAverageResult(const struct gps_site_average_s *average, struct gps_site_s *site);
+
+/** horizontal distance in meters between the site and a fix. Flat earth is plenty for a few km */
+float gps_siteDistance(const struct gps_site_s *site, int32_t latitude, int32_t longitude);
+
+/** read the site saved in the last flash sector. returns false if there is none */
+bool gps_siteLoad(struct gps_site_s *site);
+/** save the site in the last flash sector. returns false if the flash could not be locked */
+bool gps_siteStore(const struct gps_site_s *site);
+/** forget the saved site so the next boot surveys again */
+bool gps_siteErase(void);
+
+#endif // _GPS_SITE_
@@ -6,8 +6,6 @@
 #include "hardware/uart.h"
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
-#include "hardware/rtc.h"
-#include "pico/util/datetime.h"
 
 #include <stdio.h>
 #include <memory.h>
@@ -15,7 +13,15 @@
 #include "reporting_task.h"
 
 #include "gps.h"
+#include "gps_task.h"
+#include "gps_site.h"
+#include "timebase.h"
+#include "ubx.h"
+#include "nmea_filter.h"
 #include "leds.h"
+#include "capture.h"
+#include "isr_stats.h"
+#include "kernel_objects.h"
 
 #define GPS_TX_PIN 5 // The GPS is sending on this pin so it must connect to RX
 #define GPS_RX_PIN 4 // The GPS is receiving on this pin so it must connect to TX
@@ -26,53 +32,111 @@
 #define GPS_STOP_BITS 1
 #define GPS_PARITY UART_PARITY_NONE
 
+#ifndef GPS_UBX_MODE
+#define GPS_UBX_MODE 0 // 1 configures the receiver for binary UBX NAV-PVT only instead of NMEA text
+#endif
+#define GPS_UBX_RATE_MS 1000 // navigation solution period in UBX mode
+
+#ifndef GPS_FIXED_SITE
+#define GPS_FIXED_SITE 0 // 1 surveys the station position once, reports it and duty cycles the receiver
+#endif
+#define GPS_SITE_FIXES 600                  // 3D solutions averaged into the site (10 minutes at 1 Hz)
+#define GPS_SITE_MOVED_M 100.0f             // a fix this far from the site counts as moved
+#define GPS_SITE_MOVED_FIXES 30             // consecutive moved fixes before surveying again
+#define GPS_DISCIPLINE_FIXES 30             // timed solutions after waking. The PPS servo needs 8 to lock
+#define GPS_BACKUP_MS (60 * 60 * 1000)      // receiver backup time between time disciplines
+#define GPS_MAX_AWAKE_MS (10 * 60 * 1000)   // go back to backup even without a discipline
+#define GPS_WAKE_GUARD_MS 2000              // sentences this soon after the backup request are stragglers
+
 static QueueHandle_t gpsQueue;
-typedef char nmea_buffer_t[85];
+typedef char nmea_buffer_t[NMEA_SENTENCE_MAX];
+typedef uint8_t ubx_pvt_buffer_t[UBX_NAV_PVT_LENGTH];
+static StaticQueue_t gpsQueueBuffer;
+#if GPS_UBX_MODE
+static uint8_t gpsQueueStorage[GPS_UBX_QUEUE_LENGTH * sizeof(ubx_pvt_buffer_t)];
+#else
+static uint8_t gpsQueueStorage[GPS_NMEA_QUEUE_LENGTH * sizeof(nmea_buffer_t)];
+#endif
+static StackType_t gpsStack[KERNEL_STACK(GPS_STACK_WORDS)];
+static StaticTask_t gpsTaskBuffer;
+
+static struct gps_rx_stats_s gpsRxStats;
+static bool gpsAsleep;
+static TickType_t gpsAwakeSince;
+static uint32_t gpsAwakeMs; // completed awake periods
+
+#if GPS_UBX_MODE
+static struct ubx_parser_s ubxParser;
 
-struct gps_date_t
+void on_uart_rx()
 {
-    bool goodTime;
-    int year;
-    int month;
-    int day;
-    int hour;
-    int minute;
-    int second;
-};
+    TRACE_ISR_ENTER(TRACE_ISR_GPS_UART);
+    uint32_t isrStart = isr_enter();
+    bool queued = false;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
 
-SemaphoreHandle_t dateSemaphore;
-struct gps_date_t gpsDate = {false};
+    while (uart_is_readable(GPS_UART))
+    {
+        gpsRxStats.bytes++;
+        if (ubx_parse(&ubxParser, uart_getc(GPS_UART)))
+        {
+            // only NAV-PVT is queued. ACK/NAK for the configuration are dropped here.
+            if (ubxParser.msgClass != UBX_CLASS_NAV || ubxParser.msgId != UBX_NAV_PVT || ubxParser.length != UBX_NAV_PVT_LENGTH)
+            {
+                gpsRxStats.dropped++;
+            }
+            else if (pdTRUE != xQueueSendFromISR(gpsQueue, ubxParser.payload, &higherPriorityTaskWoken))
+            {
+                gpsRxStats.queueFull++;
+            }
+            else
+            {
+                gpsRxStats.queued++;
+                queued = true;
+            }
+        }
+    }
+    gpsRxStats.corrupt = ubxParser.checksumErrors;
+    gpsRxStats.overlong = ubxParser.skipped;
+    isr_exit(ISR_GPS, isrStart, queued);
+    TRACE_ISR_EXIT(TRACE_ISR_GPS_UART);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+#else
+static struct nmea_filter_s nmeaFilter;
 
 void on_uart_rx()
 {
+    TRACE_ISR_ENTER(TRACE_ISR_GPS_UART);
+    uint32_t isrStart = isr_enter();
+    bool queued = false;
     BaseType_t higherPriorityTaskWoken = pdFALSE;
-    static nmea_buffer_t nmea_buffer = {0}; // longest NMEA string is 82 bytes
-    static int buffer_position = 0;
 
     while (uart_is_readable(GPS_UART))
     {
-        char ch = uart_getc(GPS_UART);
-        switch (ch)
+        gpsRxStats.bytes++;
+        if (nmea_filterByte(&nmeaFilter, uart_getc(GPS_UART)))
         {
-        case '\r': // discard this character
-            break;
-        case '\n': // post the message on the GPS queue
-            xQueueSendFromISR(gpsQueue, &nmea_buffer, &higherPriorityTaskWoken);
-            buffer_position = 0;
-            memset(nmea_buffer, 0, sizeof(nmea_buffer));
-            break;
-        default:
-            nmea_buffer[buffer_position] = ch;
-            buffer_position++;
-            if (buffer_position > sizeof(nmea_buffer) - 1)
+            capture_nmeaFromISR(nmeaFilter.sentence, nmeaFilter.length);
+            if (pdTRUE != xQueueSendFromISR(gpsQueue, nmeaFilter.sentence, &higherPriorityTaskWoken))
             {
-                buffer_position = sizeof(nmea_buffer) - 1;
+                gpsRxStats.queueFull++;
+            }
+            else
+            {
+                gpsRxStats.queued++;
+                queued = true;
             }
-            break;
         }
     }
+    gpsRxStats.dropped = nmeaFilter.dropped;
+    gpsRxStats.corrupt = nmeaFilter.corrupt;
+    gpsRxStats.overlong = nmeaFilter.overlong;
+    isr_exit(ISR_GPS, isrStart, queued);
+    TRACE_ISR_EXIT(TRACE_ISR_GPS_UART);
     portYIELD_FROM_ISR(higherPriorityTaskWoken);
 }
+#endif
 
 static void print_tpv_value(const char *name, const char *format, const int32_t value, const int32_t scale_factor)
 {
@@ -87,17 +151,209 @@ static void print_tpv_value(const char *name, const char *format, const int32_t
     }
 }
 
+static void ubx_send(const uint8_t *frame, size_t length)
+{
+    uart_write_blocking(GPS_UART, frame, length);
+    uart_tx_wait_blocking(GPS_UART);
+}
+
+#if GPS_FIXED_SITE
+static struct gps_site_s site;
+static bool siteKnown;
+static struct gps_site_average_s siteAverage;
+static uint32_t siteMovedFixes;
+static uint32_t disciplineFixes;
+static TickType_t backupRequested;
+
+/** average 3D fixes into the site until it is surveyed, then watch for the station being moved.
+ * returns true while the position should still be reported with every sample.
+ */
+static bool gps_siteFix(int32_t latitude, int32_t longitude, int32_t altitude)
+{
+    if (siteKnown)
+    {
+        if (gps_siteDistance(&site, latitude, longitude) < GPS_SITE_MOVED_M)
+        {
+            siteMovedFixes = 0;
+            return false;
+        }
+        if (++siteMovedFixes < GPS_SITE_MOVED_FIXES)
+            return false;
+        printf("GPS site moved. Surveying again.\n");
+        siteKnown = false;
+        gps_siteErase();
+        gps_siteAverageInit(&siteAverage);
+    }
+
+    gps_siteAverageAdd(&siteAverage, latitude, longitude, altitude);
+    if (siteAverage.fixes < GPS_SITE_FIXES)
+        return true;
+
+    gps_siteAverageResult(&siteAverage, &site);
+    siteKnown = true;
+    siteMovedFixes = 0;
+    if (!gps_siteStore(&site))
+    {
+        puts("GPS site could not be saved");
+    }
+    printf("GPS site %.7f %.7f %.3fm from %lu fixes\n", site.latitude / 1e7, site.longitude / 1e7, site.altitude / 1000.0, (unsigned long)site.fixes);
+    reportGPSSite(site.latitude / 1e7f, site.longitude / 1e7f, site.altitude / 1000.0f);
+    return false;
+}
+
+/** once the site is known the receiver only needs to be awake long enough to discipline the clock */
+static void gps_dutyCycle(bool timed, TickType_t now)
+{
+    if (gpsAsleep)
+    {
+        if (now - backupRequested < pdMS_TO_TICKS(GPS_WAKE_GUARD_MS))
+            return;
+        // the receiver restarted on its own at the end of the backup period
+        gpsAsleep = false;
+        gpsAwakeSince = now;
+        disciplineFixes = 0;
+    }
+    if (timed)
+        disciplineFixes++;
+    if (!siteKnown)
+        return;
+    if (disciplineFixes < GPS_DISCIPLINE_FIXES && now - gpsAwakeSince < pdMS_TO_TICKS(GPS_MAX_AWAKE_MS))
+        return;
+
+    uint8_t frame[16];
+    ubx_send(frame, ubx_powerBackup(GPS_BACKUP_MS, frame, sizeof(frame)));
+    xQueueReset(gpsQueue);
+    gpsAwakeMs += (now - gpsAwakeSince) * portTICK_PERIOD_MS;
+    gpsRxStats.sleeps++;
+    gpsAsleep = true;
+    backupRequested = now;
+    printf("GPS in backup for %d minutes after %lu timed fixes\n", GPS_BACKUP_MS / 60000, (unsigned long)disciplineFixes);
+}
+
+static bool gps_siteSurveyed(void)
+{
+    return siteKnown;
+}
+
+static void gps_siteInit(void)
+{
+    gps_siteAverageInit(&siteAverage);
+    siteKnown = gps_siteLoad(&site);
+    if (siteKnown)
+    {
+        printf("GPS site %.7f %.7f %.3fm loaded from flash\n", site.latitude / 1e7, site.longitude / 1e7, site.altitude / 1000.0);
+        reportGPSSite(site.latitude / 1e7f, site.longitude / 1e7f, site.altitude / 1000.0f);
+    }
+}
+#else
+static bool gps_siteFix(int32_t latitude, int32_t longitude, int32_t altitude)
+{
+    return true;
+}
+
+static void gps_dutyCycle(bool timed, TickType_t now)
+{
+}
+
+static bool gps_siteSurveyed(void)
+{
+    return false;
+}
+
+static void gps_siteInit(void)
+{
+}
+#endif
+
+/** while the receiver is in backup nothing arrives until it restarts */
+static TickType_t gps_receiveTimeout(void)
+{
+    return gpsAsleep ? pdMS_TO_TICKS(GPS_BACKUP_MS + GPS_MAX_AWAKE_MS) : pdMS_TO_TICKS(2000);
+}
+
+#if GPS_UBX_MODE
+/** switch the receiver to one NAV-PVT message per solution and no NMEA */
+static void ubx_configure(void)
+{
+    uint8_t frame[32];
+
+    ubx_send(frame, ubx_configureRate(GPS_UBX_RATE_MS, frame, sizeof(frame)));
+    ubx_send(frame, ubx_configureMessage(UBX_CLASS_NAV, UBX_NAV_PVT, 1, frame, sizeof(frame)));
+    ubx_send(frame, ubx_configurePort(GPS_BAUD, frame, sizeof(frame)));
+}
+
+static void gps_task(void *parameter)
+{
+    ubx_configure();
+    gps_siteInit();
+
+    for (;;)
+    {
+        ubx_pvt_buffer_t payload;
+        if (xQueueReceive(gpsQueue, payload, gps_receiveTimeout()) == pdTRUE)
+        {
+            isr_taskRunning(ISR_GPS);
+            TickType_t received = xTaskGetTickCount();
+            bool timed = false;
+            struct ubx_nav_pvt_s pvt;
+            ubx_decodeNavPvt(payload, sizeof(payload), &pvt);
+            switch (pvt.fixType)
+            {
+            case UBX_3D_FIX:
+            case UBX_GNSS_DEAD_RECKONING:
+                putGPSLED(true);
+                if ((pvt.valid & 0x07) == 0x07) // date, time and fully resolved
+                {
+                    // nano is a signed correction to the rounded second
+                    struct utc_time_s utc = {pvt.year, pvt.month, pvt.day, pvt.hour, pvt.minute, pvt.second, 0};
+                    timebase_fromEpochMs(timebase_toEpochMs(&utc) + pvt.nano / 1000000, &utc);
+                    timebase_gpsTime(&utc, received);
+                    timed = true;
+                }
+                if (gps_siteFix(pvt.latitude, pvt.longitude, pvt.heightMSL))
+                {
+                    reportGPSData(pvt.latitude / 1e7f, pvt.longitude / 1e7f, pvt.heightMSL / 1000.0f);
+                }
+                break;
+            case UBX_2D_FIX:
+                putGPSLED(true);
+                if (!gps_siteSurveyed())
+                {
+                    reportGPSData(pvt.latitude / 1e7f, pvt.longitude / 1e7f, pvt.heightMSL / 1000.0f);
+                }
+                break;
+            default:
+                putGPSLED(false);
+                break;
+            }
+            gps_dutyCycle(timed, received);
+        }
+        else
+        {
+            puts("No GPS data for 2 seconds.");
+            gps_dutyCycle(false, xTaskGetTickCount());
+        }
+    }
+}
+#else
 static void gps_task(void *parameter)
 {
     struct gps_tpv tpv;
+    struct nmea_epoch_s epoch = {""};
     gps_init_tpv(&tpv);
+    gps_siteInit();
 
     for (;;)
     {
         nmea_buffer_t nmea_message = {0};
-        if (xQueueReceive(gpsQueue, &nmea_message, pdMS_TO_TICKS(2000)) == pdTRUE)
+        if (xQueueReceive(gpsQueue, &nmea_message, gps_receiveTimeout()) == pdTRUE)
         {
+            isr_taskRunning(ISR_GPS);
+            TickType_t received = xTaskGetTickCount();
             bool report = false;
+            bool timed = false;
+            // GGA, RMC and GSA all update the fix, the site and discipline count it once a solution
+            bool newEpoch = nmea_newEpoch(&epoch, nmea_message);
             strncat(nmea_message, "\r\n", 3);
             int gps_error = gps_decode(&tpv, nmea_message);
             if (GPS_OK == gps_error)
@@ -106,27 +362,25 @@ static void gps_task(void *parameter)
                 {
                 case GPS_MODE_3D_FIX:
                     putGPSLED(true);
-                    report = true;
-                    if (strlen(tpv.time) > 0)
+                    report = !gps_siteSurveyed();
+                    struct utc_time_s utc;
+                    if (timebase_parseIso8601(tpv.time, &utc))
                     {
-                        float s;
-                        struct gps_date_t aDate;
-                        sscanf(tpv.time, "%d-%d-%dT%d:%d:%fZ", &aDate.year,
-                               &aDate.month, &aDate.day, &aDate.hour, &aDate.minute, &s);
-                        aDate.second = (int)s;
-                        aDate.goodTime = true;
-                        if (pdTRUE == xSemaphoreTake(dateSemaphore, pdMS_TO_TICKS(10)))
-                        {
-                            gpsDate = aDate;
-                            xSemaphoreGive(dateSemaphore);
-                            /* add some code to set the RTC from the GPS every so often */
+                        timebase_gpsTime(&utc, received);
+                        timed = newEpoch;
+                        if (newEpoch)
                             printf("GPS Time: %s\n", tpv.time);
-                        }
+                    }
+                    if (newEpoch && tpv.latitude != GPS_INVALID_VALUE && tpv.altitude != GPS_INVALID_VALUE)
+                    {
+                        report = gps_siteFix((int64_t)tpv.latitude * 10000000 / GPS_LAT_LON_FACTOR,
+                                             (int64_t)tpv.longitude * 10000000 / GPS_LAT_LON_FACTOR,
+                                             (int64_t)tpv.altitude * 1000 / GPS_VALUE_FACTOR);
                     }
                     break;
                 case GPS_MODE_2D_FIX:
                     putGPSLED(true);
-                    report = true;
+                    report = !gps_siteSurveyed();
                     break;
                 case GPS_MODE_NO_FIX:
                     putGPSLED(false);
@@ -151,19 +405,27 @@ static void gps_task(void *parameter)
                     }
                 }
             }
+            gps_dutyCycle(timed, received);
         }
         else
         {
             puts("No GPS data for 2 seconds.");
+            gps_dutyCycle(false, xTaskGetTickCount());
         }
     }
 }
+#endif
 
 void init_gps(void)
 {
-    dateSemaphore = xSemaphoreCreateBinary();
-    gpsQueue = xQueueCreate(10, sizeof(nmea_buffer_t));
-    xTaskCreate(gps_task, "GPS", 1000, NULL, 10, NULL);
+#if GPS_UBX_MODE
+    ubx_parserInit(&ubxParser);
+    gpsQueue = xQueueCreateStatic(GPS_UBX_QUEUE_LENGTH, sizeof(ubx_pvt_buffer_t), gpsQueueStorage, &gpsQueueBuffer);
+#else
+    nmea_filterInit(&nmeaFilter);
+    gpsQueue = xQueueCreateStatic(GPS_NMEA_QUEUE_LENGTH, sizeof(nmea_buffer_t), gpsQueueStorage, &gpsQueueBuffer);
+#endif
+    kernel_createTask(gps_task, "GPS", gpsStack, KERNEL_WORDS(gpsStack), NULL, 10, &gpsTaskBuffer);
 
     uart_init(GPS_UART, GPS_BAUD);
     gpio_set_function(GPS_TX_PIN, GPIO_FUNC_UART);
@@ -178,38 +440,9 @@ void init_gps(void)
     uart_set_irq_enables(GPS_UART, true, false);
 }
 
-static int day_of_week(int y, int m, int d)
+void gps_getRxStats(struct gps_rx_stats_s *stats)
 {
-    return (d += m < 3 ? y-- : y - 2, 23 * m / 9 + d + 4 + y / 4 - y / 100 + y / 400) % 7;
+    // the counters only ever increase so a torn read is off by at most one
+    *stats = gpsRxStats;
+    stats->awakeSeconds = (gpsAwakeMs + (gpsAsleep ? 0 : (xTaskGetTickCount() - gpsAwakeSince) * portTICK_PERIOD_MS)) / 1000;
 }
-
-BaseType_t gps_setTime()
-{
-    BaseType_t returnValue = pdFAIL;
-    datetime_t rtc_time;
-
-    if (rtc_get_datetime(&rtc_time) == false)
-    {
-        struct gps_date_t theDate = {false};
-        if (pdTRUE == xSemaphoreTake(dateSemaphore, pdMS_TO_TICKS(10)))
-        {
-            theDate = gpsDate;
-            xSemaphoreGive(dateSemaphore);
-            if (theDate.goodTime)
-            {
-                rtc_time.year = theDate.year;
-                rtc_time.month = theDate.month;
-                rtc_time.day = theDate.day;
-                rtc_time.dotw = day_of_week(theDate.year, theDate.month, theDate.day);
-                rtc_time.hour = theDate.hour;
-                rtc_time.min = theDate.minute;
-                rtc_time.sec = theDate.second;
-                rtc_init();
-                rtc_set_datetime(&rtc_time);
-
-                returnValue = pdPASS;
-            }
-        }
-    }
-    return returnValue;
-}
\ No newline at end of file
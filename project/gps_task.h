@@ -2,8 +2,20 @@
 #define _GPS_
 #include "FreeRTOS.h"
 
-void init_gps(void);
+/** receive path counters since boot */
+struct gps_rx_stats_s
+{
+    uint32_t bytes;     // bytes read from the UART
+    uint32_t queued;    // sentences (or NAV-PVT frames) passed to the GPS task
+    uint32_t dropped;   // valid but unused sentence types
+    uint32_t corrupt;   // bad or missing checksum
+    uint32_t overlong;  // lines too long for the buffer
+    uint32_t queueFull; // valid sentences lost because the task fell behind
+    uint32_t sleeps;       // fixed site mode: times the receiver was put in backup
+    uint32_t awakeSeconds; // time the receiver has been streaming
+};
 
-BaseType_t gps_setTime();
+void init_gps(void);
+void gps_getRxStats(struct gps_rx_stats_s *stats);
 
 #endif // _GPS_
\ No newline at end of file
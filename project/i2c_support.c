@@ -9,8 +9,12 @@
 #include "hardware/gpio.h"
 
 #include "pinmap.h"
+#include "capture.h"
+#include "log.h"
+#include "kernel_objects.h"
 
 SemaphoreHandle_t i2c_semaphore;
+static StaticSemaphore_t i2cSemaphoreBuffer;
 
 #define I2C_ACCESS_TIMEOUT_MS 10
 
@@ -19,7 +23,7 @@ const int I2C_BAUDRATE = 400 * 1000; // 400khz baudrate
 
 void i2c_sensorInit()
 {
-    i2c_semaphore = xSemaphoreCreateMutex();
+    i2c_semaphore = xSemaphoreCreateMutexStatic(&i2cSemaphoreBuffer);
 
     i2c_init(IC2_SELECTION, I2C_BAUDRATE);
     gpio_set_function(I2C_SCK_PIN, GPIO_FUNC_I2C);
@@ -33,11 +37,12 @@ uint8_t i2c_readRegisterSensors(uint8_t address, uint8_t reg)
     uint8_t v;
     while (pdTRUE != xSemaphoreTake(i2c_semaphore, I2C_ACCESS_TIMEOUT_MS))
     {
-        puts("i2c_readRegisterSensors: I2C semaphoretake timeout. retrying");
+        LOG_WARN("i2c_readRegisterSensors: I2C semaphoretake timeout. retrying");
         vTaskDelay(pdMS_TO_TICKS(10));
     }
     i2c_write_blocking(IC2_SELECTION, address, &reg, 1, true);
     i2c_read_blocking(IC2_SELECTION, address, &v, 1, false);
+    capture_i2c(address, reg, &v, 1);
     xSemaphoreGive(i2c_semaphore);
     return v;
 }
@@ -47,7 +52,7 @@ void i2c_writeRegisterSensors(uint8_t address, uint8_t reg, uint8_t value)
     uint8_t buffer[2] = {reg, value};
     while (pdTRUE != xSemaphoreTake(i2c_semaphore, I2C_ACCESS_TIMEOUT_MS))
     {
-        puts("i2c_writeRegisterSensors: I2C semaphoretake timeout. retrying");
+        LOG_WARN("i2c_writeRegisterSensors: I2C semaphoretake timeout. retrying");
         vTaskDelay(pdMS_TO_TICKS(10));
     }
     i2c_write_blocking(IC2_SELECTION, address, buffer, 2, false);
@@ -58,11 +63,12 @@ void i2c_readRegisterBlockSensors(uint8_t address, uint8_t reg, uint8_t *buffer,
 {
     while (pdTRUE != xSemaphoreTake(i2c_semaphore, I2C_ACCESS_TIMEOUT_MS))
     {
-        puts("i2c_readRegisterBlockSensors: I2C semaphoretake timeout. retrying");
+        LOG_WARN("i2c_readRegisterBlockSensors: I2C semaphoretake timeout. retrying");
         vTaskDelay(pdMS_TO_TICKS(10));
     }
     i2c_write_blocking(IC2_SELECTION, address, &reg, 1, true);
     i2c_read_blocking(IC2_SELECTION, address, buffer, bufferLen, false);
+    capture_i2c(address, reg, buffer, bufferLen);
     xSemaphoreGive(i2c_semaphore);
 }
 
@@ -71,11 +77,12 @@ uint16_t i2c_readWideRegisterSensors(uint8_t address, uint8_t reg)
     uint16_t v;
     while (pdTRUE != xSemaphoreTake(i2c_semaphore, I2C_ACCESS_TIMEOUT_MS))
     {
-        puts("i2c_readWideRegisterSensors: I2C semaphoretake timeout. retrying");
+        LOG_WARN("i2c_readWideRegisterSensors: I2C semaphoretake timeout. retrying");
         vTaskDelay(pdMS_TO_TICKS(10));
     }
     i2c_write_blocking(IC2_SELECTION, address, &reg, 1, true);
     i2c_read_blocking(IC2_SELECTION, address, (uint8_t *)&v, 2, false);
+    capture_i2c(address, reg, (uint8_t *)&v, 2);
     xSemaphoreGive(i2c_semaphore);
     return v;
 }
@@ -85,7 +92,7 @@ void i2c_writeWideRegisterSensors(uint8_t address, uint8_t reg, uint16_t value)
     uint8_t buffer[3] = {reg, value >> 8, value};
     while (pdTRUE != xSemaphoreTake(i2c_semaphore, I2C_ACCESS_TIMEOUT_MS))
     {
-        puts("i2c_writeWideRegisterSensors: I2C semaphoretake timeout. retrying");
+        LOG_WARN("i2c_writeWideRegisterSensors: I2C semaphoretake timeout. retrying");
         vTaskDelay(pdMS_TO_TICKS(10));
     }
     i2c_write_blocking(IC2_SELECTION, address, buffer, 3, false);
@@ -0,0 +1,123 @@
+#include "isr_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const char *const isr_sourceNames[ISR_SOURCES] = {"wind", "rain", "gps", "expresslink"};
+
+unsigned int isr_bucket(uint32_t us)
+{
+    if (us == 0)
+        return 0;
+    unsigned int bucket = 32 - __builtin_clz(us);
+    return bucket < ISR_BUCKETS ? bucket : ISR_BUCKETS - 1;
+}
+
+void isr_histogramAdd(struct isr_histogram_s *histogram, uint32_t us)
+{
+    histogram->counts[isr_bucket(us)]++;
+    if (us > histogram->maxUs)
+        histogram->maxUs = us;
+}
+
+int isr_formatHistogram(char *text, size_t length, const struct isr_histogram_s *histogram)
+{
+    uint32_t total = 0;
+    int last = 0;
+    for (int i = 0; i < ISR_BUCKETS; i++)
+    {
+        total += histogram->counts[i];
+        if (histogram->counts[i])
+            last = i;
+    }
+    int used = snprintf(text, length, "%10lu %8lu  ", (unsigned long)total, (unsigned long)histogram->maxUs);
+    for (int i = 0; i <= last && used < (int)length; i++)
+    {
+        used += snprintf(text + used, length - used, " %lu", (unsigned long)histogram->counts[i]);
+    }
+    return used;
+}
+
+#if ISR_STATS_ENABLED
+#include "FreeRTOS.h"
+#include "task.h"
+
+static struct isr_stats_s stats[ISR_SOURCES];
+static volatile uint32_t reportDuration[ISR_SOURCES];
+static volatile uint32_t reportWake[ISR_SOURCES];
+static volatile uint32_t postedAt[ISR_SOURCES];
+static volatile bool posted[ISR_SOURCES];
+
+/** raise a report maximum from a handler. Most calls are not a new maximum and take no lock */
+static void isr_raiseFromISR(volatile uint32_t *max, uint32_t us)
+{
+    if (us <= *max)
+        return;
+    UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+    if (us > *max)
+        *max = us;
+    taskEXIT_CRITICAL_FROM_ISR(state);
+}
+
+void isr_exit(enum isr_source_e source, uint32_t start, bool work)
+{
+    uint32_t now = time_us_32();
+    uint32_t us = now - start;
+    isr_histogramAdd(&stats[source].duration, us);
+    isr_raiseFromISR(&reportDuration[source], us);
+    // the oldest work not yet picked up is the one that waited longest
+    if (work && !posted[source])
+    {
+        postedAt[source] = now;
+        posted[source] = true;
+    }
+}
+
+void isr_taskRunning(enum isr_source_e source)
+{
+    if (!posted[source])
+        return;
+    uint32_t us = time_us_32() - postedAt[source];
+    posted[source] = false;
+    isr_histogramAdd(&stats[source].wake, us);
+    if (us > reportWake[source])
+    {
+        taskENTER_CRITICAL();
+        if (us > reportWake[source])
+            reportWake[source] = us;
+        taskEXIT_CRITICAL();
+    }
+}
+
+void isr_getStats(enum isr_source_e source, struct isr_stats_s *copy)
+{
+    memcpy(copy, &stats[source], sizeof(*copy));
+}
+
+void isr_takeReportMax(uint32_t durationUs[ISR_SOURCES], uint32_t wakeUs[ISR_SOURCES])
+{
+    taskENTER_CRITICAL();
+    for (int i = 0; i < ISR_SOURCES; i++)
+    {
+        durationUs[i] = reportDuration[i];
+        wakeUs[i] = reportWake[i];
+        reportDuration[i] = reportWake[i] = 0;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void isr_print(void)
+{
+    char text[160];
+    printf("%-16s%10s %8s   buckets: 0, 1, 2-3, 4-7 us ...\n", "isr", "count", "max_us");
+    for (int i = 0; i < ISR_SOURCES; i++)
+    {
+        struct isr_stats_s copy;
+        isr_getStats(i, &copy);
+        isr_formatHistogram(text, sizeof(text), &copy.duration);
+        printf("%-11s run  %s\n", isr_sourceNames[i], text);
+        isr_formatHistogram(text, sizeof(text), &copy.wake);
+        printf("%-11s wake %s\n", isr_sourceNames[i], text);
+    }
+}
+#endif // ISR_STATS_ENABLED
@@ -0,0 +1,68 @@
+#ifndef _ISR_STATS_
+#define _ISR_STATS_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** How long the busy interrupt handlers run and how long their work waits for the task.
+ * A handler takes the time on entry and hands it to isr_exit, which counts the duration and,
+ * when the handler passed work to its task, keeps the exit time. The task calls isr_taskRunning
+ * when its wait returns and the difference is the wake latency. Both go into log2 histograms
+ * of microseconds: bucket 0 is 0, bucket n is 2^(n-1) to 2^n - 1, the last takes the rest.
+ * Each handler runs on one core and each latency is taken by one task, so the histograms need
+ * no locks. The maxima for the report are zeroed by the reporter on either core, so they are
+ * raised and taken in a critical section, which a handler only enters for a new maximum.
+ */
+#ifndef ISR_STATS_ENABLED
+#define ISR_STATS_ENABLED 1 // two timer reads and a few adds per interrupt
+#endif
+
+#define ISR_BUCKETS 20 // the last starts at 2^18 us, a quarter second
+
+enum isr_source_e
+{
+    ISR_WIND,
+    ISR_RAIN,
+    ISR_GPS,
+    ISR_EXPRESSLINK,
+    ISR_SOURCES,
+};
+
+struct isr_histogram_s
+{
+    uint32_t counts[ISR_BUCKETS];
+    uint32_t maxUs;
+};
+
+struct isr_stats_s
+{
+    struct isr_histogram_s duration;
+    struct isr_histogram_s wake;
+};
+
+extern const char *const isr_sourceNames[ISR_SOURCES];
+
+unsigned int isr_bucket(uint32_t us);
+void isr_histogramAdd(struct isr_histogram_s *histogram, uint32_t us);
+/** count, max and the buckets up to the last one used, as text for the console */
+int isr_formatHistogram(char *text, size_t length, const struct isr_histogram_s *histogram);
+
+#if ISR_STATS_ENABLED
+#include "pico/time.h"
+
+#define isr_enter() time_us_32()
+void isr_exit(enum isr_source_e source, uint32_t start, bool work);
+void isr_taskRunning(enum isr_source_e source);
+void isr_getStats(enum isr_source_e source, struct isr_stats_s *stats);
+/** the longest duration and wake of each source since the last call, for the diagnostics report */
+void isr_takeReportMax(uint32_t durationUs[ISR_SOURCES], uint32_t wakeUs[ISR_SOURCES]);
+/** the histograms as console text */
+void isr_print(void);
+#else
+#define isr_enter() 0
+#define isr_exit(source, start, work) ((void)(start), (void)(work))
+#define isr_taskRunning(source)
+#endif
+
+#endif // _ISR_STATS_
@@ -0,0 +1,109 @@
+#include "kernel_objects.h"
+
+#include <stdio.h>
+
+#include "log.h"
+
+/** the stack of every task made from this table, the kernel's own included. A static task's
+ * handle is its StaticTask_t, so the kernel's tasks are known before they exist
+ */
+static struct
+{
+    TaskHandle_t handle;
+    const char *name;
+    uint32_t words;
+} stacks[KERNEL_TASKS_MAX];
+static int stackCount;
+
+static void kernel_addStack(TaskHandle_t handle, const char *name, uint32_t words)
+{
+    taskENTER_CRITICAL();
+    if (stackCount < KERNEL_TASKS_MAX)
+    {
+        stacks[stackCount].handle = handle;
+        stacks[stackCount].name = name;
+        stacks[stackCount].words = words;
+        stackCount++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+TaskHandle_t kernel_createTask(TaskFunction_t function, const char *name, StackType_t *stack, uint32_t words,
+                               void *parameter, UBaseType_t priority, StaticTask_t *buffer)
+{
+    TaskHandle_t handle = xTaskCreateStatic(function, name, words, parameter, priority, stack, buffer);
+    configASSERT(handle);
+    kernel_addStack(handle, name, words);
+    return handle;
+}
+
+/*********************************************************************************
+ * the kernel's idle and timer tasks
+ *********************************************************************************/
+static StackType_t idleStacks[configNUMBER_OF_CORES][KERNEL_STACK(IDLE_STACK_WORDS)];
+static StaticTask_t idleTaskBuffers[configNUMBER_OF_CORES];
+static StackType_t timerStack[KERNEL_STACK(TIMER_STACK_WORDS)];
+static StaticTask_t timerTaskBuffer;
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *words)
+{
+    *tcb = &idleTaskBuffers[0];
+    *stack = idleStacks[0];
+    *words = KERNEL_STACK(IDLE_STACK_WORDS);
+    kernel_addStack((TaskHandle_t)*tcb, "IDLE", *words);
+}
+
+#if configNUMBER_OF_CORES > 1
+void vApplicationGetPassiveIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *words, BaseType_t index)
+{
+    static const char *const names[] = {"IDLE1", "IDLE2", "IDLE3", "IDLE4", "IDLE5", "IDLE6", "IDLE7"};
+    *tcb = &idleTaskBuffers[index + 1];
+    *stack = idleStacks[index + 1];
+    *words = KERNEL_STACK(IDLE_STACK_WORDS);
+    kernel_addStack((TaskHandle_t)*tcb, names[index], *words);
+}
+#endif
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *words)
+{
+    *tcb = &timerTaskBuffer;
+    *stack = timerStack;
+    *words = KERNEL_STACK(TIMER_STACK_WORDS);
+    kernel_addStack((TaskHandle_t)*tcb, "Tmr Svc", *words);
+}
+
+/*********************************************************************************
+ * high water marks
+ *********************************************************************************/
+int kernel_checkStacks(void)
+{
+    int tight = 0;
+    for (int i = 0; i < stackCount; i++)
+    {
+        uint32_t free = uxTaskGetStackHighWaterMark(stacks[i].handle);
+        if (free * 100 < stacks[i].words * KERNEL_STACK_MARGIN_PERCENT)
+        {
+            LOG_WARN("%s stack: %lu of %lu words never used", stacks[i].name, (unsigned long)free, (unsigned long)stacks[i].words);
+            tight++;
+        }
+    }
+    return tight;
+}
+
+void kernel_printStacks(void)
+{
+    uint32_t totalWords = 0;
+    uint32_t totalUsed = 0;
+    printf("%-12s %8s %8s %5s\n", "task", "words", "max_used", "used");
+    for (int i = 0; i < stackCount; i++)
+    {
+        uint32_t used = stacks[i].words - uxTaskGetStackHighWaterMark(stacks[i].handle);
+        printf("%-12s %8lu %8lu %4lu%%%s\n", stacks[i].name, (unsigned long)stacks[i].words, (unsigned long)used,
+               (unsigned long)(used * 100 / stacks[i].words),
+               (stacks[i].words - used) * 100 < stacks[i].words * KERNEL_STACK_MARGIN_PERCENT ? " tight" : "");
+        totalWords += stacks[i].words;
+        totalUsed += used;
+    }
+    printf("%-12s %8lu %8lu   %lu bytes a word\n", "total", (unsigned long)totalWords, (unsigned long)totalUsed,
+           (unsigned long)sizeof(StackType_t));
+}
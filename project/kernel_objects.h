@@ -0,0 +1,56 @@
+#ifndef _KERNEL_OBJECTS_
+#define _KERNEL_OBJECTS_
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Every task, queue, mutex, event group and timer is created static, so the RAM they take
+ * is in each module's .bss where the build's RAM budget report (tools/ram_budget.cmake)
+ * counts it, and nothing comes out of the FreeRTOS heap at run time.
+ * The sizes are all in the table below. The owning module declares the storage with them
+ * and creates its tasks through kernel_createTask, which lets the stack check match each
+ * task's high water mark to the size it was given.
+ */
+
+/** task stacks, in StackType_t words (4 bytes on the RP2040). "stacks" on the console
+ * prints the high water marks to size them by
+ */
+#define WIND_STACK_WORDS 1000
+#define RAIN_STACK_WORDS 500
+#define GPS_STACK_WORDS 1000
+#define PPS_STACK_WORDS 500
+#define TEMPERATURE_STACK_WORDS 1000
+#define PRESSURE_STACK_WORDS 1000
+#define REPORTING_STACK_WORDS 10240
+#define PUBLISH_STACK_WORDS 1000
+#define CAPTURE_STACK_WORDS 500
+#define LOG_STACK_WORDS 500
+#define CONSOLE_STACK_WORDS 500
+#define IDLE_STACK_WORDS configMINIMAL_STACK_SIZE // one idle task per core
+#define TIMER_STACK_WORDS configTIMER_TASK_STACK_DEPTH
+
+/** queue lengths in items, the item types stay with the modules */
+#define WIND_QUEUE_LENGTH 10
+#define RAIN_QUEUE_LENGTH 5
+#define GPS_UBX_QUEUE_LENGTH 4
+#define GPS_NMEA_QUEUE_LENGTH 10
+#define PPS_QUEUE_LENGTH 4
+
+/** a stack the port can run on. The sim raises them all to the pthread sized minimum */
+#define KERNEL_STACK(words) ((words) > configMINIMAL_STACK_SIZE ? (words) : configMINIMAL_STACK_SIZE)
+#define KERNEL_WORDS(stack) (sizeof(stack) / sizeof(*(stack)))
+
+#define KERNEL_TASKS_MAX 24            // the stack table, the kernel's own tasks included
+#define KERNEL_STACK_MARGIN_PERCENT 10 // less free than this is logged as a warning
+
+/** xTaskCreateStatic, and the stack goes in the table for the check */
+TaskHandle_t kernel_createTask(TaskFunction_t function, const char *name, StackType_t *stack, uint32_t words,
+                               void *parameter, UBaseType_t priority, StaticTask_t *buffer);
+/** log a warning for every task with less than KERNEL_STACK_MARGIN_PERCENT of its stack left
+ * since boot. Returns how many there are
+ */
+int kernel_checkStacks(void);
+/** every task's stack size, high water mark and use, as console text */
+void kernel_printStacks(void);
+
+#endif // _KERNEL_OBJECTS_
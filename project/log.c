@@ -0,0 +1,483 @@
+#include "log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t log_putVarint(uint8_t *out, uint64_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+size_t log_getVarint(const uint8_t *in, size_t length, uint64_t *value)
+{
+    *value = 0;
+    for (size_t i = 0; i < length && i < 10; i++)
+    {
+        *value |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80))
+            return i + 1;
+    }
+    return 0; // ran off the end
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/** one conversion of a printf format, what log_record stores for it */
+struct log_spec_s
+{
+    const char *start; // the %
+    const char *end;   // after the conversion character
+    bool starWidth;
+    bool starPrecision;
+    int precision; // -1 for none
+    int longs;     // l count, h and the rest do not change what is stored
+    char conversion;
+};
+
+/** the next conversion at or after format, false at the end */
+static bool log_nextSpec(const char *format, struct log_spec_s *spec)
+{
+    const char *p = format;
+    for (;;)
+    {
+        p = strchr(p, '%');
+        if (p == NULL)
+            return false;
+        if (p[1] != '%')
+            break;
+        p += 2;
+    }
+    spec->start = p++;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+        p++;
+    spec->starWidth = *p == '*';
+    if (spec->starWidth)
+        p++;
+    while (*p >= '0' && *p <= '9')
+        p++;
+    spec->starPrecision = false;
+    spec->precision = -1;
+    if (*p == '.')
+    {
+        p++;
+        spec->starPrecision = *p == '*';
+        if (spec->starPrecision)
+            p++;
+        spec->precision = 0;
+        while (*p >= '0' && *p <= '9')
+            spec->precision = spec->precision * 10 + *p++ - '0';
+    }
+    spec->longs = 0;
+    while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't')
+        spec->longs += *p++ == 'l';
+    spec->conversion = *p;
+    spec->end = *p ? p + 1 : p;
+    return *p != 0;
+}
+
+/*********************************************************************************
+ * host side, turning a record back into text
+ *********************************************************************************/
+struct log_text_s
+{
+    char *text;
+    size_t length;
+    size_t used;
+};
+
+static void log_append(struct log_text_s *out, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out->text + out->used, out->length - out->used, format, args);
+    va_end(args);
+    if (n > 0)
+        out->used += (size_t)n < out->length - out->used ? (size_t)n : out->length - out->used - 1;
+}
+
+/** format text up to end, %% is a single % */
+static void log_appendLiteral(struct log_text_s *out, const char *literal, const char *end)
+{
+    while (literal < end && out->used < out->length - 1)
+    {
+        out->text[out->used++] = *literal;
+        literal += literal[0] == '%' && literal + 1 < end && literal[1] == '%' ? 2 : 1;
+    }
+    out->text[out->used] = 0;
+}
+
+int log_format(char *text, size_t textLength, const char *format, const uint8_t *args, size_t argsLength)
+{
+    struct log_text_s out = {text, textLength, 0};
+    struct log_spec_s spec;
+    const char *literal = format;
+    size_t in = 0;
+    text[0] = 0;
+
+    while (log_nextSpec(literal, &spec))
+    {
+        log_appendLiteral(&out, literal, spec.start);
+        literal = spec.end;
+
+        // the conversion again with the stars filled in and without a length, added back below
+        char rebuilt[40];
+        size_t r = 0;
+        uint64_t value;
+        size_t n;
+        for (const char *p = spec.start; p < spec.end - 1 && r < 24; p++)
+        {
+            if (*p == '*')
+            {
+                if ((n = log_getVarint(args + in, argsLength - in, &value)) == 0)
+                    goto truncated;
+                in += n;
+                r += snprintf(rebuilt + r, sizeof(rebuilt) - r, "%lld", (long long)unzigzag(value));
+            }
+            else if (*p != 'h' && *p != 'l' && *p != 'z' && *p != 'j' && *p != 't')
+            {
+                rebuilt[r++] = *p;
+            }
+        }
+        rebuilt[r] = 0;
+
+        if (strchr("dicuxXopfFeEgGaAs", spec.conversion) == NULL)
+        {
+            log_appendLiteral(&out, spec.start, spec.end);
+            continue;
+        }
+        if (strchr("fFeEgGaA", spec.conversion))
+        {
+            float f;
+            if (argsLength - in < sizeof(f))
+                goto truncated;
+            memcpy(&f, args + in, sizeof(f));
+            in += sizeof(f);
+            snprintf(rebuilt + r, sizeof(rebuilt) - r, "%c", spec.conversion);
+            log_append(&out, rebuilt, (double)f);
+            continue;
+        }
+        if ((n = log_getVarint(args + in, argsLength - in, &value)) == 0)
+            goto truncated;
+        in += n;
+        switch (spec.conversion)
+        {
+        case 'd':
+        case 'i':
+            snprintf(rebuilt + r, sizeof(rebuilt) - r, "lld");
+            log_append(&out, rebuilt, (long long)unzigzag(value));
+            break;
+        case 'c':
+            snprintf(rebuilt + r, sizeof(rebuilt) - r, "c");
+            log_append(&out, rebuilt, (int)value);
+            break;
+        case 'p':
+            log_append(&out, "0x%llx", (unsigned long long)value);
+            break;
+        case 's':
+        {
+            // the bytes were cut to the precision when they were stored
+            char *dot = strchr(rebuilt, '.');
+            snprintf(dot ? dot : rebuilt + r, sizeof(rebuilt) - r, ".*s");
+            if (value > argsLength - in)
+                goto truncated;
+            log_append(&out, rebuilt, (int)value, (const char *)args + in);
+            in += value;
+            break;
+        }
+        default:
+            snprintf(rebuilt + r, sizeof(rebuilt) - r, "ll%c", spec.conversion);
+            log_append(&out, rebuilt, (unsigned long long)value);
+            break;
+        }
+    }
+    log_appendLiteral(&out, literal, literal + strlen(literal));
+    return out.used;
+
+truncated:
+    log_append(&out, "<truncated>");
+    return out.used;
+}
+
+#if LOG_DEFERRED
+/*********************************************************************************
+ * station side
+ *********************************************************************************/
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hardware/sync.h"
+#include "pico/stdio.h"
+#include "pico/stdlib.h"
+
+#include "capture.h"
+#include "kernel_objects.h"
+
+#define LOG_PRIORITY 1
+#define LOG_RING_SIZE 2048 // per core, a power of two
+#define LOG_DRAIN_MS 500 // the sim wakes for this as well, so not too often
+#define LOG_HEADER_MAX (1 + 3 + 10)
+
+/** One ring per core. A record is written with the interrupts of its core off, so tasks and
+ * handlers on that core take turns and the two cores never share a ring. The drain task is
+ * the only reader; head and tail are the only words both sides touch.
+ */
+struct log_ring_s
+{
+    uint8_t data[LOG_RING_SIZE];
+    uint32_t head;     // free running, published after the record is in
+    uint32_t tail;     // free running, only the drain task moves it
+    uint64_t lastUs;   // time of the newest record
+    uint64_t drainUs;  // time of the last record taken
+    uint32_t dropped;  // since the last dropped record was written
+    struct log_stats_s stats;
+};
+
+static struct log_ring_s rings[NUM_CORES];
+
+extern const char __start_logfmt[];
+static const char droppedFormat[] __attribute__((section(LOG_SECTION), used)) = "\002log: %lu records dropped";
+
+static void ringPut(struct log_ring_s *ring, uint32_t head, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        ring->data[(head + i) & (LOG_RING_SIZE - 1)] = data[i];
+    }
+}
+
+/** write the header and the arguments as one record, false when it does not fit with reserve
+ * bytes to spare
+ */
+static bool log_put(struct log_ring_s *ring, uint32_t *head, const char *format, uint64_t now, const uint8_t *args,
+                    size_t argsLength, size_t reserve)
+{
+    uint8_t header[LOG_HEADER_MAX];
+    size_t headerLength = 1 + log_putVarint(header + 1, format - __start_logfmt);
+    headerLength += log_putVarint(header + headerLength, now - ring->lastUs);
+    header[0] = headerLength - 1 + argsLength;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (*head - tail + headerLength + argsLength + reserve > LOG_RING_SIZE)
+        return false;
+    ringPut(ring, *head, header, headerLength);
+    ringPut(ring, *head + headerLength, args, argsLength);
+    *head += headerLength + argsLength;
+    ring->lastUs = now;
+    ring->stats.records++;
+    ring->stats.bytes += headerLength + argsLength;
+    return true;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+/** the arguments in format order, see log.h */
+static size_t log_encode(const char *format, va_list args, uint8_t *out, size_t length)
+{
+    size_t used = 0;
+    struct log_spec_s spec;
+    while (log_nextSpec(format, &spec) && used + 10 <= length)
+    {
+        format = spec.end;
+        if (spec.starWidth)
+            used += log_putVarint(out + used, zigzag(va_arg(args, int)));
+        if (spec.starPrecision)
+        {
+            spec.precision = va_arg(args, int);
+            used += log_putVarint(out + used, zigzag(spec.precision));
+        }
+        switch (spec.conversion)
+        {
+        case 'd':
+        case 'i':
+            if (spec.longs >= 2)
+                used += log_putVarint(out + used, zigzag(va_arg(args, long long)));
+            else if (spec.longs == 1)
+                used += log_putVarint(out + used, zigzag(va_arg(args, long)));
+            else
+                used += log_putVarint(out + used, zigzag(va_arg(args, int)));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            if (spec.longs >= 2)
+                used += log_putVarint(out + used, va_arg(args, unsigned long long));
+            else if (spec.longs == 1)
+                used += log_putVarint(out + used, va_arg(args, unsigned long));
+            else
+                used += log_putVarint(out + used, va_arg(args, unsigned int));
+            break;
+        case 'c':
+            used += log_putVarint(out + used, (unsigned int)va_arg(args, int));
+            break;
+        case 'p':
+            used += log_putVarint(out + used, (uintptr_t)va_arg(args, void *));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+        {
+            float f = va_arg(args, double);
+            memcpy(out + used, &f, sizeof(f));
+            used += sizeof(f);
+            break;
+        }
+        case 's':
+        {
+            const char *s = va_arg(args, const char *);
+            size_t limit = LOG_STRING_MAX;
+            if (spec.precision >= 0 && spec.precision < limit)
+                limit = spec.precision;
+            if (limit > length - used - 2)
+                limit = length - used - 2;
+            size_t n = s ? strnlen(s, limit) : 0;
+            used += log_putVarint(out + used, n);
+            if (n)
+                memcpy(out + used, s, n);
+            used += n;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return used;
+}
+
+void log_record(const char *format, ...)
+{
+    uint8_t args[LOG_RECORD_MAX - LOG_HEADER_MAX];
+    va_list list;
+    va_start(list, format);
+    size_t argsLength = log_encode(format + 1, list, args, sizeof(args));
+    va_end(list);
+
+    uint32_t interrupts = save_and_disable_interrupts();
+    struct log_ring_s *ring = &rings[get_core_num()];
+    uint64_t now = time_us_64();
+    uint32_t head = ring->head;
+    if (ring->dropped)
+    {
+        // only with room for this record too, or every call would count one drop
+        uint8_t count[10];
+        if (log_put(ring, &head, droppedFormat, now, count, log_putVarint(count, ring->dropped), LOG_HEADER_MAX + argsLength))
+            ring->dropped = 0;
+    }
+    if (ring->dropped || !log_put(ring, &head, format, now, args, argsLength, 0))
+    {
+        ring->dropped++;
+        ring->stats.dropped++;
+    }
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    restore_interrupts(interrupts);
+}
+
+size_t log_take(unsigned int core, uint8_t *out, size_t length, uint64_t *time)
+{
+    struct log_ring_s *ring = &rings[core];
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+    size_t used = 0;
+    *time = ring->drainUs;
+    while (tail != head)
+    {
+        size_t recordLength = 1 + ring->data[tail & (LOG_RING_SIZE - 1)];
+        if (used + recordLength > length)
+            break;
+        for (size_t i = 0; i < recordLength; i++)
+        {
+            out[used + i] = ring->data[(tail + i) & (LOG_RING_SIZE - 1)];
+        }
+        // follow the record times so the frame can say where they start
+        uint64_t skip;
+        uint64_t delta;
+        size_t n = log_getVarint(out + used + 1, recordLength - 1, &skip);
+        log_getVarint(out + used + 1 + n, recordLength - 1 - n, &delta);
+        ring->drainUs += delta;
+        used += recordLength;
+        tail += recordLength;
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return used;
+}
+
+void log_getStats(struct log_stats_s *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int core = 0; core < NUM_CORES; core++)
+    {
+        stats->records += rings[core].stats.records;
+        stats->bytes += rings[core].stats.bytes;
+        stats->dropped += rings[core].stats.dropped;
+        stats->written += rings[core].stats.written;
+    }
+}
+
+/** frames like capture.c so the console can carry both */
+static void log_drain(void)
+{
+    static uint8_t records[CAPTURE_FRAME_MAX - 16];
+    static uint8_t frame[CAPTURE_FRAME_MAX];
+    for (unsigned int core = 0; core < NUM_CORES; core++)
+    {
+        uint64_t time;
+        size_t length;
+        while ((length = log_take(core, records, sizeof(records), &time)) > 0)
+        {
+            size_t payload = 4;
+            frame[payload++] = core;
+            payload += log_putVarint(frame + payload, time);
+            memcpy(frame + payload, records, length);
+            payload += length;
+            uint8_t sum = 0;
+            for (size_t i = 4; i < payload; i++)
+            {
+                sum += frame[i];
+            }
+            frame[0] = CAPTURE_FRAME_START;
+            frame[1] = LOG_FRAME;
+            frame[2] = (payload - 4) & 0xFF;
+            frame[3] = (payload - 4) >> 8;
+            frame[payload] = sum;
+            // only this task waits when USB is slow or the host is not reading
+            stdio_put_string((const char *)frame, payload + 1, false, false);
+            rings[core].stats.written += payload + 1;
+        }
+    }
+}
+
+static void log_task(void *parameter)
+{
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+        log_drain();
+    }
+}
+
+static StackType_t logStack[KERNEL_STACK(LOG_STACK_WORDS)];
+static StaticTask_t logTaskBuffer;
+
+void init_log(void)
+{
+    kernel_createTask(log_task, "Log", logStack, KERNEL_WORDS(logStack), NULL, LOG_PRIORITY, &logTaskBuffer);
+}
+#endif // LOG_DEFERRED
@@ -0,0 +1,109 @@
+#ifndef _LOG_
+#define _LOG_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Deferred binary logging for the busy paths.
+ * A LOG_x call keeps its format string in the logfmt section and writes only the offset of
+ * the string, the time and the arguments to a RAM ring of the core it runs on. Nothing is
+ * formatted on the station: a low priority task sends the rings to USB in frames between
+ * the console text and the weather_log host tool expands them with the strings from the ELF.
+ *
+ * A record in the ring:
+ *   byte     length of the rest of the record
+ *   varint   offset of the format string in logfmt. The first byte of the string is the level
+ *   varint   microseconds since the previous record on this core
+ *   args     in format order: integers as varints, signed ones zigzagged, a * width or
+ *            precision the same way, doubles as 4 byte floats, strings as varint length and
+ *            bytes cut at LOG_STRING_MAX
+ * varints are LEB128 as in capture.h. A full ring drops records and counts them.
+ *
+ * Over USB a frame is
+ *   CAPTURE_FRAME_START 'L' length-lo length-hi core varint-time-before-the-first data sum-of-data-bytes
+ * where data is whole records and the time is in microseconds since boot.
+ */
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO // calls above this level are compiled out, arguments and all
+#endif
+#ifndef LOG_DEFERRED
+#define LOG_DEFERRED 1 // 0 prints each call with printf, for a terminal without weather_log
+#endif
+
+#define LOG_FRAME 'L'
+#define LOG_RECORD_MAX 128
+#define LOG_STRING_MAX 48
+#define LOG_SECTION "logfmt"
+
+struct log_stats_s
+{
+    uint32_t records;
+    uint32_t bytes;
+    uint32_t dropped; // ring full
+    uint32_t written; // bytes sent to USB
+};
+
+#if LOG_DEFERRED
+/** the level goes in front of the format as a control character, "\001" to "\004" */
+#define LOG_AT(tag, format, ...)                                                                \
+    do                                                                                          \
+    {                                                                                           \
+        static const char logFormat[] __attribute__((section(LOG_SECTION), used)) = tag format; \
+        log_record(logFormat, ##__VA_ARGS__);                                                   \
+    } while (0)
+#else
+#include <stdio.h>
+#define LOG_AT(tag, format, ...) printf(format "\n", ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) LOG_AT("\001", format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...) LOG_AT("\002", format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...) LOG_AT("\003", format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) LOG_AT("\004", format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) ((void)0)
+#endif
+
+#if LOG_DEFERRED
+/** start the drain task */
+void init_log(void);
+/** safe from tasks and interrupt handlers on either core. format must be in logfmt */
+void log_record(const char *format, ...) __attribute__((format(printf, 1, 2)));
+/** move whole records of one core's ring into out, the time before the first goes in time.
+ * The drain task uses this, so does the benchmark
+ */
+size_t log_take(unsigned int core, uint8_t *out, size_t length, uint64_t *time);
+void log_getStats(struct log_stats_s *stats);
+#else
+#define init_log()
+#endif
+
+/** the host side of the encoding, shared by weather_log */
+size_t log_putVarint(uint8_t *out, uint64_t value);
+size_t log_getVarint(const uint8_t *in, size_t length, uint64_t *value);
+/** expand one record's arguments with its format into text, returns the text length.
+ * A record that ends early gets <truncated> at the end
+ */
+int log_format(char *text, size_t textLength, const char *format, const uint8_t *args, size_t argsLength);
+
+#endif // _LOG_
@@ -18,6 +18,14 @@
 #include "reporting_task.h"
 #include "temperature_task.h"
 #include "pressure_task.h"
+#include "timebase.h"
+#include "scheduler.h"
+#include "publish_queue.h"
+#include "alerts.h"
+#include "pps_task.h"
+#include "capture.h"
+#include "log.h"
+#include "console.h"
 
 #include "switch_inputs.pio.h"
 
@@ -32,6 +40,9 @@ static int8_t pio_irq;
 int main()
 {
 	stdio_init_all();
+	init_capture();
+	init_log();
+	init_console();
 
 	i2c_sensorInit();
 
@@ -40,10 +51,15 @@ int main()
 	gpio_pull_up(WIND_SPEED_PIN);
 	gpio_pull_up(RAIN_BUCKET_PIN);
 
+	init_timebase();
+	init_scheduler();
+	init_publish_queue();
+	init_alerts();
 	init_reporting();
 	init_rain();
 	init_wind();
 	init_gps();
+	init_pps();
 	init_temperature();
 	init_pressure();
 
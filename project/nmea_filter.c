@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include "nmea_filter.h"
+
+/** only these sentence types are queued for gps_decode. Everything else is dropped in the ISR */
+#define NMEA_SENTENCES {"GGA", "RMC", "GSA"}
+
+enum nmea_state_e
+{
+    NMEA_IDLE,       // waiting for '$'
+    NMEA_BODY,       // accumulating the checksum until '*'
+    NMEA_CHECKSUM_1, // first hex digit
+    NMEA_CHECKSUM_2, // second hex digit
+};
+
+static const char *const nmeaSentences[] = NMEA_SENTENCES;
+
+static bool nmea_wanted(const char *type)
+{
+    for (int i = 0; i < sizeof(nmeaSentences) / sizeof(*nmeaSentences); i++)
+    {
+        if (memcmp(type, nmeaSentences[i], 3) == 0)
+            return true;
+    }
+    return false;
+}
+
+static int nmea_hex(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    return -1;
+}
+
+void nmea_filterInit(struct nmea_filter_s *filter)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->state = NMEA_IDLE;
+}
+
+bool nmea_filterByte(struct nmea_filter_s *filter, char ch)
+{
+    int digit;
+
+    if (ch == '$') // a start always begins a new sentence
+    {
+        if (filter->state != NMEA_IDLE)
+            filter->corrupt++;
+        filter->state = NMEA_BODY;
+        filter->checksum = 0;
+        filter->length = 0;
+        filter->sentence[filter->length++] = ch;
+        return false;
+    }
+
+    switch (filter->state)
+    {
+    case NMEA_IDLE: // discard the \r\n and any noise between sentences
+        break;
+    case NMEA_BODY:
+        if (ch == '\r' || ch == '\n') // the line ended without a checksum
+        {
+            filter->corrupt++;
+            filter->state = NMEA_IDLE;
+            break;
+        }
+        if (filter->length >= sizeof(filter->sentence) - 6) // leave room for *hh and the \r\n the task adds
+        {
+            filter->overlong++;
+            filter->state = NMEA_IDLE;
+            break;
+        }
+        filter->sentence[filter->length++] = ch;
+        if (ch == '*')
+        {
+            filter->state = NMEA_CHECKSUM_1;
+            break;
+        }
+        filter->checksum ^= ch;
+        if (filter->length == 6 && !nmea_wanted(&filter->sentence[3])) // $ttsss
+        {
+            filter->dropped++;
+            filter->state = NMEA_IDLE;
+        }
+        break;
+    case NMEA_CHECKSUM_1:
+        digit = nmea_hex(ch);
+        filter->sentence[filter->length++] = ch;
+        filter->received = digit << 4;
+        filter->state = NMEA_CHECKSUM_2;
+        if (digit < 0)
+        {
+            filter->corrupt++;
+            filter->state = NMEA_IDLE;
+        }
+        break;
+    case NMEA_CHECKSUM_2:
+        digit = nmea_hex(ch);
+        filter->sentence[filter->length++] = ch;
+        filter->sentence[filter->length] = 0;
+        filter->state = NMEA_IDLE;
+        if (digit < 0 || (filter->received | digit) != filter->checksum)
+        {
+            filter->corrupt++;
+            break;
+        }
+        return true;
+    default:
+        filter->state = NMEA_IDLE;
+        break;
+    }
+    return false;
+}
+
+bool nmea_newEpoch(struct nmea_epoch_s *epoch, const char *sentence)
+{
+    if (strlen(sentence) < 7 || sentence[0] != '$' || memcmp(&sentence[3], "GGA,", 4) != 0) // $ttGGA,
+        return false;
+    const char *time = &sentence[7];
+    size_t length = strcspn(time, ",*");
+    if (length == 0 || length >= sizeof(epoch->time))
+        return false;
+    if (strncmp(epoch->time, time, length) == 0 && epoch->time[length] == 0)
+        return false;
+    memcpy(epoch->time, time, length);
+    epoch->time[length] = 0;
+    return true;
+}
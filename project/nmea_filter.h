@@ -0,0 +1,42 @@
+#ifndef _NMEA_FILTER_
+#define _NMEA_FILTER_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** NMEA 0183 sentence filter for the GPS receive interrupt.
+ * A sentence starts on '$', the body is XORed up to '*' and the two hex digits after it must
+ * match. The type is checked against NMEA_SENTENCES as soon as the "$ttsss" header is in, so
+ * unwanted sentences cost one compare and are not copied any further.
+ */
+#define NMEA_SENTENCE_MAX 85 // the longest sentence is 82 bytes, the task adds \r\n and the 0
+
+struct nmea_filter_s
+{
+    uint8_t state;
+    uint8_t checksum;
+    uint8_t received;
+    uint8_t length;
+    char sentence[NMEA_SENTENCE_MAX]; // "$...*hh", 0 terminated when complete
+    uint32_t dropped;  // valid but unused sentence types
+    uint32_t corrupt;  // bad or missing checksum
+    uint32_t overlong; // lines too long for the buffer
+};
+
+/** The receiver sends several sentences for each navigation solution. The GGA carries the
+ * position, the fix quality and the altitude, so a solution is counted once, on its GGA.
+ */
+struct nmea_epoch_s
+{
+    char time[12]; // the hhmmss.ss field of the last GGA counted
+};
+
+void nmea_filterInit(struct nmea_filter_s *filter);
+/** feed one received byte. Returns true when a complete wanted sentence with a valid checksum is
+ * in filter->sentence
+ */
+bool nmea_filterByte(struct nmea_filter_s *filter, char ch);
+/** true when sentence is the GGA of a solution that has not been counted yet */
+bool nmea_newEpoch(struct nmea_epoch_s *epoch, const char *sentence);
+
+#endif // _NMEA_FILTER_
@@ -19,11 +19,15 @@
 #define CLICK_SCL_PIN 11
 #define CLICK_PWM_PIN 15
 
+// the ExpressLink does not use the click I2C pins, the GPS PPS is wired to SCL
+#define GPS_PPS_PIN CLICK_SCL_PIN
+
 #define WIND_LED_PIN 8
 #define RAIN_LED_PIN 7
 #define GPS_LED_PIN 3
 #define BMP_LED_PIN 2
 #define TMP_LED_PIN 1
 #define REPORT_LED_PIN 0
+#define TMP_ALERT_PIN 6
 #define VSYS_PIN 29
 #define VSYS_ADC 3
\ No newline at end of file
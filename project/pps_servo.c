@@ -0,0 +1,86 @@
+#include "pps_servo.h"
+
+#define PPS_LOCK_PULSES 8        // consecutive good pulses before the servo is trusted
+#define PPS_OUTLIER_PPM 100.0f   // a second further off than this is a glitch or a missed pulse
+#define PPS_MAX_GAP_SECONDS 60   // the counter wraps after 68 seconds at 62.5MHz
+#define PPS_FREQUENCY_GAIN 16.0f // frequency filter time constant in pulses
+
+void pps_servoInit(struct pps_servo_s *servo, uint32_t nominalCounts)
+{
+    *servo = (struct pps_servo_s){0};
+    servo->nominalCounts = nominalCounts;
+}
+
+bool pps_servoLocked(const struct pps_servo_s *servo)
+{
+    return servo->labeled && servo->goodPulses >= PPS_LOCK_PULSES;
+}
+
+void pps_servoUpdate(struct pps_servo_s *servo, uint32_t count, uint64_t micros, int64_t utcEstimateMs)
+{
+    uint32_t seconds = 0;
+    servo->pulses++;
+
+    if (servo->havePrevious)
+    {
+        // the microsecond timer says how many seconds passed. The counter says exactly how long they were.
+        seconds = (uint32_t)((micros - servo->previousMicros + 500000) / 1000000);
+        if (seconds == 0 || seconds > PPS_MAX_GAP_SECONDS)
+        {
+            servo->goodPulses = 0;
+            servo->labeled = false;
+            seconds = 0;
+        }
+        else
+        {
+            uint32_t counts = count - servo->previousCount; // modulo 2^32
+            int64_t expected = (int64_t)servo->nominalCounts * seconds;
+            float ppm = (float)((int64_t)counts - expected) * 1e6f / (float)expected;
+            servo->lastPpm = ppm;
+
+            float error = ppm - servo->driftPpm;
+            if (servo->goodPulses > 0 && (error > PPS_OUTLIER_PPM || error < -PPS_OUTLIER_PPM))
+            {
+                servo->outliers++;
+                servo->goodPulses = 0;
+            }
+            else if (servo->goodPulses < PPS_LOCK_PULSES)
+            {
+                // average the first measurements so the filter starts near the answer
+                servo->goodPulses++;
+                servo->driftPpm += error / servo->goodPulses;
+            }
+            else
+            {
+                servo->driftPpm += error / PPS_FREQUENCY_GAIN;
+            }
+        }
+    }
+
+    if (servo->labeled && seconds > 0)
+    {
+        servo->anchorUtcMicros += (int64_t)seconds * 1000000;
+    }
+    else if (utcEstimateMs > 0)
+    {
+        // The coarse clock comes from NMEA, which arrives after the pulse it describes, so it
+        // lags by a fraction of a second. The edge is at the next whole second.
+        servo->anchorUtcMicros = (utcEstimateMs / 1000 + 1) * 1000000;
+        servo->labeled = true;
+    }
+    servo->anchorMicros = micros;
+    servo->previousCount = count;
+    servo->previousMicros = micros;
+    servo->havePrevious = true;
+}
+
+bool pps_servoToUtc(const struct pps_servo_s *servo, uint64_t micros, int64_t *utcMicros)
+{
+    if (!pps_servoLocked(servo))
+        return false;
+
+    int64_t elapsed = (int64_t)(micros - servo->anchorMicros);
+    // a fast local clock counts too many microseconds so they are scaled down
+    *utcMicros = servo->anchorUtcMicros + elapsed - (int64_t)((float)elapsed * servo->driftPpm * 1e-6f);
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef _PPS_SERVO_
+#define _PPS_SERVO_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** PPS servo: measures the local crystal against the GPS second and maps local
+ * microsecond timestamps to UTC.
+ */
+struct pps_servo_s
+{
+    uint32_t nominalCounts; // counter ticks per second for a perfect crystal
+    bool havePrevious;
+    uint32_t previousCount;
+    uint64_t previousMicros;
+    bool labeled;             // the UTC second of the anchor is known
+    int64_t anchorUtcMicros;  // UTC of the last PPS edge
+    uint64_t anchorMicros;    // local time of the last PPS edge
+    float driftPpm;           // filtered frequency error, positive when the local clock is fast
+    float lastPpm;            // raw measurement of the last second
+    uint16_t goodPulses;      // consecutive pulses within the outlier limit
+    uint32_t pulses;
+    uint32_t outliers;
+};
+
+void pps_servoInit(struct pps_servo_s *servo, uint32_t nominalCounts);
+/** one PPS edge: the latched counter and the local microsecond time when it was seen.
+ * utcEstimateMs is the coarse UTC at that moment (0 if unknown). It only labels the first second.
+ */
+void pps_servoUpdate(struct pps_servo_s *servo, uint32_t count, uint64_t micros, int64_t utcEstimateMs);
+bool pps_servoLocked(const struct pps_servo_s *servo);
+/** convert a local microsecond timestamp to UTC microseconds */
+bool pps_servoToUtc(const struct pps_servo_s *servo, uint64_t micros, int64_t *utcMicros);
+
+#endif // _PPS_SERVO_
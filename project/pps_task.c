@@ -0,0 +1,122 @@
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "pico/time.h"
+
+#include <stdio.h>
+#include "pps_task.h"
+#include "pps_servo.h"
+#include "timebase.h"
+#include "reporting_task.h"
+#include "capture.h"
+#include "kernel_objects.h"
+#include "log.h"
+#include "pinmap.h"
+
+#include "pps_capture.pio.h"
+
+#define PPS_PRIORITY 30
+#define PPS_PIO pio1 // pio0 is full with the wind and rain counters
+#define PPS_IRQ PIO1_IRQ_0
+#define PPS_PIO_OVERHEAD_CLOCKS 3 // clocks per pulse that the PIO program does not count
+
+struct pps_capture_s
+{
+    uint32_t count;
+    uint64_t micros;
+};
+
+static QueueHandle_t ppsQueue;
+static StaticQueue_t ppsQueueBuffer;
+static uint8_t ppsQueueStorage[PPS_QUEUE_LENGTH * sizeof(struct pps_capture_s)];
+static StackType_t ppsStack[KERNEL_STACK(PPS_STACK_WORDS)];
+static StaticTask_t ppsTaskBuffer;
+static unsigned int pps_sm;
+static struct pps_servo_s ppsServo;
+
+void pps_irq_func(void)
+{
+    TRACE_ISR_ENTER(TRACE_ISR_PPS);
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    // the edge was a few microseconds ago. The latched count is exact and the timestamp is close.
+    uint64_t now = time_us_64();
+    while (!pio_sm_is_rx_fifo_empty(PPS_PIO, pps_sm))
+    {
+        struct pps_capture_s capture = {PPS_PIO->rxf[pps_sm], now};
+        capture_pioFromISR(CAPTURE_PIO_PPS, capture.count);
+        xQueueSendFromISR(ppsQueue, &capture, &higherPriorityTaskWoken);
+    }
+    TRACE_ISR_EXIT(TRACE_ISR_PPS);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+static void pps_task(void *parameter)
+{
+    bool wasLocked = false;
+    for (;;)
+    {
+        struct pps_capture_s capture;
+        if (pdTRUE == xQueueReceive(ppsQueue, &capture, pdMS_TO_TICKS(2000)))
+        {
+            taskENTER_CRITICAL();
+            pps_servoUpdate(&ppsServo, capture.count, capture.micros, timebase_nowMs());
+            bool locked = pps_servoLocked(&ppsServo);
+            float drift = ppsServo.driftPpm;
+            taskEXIT_CRITICAL();
+
+            if (locked != wasLocked)
+            {
+                LOG_INFO("PPS: %s, crystal %.3f ppm", locked ? "locked" : "unlocked", drift);
+                wasLocked = locked;
+            }
+            reportPPSData(drift, locked);
+        }
+        else
+        {
+            if (wasLocked)
+            {
+                LOG_WARN("No PPS for 2 seconds.");
+                reportPPSData(ppsServo.driftPpm, false);
+            }
+            wasLocked = false;
+        }
+    }
+}
+
+void init_pps(void)
+{
+    uint32_t nominalCounts = (clock_get_hz(clk_sys) - PPS_PIO_OVERHEAD_CLOCKS) / 2;
+    pps_servoInit(&ppsServo, nominalCounts);
+
+    ppsQueue = xQueueCreateStatic(PPS_QUEUE_LENGTH, sizeof(struct pps_capture_s), ppsQueueStorage, &ppsQueueBuffer);
+    kernel_createTask(pps_task, "PPS", ppsStack, KERNEL_WORDS(ppsStack), NULL, PPS_PRIORITY, &ppsTaskBuffer);
+
+    pps_sm = pio_claim_unused_sm(PPS_PIO, true);
+    unsigned int offset = pio_add_program(PPS_PIO, &pps_capture_program);
+    pps_capture_program_init(PPS_PIO, pps_sm, offset, GPS_PPS_PIN);
+
+    irq_set_exclusive_handler(PPS_IRQ, pps_irq_func);
+    irq_set_enabled(PPS_IRQ, true);
+    pio_set_irqn_source_enabled(PPS_PIO, 0, pis_sm0_rx_fifo_not_empty + pps_sm, true);
+    pio_sm_set_enabled(PPS_PIO, pps_sm, true);
+}
+
+float pps_getDriftPpm(void)
+{
+    return ppsServo.driftPpm;
+}
+
+bool pps_isLocked(void)
+{
+    return pps_servoLocked(&ppsServo);
+}
+
+bool pps_toUtcMicros(uint64_t micros, int64_t *utcMicros)
+{
+    taskENTER_CRITICAL();
+    bool valid = pps_servoToUtc(&ppsServo, micros, utcMicros);
+    taskEXIT_CRITICAL();
+    return valid;
+}
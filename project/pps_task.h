@@ -0,0 +1,16 @@
+#ifndef _PPS_
+#define _PPS_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void init_pps(void);
+void pps_irq_func(void);
+
+/** the measured crystal error in ppm, positive when the local clock runs fast */
+float pps_getDriftPpm(void);
+bool pps_isLocked(void);
+/** convert a time_us_64() timestamp to UTC microseconds. false until the servo is locked */
+bool pps_toUtcMicros(uint64_t micros, int64_t *utcMicros);
+
+#endif // _PPS_
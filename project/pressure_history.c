@@ -0,0 +1,156 @@
+#include "pressure_history.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+/** The history stores each sample as an unsigned offset in Pa from this base.
+ * That covers 500hPa to 1155hPa at 1 Pa resolution in 16 bits, 362 bytes for 3 hours.
+ */
+#define PRESSURE_HISTORY_BASE 50000
+
+#define STANDARD_GRAVITY 9.80665f   // m/s^2
+#define DRY_AIR_GAS_CONSTANT 287.05f // J/(kg K)
+#define STANDARD_LAPSE_RATE 0.0065f // K/m
+
+void pressure_historyInit(struct pressure_history_s *history)
+{
+    memset(history, 0, sizeof(*history));
+    history->tendencyClass = PRESSURE_TENDENCY_UNKNOWN;
+}
+
+static enum pressure_tendency_e classifyTendency(int32_t pascal)
+{
+    int32_t magnitude = pascal < 0 ? -pascal : pascal;
+    enum pressure_tendency_e rising;
+
+    if (magnitude < 10)
+    {
+        return PRESSURE_STEADY;
+    }
+    else if (magnitude <= 150)
+    {
+        rising = PRESSURE_RISING_SLOWLY;
+    }
+    else if (magnitude <= 350)
+    {
+        rising = PRESSURE_RISING;
+    }
+    else if (magnitude <= 600)
+    {
+        rising = PRESSURE_RISING_QUICKLY;
+    }
+    else
+    {
+        rising = PRESSURE_RISING_VERY_RAPIDLY;
+    }
+    // the falling classes are in the same order as the rising ones
+    return pascal > 0 ? rising : rising + (PRESSURE_FALLING_SLOWLY - PRESSURE_RISING_SLOWLY);
+}
+
+static bool isFilled(const struct pressure_history_s *history, uint16_t index)
+{
+    return history->filled[index / 8] & (1 << (index % 8));
+}
+
+static void addSample(struct pressure_history_s *history, int32_t offset, bool filled)
+{
+    if (history->count > 0)
+    {
+        if (++history->newest > PRESSURE_HISTORY_MINUTES)
+            history->newest = 0;
+    }
+    // the sample being overwritten leaves the ring
+    if (history->count > PRESSURE_HISTORY_MINUTES && isFilled(history, history->newest))
+        history->filledCount--;
+    if (filled)
+    {
+        history->filled[history->newest / 8] |= 1 << (history->newest % 8);
+        history->filledCount++;
+    }
+    else
+    {
+        history->filled[history->newest / 8] &= ~(1 << (history->newest % 8));
+    }
+    history->samples[history->newest] = offset;
+
+    if (history->count <= PRESSURE_HISTORY_MINUTES)
+    {
+        history->count++;
+    }
+
+    if (history->count > PRESSURE_HISTORY_MINUTES)
+    {
+        // the ring holds 181 samples so the oldest one is exactly 3 hours before the newest
+        uint16_t oldest = history->newest == PRESSURE_HISTORY_MINUTES ? 0 : history->newest + 1;
+        history->tendency = (int32_t)history->samples[history->newest] - (int32_t)history->samples[oldest];
+        history->tendencyClass = classifyTendency(history->tendency);
+    }
+}
+
+static int32_t toOffset(float pascal)
+{
+    int32_t offset = (int32_t)lroundf(pascal) - PRESSURE_HISTORY_BASE;
+    if (offset < 0)
+        offset = 0;
+    if (offset > UINT16_MAX)
+        offset = UINT16_MAX;
+    return offset;
+}
+
+void pressure_historyAdd(struct pressure_history_s *history, float pascal)
+{
+    addSample(history, toOffset(pascal), false);
+}
+
+void pressure_historyAddAfter(struct pressure_history_s *history, float pascal, uint16_t minutes)
+{
+    int32_t offset = toOffset(pascal);
+    if (history->count > 0 && minutes > 1)
+    {
+        // a straight line from the previous measurement rather than a flat step, so the
+        // tendency and the 30 minute change keep the slope across a long sampling interval
+        int32_t previous = history->samples[history->newest];
+        for (uint16_t minute = 1; minute < minutes; minute++)
+        {
+            addSample(history, previous + lroundf((float)(offset - previous) * minute / minutes), true);
+        }
+    }
+    addSample(history, offset, false);
+}
+
+int32_t pressure_historyChange(const struct pressure_history_s *history, uint16_t minutes)
+{
+    if (minutes > PRESSURE_HISTORY_MINUTES || history->count <= minutes)
+        return 0;
+    int then = (int)history->newest - minutes;
+    if (then < 0)
+        then += PRESSURE_HISTORY_MINUTES + 1;
+    return (int32_t)history->samples[history->newest] - (int32_t)history->samples[then];
+}
+
+const char *pressure_tendencyName(enum pressure_tendency_e tendency)
+{
+    static const char *const names[] = {
+        "unknown",
+        "steady",
+        "rising_slowly",
+        "rising",
+        "rising_quickly",
+        "rising_very_rapidly",
+        "falling_slowly",
+        "falling",
+        "falling_quickly",
+        "falling_very_rapidly",
+    };
+    if (tendency >= sizeof(names) / sizeof(*names))
+        return names[PRESSURE_TENDENCY_UNKNOWN];
+    return names[tendency];
+}
+
+float pressure_seaLevel(float stationPascal, float temperatureC, float altitudeMeters)
+{
+    // hypsometric reduction using the mean temperature of the fictitious air column below the station
+    float meanColumnKelvin = temperatureC + 273.15f + STANDARD_LAPSE_RATE * altitudeMeters / 2.0f;
+    return stationPascal * expf(STANDARD_GRAVITY * altitudeMeters / (DRY_AIR_GAS_CONSTANT * meanColumnKelvin));
+}
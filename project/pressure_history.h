@@ -0,0 +1,49 @@
+#ifndef _PRESSURE_HISTORY_
+#define _PRESSURE_HISTORY_
+
+#include <stdint.h>
+
+/** one pressure sample per minute for the 3 hour tendency */
+#define PRESSURE_HISTORY_MINUTES 180
+
+/** the descriptive tendency classes used for the 3 hour change */
+enum pressure_tendency_e
+{
+    PRESSURE_TENDENCY_UNKNOWN = 0, // less than 3 hours of history
+    PRESSURE_STEADY,               // < 0.1hPa
+    PRESSURE_RISING_SLOWLY,        // 0.1 - 1.5hPa
+    PRESSURE_RISING,               // 1.6 - 3.5hPa
+    PRESSURE_RISING_QUICKLY,       // 3.6 - 6.0hPa
+    PRESSURE_RISING_VERY_RAPIDLY,  // > 6.0hPa
+    PRESSURE_FALLING_SLOWLY,
+    PRESSURE_FALLING,
+    PRESSURE_FALLING_QUICKLY,
+    PRESSURE_FALLING_VERY_RAPIDLY,
+};
+
+struct pressure_history_s
+{
+    uint16_t samples[PRESSURE_HISTORY_MINUTES + 1]; // Pa above PRESSURE_HISTORY_BASE
+    uint16_t newest;                                 // index of the most recent sample
+    uint16_t count;                                  // number of valid samples
+    uint8_t filled[(PRESSURE_HISTORY_MINUTES + 8) / 8]; // a bit per sample interpolated between two measured ones
+    uint16_t filledCount;                            // interpolated samples in the ring
+    int32_t tendency;                                // Pa change over the last 3 hours
+    enum pressure_tendency_e tendencyClass;
+};
+
+void pressure_historyInit(struct pressure_history_s *history);
+/** add the station pressure for this minute and update the tendency */
+void pressure_historyAdd(struct pressure_history_s *history, float pascal);
+/** add the station pressure measured minutes after the previous sample. The minutes in between
+ * are interpolated from the previous sample and flagged in filled
+ */
+void pressure_historyAddAfter(struct pressure_history_s *history, float pascal, uint16_t minutes);
+/** Pa change over the last minutes (up to 3 hours). 0 until that much history is stored */
+int32_t pressure_historyChange(const struct pressure_history_s *history, uint16_t minutes);
+const char *pressure_tendencyName(enum pressure_tendency_e tendency);
+
+/** reduce the station pressure to sea level using the air temperature at the station */
+float pressure_seaLevel(float stationPascal, float temperatureC, float altitudeMeters);
+
+#endif // _PRESSURE_HISTORY_
@@ -2,15 +2,21 @@
 #include "task.h"
 
 #include "i2c_support.h"
-#include <math.h>
+#include "bmp388_compensation.h"
+#include "pressure_history.h"
 #include "leds.h"
 #include <stdio.h>
 
 #include "reporting_task.h"
+#include "scheduler.h"
+#include "alerts.h"
+#include "deadline.h"
+#include "kernel_objects.h"
 
 /** monitor the temperature and pressure from a BMP388 every minute or so */
 
 #define BMP_ADDRESS 0x77
+#define BMP_SAMPLE_BUDGET_MS 100 // a forced conversion without oversampling is about 5ms
 
 /** BMP388 settings for a weather station (page 17 of the datasheet)
  * Mode : Forced
@@ -53,66 +59,87 @@
 #define ERR_REG 0x02
 #define CHIP_ID 0x00
 
-static float temperature_compensation(int32_t temperature_raw);
-static float pressure_compensation(int32_t pressure_raw);
-
-struct FloatParams
-{ // The BMP388 float point compensation trim parameters
-    float param_T1;
-    float param_T2;
-    float param_T3;
-    float param_P1;
-    float param_P2;
-    float param_P3;
-    float param_P4;
-    float param_P5;
-    float param_P6;
-    float param_P7;
-    float param_P8;
-    float param_P9;
-    float param_P10;
-    float param_P11;
-    float temperature; // linearized temperature for the pressure sensor
-} floatParams;
+#ifndef BMP388_INTEGER_COMPENSATION
+#define BMP388_INTEGER_COMPENSATION 1 // 0 selects the datasheet floating point compensation
+#endif
+
+#ifndef BMP388_BENCHMARK
+#define BMP388_BENCHMARK 0 // print the cycles per compensation for both paths at startup
+#endif
+
+#if BMP388_BENCHMARK
+#include "pico/time.h"
+#include "hardware/clocks.h"
+#endif
+
+// computed once from the trim parameters at boot and only read after that
+static struct bmp388_float_coefficients_s floatCoefficients;
+static struct bmp388_integer_coefficients_s integerCoefficients;
+
+static struct pressure_history_s pressureHistory;
 
 static void getTrimParameters()
 {
-    struct parameter_t
-    { // The BMP388 compensation trim parameters (coefficients)
-        uint16_t param_T1;
-        uint16_t param_T2;
-        int8_t param_T3;
-        int16_t param_P1;
-        int16_t param_P2;
-        int8_t param_P3;
-        int8_t param_P4;
-        uint16_t param_P5;
-        uint16_t param_P6;
-        int8_t param_P7;
-        int8_t param_P8;
-        int16_t param_P9;
-        int8_t param_P10;
-        int8_t param_P11;
-    } __attribute__((packed)) params;
+    struct bmp388_trim_s params;
 
     i2c_readRegisterBlockSensors(BMP_ADDRESS, TRIM, (uint8_t *)&params, sizeof(params));
 
-    floatParams.param_T1 = (float)params.param_T1 / powf(2.0f, -8.0f); // Calculate the floating point trim parameters
-    floatParams.param_T2 = (float)params.param_T2 / powf(2.0f, 30.0f);
-    floatParams.param_T3 = (float)params.param_T3 / powf(2.0f, 48.0f);
-    floatParams.param_P1 = ((float)params.param_P1 - powf(2.0f, 14.0f)) / powf(2.0f, 20.0f);
-    floatParams.param_P2 = ((float)params.param_P2 - powf(2.0f, 14.0f)) / powf(2.0f, 29.0f);
-    floatParams.param_P3 = (float)params.param_P3 / powf(2.0f, 32.0f);
-    floatParams.param_P4 = (float)params.param_P4 / powf(2.0f, 37.0f);
-    floatParams.param_P5 = (float)params.param_P5 / powf(2.0f, -3.0f);
-    floatParams.param_P6 = (float)params.param_P6 / powf(2.0f, 6.0f);
-    floatParams.param_P7 = (float)params.param_P7 / powf(2.0f, 8.0f);
-    floatParams.param_P8 = (float)params.param_P8 / powf(2.0f, 15.0f);
-    floatParams.param_P9 = (float)params.param_P9 / powf(2.0f, 48.0f);
-    floatParams.param_P10 = (float)params.param_P10 / powf(2.0f, 48.0f);
-    floatParams.param_P11 = (float)params.param_P11 / powf(2.0f, 65.0f);
+    bmp388_floatCoefficients(&params, &floatCoefficients);
+    bmp388_integerCoefficients(&params, &integerCoefficients);
+}
+
+static void compensate(uint32_t temperature_raw, uint32_t pressure_raw, float *temperature, float *pressure)
+{
+#if BMP388_INTEGER_COMPENSATION
+    int64_t t_lin;
+    int64_t centiCelsius = bmp388_compensateTemperatureInteger(&integerCoefficients, temperature_raw, &t_lin);
+    uint64_t centiPascal = bmp388_compensatePressureInteger(&integerCoefficients, pressure_raw, t_lin);
+    *temperature = (float)centiCelsius / 100.0f;
+    *pressure = (float)(uint32_t)centiPascal / 100.0f;
+#else
+    *temperature = bmp388_compensateTemperatureFloat(&floatCoefficients, temperature_raw);
+    *pressure = bmp388_compensatePressureFloat(&floatCoefficients, pressure_raw, *temperature);
+#endif
 }
 
+#if BMP388_BENCHMARK
+/** time both compensation paths over a sweep of raw values.
+ * The M0+ has no cycle counter and SysTick belongs to FreeRTOS so the microsecond timer is scaled by clk_sys.
+ */
+static void benchmarkCompensation()
+{
+    const uint32_t iterations = 1000;
+    volatile float sinkFloat;
+    volatile uint64_t sinkInteger;
+    uint32_t start;
+    uint32_t floatMicroseconds;
+    uint32_t integerMicroseconds;
+
+    start = time_us_32();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        float t = bmp388_compensateTemperatureFloat(&floatCoefficients, 8000000 + i * 97);
+        sinkFloat = bmp388_compensatePressureFloat(&floatCoefficients, 6000000 + i * 131, t);
+    }
+    floatMicroseconds = time_us_32() - start;
+
+    start = time_us_32();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        int64_t t_lin;
+        (void)bmp388_compensateTemperatureInteger(&integerCoefficients, 8000000 + i * 97, &t_lin);
+        sinkInteger = bmp388_compensatePressureInteger(&integerCoefficients, 6000000 + i * 131, t_lin);
+    }
+    integerMicroseconds = time_us_32() - start;
+    (void)sinkFloat;
+    (void)sinkInteger;
+
+    uint32_t cyclesPerMicrosecond = clock_get_hz(clk_sys) / 1000000;
+    printf("BMP388 : float compensation %lu cycles\n", (unsigned long)(floatMicroseconds * cyclesPerMicrosecond / iterations));
+    printf("BMP388 : integer compensation %lu cycles\n", (unsigned long)(integerMicroseconds * cyclesPerMicrosecond / iterations));
+}
+#endif
+
 static void pressure_task(void *parameter)
 {
     printf("BMP388 : ");
@@ -140,15 +167,21 @@ static void pressure_task(void *parameter)
     getTrimParameters();
     printf("Finished\n");
     vPortYield();
+#if BMP388_BENCHMARK
+    benchmarkCompensation();
+#endif
     // Configuring the OSR for Temperature & Pressure
     // No oversampling
     i2c_writeRegisterSensors(BMP_ADDRESS, OSR, 0x00);
 
+    int64_t historyEpochMs = 0;
     for (;;)
     {
 
         uint8_t r;
 
+        int64_t epochMs = scheduler_waitForSample();
+        deadline_start(DEADLINE_PRESSURE);
         putBMPLED(true);
         // Start a Power and Temperature Forced cycle
         i2c_writeRegisterSensors(BMP_ADDRESS, PWR_CTRL, 0b00010011);
@@ -167,61 +200,37 @@ static void pressure_task(void *parameter)
         uint32_t pressure = data[2] << 16 | data[1] << 8 | data[0];
         uint32_t temperature = data[5] << 16 | data[4] << 8 | data[3];
 
-        reportBMPData(temperature_compensation(temperature), pressure_compensation(pressure));
+        float compensatedTemperature;
+        float compensatedPressure;
+        compensate(temperature, pressure, &compensatedTemperature, &compensatedPressure);
+        reportBMPData(compensatedTemperature, compensatedPressure);
+        alerts_checkPressure(compensatedPressure);
 
+        // the history holds one sample per minute whatever the sampling interval
+        if (epochMs % 60000 == 0)
+        {
+            int64_t minutes = historyEpochMs == 0 ? 1 : (epochMs - historyEpochMs) / 60000;
+            if (minutes < 1 || minutes > SCHEDULER_MAX_INTERVAL_MS / 60000)
+                minutes = 1; // the clock was set or stepped
+            pressure_historyAddAfter(&pressureHistory, compensatedPressure, minutes);
+            historyEpochMs = epochMs;
+        }
+        reportBMPTendency(pressureHistory.tendency, pressure_tendencyName(pressureHistory.tendencyClass), pressure_historyChange(&pressureHistory, 30),
+                          pressureHistory.filledCount);
+
+        scheduler_sampleDone(SCHEDULER_PRESSURE);
         putBMPLED(false);
-
-        vTaskDelay(pdMS_TO_TICKS(60000));
+        deadline_end(DEADLINE_PRESSURE);
     }
 }
 
-void init_pressure(void)
-{
-    xTaskCreate(pressure_task, "pressure", 1000, NULL, 10, NULL);
-}
+static StackType_t pressureStack[KERNEL_STACK(PRESSURE_STACK_WORDS)];
+static StaticTask_t pressureTaskBuffer;
 
-static float temperature_compensation(int32_t temperature_raw)
+void init_pressure(void)
 {
-    // use the datasheet compensation formula
-
-    float temp = (float)temperature_raw;
-    float partial_data1;
-    float partial_data2;
-
-    partial_data1 = temp - floatParams.param_T1;
-    partial_data2 = partial_data1 * floatParams.param_T2;
-    floatParams.temperature = partial_data1 * partial_data1 * floatParams.param_T3;
-    floatParams.temperature += partial_data2;
-    return floatParams.temperature;
+    pressure_historyInit(&pressureHistory);
+    TaskHandle_t pressureTask = kernel_createTask(pressure_task, "pressure", pressureStack, KERNEL_WORDS(pressureStack), NULL, 10, &pressureTaskBuffer);
+    scheduler_register(SCHEDULER_PRESSURE, pressureTask);
+    deadline_register(DEADLINE_PRESSURE, scheduler_intervalMs(SCHEDULER_PRESSURE), BMP_SAMPLE_BUDGET_MS);
 }
-
-static float pressure_compensation(int32_t pressure_raw)
-{
-    float pressure = (float)pressure_raw;
-    float compensated_pressure;
-    float partial_data1;
-    float partial_data2;
-    float partial_data3;
-    float partial_data4;
-    float partial_out1;
-    float partial_out2;
-
-    partial_data1 = floatParams.param_P6 * floatParams.temperature;
-    partial_data2 = floatParams.param_P7 * floatParams.temperature * floatParams.temperature;
-    partial_data3 = floatParams.param_P8 * floatParams.temperature * floatParams.temperature * floatParams.temperature;
-    partial_out1 = floatParams.param_P5 + partial_data1 + partial_data2 + partial_data3;
-
-    partial_data1 = floatParams.param_P2 * floatParams.temperature;
-    partial_data2 = floatParams.param_P3 * floatParams.temperature * floatParams.temperature;
-    partial_data3 = floatParams.param_P4 * floatParams.temperature * floatParams.temperature * floatParams.temperature;
-    partial_out2 = pressure * (floatParams.param_P1 + partial_data1 + partial_data2 + partial_data3);
-
-    partial_data1 = pressure * pressure;
-    partial_data2 = floatParams.param_P9 + floatParams.param_P10 * floatParams.temperature;
-    partial_data3 = partial_data1 * partial_data2;
-    partial_data4 = partial_data3 + pressure * pressure * pressure * floatParams.param_P11;
-
-    compensated_pressure = partial_out1 + partial_out2 + partial_data4;
-
-    return compensated_pressure;
-}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "publish_policy.h"
+
+#include <string.h>
+
+#define PUBLISH_BACKOFF_MS 1000
+#define PUBLISH_BACKOFF_MAX_MS 64000
+
+/** slots held back for a class so lower classes can never starve it */
+static const uint8_t reservedSlots[PUBLISH_CLASSES] = {2, 2, 1};
+/** sends before a message is given up */
+static const uint8_t maxAttempts[PUBLISH_CLASSES] = {16, 4, 3};
+
+void publish_policyInit(struct publish_policy_s *policy)
+{
+    memset(policy, 0, sizeof(*policy));
+}
+
+/** the oldest message of a class, or -1 */
+static int oldestOf(const struct publish_policy_s *policy, enum publish_class_e publishClass)
+{
+    const struct publish_slot_s *slots = policy->slots;
+    int oldest = -1;
+    for (int i = 0; i < PUBLISH_SLOTS; i++)
+    {
+        if (slots[i].used && slots[i].publishClass == publishClass &&
+            (oldest < 0 || (int32_t)(slots[i].sequence - slots[oldest].sequence) < 0))
+            oldest = i;
+    }
+    return oldest;
+}
+
+/** a free slot this class may take without eating into the reservation of a higher class */
+static int freeSlotFor(const struct publish_policy_s *policy, enum publish_class_e publishClass)
+{
+    int used[PUBLISH_CLASSES] = {0};
+    int freeSlot = -1;
+    int freeCount = 0;
+    for (int i = 0; i < PUBLISH_SLOTS; i++)
+    {
+        if (policy->slots[i].used)
+            used[policy->slots[i].publishClass]++;
+        else
+        {
+            freeSlot = i;
+            freeCount++;
+        }
+    }
+    int heldBack = 0;
+    for (int higher = 0; higher < publishClass; higher++)
+    {
+        if (used[higher] < reservedSlots[higher])
+            heldBack += reservedSlots[higher] - used[higher];
+    }
+    return freeCount > heldBack ? freeSlot : -1;
+}
+
+static int makeRoomFor(struct publish_policy_s *policy, enum publish_class_e publishClass)
+{
+    int slot = freeSlotFor(policy, publishClass);
+    if (slot >= 0 || publishClass >= PUBLISH_DIAG)
+        return slot;
+
+    // evict the oldest message of the lowest class below this one
+    for (int lower = PUBLISH_CLASSES - 1; lower > publishClass; lower--)
+    {
+        slot = oldestOf(policy, lower);
+        if (slot >= 0)
+        {
+            policy->stats[lower].dropped++;
+            return slot;
+        }
+    }
+    // a newer live report supersedes the oldest one. Alerts keep everything they have
+    if (publishClass == PUBLISH_LIVE)
+    {
+        slot = oldestOf(policy, PUBLISH_LIVE);
+        if (slot >= 0)
+            policy->stats[PUBLISH_LIVE].dropped++;
+    }
+    return slot;
+}
+
+int publish_policyEnqueue(struct publish_policy_s *policy, enum publish_class_e publishClass, int topic,
+                          struct pool_block_s *block, uint32_t nowMs, struct pool_block_s **evicted)
+{
+    *evicted = NULL;
+    int slot = makeRoomFor(policy, publishClass);
+    if (slot < 0)
+    {
+        policy->stats[publishClass].dropped++;
+        return -1;
+    }
+    struct publish_slot_s *entry = &policy->slots[slot];
+    if (entry->used)
+        *evicted = entry->block;
+    entry->used = true;
+    entry->publishClass = publishClass;
+    entry->topic = topic;
+    entry->attempts = 0;
+    entry->sequence = policy->nextSequence++;
+    entry->queuedMs = nowMs;
+    entry->nextAttemptMs = nowMs;
+    entry->block = block;
+    policy->stats[publishClass].queued++;
+    return slot;
+}
+
+int publish_policyNextDue(const struct publish_policy_s *policy, uint32_t nowMs, uint32_t *waitMs)
+{
+    const struct publish_slot_s *slots = policy->slots;
+    int best = -1;
+    *waitMs = UINT32_MAX;
+    for (int i = 0; i < PUBLISH_SLOTS; i++)
+    {
+        if (!slots[i].used)
+            continue;
+        int32_t until = (int32_t)(slots[i].nextAttemptMs - nowMs);
+        if (until > 0)
+        {
+            if ((uint32_t)until < *waitMs)
+                *waitMs = until;
+            continue;
+        }
+        if (best < 0 || slots[i].publishClass < slots[best].publishClass ||
+            (slots[i].publishClass == slots[best].publishClass && (int32_t)(slots[i].sequence - slots[best].sequence) < 0))
+            best = i;
+    }
+    return best;
+}
+
+struct pool_block_s *publish_policySent(struct publish_policy_s *policy, int slot, const struct publish_slot_s *entry, bool sent,
+                                        uint32_t nowMs)
+{
+    struct publish_slot_s *current = &policy->slots[slot];
+    struct publish_stats_s *stats = &policy->stats[entry->publishClass];
+    bool same = current->used && current->sequence == entry->sequence;
+    if (sent)
+    {
+        uint32_t latency = nowMs - entry->queuedMs;
+        stats->sent++;
+        stats->lastLatencyMs = latency;
+        if (latency > stats->maxLatencyMs)
+            stats->maxLatencyMs = latency;
+    }
+    else if (same)
+    {
+        if (++current->attempts < maxAttempts[entry->publishClass])
+        {
+            uint32_t backoff = PUBLISH_BACKOFF_MS << (current->attempts - 1);
+            if (backoff > PUBLISH_BACKOFF_MAX_MS)
+                backoff = PUBLISH_BACKOFF_MAX_MS;
+            current->nextAttemptMs = nowMs + backoff;
+            stats->retries++;
+            return NULL;
+        }
+        stats->dropped++;
+    }
+    if (!same)
+        return NULL;
+    current->used = false;
+    return current->block;
+}
@@ -0,0 +1,51 @@
+#ifndef _PUBLISH_POLICY_
+#define _PUBLISH_POLICY_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "buffer_pool.h"
+#include "publish_queue.h"
+
+/** The slot policy of the publish queue: which message a new one may evict, which one is sent
+ * next and when a failed one is tried again. Times are ms from any start, compared across the wrap.
+ * The policy only moves block pointers, publish_queue.c takes and drops the references and
+ * holds its mutex around each call.
+ */
+struct publish_slot_s
+{
+    bool used;
+    uint8_t publishClass;
+    uint8_t topic;
+    uint8_t attempts;
+    uint32_t sequence; // FIFO order within a class
+    uint32_t queuedMs;
+    uint32_t nextAttemptMs;
+    struct pool_block_s *block;
+};
+
+struct publish_policy_s
+{
+    struct publish_slot_s slots[PUBLISH_SLOTS];
+    struct publish_stats_s stats[PUBLISH_CLASSES];
+    uint32_t nextSequence;
+};
+
+void publish_policyInit(struct publish_policy_s *policy);
+/** take a slot for a message, evicting a lower class or superseding an older live message where the
+ * class policy allows. *evicted is the block of the message that lost its slot, or NULL. Returns the
+ * slot, or -1 when the message was dropped
+ */
+int publish_policyEnqueue(struct publish_policy_s *policy, enum publish_class_e publishClass, int topic,
+                          struct pool_block_s *block, uint32_t nowMs, struct pool_block_s **evicted);
+/** the highest class message that is due, FIFO within the class. Otherwise -1 and the ms until one
+ * is, UINT32_MAX when nothing is queued
+ */
+int publish_policyNextDue(const struct publish_policy_s *policy, uint32_t nowMs, uint32_t *waitMs);
+/** the outcome of sending entry, the copy of a slot taken when it was due. The slot may have been
+ * evicted and reused while the send was in progress. Returns the block the slot let go of, or NULL
+ */
+struct pool_block_s *publish_policySent(struct publish_policy_s *policy, int slot, const struct publish_slot_s *entry, bool sent,
+                                        uint32_t nowMs);
+
+#endif // _PUBLISH_POLICY_
@@ -0,0 +1,136 @@
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include <stdio.h>
+
+#include "publish_queue.h"
+#include "publish_policy.h"
+#include "expresslink.h"
+#include "scheduler.h"
+#include "kernel_objects.h"
+
+#define PUBLISH_PRIORITY 11 // above the sensors and the reporter so an alert goes out next
+
+static struct publish_policy_s policy;
+static SemaphoreHandle_t queueMutex;
+static StaticSemaphore_t queueMutexBuffer;
+static TaskHandle_t publishTask;
+static StackType_t publishStack[KERNEL_STACK(PUBLISH_STACK_WORDS)];
+static StaticTask_t publishTaskBuffer;
+
+const char *publish_className(enum publish_class_e publishClass)
+{
+    static const char *const names[PUBLISH_CLASSES] = {"alert", "live", "diag"};
+    return publishClass < PUBLISH_CLASSES ? names[publishClass] : "unknown";
+}
+
+/** the policy runs on ms, which wrap with the ticks */
+static uint32_t publish_nowMs(void)
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+bool publish_enqueue(enum publish_class_e publishClass, int topic, struct pool_block_s *block)
+{
+    struct pool_block_s *evicted;
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    int slot = publish_policyEnqueue(&policy, publishClass, topic, block, publish_nowMs(), &evicted);
+    if (slot >= 0)
+        pool_retain(block);
+    xSemaphoreGive(queueMutex);
+    if (evicted != NULL)
+        pool_release(evicted);
+    if (slot < 0)
+        return false;
+
+    if (publishTask != NULL)
+        xTaskNotifyGive(publishTask);
+    return true;
+}
+
+#if PUBLISH_SLEEP_MODE
+/** with nothing left to send, sleep the module until its wake lead before the next report
+ * window and wake it then. Returns how long the publisher may block
+ */
+static TickType_t publish_sleepUntilWindow(void)
+{
+    uint32_t untilReport = scheduler_msUntilReport();
+    uint32_t lead = expresslinkWakeLeadMs();
+    if (expresslinkIsAsleep())
+    {
+        if (untilReport > lead)
+            return pdMS_TO_TICKS(untilReport - lead);
+        uint32_t linkWaitMs;
+        expresslinkReady(&linkWaitMs); // wake and attach in time for the window
+        return portMAX_DELAY;
+    }
+    if (untilReport > PUBLISH_SLEEP_MIN_MS && untilReport > lead && expresslinkSleep(untilReport))
+        return pdMS_TO_TICKS(untilReport - lead);
+    return portMAX_DELAY;
+}
+#endif
+
+static void publish_task(void *parameter)
+{
+    for (;;)
+    {
+        uint32_t waitMs;
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        int slot = publish_policyNextDue(&policy, publish_nowMs(), &waitMs);
+        struct publish_slot_s entry;
+        if (slot >= 0)
+        {
+            // the send holds a reference of its own, the slot may be evicted while it runs
+            entry = policy.slots[slot];
+            pool_retain(entry.block);
+        }
+        xSemaphoreGive(queueMutex);
+
+        if (slot < 0)
+        {
+            TickType_t wait = waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+#if PUBLISH_SLEEP_MODE
+            if (wait == portMAX_DELAY) // nothing queued, not even a retry
+                wait = publish_sleepUntilWindow();
+#endif
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
+        // while the link is backing off nothing is sent, so no message uses up its attempts
+        uint32_t linkWaitMs;
+        if (!expresslinkReady(&linkWaitMs))
+        {
+            pool_release(entry.block);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(linkWaitMs));
+            continue;
+        }
+
+        bool sent = expresslinkPublish(entry.topic, entry.block);
+
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        struct pool_block_s *done = publish_policySent(&policy, slot, &entry, sent, publish_nowMs());
+        xSemaphoreGive(queueMutex);
+        if (done != NULL)
+            pool_release(done);
+        pool_release(entry.block);
+    }
+}
+
+void init_publish_queue(void)
+{
+    publish_policyInit(&policy);
+    queueMutex = xSemaphoreCreateMutexStatic(&queueMutexBuffer);
+}
+
+void publish_start(void)
+{
+    publishTask = kernel_createTask(publish_task, "publish", publishStack, KERNEL_WORDS(publishStack), NULL, PUBLISH_PRIORITY, &publishTaskBuffer);
+}
+
+void publish_getStats(enum publish_class_e publishClass, struct publish_stats_s *stats)
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    *stats = policy.stats[publishClass];
+    xSemaphoreGive(queueMutex);
+}
@@ -0,0 +1,52 @@
+#ifndef _PUBLISH_QUEUE_
+#define _PUBLISH_QUEUE_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer_pool.h"
+
+/** All outbound MQTT traffic goes through one bounded queue with priority classes.
+ * The highest class that is due is always sent first. Failed sends are retried with
+ * an exponential backoff and each class has its own drop policy when the slots run out, see
+ * publish_policy.h. A slot holds a reference to the pool block the message was formatted in,
+ * nothing is copied.
+ */
+enum publish_class_e
+{
+    PUBLISH_ALERT, // may evict any lower class
+    PUBLISH_LIVE,  // may evict diagnostics, otherwise replaces its own oldest
+    PUBLISH_DIAG,  // dropped when there is no free slot
+    PUBLISH_CLASSES,
+};
+
+#define PUBLISH_SLOTS 8 // each may hold a block of its own, see POOL_BLOCKS
+
+#ifndef PUBLISH_SLEEP_MODE
+#define PUBLISH_SLEEP_MODE 0 // 1 puts the ExpressLink to sleep between report windows
+#endif
+/** a shorter gap costs more to wake and reattach from than sleeping saves, about 150s for a cellular module */
+#define PUBLISH_SLEEP_MIN_MS 160000
+
+struct publish_stats_s
+{
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t retries;
+    uint32_t dropped; // rejected, evicted, superseded or out of attempts
+    uint32_t lastLatencyMs; // enqueue to send complete
+    uint32_t maxLatencyMs;
+};
+
+void init_publish_queue(void);
+/** start sending once the ExpressLink is set up. Messages queued before then wait */
+void publish_start(void);
+/** queue a message. The queue takes its own reference, the caller still releases its one.
+ * Returns false if the class policy dropped it
+ */
+bool publish_enqueue(enum publish_class_e publishClass, int topic, struct pool_block_s *block);
+void publish_getStats(enum publish_class_e publishClass, struct publish_stats_s *stats);
+const char *publish_className(enum publish_class_e publishClass);
+
+#endif // _PUBLISH_QUEUE_
@@ -2,11 +2,27 @@
 #include "task.h"
 #include "queue.h"
 #include "hardware/pio.h"
+#include "pico/time.h"
 
 #include <stdio.h>
 #include "reporting_task.h"
+#include "alerts.h"
+#include "capture.h"
+#include "isr_stats.h"
+#include "deadline.h"
+#include "kernel_objects.h"
+
+struct rain_capture_s
+{
+    uint32_t count;
+    uint64_t micros; // when the interrupt took the count, for the PPS timebase
+};
 
 static QueueHandle_t rainQueue;
+static StaticQueue_t rainQueueBuffer;
+static uint8_t rainQueueStorage[RAIN_QUEUE_LENGTH * sizeof(struct rain_capture_s)];
+static StackType_t rainStack[KERNEL_STACK(RAIN_STACK_WORDS)];
+static StaticTask_t rainTaskBuffer;
 unsigned int rain_sm;
 
 extern PIO pio;
@@ -15,66 +31,81 @@ extern PIO pio;
 
 void rain_irq_func(void)
 {
+    TRACE_ISR_ENTER(TRACE_ISR_PIO_RAIN);
+    uint32_t isrStart = isr_enter();
     BaseType_t higherPriorityTaskWoken = pdFALSE;
     uint32_t c; // empty the fifo and keep the last value
     while (!pio_sm_is_rx_fifo_empty(pio, rain_sm))
     {
         c = pio->rxf[rain_sm];
     }
-    xQueueSendFromISR(rainQueue, &c, &higherPriorityTaskWoken);
+    capture_pioFromISR(CAPTURE_PIO_RAIN, c);
+    struct rain_capture_s capture = {c, time_us_64()};
+    xQueueSendFromISR(rainQueue, &capture, &higherPriorityTaskWoken);
+    isr_exit(ISR_RAIN, isrStart, true);
+    TRACE_ISR_EXIT(TRACE_ISR_PIO_RAIN);
     portYIELD_FROM_ISR(higherPriorityTaskWoken);
 }
 
+#define RAIN_INCHES_PER_TIP 0.011
+#define RAIN_HOUR_MS 3600000U
+#define RAIN_HOUR_BUDGET_MS 50
+
 static void rain_task(void *parameter)
 {
-    uint32_t hour_start_ticks = 0;
-    uint32_t hour_start_tips = 0;
-    uint32_t day_start_tips = 0;
+    bool started = false;
+    uint32_t lastCount = 0;
+    uint64_t edges = 0; // since boot, two to a tip. 64 bits so the tips never wrap mid tip
+    TickType_t hourStart = xTaskGetTickCount();
+    uint64_t hour_start_tips = 0;
+    uint64_t day_start_tips = 0;
     float rainInchesLastHour = 0.0;
     float rainInchesLastDay = 0.0;
     int hours = 0;
     for (;;)
     {
-        unsigned int count;
-        if (xQueueReceive(rainQueue, &count, pdMS_TO_TICKS(1000)) == pdTRUE)
+        struct rain_capture_s capture;
+        if (xQueueReceive(rainQueue, &capture, pdMS_TO_TICKS(1000)) == pdTRUE)
         {
-            unsigned int now_s = (xTaskGetTickCount() / portTICK_RATE_MS) / 1000;
-            if (now_s - hour_start_ticks > 60000)
+            uint32_t count = capture.count;
+            isr_taskRunning(ISR_RAIN);
+            if (!started)
             {
-                unsigned int pCount = count / 2;
-                hour_start_ticks += 60000; // add an hour
-                if (++hours > 23)
-                {
-                    hours = 0;
-                    int tipsLastDay = pCount - day_start_tips;
-                    if (tipsLastDay < day_start_tips)
-                    {
-                        tipsLastDay += UINT32_MAX;
-                    }
-                    day_start_tips = pCount;
-                    rainInchesLastDay = tipsLastDay * 0.011;
-                }
-
-                int tipsLastHour = pCount - hour_start_tips;
-                if (tipsLastHour < hour_start_tips)
-                {
-                    tipsLastHour += UINT32_MAX;
-                }
-                hour_start_tips = pCount;
+                // the PIO pushes its count as it starts, the edges before that are not rain
+                started = true;
+                lastCount = count;
+            }
+            edges += (uint32_t)(count - lastCount); // modular across the 32 bit PIO count wrap
+            lastCount = count;
+            reportRAINData(count, capture.micros);
+            alerts_checkRainTips((uint32_t)(edges / 2));
+        }
 
-                rainInchesLastHour = tipsLastHour * 0.011;
-                reportRainScaledData(rainInchesLastHour, rainInchesLastDay);
+        // checked on the timeout too, so a dry hour still reports. Tick differences are modular
+        if (xTaskGetTickCount() - hourStart >= pdMS_TO_TICKS(RAIN_HOUR_MS))
+        {
+            deadline_start(DEADLINE_RAIN);
+            uint64_t tips = edges / 2;
+            hourStart += pdMS_TO_TICKS(RAIN_HOUR_MS); // add an hour
+            if (++hours > 23)
+            {
+                hours = 0;
+                rainInchesLastDay = (tips - day_start_tips) * RAIN_INCHES_PER_TIP;
+                day_start_tips = tips;
             }
-            reportRAINData(count);
+
+            rainInchesLastHour = (tips - hour_start_tips) * RAIN_INCHES_PER_TIP;
+            hour_start_tips = tips;
+            reportRainScaledData(rainInchesLastHour, rainInchesLastDay);
+            deadline_end(DEADLINE_RAIN);
         }
     }
 }
 
 void init_rain()
 {
-    rainQueue = xQueueCreate(
-        5,
-        sizeof(int));
+    rainQueue = xQueueCreateStatic(RAIN_QUEUE_LENGTH, sizeof(struct rain_capture_s), rainQueueStorage, &rainQueueBuffer);
 
-    xTaskCreate(rain_task, "Rain", 500, NULL, RAIN_PRIORITY, NULL);
+    deadline_register(DEADLINE_RAIN, RAIN_HOUR_MS, RAIN_HOUR_BUDGET_MS);
+    kernel_createTask(rain_task, "Rain", rainStack, KERNEL_WORDS(rainStack), NULL, RAIN_PRIORITY, &rainTaskBuffer);
 }
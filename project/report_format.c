@@ -0,0 +1,55 @@
+#include "report_format.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/** deadband and longest silence for each scaled field */
+static const struct deadband_field_s scaledFields[SCALED_FIELDS] = {
+    [FIELD_VOLTS] = {NULL, "VOLTS", "%.2f", DEADBAND_NUMBER, 0.05f, 60 * 60000},
+    [FIELD_BMP_TEMPERATURE] = {"BMP", "temperature", "%.2f", DEADBAND_NUMBER, 0.2f, 15 * 60000},
+    [FIELD_BMP_PRESSURE] = {"BMP", "pressure", "%.2f", DEADBAND_NUMBER, 10.0f, 15 * 60000},
+    [FIELD_BMP_SEA_LEVEL] = {"BMP", "sea_level", "%.2f", DEADBAND_NUMBER, 10.0f, 15 * 60000},
+    [FIELD_BMP_TENDENCY_3H] = {"BMP", "tendency_3h", "%.0f", DEADBAND_NUMBER, 10.0f, 30 * 60000},
+    [FIELD_BMP_TENDENCY] = {"BMP", "tendency", NULL, DEADBAND_TEXT, 0, 30 * 60000},
+    [FIELD_BMP_FILLED] = {"BMP", "tendency_filled", "%.0f", DEADBAND_NUMBER, 30.0f, 30 * 60000},
+    [FIELD_TMP_TEMPERATURE] = {"TMP", "temperature", "%.2f", DEADBAND_NUMBER, 0.1f, 15 * 60000},
+    [FIELD_GPS_LATITUDE] = {"GPS", "latitude", "%.5f", DEADBAND_NUMBER, 0.00005f, 6 * 60 * 60000},
+    [FIELD_GPS_LONGITUDE] = {"GPS", "longitude", "%.5f", DEADBAND_NUMBER, 0.00005f, 6 * 60 * 60000},
+    [FIELD_GPS_ALTITUDE] = {"GPS", "altitude", "%.1f", DEADBAND_NUMBER, 5.0f, 6 * 60 * 60000},
+    [FIELD_WIND_SPEED] = {"WIND", "avg_speed_2min", "%.2f", DEADBAND_NUMBER, 1.0f, 10 * 60000},
+    [FIELD_WIND_DIRECTION] = {"WIND", "avg_direction_2m", "%.0f", DEADBAND_ANGLE, 15.0f, 10 * 60000},
+    [FIELD_GUST_SPEED] = {"WIND", "gust_speed_10min", "%.2f", DEADBAND_NUMBER, 2.0f, 10 * 60000},
+    [FIELD_GUST_DIRECTION] = {"WIND", "gust_direction_10min", "%.0f", DEADBAND_ANGLE, 15.0f, 10 * 60000},
+    [FIELD_RAIN_HOUR] = {"RAIN", "inches_last_hour", "%.2f", DEADBAND_NUMBER, 0.01f, 30 * 60000},
+    [FIELD_RAIN_DAY] = {"RAIN", "inches_last_day", "%.2f", DEADBAND_NUMBER, 0.01f, 30 * 60000},
+};
+
+int report_formatScaled(char *buffer, size_t bufferLength, const char *thingName, const struct report_scaled_s *report)
+{
+    return snprintf(buffer, bufferLength,
+                    "{\"ID\":\"%s\","
+                    "\"VOLTS\":%.2f,"
+                    "\"BMP\":{\"temperature\":%.2f,\"pressure\":%.2f,\"sea_level\":%.2f,\"tendency_3h\":%d,\"tendency\":\"%s\",\"tendency_filled\":%d},"
+                    "\"TMP\":{\"temperature\":%.2f},"
+                    "%s"
+                    "\"WIND\":{\"avg_speed_2min\":%.2f,\"avg_direction_2m\":%d,\"gust_speed_10min\":%.2f,\"gust_direction_10min\":%d},"
+                    "\"RAIN\":{\"inches_last_hour\":%.2f,\"inches_last_day\":%.2f},\"time_ms\":%u,\"utc\":\"%s\"}",
+                    thingName, report->volts,
+                    report->bmpTemperature, report->bmpPressure, report->seaLevelPressure, report->tendency_3h, report->tendency, report->tendencyFilled,
+                    report->tmpTemperature,
+                    report->gps,
+                    report->windSpeed_2m, report->windDirection_2m, report->gustSpeed_10m, report->gustDirection_10m,
+                    report->rain_in_hr, report->rain_in_day, report->timeMs, report->utc);
+}
+
+int report_formatDeadband(char *buffer, size_t bufferLength, const char *thingName, const char *gps, const char *fields, bool keyframe,
+                          unsigned int timeMs, const char *utc)
+{
+    return snprintf(buffer, bufferLength, "{\"ID\":\"%s\",%s%s\"keyframe\":%d,\"time_ms\":%u,\"utc\":\"%s\"}",
+                    thingName, gps, fields, keyframe, timeMs, utc);
+}
+
+void report_deadbandFields(struct deadband_field_s fields[SCALED_FIELDS])
+{
+    memcpy(fields, scaledFields, sizeof(scaledFields));
+}
@@ -0,0 +1,63 @@
+#ifndef _REPORT_FORMAT_
+#define _REPORT_FORMAT_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "deadband.h"
+
+/** the fields of the scaled report */
+struct report_scaled_s
+{
+    float volts;
+    float bmpTemperature;
+    float bmpPressure;
+    float seaLevelPressure;
+    int tendency_3h;
+    const char *tendency;
+    int tendencyFilled; // minutes of the 3 hours interpolated across longer sampling intervals
+    float tmpTemperature;
+    const char *gps; // a preformatted "GPS" or "SITE" object with its comma, or ""
+    float windSpeed_2m;
+    int windDirection_2m;
+    float gustSpeed_10m;
+    int gustDirection_10m;
+    float rain_in_hr;
+    float rain_in_day;
+    unsigned int timeMs;
+    const char *utc;
+};
+
+/** the scaled report JSON. Returns the length snprintf would have written */
+int report_formatScaled(char *buffer, size_t bufferLength, const char *thingName, const struct report_scaled_s *report);
+
+/** the scaled report fields in message order */
+enum scaled_field_e
+{
+    FIELD_VOLTS,
+    FIELD_BMP_TEMPERATURE,
+    FIELD_BMP_PRESSURE,
+    FIELD_BMP_SEA_LEVEL,
+    FIELD_BMP_TENDENCY_3H,
+    FIELD_BMP_TENDENCY,
+    FIELD_BMP_FILLED,
+    FIELD_TMP_TEMPERATURE,
+    FIELD_GPS_LATITUDE,
+    FIELD_GPS_LONGITUDE,
+    FIELD_GPS_ALTITUDE,
+    FIELD_WIND_SPEED,
+    FIELD_WIND_DIRECTION,
+    FIELD_GUST_SPEED,
+    FIELD_GUST_DIRECTION,
+    FIELD_RAIN_HOUR,
+    FIELD_RAIN_DAY,
+    SCALED_FIELDS,
+};
+
+/** the scaled report with the fields deadband_encode chose. gps as for report_formatScaled */
+int report_formatDeadband(char *buffer, size_t bufferLength, const char *thingName, const char *gps, const char *fields, bool keyframe,
+                          unsigned int timeMs, const char *utc);
+/** the deadband and longest silence of each scaled field, for deadband_init */
+void report_deadbandFields(struct deadband_field_s fields[SCALED_FIELDS]);
+
+#endif // _REPORT_FORMAT_
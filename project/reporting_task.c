@@ -8,53 +8,100 @@
 #include <string.h>
 #include "leds.h"
 #include "expresslink.h"
+#include "pressure_history.h"
+#include "timebase.h"
+#include "pps_task.h"
+#include "gps_task.h"
+#include "scheduler.h"
+#include "sampling_policy.h"
+#include "deadband.h"
+#include "alerts.h"
+#include "publish_queue.h"
+#include "buffer_pool.h"
+#include "report_format.h"
+#include "log.h"
+#include "isr_stats.h"
+#include "deadline.h"
+#include "kernel_objects.h"
 
 #define REPORTING_PRIORITY 9
+#define REPORTING_SITE_REPEAT 1440 // reports between repeats of a fixed site (one day)
+#define REPORTING_BUDGET_MS 1000    // the reports are queued, the publisher does the sending
+
+#ifndef REPORT_DEADBAND_MODE
+#define REPORT_DEADBAND_MODE 0 // 1 sends only the scaled fields that changed, with an hourly keyframe
+#endif
+#define REPORT_KEYFRAME_MS (60 * 60000) // every field, and the raw report, at least this often
 
 struct volts_report_s
 {
     SemaphoreHandle_t dataMutex;
+    StaticSemaphore_t dataMutexBuffer;
     float volts;
 };
 
+struct pps_report_s
+{
+    SemaphoreHandle_t dataMutex;
+    StaticSemaphore_t dataMutexBuffer;
+    float driftPpm;
+    bool locked;
+};
+
 struct gps_report_s
 {
     SemaphoreHandle_t dataMutex;
+    StaticSemaphore_t dataMutexBuffer;
     float latitude;
     float longtitude;
     float altitude;
+    int64_t utc_ms; // UTC time of the sample or 0 before the GPS time is known
+    bool fixedSite;          // the position is a surveyed site that does not change
+    unsigned int siteReport; // reports until the site is sent again
 };
 
 struct tmp_report_s
 {
     SemaphoreHandle_t dataMutex;
+    StaticSemaphore_t dataMutexBuffer;
     float tmp_temperature;
+    int64_t utc_ms; // UTC time of the sample or 0 before the GPS time is known
 };
 
 struct bmp_report_s
 {
     SemaphoreHandle_t dataMutex;
+    StaticSemaphore_t dataMutexBuffer;
     float temperature;
     float pressure;
+    int tendency_3h;
+    const char *tendency;
+    int change_30m;
+    int filled_3h;
+    int64_t utc_ms; // UTC time of the sample or 0 before the GPS time is known
 };
 
 struct wind_report_s
 {
     SemaphoreHandle_t dataMutex;
+    StaticSemaphore_t dataMutexBuffer;
     unsigned int wind_counts;
     int wind_direction;
     float windSpeed_2m;
     float gustSpeed_10m;
     int windDirection_2m;
     int gustDirection_10m;
+    int64_t utc_ms; // UTC time of the sample or 0 before the GPS time is known
 };
 
 struct rain_report_s
 {
     SemaphoreHandle_t dataMutex;
+    StaticSemaphore_t dataMutexBuffer;
     unsigned int rain_counts;
     float rain_in_hr;
     float rain_in_day;
+    int64_t utc_ms; // UTC time of the sample or 0 before the GPS time is known
 };
 
 static struct gps_report_s gpsData;
@@ -63,6 +110,17 @@ static struct rain_report_s rainData;
 static struct bmp_report_s bmpData;
 static struct tmp_report_s tmpData;
 static struct volts_report_s voltsData;
+static struct pps_report_s ppsData;
+static StackType_t reportingStack[KERNEL_STACK(REPORTING_STACK_WORDS)];
+static StaticTask_t reportingTaskBuffer;
+
+/** a message formatted in parts: snprintf returns what it wanted to write, which may be past the
+ * block, so the next part starts no further than the block's last byte
+ */
+static int report_inBlock(int used)
+{
+    return used < POOL_BLOCK_SIZE ? used : POOL_BLOCK_SIZE - 1;
+}
 
 void reporting_task(void *parameter)
 {
@@ -81,30 +139,59 @@ void reporting_task(void *parameter)
         int gustDirection_10m;
         float bmp_temperature;
         float bmp_pressure;
+        int bmp_tendency_3h;
+        const char *bmp_tendency;
+        int bmp_change_30m;
+        int bmp_filled_3h;
         float latitude;
         float longtitude;
         float altitude;
+        bool fixedSite;
+        bool sendSite;
         float tmp_temperature;
         float volts;
+        float driftPpm;
+        bool ppsLocked;
+        int64_t rain_utc_ms;
+        int64_t wind_utc_ms;
+        int64_t gps_utc_ms;
+        int64_t bmp_utc_ms;
+        int64_t tmp_utc_ms;
     };
 
     expresslinkInit();
 
     expresslinkGetThingName(thingName, sizeof(thingName));
+    alerts_setThingName(thingName);
+    publish_start();
+
+    // the policy runs on ms since boot, accumulated from tick differences so it survives the tick rollover
+    struct sampling_policy_s policy;
+    int64_t uptimeMs = 0;
+    TickType_t policyTick = xTaskGetTickCount();
+    sampling_policyInit(&policy, uptimeMs);
+#if REPORT_DEADBAND_MODE
+    static struct deadband_field_s scaledFields[SCALED_FIELDS];
+    report_deadbandFields(scaledFields);
+    struct deadband_s deadband;
+    deadband_init(&deadband, scaledFields, SCALED_FIELDS, REPORT_KEYFRAME_MS);
+#endif
 
-    TickType_t previousWakeTime = xTaskGetTickCount();
     for (;;)
     {
-        vTaskDelayUntil(&previousWakeTime, pdMS_TO_TICKS(60000));
+        // every slow sensor has sampled for this epoch or missed its deadline
+        int64_t epochMs = scheduler_waitForReport();
+        deadline_start(DEADLINE_REPORTING);
         struct data_report_s dataCopy;
-        puts("collecting rain data");
+        LOG_DEBUG("collecting rain data");
         xSemaphoreTake(rainData.dataMutex, pdMS_TO_TICKS(1));
         dataCopy.rain_in_day = rainData.rain_in_day;
         dataCopy.rain_in_hr = rainData.rain_in_hr;
         dataCopy.rain_counts = rainData.rain_counts;
+        dataCopy.rain_utc_ms = rainData.utc_ms;
         xSemaphoreGive(rainData.dataMutex);
-        puts("Done with rain data");
-        puts("Collecting wind data");
+        LOG_DEBUG("Done with rain data");
+        LOG_DEBUG("Collecting wind data");
         xSemaphoreTake(windData.dataMutex, pdMS_TO_TICKS(1));
         dataCopy.wind_counts = windData.wind_counts;
         dataCopy.wind_direction = windData.wind_direction;
@@ -112,88 +199,269 @@ void reporting_task(void *parameter)
         dataCopy.windSpeed_2m = windData.windSpeed_2m;
         dataCopy.gustDirection_10m = windData.gustDirection_10m;
         dataCopy.gustSpeed_10m = windData.gustSpeed_10m;
+        dataCopy.wind_utc_ms = windData.utc_ms;
         xSemaphoreGive(windData.dataMutex);
-        puts("Done with wind data");
-        puts("Collecting gps data");
+        LOG_DEBUG("Done with wind data");
+        LOG_DEBUG("Collecting gps data");
         xSemaphoreTake(gpsData.dataMutex, pdMS_TO_TICKS(1));
         dataCopy.latitude = gpsData.latitude;
         dataCopy.longtitude = gpsData.longtitude;
         dataCopy.altitude = gpsData.altitude;
+        dataCopy.gps_utc_ms = gpsData.utc_ms;
+        dataCopy.fixedSite = gpsData.fixedSite;
+        dataCopy.sendSite = gpsData.fixedSite && gpsData.siteReport == 0;
+        if (gpsData.fixedSite)
+        {
+            // publishing cannot report a failure so the site is repeated once a day
+            gpsData.siteReport = gpsData.siteReport == 0 ? REPORTING_SITE_REPEAT - 1 : gpsData.siteReport - 1;
+        }
         xSemaphoreGive(gpsData.dataMutex);
-        puts("Done with gps data");
-        puts("Collecting bmp data");
+        LOG_DEBUG("Done with gps data");
+        LOG_DEBUG("Collecting bmp data");
         xSemaphoreTake(bmpData.dataMutex, pdMS_TO_TICKS(1));
         dataCopy.bmp_pressure = bmpData.pressure;
         dataCopy.bmp_temperature = bmpData.temperature;
+        dataCopy.bmp_tendency_3h = bmpData.tendency_3h;
+        dataCopy.bmp_tendency = bmpData.tendency;
+        dataCopy.bmp_change_30m = bmpData.change_30m;
+        dataCopy.bmp_filled_3h = bmpData.filled_3h;
+        dataCopy.bmp_utc_ms = bmpData.utc_ms;
         xSemaphoreGive(bmpData.dataMutex);
-        puts("Done with bmp data");
-        puts("Collecting tmp data");
+        LOG_DEBUG("Done with bmp data");
+        LOG_DEBUG("Collecting tmp data");
         xSemaphoreTake(tmpData.dataMutex, pdMS_TO_TICKS(1));
         dataCopy.tmp_temperature = tmpData.tmp_temperature;
+        dataCopy.tmp_utc_ms = tmpData.utc_ms;
         xSemaphoreGive(tmpData.dataMutex);
-        puts("Done with tmp data");
-        puts("Collecting volts data");
+        LOG_DEBUG("Done with tmp data");
+        LOG_DEBUG("Collecting volts data");
         xSemaphoreTake(voltsData.dataMutex, pdMS_TO_TICKS(1));
         dataCopy.volts = voltsData.volts;
         xSemaphoreGive(voltsData.dataMutex);
-        puts("Done with volts data");
+        LOG_DEBUG("Done with volts data");
+        xSemaphoreTake(ppsData.dataMutex, pdMS_TO_TICKS(1));
+        dataCopy.driftPpm = ppsData.driftPpm;
+        dataCopy.ppsLocked = ppsData.locked;
+        xSemaphoreGive(ppsData.dataMutex);
+        struct gps_rx_stats_s gpsRx;
+        gps_getRxStats(&gpsRx);
+        struct scheduler_stats_s schedule;
+        scheduler_getStats(&schedule);
+        struct alert_stats_s alertStats;
+        alerts_getStats(&alertStats);
+        struct publish_stats_s liveStats;
+        publish_getStats(PUBLISH_LIVE, &liveStats);
+        struct publish_stats_s diagStats;
+        publish_getStats(PUBLISH_DIAG, &diagStats);
+        struct connection_stats_s linkStats;
+        expresslinkGetLinkStats(&linkStats);
+        struct expresslink_sleep_stats_s sleepStats;
+        expresslinkGetSleepStats(&sleepStats);
         unsigned int now = xTaskGetTickCount() / portTICK_RATE_MS;
+        TickType_t tick = xTaskGetTickCount();
+        uptimeMs += (int64_t)(TickType_t)(tick - policyTick) * portTICK_PERIOD_MS;
+        policyTick = tick;
+        char utc[32] = "";
+        if (epochMs != 0)
+        {
+            timebase_format(epochMs, utc, sizeof(utc));
+        }
         // format and send the data copy
         putRPTLED(true);
-        // make sure we are connected.
-        if (!expresslinkIsConnected())
+        // reduce the station pressure with the outside temperature and the GPS altitude
+        float seaLevelPressure = pressure_seaLevel(dataCopy.bmp_pressure, dataCopy.tmp_temperature, dataCopy.altitude);
+        // a fixed site is sent on its own now and then instead of a position in every report
+        char gpsRaw[128] = "";
+        char gpsScaled[96] = "";
+        if (dataCopy.sendSite)
+        {
+            snprintf(gpsRaw, sizeof(gpsRaw), "\"SITE\":{\"latitude\":%.7f,\"longitude\":%.7f,\"altitude\":%.3f},",
+                     dataCopy.latitude, dataCopy.longtitude, dataCopy.altitude);
+            strcpy(gpsScaled, gpsRaw);
+        }
+        else if (!dataCopy.fixedSite)
         {
-            expresslinkConnect();
+            snprintf(gpsRaw, sizeof(gpsRaw), "\"GPS\":{\"latitude\":%5.5f,\"longitude\":%5.5f, \"altitude\":%5.1f,\"utc_ms\":%lld},",
+                     dataCopy.latitude, dataCopy.longtitude, dataCopy.altitude, (long long)dataCopy.gps_utc_ms);
+            snprintf(gpsScaled, sizeof(gpsScaled), "\"GPS\":{\"latitude\":%.5f,\"longitude\":%.5f, \"altitude\":%.1f},",
+                     dataCopy.latitude, dataCopy.longtitude, dataCopy.altitude);
+        }
+        // each message is formatted in a pool block that the publish queue sends from
+        struct pool_block_s *block;
+        bool keyframe = true;
+#if REPORT_DEADBAND_MODE
+        // the fields are encoded first to learn whether this report is a keyframe
+        struct deadband_value_s values[SCALED_FIELDS] = {
+            [FIELD_VOLTS] = {true, dataCopy.volts},
+            [FIELD_BMP_TEMPERATURE] = {true, dataCopy.bmp_temperature},
+            [FIELD_BMP_PRESSURE] = {true, dataCopy.bmp_pressure},
+            [FIELD_BMP_SEA_LEVEL] = {true, seaLevelPressure},
+            [FIELD_BMP_TENDENCY_3H] = {true, dataCopy.bmp_tendency_3h},
+            [FIELD_BMP_TENDENCY] = {true, 0, dataCopy.bmp_tendency},
+            [FIELD_BMP_FILLED] = {true, dataCopy.bmp_filled_3h},
+            [FIELD_TMP_TEMPERATURE] = {true, dataCopy.tmp_temperature},
+            [FIELD_GPS_LATITUDE] = {!dataCopy.fixedSite, dataCopy.latitude},
+            [FIELD_GPS_LONGITUDE] = {!dataCopy.fixedSite, dataCopy.longtitude},
+            [FIELD_GPS_ALTITUDE] = {!dataCopy.fixedSite, dataCopy.altitude},
+            [FIELD_WIND_SPEED] = {true, dataCopy.windSpeed_2m},
+            [FIELD_WIND_DIRECTION] = {true, dataCopy.windDirection_2m},
+            [FIELD_GUST_SPEED] = {true, dataCopy.gustSpeed_10m},
+            [FIELD_GUST_DIRECTION] = {true, dataCopy.gustDirection_10m},
+            [FIELD_RAIN_HOUR] = {true, dataCopy.rain_in_hr},
+            [FIELD_RAIN_DAY] = {true, dataCopy.rain_in_day},
+        };
+        char fields[512];
+        deadband_encode(&deadband, values, uptimeMs, fields, sizeof(fields), &keyframe);
+#endif
+        uint32_t reportBytes = 0;
+        if (keyframe) // with deadbands the raw diagnostics only go with the keyframes
+        {
+            // the longest interrupt run and task wake per source since the last raw report
+            char isrRaw[96] = "";
+#if ISR_STATS_ENABLED
+            uint32_t isrRun[ISR_SOURCES], isrWake[ISR_SOURCES];
+            isr_takeReportMax(isrRun, isrWake);
+            snprintf(isrRaw, sizeof(isrRaw), "\"ISR\":{\"run_us\":[%lu,%lu,%lu,%lu],\"wake_us\":[%lu,%lu,%lu,%lu]},",
+                     (unsigned long)isrRun[ISR_WIND], (unsigned long)isrRun[ISR_RAIN], (unsigned long)isrRun[ISR_GPS], (unsigned long)isrRun[ISR_EXPRESSLINK],
+                     (unsigned long)isrWake[ISR_WIND], (unsigned long)isrWake[ISR_RAIN], (unsigned long)isrWake[ISR_GPS], (unsigned long)isrWake[ISR_EXPRESSLINK]);
+#endif
+            block = pool_alloc();
+            if (block != NULL)
+            {
+                int used = snprintf(block->data, POOL_BLOCK_SIZE,
+                         "{\"ID\":\"%s\","
+                         "\"VOLTS\":%.2f,"
+                         "\"BMP\":{\"temperature\":%.2f,\"pressure\":%.2f,\"utc_ms\":%lld},"
+                         "\"TMP\":{\"temperature\":%.2f,\"utc_ms\":%lld},"
+                         "%s"
+                         "\"WIND\":{\"counts\":%u,\"direction\":%d,\"utc_ms\":%lld},"
+                         "\"RAIN\":{\"counts\":%u,\"utc_ms\":%lld},"
+                         "\"CLOCK\":{\"drift_ppm\":%.3f,\"pps_locked\":%d},"
+                         "\"SCHED\":{\"epochs\":%lu,\"tmp_missed\":%lu,\"bmp_missed\":%lu},"
+                         "\"SAMPLING\":{\"level\":\"%s\",\"budget_limited\":%lu},"
+                         "\"ALERTS\":{\"raised\":%lu,\"sent\":%lu,\"max_latency_ms\":%lu},"
+                         "\"QUEUE\":{\"live_ms\":%lu,\"retries\":%lu,\"dropped\":%lu},"
+                         "%s"
+                         "\"time_ms\":%u,\"utc\":\"%s\"}",
+                         thingName, dataCopy.volts,
+                         dataCopy.bmp_temperature, dataCopy.bmp_pressure, (long long)dataCopy.bmp_utc_ms,
+                         dataCopy.tmp_temperature, (long long)dataCopy.tmp_utc_ms,
+                         gpsRaw,
+                         dataCopy.wind_counts, dataCopy.wind_direction, (long long)dataCopy.wind_utc_ms,
+                         dataCopy.rain_counts, (long long)dataCopy.rain_utc_ms,
+                         dataCopy.driftPpm, dataCopy.ppsLocked,
+                         (unsigned long)schedule.epochs, (unsigned long)schedule.misses[SCHEDULER_TEMPERATURE], (unsigned long)schedule.misses[SCHEDULER_PRESSURE],
+                         sampling_levelName(policy.level), (unsigned long)policy.budgetLimited,
+                         (unsigned long)alertStats.raised, (unsigned long)alertStats.sent, (unsigned long)alertStats.maxLatencyMs,
+                         (unsigned long)liveStats.maxLatencyMs, (unsigned long)(liveStats.retries + diagStats.retries), (unsigned long)(liveStats.dropped + diagStats.dropped),
+                         isrRaw, now, utc);
+                if (used < POOL_BLOCK_SIZE)
+                {
+                    block->length = used;
+                    publish_enqueue(PUBLISH_DIAG, 1, block);
+                    reportBytes = block->length;
+                }
+                else
+                {
+                    LOG_WARN("Raw report of %d bytes cut short, not sent", used);
+                }
+                pool_release(block);
+            }
+            // the link and task summaries go on their own, the raw report has no room left
+            block = pool_alloc();
+            if (block != NULL)
+            {
+                int used = snprintf(block->data, POOL_BLOCK_SIZE,
+                                    "{\"ID\":\"%s\","
+                                    "\"LINK\":{\"commands\":%lu,\"probes\":%lu,\"attaches\":%lu,\"resets\":%lu,\"sleeps\":%lu,\"wake_ms\":%lu},"
+                                    "\"GPSRX\":{\"bytes\":%lu,\"awake_s\":%lu,\"sleeps\":%lu},",
+                                    thingName,
+                                    (unsigned long)linkStats.commands, (unsigned long)linkStats.probes, (unsigned long)linkStats.attaches, (unsigned long)linkStats.resets,
+                                    (unsigned long)sleepStats.sleeps, (unsigned long)sleepStats.lastWakeMs,
+                                    (unsigned long)gpsRx.bytes, (unsigned long)gpsRx.awakeSeconds, (unsigned long)gpsRx.sleeps);
+#if DEADLINE_ENABLED
+                struct deadline_stats_s deadlines[DEADLINE_TASKS];
+                for (int i = 0; i < DEADLINE_TASKS; i++)
+                {
+                    deadline_getStats(i, &deadlines[i]);
+                }
+                used = report_inBlock(used);
+                used += snprintf(block->data + used, POOL_BLOCK_SIZE - used, "\"DEADLINE\":");
+                used = report_inBlock(used);
+                used += deadline_formatJson(block->data + used, POOL_BLOCK_SIZE - used, deadlines);
+                used = report_inBlock(used);
+                used += snprintf(block->data + used, POOL_BLOCK_SIZE - used, ",");
+#endif
+                used = report_inBlock(used);
+                used += snprintf(block->data + used, POOL_BLOCK_SIZE - used, "\"time_ms\":%u,\"utc\":\"%s\"}", now, utc);
+                if (used < POOL_BLOCK_SIZE)
+                {
+                    block->length = used;
+                    publish_enqueue(PUBLISH_DIAG, 1, block);
+                    reportBytes += block->length;
+                }
+                else
+                {
+                    LOG_WARN("Summary report cut short, not sent");
+                }
+                pool_release(block);
+            }
+            kernel_checkStacks(); // the console shows the whole table
         }
-        char buffer[400];
-        snprintf(buffer, sizeof(buffer),
-                 "{\"ID\":\"%s\","
-                 "\"VOLTS\":%.2f,"
-                 "\"BMP\":{\"temperature\":%.2f,\"pressure\":%.2f},"
-                 "\"TMP\":{\"temperature\":%.2f},"
-                 "\"GPS\":{\"latitude\":%5.5f,\"longitude\":%5.5f, \"altitude\":%5.1f},"
-                 "\"WIND\":{\"counts\":%u,\"direction\":%d},"
-                 "\"RAIN\":{\"counts\":%u},\"time_ms\":%u}",
-                 thingName, dataCopy.volts,
-                 dataCopy.bmp_temperature, dataCopy.bmp_pressure,
-                 dataCopy.tmp_temperature,
-                 dataCopy.latitude, dataCopy.longtitude, dataCopy.altitude,
-                 dataCopy.wind_counts, dataCopy.wind_direction,
-                 dataCopy.rain_counts, now);
-        expresslinkPublish(1, buffer, sizeof(buffer));
 
-        snprintf(buffer, sizeof(buffer),
-                 "{\"ID\":\"%s\","
-                 "\"VOLTS\":%.2f,"
-                 "\"BMP\":{\"temperature\":%.2f,\"pressure\":%.2f},"
-                 "\"TMP\":{\"temperature\":%.2f},"
-                 "\"GPS\":{\"latitude\":%.5f,\"longitude\":%.5f, \"altitude\":%.1f},"
-                 "\"WIND\":{\"avg_speed_2min\":%.2f,\"avg_direction_2m\":%d,\"gust_speed_10min\":%.2f,\"gust_direction_10min\":%d},"
-                 "\"RAIN\":{\"inches_last_hour\":%.2f,\"inches_last_day\":%.2f},\"time_ms\":%u}",
-                 thingName, dataCopy.volts,
-                 dataCopy.bmp_temperature, dataCopy.bmp_pressure,
-                 dataCopy.tmp_temperature,
-                 dataCopy.latitude, dataCopy.longtitude, dataCopy.altitude,
-                 dataCopy.windSpeed_2m, dataCopy.windDirection_2m, dataCopy.gustSpeed_10m, dataCopy.gustDirection_10m,
-                 dataCopy.rain_in_hr, dataCopy.rain_in_day, now);
+        block = pool_alloc();
+        if (block != NULL)
+        {
+#if REPORT_DEADBAND_MODE
+            // a fixed site is not a deadband field, it goes out on its own schedule
+            report_formatDeadband(block->data, POOL_BLOCK_SIZE, thingName, dataCopy.sendSite ? gpsScaled : "", fields, keyframe, now, utc);
+#else
+            struct report_scaled_s scaled = {
+                dataCopy.volts,
+                dataCopy.bmp_temperature, dataCopy.bmp_pressure, seaLevelPressure, dataCopy.bmp_tendency_3h, dataCopy.bmp_tendency, dataCopy.bmp_filled_3h,
+                dataCopy.tmp_temperature,
+                gpsScaled,
+                dataCopy.windSpeed_2m, dataCopy.windDirection_2m, dataCopy.gustSpeed_10m, dataCopy.gustDirection_10m,
+                dataCopy.rain_in_hr, dataCopy.rain_in_day, now, utc};
+            report_formatScaled(block->data, POOL_BLOCK_SIZE, thingName, &scaled);
+#endif
+            block->length = strlen(block->data);
+
+            // queued, the publisher sends them in priority order and retries the failures.
+            // Both topics send the same block
+            publish_enqueue(PUBLISH_LIVE, 2, block);
+            publish_enqueue(PUBLISH_LIVE, 3, block);
+            reportBytes += 2 * block->length;
+            pool_release(block);
+        }
 
-        expresslinkPublish(2, buffer, sizeof(buffer));
-        expresslinkPublish(3, buffer, sizeof(buffer));
+        // pick the sampling rates for the next epochs from the weather in this report
+        struct sampling_inputs_s conditions = {dataCopy.bmp_change_30m, dataCopy.rain_in_hr, dataCopy.windSpeed_2m, dataCopy.gustSpeed_10m};
+        if (sampling_policyUpdate(&policy, &conditions, uptimeMs, reportBytes))
+        {
+            uint32_t sensorIntervals[SCHEDULER_SENSORS] = {policy.intervalMs[SAMPLING_TEMPERATURE], policy.intervalMs[SAMPLING_PRESSURE]};
+            scheduler_setIntervals(sensorIntervals, policy.intervalMs[SAMPLING_REPORT]);
+            LOG_INFO("Sampling %s: report every %lus", sampling_levelName(policy.level), (unsigned long)policy.intervalMs[SAMPLING_REPORT] / 1000);
+        }
         // disconnecting and reconnecting costs 10KB of data which is expensive on a Cellular connection
         //        expresslinkDisconnect();
         putRPTLED(false);
+        deadline_end(DEADLINE_REPORTING);
     }
 }
 
 void init_reporting(void)
 {
-    bmpData.dataMutex = xSemaphoreCreateMutex();
-    tmpData.dataMutex = xSemaphoreCreateMutex();
-    gpsData.dataMutex = xSemaphoreCreateMutex();
-    windData.dataMutex = xSemaphoreCreateMutex();
-    rainData.dataMutex = xSemaphoreCreateMutex();
-    voltsData.dataMutex = xSemaphoreCreateMutex();
-    xTaskCreate(reporting_task, "reporting", 10240, NULL, REPORTING_PRIORITY, NULL);
+    bmpData.dataMutex = xSemaphoreCreateMutexStatic(&bmpData.dataMutexBuffer);
+    bmpData.tendency = pressure_tendencyName(PRESSURE_TENDENCY_UNKNOWN);
+    tmpData.dataMutex = xSemaphoreCreateMutexStatic(&tmpData.dataMutexBuffer);
+    gpsData.dataMutex = xSemaphoreCreateMutexStatic(&gpsData.dataMutexBuffer);
+    windData.dataMutex = xSemaphoreCreateMutexStatic(&windData.dataMutexBuffer);
+    rainData.dataMutex = xSemaphoreCreateMutexStatic(&rainData.dataMutexBuffer);
+    voltsData.dataMutex = xSemaphoreCreateMutexStatic(&voltsData.dataMutexBuffer);
+    ppsData.dataMutex = xSemaphoreCreateMutexStatic(&ppsData.dataMutexBuffer);
+    deadline_register(DEADLINE_REPORTING, SCHEDULER_EPOCH_MS, REPORTING_BUDGET_MS);
+    kernel_createTask(reporting_task, "reporting", reportingStack, KERNEL_WORDS(reportingStack), NULL, REPORTING_PRIORITY, &reportingTaskBuffer);
 }
 
 void reportBMPData(float temperature, float pressure)
@@ -201,12 +469,23 @@ void reportBMPData(float temperature, float pressure)
     xSemaphoreTake(bmpData.dataMutex, pdMS_TO_TICKS(1));
     bmpData.pressure = pressure;
     bmpData.temperature = temperature;
+    bmpData.utc_ms = timebase_nowMs();
+    xSemaphoreGive(bmpData.dataMutex);
+}
+void reportBMPTendency(int tendency_3h, const char *tendency, int change_30m, int filled_3h)
+{
+    xSemaphoreTake(bmpData.dataMutex, pdMS_TO_TICKS(1));
+    bmpData.tendency_3h = tendency_3h;
+    bmpData.tendency = tendency;
+    bmpData.change_30m = change_30m;
+    bmpData.filled_3h = filled_3h;
     xSemaphoreGive(bmpData.dataMutex);
 }
 void reportTMPData(float temperature)
 {
     xSemaphoreTake(tmpData.dataMutex, pdMS_TO_TICKS(1));
     tmpData.tmp_temperature = temperature;
+    tmpData.utc_ms = timebase_nowMs();
     xSemaphoreGive(tmpData.dataMutex);
 }
 void reportGPSData(float lat, float lng, float altitude)
@@ -215,19 +494,45 @@ void reportGPSData(float lat, float lng, float altitude)
     gpsData.latitude = lat;
     gpsData.longtitude = lng;
     gpsData.altitude = altitude;
+    gpsData.utc_ms = timebase_nowMs();
+    gpsData.fixedSite = false;
+    xSemaphoreGive(gpsData.dataMutex);
+}
+void reportGPSSite(float lat, float lng, float altitude)
+{
+    xSemaphoreTake(gpsData.dataMutex, pdMS_TO_TICKS(1));
+    gpsData.latitude = lat;
+    gpsData.longtitude = lng;
+    gpsData.altitude = altitude;
+    gpsData.utc_ms = timebase_nowMs();
+    gpsData.fixedSite = true;
+    gpsData.siteReport = 0; // send it with the next report
     xSemaphoreGive(gpsData.dataMutex);
 }
-void reportWINDData(unsigned int counts, int direction_degrees)
+/** UTC of a counter sample from the microsecond time it was taken at */
+static int64_t counterUtcMs(uint64_t micros)
+{
+    int64_t utcMicros;
+    if (pps_toUtcMicros(micros, &utcMicros))
+        return utcMicros / 1000;
+    return timebase_nowMs();
+}
+
+void reportWINDData(unsigned int counts, int direction_degrees, uint64_t micros)
 {
+    int64_t utcMs = counterUtcMs(micros);
     xSemaphoreTake(windData.dataMutex, pdMS_TO_TICKS(1));
     windData.wind_counts = counts;
     windData.wind_direction = direction_degrees;
+    windData.utc_ms = utcMs;
     xSemaphoreGive(windData.dataMutex);
 }
-void reportRAINData(unsigned int tips)
+void reportRAINData(unsigned int tips, uint64_t micros)
 {
+    int64_t utcMs = counterUtcMs(micros);
     xSemaphoreTake(rainData.dataMutex, pdMS_TO_TICKS(1));
     rainData.rain_counts = tips;
+    rainData.utc_ms = utcMs;
     xSemaphoreGive(rainData.dataMutex);
 }
 
@@ -254,4 +559,12 @@ void reportBatteryVoltage(float volts)
     xSemaphoreTake(voltsData.dataMutex, pdMS_TO_TICKS(1));
     voltsData.volts = volts;
     xSemaphoreGive(voltsData.dataMutex);
-}
\ No newline at end of file
+}
+
+void reportPPSData(float driftPpm, bool locked)
+{
+    xSemaphoreTake(ppsData.dataMutex, pdMS_TO_TICKS(1));
+    ppsData.driftPpm = driftPpm;
+    ppsData.locked = locked;
+    xSemaphoreGive(ppsData.dataMutex);
+}
@@ -1,15 +1,26 @@
 #ifndef _REPORTING_
 #define _REPORTING_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 void init_reporting(void);
 
 void reportBMPData(float temperature, float pressure);
+/** filled_3h is the minutes of the 3 hour history interpolated across longer sampling intervals */
+void reportBMPTendency(int tendency_3h, const char *tendency, int change_30m, int filled_3h);
 void reportTMPData(float temperature);
 void reportGPSData(float lat, float lng, float altitude);
-void reportWINDData(int counts, int direction_degrees);
-void reportRAINData(int tips);
+/** the surveyed position of a fixed station. It is reported occasionally instead of with every sample */
+void reportGPSSite(float lat, float lng, float altitude);
+/** micros is the time_us_64() the count was taken at. It is put in UTC with the PPS timebase once
+ * that is locked, before that with the tick clock
+ */
+void reportWINDData(int counts, int direction_degrees, uint64_t micros);
+void reportRAINData(int tips, uint64_t micros);
 void reportRainScaledData(float rain_hr, float rain_day);
 void reportWINDScaledData(float avgSpeed_2m, int avgDirection_2m, float gustSpeed_10m, int gustDirection_10m);
 void reportBatteryVoltage(float volts);
+void reportPPSData(float driftPpm, bool locked);
 
 #endif // _REPORTING_
\ No newline at end of file
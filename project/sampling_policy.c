@@ -0,0 +1,148 @@
+#include "sampling_policy.h"
+
+#include <string.h>
+
+/** intervals for each level. Every interval divides the longer ones and the hour
+ * so the scheduler epochs of all streams stay aligned to the wall clock.
+ */
+static const uint32_t levelIntervalMs[SAMPLING_LEVELS][SAMPLING_STREAMS] = {
+    [SAMPLING_CALM] = {300000, 300000, 300000},
+    [SAMPLING_NORMAL] = {60000, 60000, 60000},
+    [SAMPLING_ACTIVE] = {30000, 30000, 60000},
+    [SAMPLING_STORM] = {15000, 15000, 30000},
+};
+
+/** per stream limits. A level never samples faster or slower than these */
+static const uint32_t minIntervalMs[SAMPLING_STREAMS] = {15000, 15000, 30000};
+static const uint32_t maxIntervalMs[SAMPLING_STREAMS] = {300000, 300000, 300000};
+
+/** I2C transactions per sample: 4 averaged TMP102 reads, BMP388 trigger, ~3 status polls and the burst read */
+static const uint32_t i2cCost[SAMPLING_STREAMS] = {4, 5, 0};
+
+#define SAMPLING_I2C_PER_HOUR 3600
+/* a report is the raw diagnostics, the link and DEADLINE summary and the scaled report on two
+ * topics, about 2.4 KB and 3 KB at the most. NORMAL's report a minute fits with room for the
+ * STORM bursts
+ */
+#define SAMPLING_REPORT_BYTES_PER_HOUR 200000
+#define SAMPLING_BURST_MINUTES 10     // a level needs this long at its rate in the budget
+#define SAMPLING_HOLD_MS (20 * 60000) // stay at a level this long after the weather stops asking for it
+
+/** thresholds for ACTIVE and STORM */
+#define SAMPLING_ACTIVE_PRESSURE_PA 60  // change over 30 minutes
+#define SAMPLING_STORM_PRESSURE_PA 150
+#define SAMPLING_ACTIVE_RAIN_IN_HR 0.01f // any tip in the last hour
+#define SAMPLING_STORM_RAIN_IN_HR 0.5f
+#define SAMPLING_ACTIVE_GUST_SPREAD_MPH 10.0f // gust above the average wind
+#define SAMPLING_STORM_GUST_MPH 35.0f
+#define SAMPLING_CALM_GUST_MPH 8.0f
+#define SAMPLING_CALM_PRESSURE_PA 20
+
+static uint32_t clampInterval(enum sampling_stream_e stream, uint32_t intervalMs)
+{
+    if (intervalMs < minIntervalMs[stream])
+        return minIntervalMs[stream];
+    if (intervalMs > maxIntervalMs[stream])
+        return maxIntervalMs[stream];
+    return intervalMs;
+}
+
+static enum sampling_level_e weatherLevel(const struct sampling_inputs_s *inputs)
+{
+    int32_t pressure = inputs->pressureChange_30m < 0 ? -inputs->pressureChange_30m : inputs->pressureChange_30m;
+    float gustSpread = inputs->gustSpeed_10m - inputs->windSpeed_2m;
+
+    if (pressure >= SAMPLING_STORM_PRESSURE_PA || inputs->rain_in_hr >= SAMPLING_STORM_RAIN_IN_HR || inputs->gustSpeed_10m >= SAMPLING_STORM_GUST_MPH)
+        return SAMPLING_STORM;
+    if (pressure >= SAMPLING_ACTIVE_PRESSURE_PA || inputs->rain_in_hr >= SAMPLING_ACTIVE_RAIN_IN_HR || gustSpread >= SAMPLING_ACTIVE_GUST_SPREAD_MPH)
+        return SAMPLING_ACTIVE;
+    if (pressure < SAMPLING_CALM_PRESSURE_PA && inputs->gustSpeed_10m < SAMPLING_CALM_GUST_MPH)
+        return SAMPLING_CALM;
+    return SAMPLING_NORMAL;
+}
+
+/** true when the budgets can pay for SAMPLING_BURST_MINUTES at this level */
+static bool affordable(const struct sampling_policy_s *policy, enum sampling_level_e level, uint32_t reportBytes)
+{
+    float i2cPerMinute = 0;
+    for (int stream = 0; stream < SAMPLING_STREAMS; stream++)
+    {
+        i2cPerMinute += 60000.0f / clampInterval(stream, levelIntervalMs[level][stream]) * i2cCost[stream];
+    }
+    float bytesPerMinute = 60000.0f / clampInterval(SAMPLING_REPORT, levelIntervalMs[level][SAMPLING_REPORT]) * reportBytes;
+    return policy->i2cTokens >= i2cPerMinute * SAMPLING_BURST_MINUTES && policy->reportTokens >= bytesPerMinute * SAMPLING_BURST_MINUTES;
+}
+
+void sampling_policyInit(struct sampling_policy_s *policy, int64_t nowMs)
+{
+    memset(policy, 0, sizeof(*policy));
+    policy->level = SAMPLING_NORMAL;
+    policy->heldMs = nowMs;
+    policy->lastUpdateMs = nowMs;
+    policy->i2cTokens = SAMPLING_I2C_PER_HOUR;
+    policy->reportTokens = SAMPLING_REPORT_BYTES_PER_HOUR;
+    for (int stream = 0; stream < SAMPLING_STREAMS; stream++)
+    {
+        policy->intervalMs[stream] = clampInterval(stream, levelIntervalMs[SAMPLING_NORMAL][stream]);
+    }
+}
+
+bool sampling_policyUpdate(struct sampling_policy_s *policy, const struct sampling_inputs_s *inputs, int64_t nowMs, uint32_t reportBytes)
+{
+    float elapsedMs = (float)(nowMs - policy->lastUpdateMs);
+    policy->lastUpdateMs = nowMs;
+    if (elapsedMs < 0)
+        elapsedMs = 0;
+
+    // token buckets holding one hour of budget
+    float i2c = 0;
+    for (int stream = 0; stream < SAMPLING_STREAMS; stream++)
+    {
+        i2c += elapsedMs / policy->intervalMs[stream] * i2cCost[stream];
+    }
+    float bytes = elapsedMs / policy->intervalMs[SAMPLING_REPORT] * reportBytes;
+    policy->i2cUsed += (uint64_t)i2c;
+    policy->bytesUsed += (uint64_t)bytes;
+    policy->i2cTokens += elapsedMs * (SAMPLING_I2C_PER_HOUR / 3600000.0f) - i2c;
+    policy->reportTokens += elapsedMs * (SAMPLING_REPORT_BYTES_PER_HOUR / 3600000.0f) - bytes;
+    if (policy->i2cTokens > SAMPLING_I2C_PER_HOUR)
+        policy->i2cTokens = SAMPLING_I2C_PER_HOUR;
+    if (policy->reportTokens > SAMPLING_REPORT_BYTES_PER_HOUR)
+        policy->reportTokens = SAMPLING_REPORT_BYTES_PER_HOUR;
+
+    // step up at once, step down one level at a time after the hold
+    enum sampling_level_e wanted = weatherLevel(inputs);
+    enum sampling_level_e level = policy->level;
+    if (wanted >= level)
+    {
+        level = wanted;
+        policy->heldMs = nowMs;
+    }
+    else if (nowMs - policy->heldMs >= SAMPLING_HOLD_MS)
+    {
+        level--;
+        policy->heldMs = nowMs;
+    }
+
+    while (level > SAMPLING_CALM && !affordable(policy, level, reportBytes))
+    {
+        level--;
+        policy->budgetLimited++;
+    }
+    policy->level = level;
+
+    bool changed = false;
+    for (int stream = 0; stream < SAMPLING_STREAMS; stream++)
+    {
+        uint32_t interval = clampInterval(stream, levelIntervalMs[level][stream]);
+        changed |= interval != policy->intervalMs[stream];
+        policy->intervalMs[stream] = interval;
+    }
+    return changed;
+}
+
+const char *sampling_levelName(enum sampling_level_e level)
+{
+    static const char *const names[SAMPLING_LEVELS] = {"calm", "normal", "active", "storm"};
+    return level < SAMPLING_LEVELS ? names[level] : "unknown";
+}
@@ -0,0 +1,57 @@
+#ifndef _SAMPLING_POLICY_
+#define _SAMPLING_POLICY_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Adaptive sampling: the weather picks a level, the level picks the intervals
+ * and the I2C and report byte budgets can hold the level down.
+ */
+enum sampling_level_e
+{
+    SAMPLING_CALM,   // dry, light wind and steady pressure
+    SAMPLING_NORMAL,
+    SAMPLING_ACTIVE, // rain, gusts or pressure moving
+    SAMPLING_STORM,  // heavy rain, strong gusts or a fast pressure change
+    SAMPLING_LEVELS,
+};
+
+/** the streams the policy sets an interval for. The sensors match the scheduler order */
+enum sampling_stream_e
+{
+    SAMPLING_TEMPERATURE,
+    SAMPLING_PRESSURE,
+    SAMPLING_REPORT,
+    SAMPLING_STREAMS,
+};
+
+/** the conditions at one report */
+struct sampling_inputs_s
+{
+    int32_t pressureChange_30m; // Pa
+    float rain_in_hr;
+    float windSpeed_2m;  // mph
+    float gustSpeed_10m; // mph
+};
+
+struct sampling_policy_s
+{
+    enum sampling_level_e level;
+    int64_t heldMs;        // last time the weather asked for the current level or higher
+    int64_t lastUpdateMs;
+    float i2cTokens;       // I2C transactions that may still be spent
+    float reportTokens;    // report bytes that may still be spent
+    uint32_t intervalMs[SAMPLING_STREAMS];
+    uint32_t budgetLimited; // updates where a budget lowered the level
+    uint64_t i2cUsed;
+    uint64_t bytesUsed;
+};
+
+void sampling_policyInit(struct sampling_policy_s *policy, int64_t nowMs);
+/** charge the samples and reports since the last update and choose the level for the conditions.
+ * reportBytes is the size of the last report. Returns true when the intervals changed.
+ */
+bool sampling_policyUpdate(struct sampling_policy_s *policy, const struct sampling_inputs_s *inputs, int64_t nowMs, uint32_t reportBytes);
+const char *sampling_levelName(enum sampling_level_e level);
+
+#endif // _SAMPLING_POLICY_
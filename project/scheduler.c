@@ -0,0 +1,192 @@
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "event_groups.h"
+
+#include <stdio.h>
+
+#include "scheduler.h"
+#include "timebase.h"
+#include "deadline.h"
+#include "kernel_objects.h"
+#include "log.h"
+
+/** One one-shot software timer is re-armed at every epoch from the current wall clock,
+ * so corrections from the GPS are absorbed at the next epoch instead of accumulating.
+ * Before the GPS time is known the epochs are aligned to the tick count instead.
+ * The timer runs at the shortest interval and each stream is due on the epochs that
+ * are a multiple of its own interval.
+ */
+#define SCHEDULER_EPOCH_BIT (1 << SCHEDULER_SENSORS) // a report epoch was triggered
+
+static TimerHandle_t epochTimer;
+static StaticTimer_t epochTimerBuffer;
+static EventGroupHandle_t epochEvents;
+static StaticEventGroup_t epochEventsBuffer;
+static TaskHandle_t sensorTasks[SCHEDULER_SENSORS];
+static EventBits_t registeredSensors;
+static uint32_t sensorIntervalMs[SCHEDULER_SENSORS] = {SCHEDULER_EPOCH_MS, SCHEDULER_EPOCH_MS};
+static uint32_t reportIntervalMs = SCHEDULER_EPOCH_MS;
+static int64_t pendingEpochMs;   // the epoch the timer is armed for
+static bool pendingUtc;          // the epoch is UTC rather than ms since boot
+static int64_t triggeredEpochMs; // the epoch the sensors are sampling for
+static int64_t reportEpochMs;    // the epoch of the snapshot being collected
+static bool reportUtc;
+static EventBits_t reportSensors; // the sensors sampling for the snapshot
+static TickType_t reportTick;
+static struct scheduler_stats_s schedulerStats;
+
+static const char *const sensorNames[SCHEDULER_SENSORS] = {"TMP102", "BMP388"};
+
+int64_t scheduler_nextEpochMs(int64_t nowMs, int64_t periodMs, int64_t leadMs)
+{
+    return ((nowMs + leadMs) / periodMs + 1) * periodMs;
+}
+
+int64_t scheduler_followingEpochMs(int64_t nowMs, int64_t triggeredEpochMs, int64_t periodMs)
+{
+    if (nowMs < triggeredEpochMs - SCHEDULER_LEAD_MS)
+        nowMs = triggeredEpochMs - SCHEDULER_LEAD_MS;
+    return scheduler_nextEpochMs(nowMs, periodMs, SCHEDULER_LEAD_MS);
+}
+
+static int64_t scheduler_nowMs(void)
+{
+    if (timebase_isValid())
+        return timebase_nowMs();
+    return (int64_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static uint32_t scheduler_periodMs(void)
+{
+    uint32_t period = reportIntervalMs;
+    for (int i = 0; i < SCHEDULER_SENSORS; i++)
+    {
+        if (sensorIntervalMs[i] < period)
+            period = sensorIntervalMs[i];
+    }
+    return period;
+}
+
+static void scheduler_arm(void)
+{
+    pendingEpochMs = scheduler_followingEpochMs(scheduler_nowMs(), triggeredEpochMs, scheduler_periodMs());
+    pendingUtc = timebase_isValid();
+
+    TickType_t delay = pdMS_TO_TICKS(pendingEpochMs - SCHEDULER_LEAD_MS - scheduler_nowMs());
+    if (delay == 0 || delay > pdMS_TO_TICKS(2 * SCHEDULER_MAX_INTERVAL_MS))
+        delay = 1;
+    xTimerChangePeriod(epochTimer, delay, 0);
+}
+
+static void scheduler_rearm(void *parameter1, uint32_t parameter2)
+{
+    scheduler_arm();
+}
+
+static void scheduler_callback(TimerHandle_t timer)
+{
+    EventBits_t due = 0;
+    triggeredEpochMs = pendingEpochMs;
+    for (int i = 0; i < SCHEDULER_SENSORS; i++)
+    {
+        if ((registeredSensors & (1 << i)) && triggeredEpochMs % sensorIntervalMs[i] == 0)
+            due |= 1 << i;
+    }
+    xEventGroupClearBits(epochEvents, due);
+    for (int i = 0; i < SCHEDULER_SENSORS; i++)
+    {
+        if (due & (1 << i))
+            xTaskNotify(sensorTasks[i], SCHEDULER_NOTIFY_SAMPLE, eSetBits);
+    }
+    if (triggeredEpochMs % reportIntervalMs == 0)
+    {
+        reportEpochMs = triggeredEpochMs;
+        reportUtc = pendingUtc;
+        reportSensors = due;
+        reportTick = xTaskGetTickCount();
+        xEventGroupSetBits(epochEvents, SCHEDULER_EPOCH_BIT);
+    }
+    scheduler_arm();
+}
+
+void init_scheduler(void)
+{
+    epochEvents = xEventGroupCreateStatic(&epochEventsBuffer);
+    epochTimer = xTimerCreateStatic("epoch", pdMS_TO_TICKS(SCHEDULER_EPOCH_MS), pdFALSE, NULL, scheduler_callback, &epochTimerBuffer);
+    scheduler_arm();
+}
+
+void scheduler_register(enum scheduler_sensor_e sensor, TaskHandle_t task)
+{
+    sensorTasks[sensor] = task;
+    registeredSensors |= 1 << sensor;
+}
+
+void scheduler_setIntervals(const uint32_t sensorMs[SCHEDULER_SENSORS], uint32_t reportMs)
+{
+    // the timer task owns the schedule so the change is made there
+    taskENTER_CRITICAL();
+    for (int i = 0; i < SCHEDULER_SENSORS; i++)
+    {
+        sensorIntervalMs[i] = sensorMs[i];
+    }
+    reportIntervalMs = reportMs;
+    taskEXIT_CRITICAL();
+    deadline_setPeriod(DEADLINE_TEMPERATURE, sensorMs[SCHEDULER_TEMPERATURE]);
+    deadline_setPeriod(DEADLINE_PRESSURE, sensorMs[SCHEDULER_PRESSURE]);
+    deadline_setPeriod(DEADLINE_REPORTING, reportMs);
+    xTimerPendFunctionCall(scheduler_rearm, NULL, 0, 0);
+}
+
+uint32_t scheduler_intervalMs(enum scheduler_sensor_e sensor)
+{
+    return sensorIntervalMs[sensor];
+}
+
+int64_t scheduler_waitForSample(void)
+{
+    uint32_t notification;
+    do
+    {
+        xTaskNotifyWait(0, SCHEDULER_NOTIFY_SAMPLE, &notification, portMAX_DELAY);
+    } while (!(notification & SCHEDULER_NOTIFY_SAMPLE));
+    return triggeredEpochMs;
+}
+
+void scheduler_sampleDone(enum scheduler_sensor_e sensor)
+{
+    xEventGroupSetBits(epochEvents, 1 << sensor);
+}
+
+int64_t scheduler_waitForReport(void)
+{
+    xEventGroupWaitBits(epochEvents, SCHEDULER_EPOCH_BIT, pdTRUE, pdFALSE, portMAX_DELAY);
+
+    TickType_t deadline = reportTick + pdMS_TO_TICKS(SCHEDULER_LEAD_MS + SCHEDULER_DEADLINE_MS);
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = (int32_t)(deadline - now) > 0 ? deadline - now : 0;
+    EventBits_t done = reportSensors ? xEventGroupWaitBits(epochEvents, reportSensors, pdFALSE, pdTRUE, wait) : 0;
+
+    schedulerStats.epochs++;
+    for (int i = 0; i < SCHEDULER_SENSORS; i++)
+    {
+        if ((reportSensors & (1 << i)) && !(done & (1 << i)))
+        {
+            schedulerStats.misses[i]++;
+            LOG_WARN("%s missed the deadline for epoch %lld", sensorNames[i], (long long)reportEpochMs);
+        }
+    }
+    return reportUtc ? reportEpochMs : 0;
+}
+
+void scheduler_getStats(struct scheduler_stats_s *stats)
+{
+    *stats = schedulerStats;
+}
+
+uint32_t scheduler_msUntilReport(void)
+{
+    int64_t now = scheduler_nowMs();
+    return scheduler_nextEpochMs(now, reportIntervalMs, 0) - now;
+}
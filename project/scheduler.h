@@ -0,0 +1,62 @@
+#ifndef _SCHEDULER_
+#define _SCHEDULER_
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** The slow sensors sample for shared epochs aligned to the wall clock and the
+ * reporter sends one snapshot per report epoch.
+ *
+ *   epoch - SCHEDULER_LEAD_MS      the sensors are notified
+ *   epoch                          the nominal sample time the report is labeled with
+ *   epoch + SCHEDULER_DEADLINE_MS  the report goes out with whatever is in
+ */
+#define SCHEDULER_EPOCH_MS 60000           // the interval until scheduler_setIntervals is called
+#define SCHEDULER_MAX_INTERVAL_MS 300000
+#define SCHEDULER_LEAD_MS 2000
+#define SCHEDULER_DEADLINE_MS 3000
+
+/** the task notification bit a sensor task receives when it should sample */
+#define SCHEDULER_NOTIFY_SAMPLE 0x80000000
+
+enum scheduler_sensor_e
+{
+    SCHEDULER_TEMPERATURE,
+    SCHEDULER_PRESSURE,
+    SCHEDULER_SENSORS,
+};
+
+struct scheduler_stats_s
+{
+    uint32_t epochs;                    // snapshots handed to the reporter
+    uint32_t misses[SCHEDULER_SENSORS]; // epochs a sensor missed the deadline
+};
+
+void init_scheduler(void);
+/** the task to notify at each epoch. Call before the scheduler starts */
+void scheduler_register(enum scheduler_sensor_e sensor, TaskHandle_t task);
+/** change the sample and report intervals. Each one must divide the longer ones and the hour */
+void scheduler_setIntervals(const uint32_t sensorMs[SCHEDULER_SENSORS], uint32_t reportMs);
+uint32_t scheduler_intervalMs(enum scheduler_sensor_e sensor);
+/** block a sensor task until its next sample is due. Returns the epoch being sampled in ms */
+int64_t scheduler_waitForSample(void);
+/** a sensor has reported its reading for the current epoch */
+void scheduler_sampleDone(enum scheduler_sensor_e sensor);
+/** block the reporter until the next snapshot is complete or overdue.
+ * Returns the UTC epoch in ms or 0 before the GPS time is known.
+ */
+int64_t scheduler_waitForReport(void);
+void scheduler_getStats(struct scheduler_stats_s *stats);
+/** ms from now to the next report epoch */
+uint32_t scheduler_msUntilReport(void);
+
+/** the first epoch, a multiple of periodMs, whose trigger at epoch - leadMs is after nowMs */
+int64_t scheduler_nextEpochMs(int64_t nowMs, int64_t periodMs, int64_t leadMs);
+/** the epoch to arm the timer for after triggeredEpochMs fired. The same epoch is never triggered
+ * twice, even when the clock was stepped back
+ */
+int64_t scheduler_followingEpochMs(int64_t nowMs, int64_t triggeredEpochMs, int64_t periodMs);
+
+#endif // _SCHEDULER_
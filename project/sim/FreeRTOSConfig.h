@@ -0,0 +1,89 @@
+/*
+ * FreeRTOS configuration for the host simulation on the POSIX port.
+ * It follows ../FreeRTOSConfig.h so the firmware sees the same kernel. The differences are
+ * the port, heap_3 on malloc, and tickless idle which the simulation uses to skip idle time.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#define configUSE_PREEMPTION 1
+#define configUSE_TICKLESS_IDLE 1
+#define configUSE_IDLE_HOOK 0
+#define configUSE_TICK_HOOK 0
+#define configTICK_RATE_HZ ((TickType_t)1000)
+#define configMAX_PRIORITIES 32
+#define configMINIMAL_STACK_SIZE (configSTACK_DEPTH_TYPE)8192 // words, 64K for glibc
+#define configUSE_16_BIT_TICKS 0
+
+/* the soak build starts the tick count ten minutes short of its wrap, see sim_soak.c */
+#if SIM_SOAK
+#define SIM_SOAK_TICK_LEAD 600000U
+#define configINITIAL_TICK_COUNT ((TickType_t)(0U - SIM_SOAK_TICK_LEAD))
+#endif
+#define configIDLE_SHOULD_YIELD 1
+
+#define configUSE_MUTEXES 1
+#define configUSE_RECURSIVE_MUTEXES 1
+#define configUSE_APPLICATION_TASK_TAG 0
+#define configUSE_COUNTING_SEMAPHORES 1
+#define configQUEUE_REGISTRY_SIZE 8
+#define configUSE_QUEUE_SETS 1
+#define configUSE_TIME_SLICING 1
+#define configUSE_NEWLIB_REENTRANT 0
+#define configENABLE_BACKWARD_COMPATIBILITY 1
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5
+
+#define configSTACK_DEPTH_TYPE uint32_t
+#define configMESSAGE_BUFFER_LENGTH_TYPE size_t
+
+#define configSUPPORT_STATIC_ALLOCATION 1 // the firmware's objects, see kernel_objects.h
+#define configSUPPORT_DYNAMIC_ALLOCATION 1 // the sim's own tasks
+#define configTOTAL_HEAP_SIZE (128 * 1024) // unused by heap_3
+#define configAPPLICATION_ALLOCATED_HEAP 0
+
+#define configCHECK_FOR_STACK_OVERFLOW 0
+#define configUSE_MALLOC_FAILED_HOOK 0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK 0
+
+#define configGENERATE_RUN_TIME_STATS 0
+#define configUSE_TRACE_FACILITY 1
+#define configUSE_STATS_FORMATTING_FUNCTIONS 0
+
+#define configUSE_CO_ROUTINES 0
+#define configMAX_CO_ROUTINE_PRIORITIES 1
+
+#define configUSE_TIMERS 1
+#define configTIMER_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+#define configTIMER_QUEUE_LENGTH 10
+#define configTIMER_TASK_STACK_DEPTH 1024
+
+/* skip idle time, see sim_main.c */
+#include <stdint.h>
+void sim_skipTicks(uint32_t idleTicks);
+#define portSUPPRESS_TICKS_AND_SLEEP(xExpectedIdleTime) sim_skipTicks(xExpectedIdleTime)
+
+#include <assert.h>
+#define configASSERT(x) assert(x)
+
+#define INCLUDE_vTaskPrioritySet 1
+#define INCLUDE_uxTaskPriorityGet 1
+#define INCLUDE_vTaskDelete 1
+#define INCLUDE_vTaskSuspend 1
+#define INCLUDE_vTaskDelayUntil 1
+#define INCLUDE_vTaskDelay 1
+#define INCLUDE_xTaskGetSchedulerState 1
+#define INCLUDE_xTaskGetCurrentTaskHandle 1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
+#define INCLUDE_xTaskGetIdleTaskHandle 1
+#define INCLUDE_eTaskGetState 1
+#define INCLUDE_xTimerPendFunctionCall 1
+#define INCLUDE_xTaskAbortDelay 1
+#define INCLUDE_xTaskGetHandle 1
+#define INCLUDE_xTaskResumeFromISR 1
+#define INCLUDE_xQueueGetMutexHolder 1
+
+/* the firmware's trace hooks, relative so the kernel library finds it */
+#include "../trace.h"
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,2 @@
+// pico-sdk shim for the host simulation
+#include "sim_hardware.h"
@@ -0,0 +1,9 @@
+// generated PIO header shim for the host simulation
+#include "sim_hardware.h"
+
+static const pio_program_t pps_capture_program = {0};
+
+static inline void pps_capture_program_init(PIO pio, uint sm, uint offset, uint pin)
+{
+    sim_pioAttach(pio, sm, pin);
+}
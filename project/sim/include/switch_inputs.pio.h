@@ -0,0 +1,9 @@
+// generated PIO header shim for the host simulation
+#include "sim_hardware.h"
+
+static const pio_program_t input_program = {0};
+
+static inline void input_program_init(PIO pio, uint sm, uint offset, uint ledPin, uint inputPin)
+{
+    sim_pioAttach(pio, sm, inputPin);
+}
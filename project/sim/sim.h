@@ -0,0 +1,65 @@
+#ifndef _SIM_
+#define _SIM_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "sim_scenario.h"
+
+#ifndef SIM_SOAK
+#define SIM_SOAK 0 // 1 in the soak build, cmake -DSIM_SOAK=ON. See sim_soak.c
+#endif
+
+/** the command line of the host simulation */
+struct sim_options_s
+{
+    double days;          // simulated run length
+    time_t startUtc;      // GPS time at the start of the run
+    double driftPpm;      // crystal error the PPS servo should find
+    double latitude;      // degrees, the GPS position of the station
+    double longitude;
+    double altitudeM;
+    unsigned int seed;    // for the gusts, noise and module timings
+    bool realtime;        // run on the wall clock instead of skipping idle time
+    bool trace;           // send the kernel trace to stdout at the end, for weather_trace
+    uint32_t stallMs;     // the device task holds the CPU this long every hour, 0 for never
+    FILE *publishLog;     // every accepted AT+SEND, or NULL
+};
+
+extern struct sim_options_s sim_options;
+
+/** seconds since the start of the run and the matching UTC time */
+double sim_seconds(void);
+time_t sim_utc(void);
+/** uniform in [0, 1) from the seeded generator */
+double sim_random(void);
+
+/** the sensor models: wind and rain counters, vane, battery, TMP102, BMP388, GPS and PPS */
+void sim_devicesInit(void);
+/** the task that steps the device models once a second and ends the run */
+void sim_devicesStart(void);
+
+/** the ExpressLink on uart0 */
+void sim_expresslinkInit(void);
+void sim_expresslinkStep(const struct sim_conditions_s *conditions);
+void sim_expresslinkSummary(FILE *out);
+
+/** replay a capture from capture.c in place of the device models and the ExpressLink.
+ * session picks one of several in the file, -1 for the newest
+ */
+bool sim_replayLoad(const char *path, int session);
+void sim_replayInit(void);
+void sim_replayStart(void);
+
+/** the soak checks. The counters start where sim_soakCounterStart says, the wind and rain
+ * model tell sim_soakStep what they put on them each second
+ */
+uint32_t sim_soakCounterStart(unsigned int pin);
+void sim_soakInit(void);
+void sim_soakStep(uint32_t windEdges, uint32_t rainTips);
+/** true when every check passed and every counter wrapped at least once */
+bool sim_soakSummary(FILE *out);
+
+#endif // _SIM_
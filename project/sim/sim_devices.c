@@ -0,0 +1,527 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_hardware.h"
+#include "pinmap.h"
+#include "deadline.h"
+#include "buffer_pool.h"
+
+/** Sensor models stepped once a simulated second from the scenario.
+ * Each one produces what the real part puts on its pins, so the firmware scaling,
+ * compensation and parsing are all exercised.
+ */
+#define SIM_DEVICE_PRIORITY (configMAX_PRIORITIES - 1)
+
+#define SIM_WIND_MPH_PER_HZ 1.492f // anemometer switch closures per second to mph, as wind_task.c scales them
+#define SIM_RAIN_IN_PER_TIP 0.011f // the bucket gives 2 edges per tip
+#define SIM_GUST_SECONDS 20        // about one gust second in this many
+#define SIM_BATTERY_V 4.1f
+#define SIM_VSYS_ADC 3
+
+#define SIM_PPS_OVERHEAD_CLOCKS 3
+
+/** the vane resistor network, counts after the 256 sample sum / 16 in wind_task.c */
+static const struct
+{
+    uint32_t counts;
+    int degrees;
+} vane[] = {{4400, 0}, {1400, 45}, {420, 90}, {600, 135}, {840, 180}, {2400, 225}, {12600, 270}, {7900, 315}};
+
+static struct
+{
+    uint64_t windEdges;
+    uint64_t rainTips;
+    uint64_t gpsSentences;
+    uint64_t gpsBackups;
+    uint64_t ppsPulses;
+    uint64_t bmpConversions;
+    uint64_t tmpAlerts;
+} deviceStats;
+
+static struct sim_conditions_s now;
+
+/*********************************************************************************
+ * wind, rain, vane and battery
+ *********************************************************************************/
+static void sim_windRainStep(void)
+{
+    static float windCarry;
+    static float rainCarry;
+
+    float speed = now.windMph * (0.85f + 0.3f * (float)sim_random());
+    if (now.gustMph > now.windMph && sim_random() < 1.0 / SIM_GUST_SECONDS)
+        speed = now.gustMph;
+    windCarry += speed / SIM_WIND_MPH_PER_HZ;
+    uint32_t edges = (uint32_t)windCarry;
+    windCarry -= edges;
+    if (edges)
+    {
+        sim_pioCount(WIND_SPEED_PIN, edges);
+        deviceStats.windEdges += edges;
+    }
+
+    rainCarry += now.rainInHr / SIM_RAIN_IN_PER_TIP / 3600.0f;
+    uint32_t tips = (uint32_t)rainCarry;
+    rainCarry -= tips;
+    if (tips)
+    {
+        sim_pioCount(RAIN_BUCKET_PIN, 2 * tips);
+        deviceStats.rainTips += tips;
+    }
+#if SIM_SOAK
+    sim_soakStep(edges, tips);
+#endif
+
+    int closest = 0;
+    for (int i = 1; i < sizeof(vane) / sizeof(*vane); i++)
+    {
+        float difference = fabsf(remainderf(now.directionDeg - vane[i].degrees, 360.0f));
+        if (difference < fabsf(remainderf(now.directionDeg - vane[closest].degrees, 360.0f)))
+            closest = i;
+    }
+    sim_adcSet(WIND_DIR_ADC, vane[closest].counts / 16);
+    sim_adcSet(SIM_VSYS_ADC, (uint16_t)(SIM_BATTERY_V / (3.0f * 3.3f) * 4096.0f));
+}
+
+/*********************************************************************************
+ * TMP102 at 0x48
+ *********************************************************************************/
+#define TMP102_TEMPERATURE 0
+#define TMP102_CONFIG 1
+#define TMP102_T_LOW 2
+#define TMP102_T_HIGH 3
+#define TMP102_CONFIG_OS 0x8000
+#define TMP102_CONFIG_POL 0x0400
+#define TMP102_CONFIG_TM 0x0200
+#define TMP102_CONFIG_SD 0x0100
+#define TMP102_CONFIG_EM 0x0010
+
+static uint16_t tmpRegisters[4] = {0, 0x60A0, 0x4B00, 0x5000}; // power on values
+static uint8_t tmpPointer;
+static bool tmpHot;    // above T_HIGH and not yet back under T_LOW
+static bool tmpAlert;  // ALERT asserted
+
+static bool tmp102_extended(void)
+{
+    return tmpRegisters[TMP102_CONFIG] & TMP102_CONFIG_EM;
+}
+
+static uint16_t tmp102_encode(float celsius)
+{
+    int16_t sixteenths = (int16_t)lrintf(celsius * 16.0f);
+    return tmp102_extended() ? (uint16_t)(sixteenths << 3) | 1 : (uint16_t)(sixteenths << 4);
+}
+
+static float tmp102_limit(uint16_t reg)
+{
+    return (float)((int16_t)reg >> (tmp102_extended() ? 3 : 4)) / 16.0f;
+}
+
+static void tmp102_setAlert(bool active)
+{
+    tmpAlert = active;
+    bool activeHigh = tmpRegisters[TMP102_CONFIG] & TMP102_CONFIG_POL;
+    sim_gpioInput(TMP_ALERT_PIN, active == activeHigh);
+}
+
+static void tmp102_convert(void)
+{
+    float temperature = now.temperatureC + 0.05f * (float)(sim_random() - 0.5);
+    tmpRegisters[TMP102_TEMPERATURE] = tmp102_encode(temperature);
+
+    bool wasHot = tmpHot;
+    if (temperature >= tmp102_limit(tmpRegisters[TMP102_T_HIGH]))
+        tmpHot = true;
+    else if (temperature < tmp102_limit(tmpRegisters[TMP102_T_LOW]))
+        tmpHot = false;
+
+    if (tmpRegisters[TMP102_CONFIG] & TMP102_CONFIG_TM)
+    {
+        // interrupt mode, every crossing asserts ALERT until the next read
+        if (tmpHot != wasHot)
+        {
+            tmp102_setAlert(true);
+            deviceStats.tmpAlerts++;
+        }
+    }
+    else if (tmpHot != tmpAlert)
+    {
+        tmp102_setAlert(tmpHot);
+        deviceStats.tmpAlerts += tmpHot;
+    }
+}
+
+static bool tmp102_write(const uint8_t *src, size_t len)
+{
+    tmpPointer = src[0] & 0x03;
+    if (len >= 3 && tmpPointer != TMP102_TEMPERATURE)
+    {
+        tmpRegisters[tmpPointer] = src[1] << 8 | src[2];
+        if (tmpPointer == TMP102_CONFIG && (tmpRegisters[TMP102_CONFIG] & (TMP102_CONFIG_OS | TMP102_CONFIG_SD)) == (TMP102_CONFIG_OS | TMP102_CONFIG_SD))
+        {
+            tmp102_convert(); // one-shot
+        }
+    }
+    return true;
+}
+
+static bool tmp102_read(uint8_t *dst, size_t len)
+{
+    uint16_t value = tmpRegisters[tmpPointer];
+    for (size_t i = 0; i < len; i++)
+    {
+        dst[i] = i & 1 ? value & 0xFF : value >> 8;
+    }
+    if (tmpPointer == TMP102_TEMPERATURE && tmpAlert && (tmpRegisters[TMP102_CONFIG] & TMP102_CONFIG_TM))
+        tmp102_setAlert(false);
+    return true;
+}
+
+static const struct sim_i2c_device_s tmp102 = {0x48, tmp102_write, tmp102_read};
+
+/*********************************************************************************
+ * BMP388 at 0x77
+ *********************************************************************************/
+#define BMP388_CHIP_ID 0x00
+#define BMP388_DATA_0 0x04
+#define BMP388_EVENT 0x10
+#define BMP388_INT_STATUS 0x11
+#define BMP388_PWR_CTRL 0x1B
+#define BMP388_TRIM 0x31
+#define BMP388_CMD 0x7E
+
+/** trim chosen so the datasheet compensation is linear and exact:
+ * T = (raw - T1 * 256) / 65536 and P = raw / 128 with every other term zero
+ */
+#define BMP388_T1 27000
+#define BMP388_T2 16384
+#define BMP388_P1 24576
+#define BMP388_P2 16384
+
+static uint8_t bmpRegisters[128];
+static uint8_t bmpPointer;
+
+static void bmp388_powerOn(void)
+{
+    static const uint8_t trim[21] = {
+        BMP388_T1 & 0xFF, BMP388_T1 >> 8, BMP388_T2 & 0xFF, BMP388_T2 >> 8, 0, // T1 T2 T3
+        BMP388_P1 & 0xFF, BMP388_P1 >> 8, BMP388_P2 & 0xFF, BMP388_P2 >> 8,    // P1 P2
+    };
+    memset(bmpRegisters, 0, sizeof(bmpRegisters));
+    bmpRegisters[BMP388_CHIP_ID] = 0x50;
+    memcpy(&bmpRegisters[BMP388_TRIM], trim, sizeof(trim));
+}
+
+static void bmp388_put24(uint8_t reg, uint32_t value)
+{
+    if (value > 0xFFFFFF)
+        value = 0xFFFFFF;
+    bmpRegisters[reg] = value;
+    bmpRegisters[reg + 1] = value >> 8;
+    bmpRegisters[reg + 2] = value >> 16;
+}
+
+static void bmp388_convert(void)
+{
+    float pressure = now.pressurePa + 2.0f * (float)(sim_random() - 0.5);
+    float temperature = now.temperatureC + 0.5f; // the board runs a little warmer than the TMP102
+    bmp388_put24(BMP388_DATA_0, (uint32_t)lrintf(pressure * 128.0f));
+    bmp388_put24(BMP388_DATA_0 + 3, (uint32_t)lrintf(BMP388_T1 * 256.0f + temperature * 65536.0f));
+    bmpRegisters[BMP388_INT_STATUS] |= 0x08; // drdy
+    deviceStats.bmpConversions++;
+}
+
+static void bmp388_writeRegister(uint8_t reg, uint8_t value)
+{
+    switch (reg)
+    {
+    case BMP388_CMD:
+        if (value == 0xB6) // soft reset
+        {
+            bmp388_powerOn();
+            bmpRegisters[BMP388_EVENT] = 0x01; // por_detected
+        }
+        break;
+    case BMP388_PWR_CTRL:
+        if ((value >> 4 & 0x03) == 0x01 || (value >> 4 & 0x03) == 0x02) // forced, back to sleep after
+        {
+            bmp388_convert();
+            value &= 0x0F;
+        }
+        bmpRegisters[reg] = value;
+        break;
+    default:
+        if (reg < BMP388_TRIM)
+            bmpRegisters[reg] = value;
+        break;
+    }
+}
+
+static bool bmp388_write(const uint8_t *src, size_t len)
+{
+    bmpPointer = src[0] & 0x7F;
+    // a burst write is register and value pairs
+    for (size_t i = 0; i + 1 < len; i += 2)
+    {
+        bmp388_writeRegister(src[i] & 0x7F, src[i + 1]);
+    }
+    return true;
+}
+
+static bool bmp388_read(uint8_t *dst, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t reg = (bmpPointer + i) & 0x7F;
+        dst[i] = bmpRegisters[reg];
+        if (reg == BMP388_EVENT || reg == BMP388_INT_STATUS) // cleared on read
+            bmpRegisters[reg] = 0;
+    }
+    return true;
+}
+
+static const struct sim_i2c_device_s bmp388 = {0x77, bmp388_write, bmp388_read};
+
+/*********************************************************************************
+ * GPS on uart1 and its PPS
+ *********************************************************************************/
+static double backupUntil; // seconds, the receiver is in backup until then
+static double ppsCount;
+
+static void nmea_send(const char *body)
+{
+    char sentence[100];
+    uint8_t checksum = 0;
+    for (const char *c = body; *c; c++)
+    {
+        checksum ^= *c;
+    }
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    sim_uartReceive(uart1, (const uint8_t *)sentence, length);
+    deviceStats.gpsSentences++;
+}
+
+/** ddmm.mmmm or dddmm.mmmm and the hemisphere */
+static void nmea_angle(char *out, size_t outLength, double degrees, int width, char positive, char negative)
+{
+    char hemisphere = degrees < 0 ? negative : positive;
+    degrees = fabs(degrees);
+    int whole = (int)degrees;
+    double minutes = (degrees - whole) * 60.0;
+    snprintf(out, outLength, "%0*d%07.4f,%c", width, whole, minutes, hemisphere);
+}
+
+static void sim_gpsStep(void)
+{
+    double seconds = sim_seconds();
+    if (seconds < backupUntil)
+        return;
+
+    // the PPS edge first, the sentences for that second follow it
+    ppsCount += (clock_get_hz(clk_sys) * (1.0 + sim_options.driftPpm * 1e-6) - SIM_PPS_OVERHEAD_CLOCKS) / 2.0;
+    sim_pioCapture(GPS_PPS_PIN, (uint32_t)(uint64_t)ppsCount);
+    deviceStats.ppsPulses++;
+
+    time_t utc = sim_utc();
+    struct tm calendar;
+    gmtime_r(&utc, &calendar);
+    char latitude[20];
+    char longitude[20];
+    double noise = 1e-5 * (sim_random() - 0.5); // about a metre
+    nmea_angle(latitude, sizeof(latitude), sim_options.latitude + noise, 2, 'N', 'S');
+    nmea_angle(longitude, sizeof(longitude), sim_options.longitude + noise, 3, 'E', 'W');
+
+    char body[90];
+    snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,%s,%s,1,08,0.9,%.1f,M,0.0,M,,",
+             calendar.tm_hour, calendar.tm_min, calendar.tm_sec, latitude, longitude, sim_options.altitudeM);
+    nmea_send(body);
+    snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d.00,A,%s,%s,0.0,0.0,%02d%02d%02d,,,A",
+             calendar.tm_hour, calendar.tm_min, calendar.tm_sec, latitude, longitude,
+             calendar.tm_mday, calendar.tm_mon + 1, calendar.tm_year % 100);
+    nmea_send(body);
+    nmea_send("GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.8,0.9,1.5");
+}
+
+/** the receiver only listens for RXM-PMREQ */
+static void sim_gpsTransmit(uint8_t byte)
+{
+    static uint8_t frame[16];
+    static size_t length;
+
+    if (length == 0 && byte != 0xB5)
+        return;
+    if (length < sizeof(frame))
+        frame[length++] = byte;
+    if (length >= 6 && length == 8 + (size_t)(frame[4] | frame[5] << 8))
+    {
+        if (frame[2] == 0x02 && frame[3] == 0x41 && length == 16) // RXM-PMREQ, 8 byte payload
+        {
+            uint32_t durationMs = frame[6] | frame[7] << 8 | frame[8] << 16 | (uint32_t)frame[9] << 24;
+            backupUntil = sim_seconds() + durationMs / 1000.0;
+            deviceStats.gpsBackups++;
+        }
+        length = 0;
+    }
+    else if (length == sizeof(frame))
+    {
+        length = 0; // something longer, a CFG message
+    }
+}
+
+/*********************************************************************************
+ * the device task
+ *********************************************************************************/
+static void sim_deviceSummary(FILE *out)
+{
+    fprintf(out, "sim: %.1f days, wind %llu edges, rain %llu tips, TMP102 %llu alerts, BMP388 %llu conversions\n",
+            sim_seconds() / 86400.0, (unsigned long long)deviceStats.windEdges, (unsigned long long)deviceStats.rainTips,
+            (unsigned long long)deviceStats.tmpAlerts, (unsigned long long)deviceStats.bmpConversions);
+    fprintf(out, "sim: GPS %llu sentences, %llu PPS, %llu backups\n",
+            (unsigned long long)deviceStats.gpsSentences, (unsigned long long)deviceStats.ppsPulses,
+            (unsigned long long)deviceStats.gpsBackups);
+    sim_expresslinkSummary(out);
+    struct pool_stats_s pool;
+    pool_getStats(&pool);
+    fprintf(out, "sim: buffer pool %lu allocations, high water %u of %u blocks, %lu failures\n",
+            (unsigned long)pool.allocations, pool.highWater, POOL_BLOCKS, (unsigned long)pool.failures);
+}
+
+/*********************************************************************************
+ * stalls for the deadline monitor
+ *********************************************************************************/
+#if DEADLINE_ENABLED
+#define SIM_STALL_AT_S 1800 // into each hour, clear of the rain task's hour
+#define SIM_STALL_CHECK_S 5 // after a stall, the wind task has caught up by then
+
+static struct
+{
+    uint32_t stalls;
+    uint32_t seen;          // stalls the wind task counted an overrun for
+    uint32_t windOverruns;  // before the last stall
+    bool pending;
+    double checkAt;
+    int hour;
+} stall = {.hour = -1};
+
+/** the wind task has had time to run since the last stall, or the run is over */
+static void sim_stallCheck(void)
+{
+    if (!stall.pending)
+        return;
+    struct deadline_stats_s wind;
+    deadline_getStats(DEADLINE_WIND, &wind);
+    if (wind.overruns > stall.windOverruns)
+        stall.seen++;
+    stall.pending = false;
+}
+
+/** at the top priority every firmware task waits it out, as behind an ISR storm or a hung driver.
+ * The ticks go on in real time meanwhile
+ */
+static void sim_stallStep(double seconds)
+{
+    if (stall.pending && seconds >= stall.checkAt)
+        sim_stallCheck();
+    int hour = seconds / 3600;
+    if (sim_options.stallMs == 0 || hour == stall.hour || seconds - hour * 3600.0 < SIM_STALL_AT_S)
+        return;
+    stall.hour = hour;
+    struct deadline_stats_s wind;
+    deadline_getStats(DEADLINE_WIND, &wind);
+    stall.windOverruns = wind.overruns;
+    TickType_t start = xTaskGetTickCount();
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(sim_options.stallMs))
+    {
+    }
+    stall.stalls++;
+    stall.pending = true;
+    stall.checkAt = sim_seconds() + SIM_STALL_CHECK_S;
+}
+
+/** true when the deadline monitor saw every stall */
+static bool sim_stallSummary(FILE *out)
+{
+    sim_stallCheck();
+    fprintf(out, "sim: %lu stalls of %lums, the wind task overran after %lu\n", (unsigned long)stall.stalls,
+            (unsigned long)sim_options.stallMs, (unsigned long)stall.seen);
+    for (int i = 0; i < DEADLINE_TASKS; i++)
+    {
+        struct deadline_stats_s stats;
+        deadline_getStats(i, &stats);
+        fprintf(out, "sim: deadline %-11s %lu passes, %lu overruns, %lu over budget, wcet %luus, jitter %luus\n",
+                deadline_taskNames[i], (unsigned long)stats.passes, (unsigned long)stats.overruns,
+                (unsigned long)stats.overBudget, (unsigned long)stats.wcetUs, (unsigned long)stats.jitterUs);
+    }
+    return stall.seen == stall.stalls;
+}
+#else
+#define sim_stallStep(seconds)
+#define sim_stallSummary(out) false
+#endif
+
+static void sim_deviceTask(void *parameter)
+{
+    TickType_t wake = xTaskGetTickCount();
+    int day = 0;
+    for (;;)
+    {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000));
+        double seconds = sim_seconds();
+        sim_scenarioAt(seconds / 3600.0, &now);
+
+        sim_windRainStep();
+        if (!(tmpRegisters[TMP102_CONFIG] & TMP102_CONFIG_SD))
+            tmp102_convert(); // continuous mode
+        sim_gpsStep();
+        sim_expresslinkStep(&now);
+        sim_stallStep(seconds);
+
+        if ((int)(seconds / 86400) != day)
+        {
+            day = seconds / 86400;
+            fprintf(stderr, "sim: day %d\n", day);
+        }
+        if (seconds >= sim_options.days * 86400.0)
+        {
+            if (sim_options.trace)
+                trace_dump();
+            fflush(stdout);
+            sim_deviceSummary(stderr);
+            if (sim_options.stallMs && !sim_stallSummary(stderr))
+                exit(1);
+#if SIM_SOAK
+            exit(sim_soakSummary(stderr) ? 0 : 1);
+#endif
+            exit(0);
+        }
+    }
+}
+
+void sim_devicesInit(void)
+{
+    sim_scenarioAt(0, &now);
+    bmp388_powerOn();
+    sim_i2cAttach(&tmp102);
+    sim_i2cAttach(&bmp388);
+    sim_uartOnTransmit(uart1, sim_gpsTransmit);
+    sim_windRainStep();
+#if SIM_SOAK
+    sim_pioPreset(WIND_SPEED_PIN, sim_soakCounterStart(WIND_SPEED_PIN));
+    sim_pioPreset(RAIN_BUCKET_PIN, sim_soakCounterStart(RAIN_BUCKET_PIN));
+    sim_soakInit();
+#else
+    sim_pioPreset(WIND_SPEED_PIN, 0);
+    sim_pioPreset(RAIN_BUCKET_PIN, 0);
+#endif
+}
+
+void sim_devicesStart(void)
+{
+    xTaskCreate(sim_deviceTask, "sim devices", 4096, NULL, SIM_DEVICE_PRIORITY, NULL);
+}
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sim.h"
+#include "sim_hardware.h"
+#include "pinmap.h"
+
+/** An ExpressLink on uart0 that answers the AT commands the firmware uses.
+ * Most commands answer at once. AT+SEND answers after a cellular round trip, AT+CONNECT takes a
+ * few simulated seconds and fails while the scenario has the link down. AT+SLEEP stops the module
+ * answering until WAKE goes low and the module has had time to start.
+ * Each alert's latency is measured from its utc_ms, the time it was detected, to its OK.
+ */
+#define SIM_EL_WAKE_PIN CLICK_PWM_PIN
+#define SIM_EL_RESET_PIN CLICK_RST_PIN
+#define SIM_EL_THING_NAME "weather-sim"
+#define SIM_EL_CONNECT_S 3      // plus up to as much again at random
+#define SIM_EL_CONNECT_FAIL_S 20 // how long a connect to an unreachable broker takes to give up
+#define SIM_EL_WAKE_S 1.5       // plus up to 1 s at random
+#define SIM_EL_TOPICS 8
+#define SIM_EL_SEND_MS 200         // an AT+SEND round trip, plus up to SIM_EL_SEND_SPREAD_MS at random
+#define SIM_EL_SEND_SPREAD_MS 1300
+#define SIM_EL_ALERT_TOPIC 4
+#define SIM_EL_ALERTS 4096 // latencies kept for the summary
+#define SIM_EL_PRIORITY (configMAX_PRIORITIES - 1)
+
+static struct
+{
+    char line[1100];
+    size_t length;
+    bool connected;
+    bool linkUp;
+    bool asleep;
+    double sleepUntil;   // the AT+SLEEP backstop
+    double wakeAt;       // WAKE was asserted, answering from then
+    double connectDone;  // an AT+CONNECT is in progress until then
+    bool connecting;
+    double sendDone;     // an AT+SEND is in progress until then
+    bool sending;
+    int64_t alertUtcMs;  // the detection time of the alert being sent, or 0
+} modem;
+
+static TaskHandle_t modemTask;
+static uint32_t alertLatencyMs[SIM_EL_ALERTS];
+static uint32_t alertLatencies;
+
+static struct
+{
+    uint64_t commands;
+    uint64_t connects;
+    uint64_t connectFailures;
+    uint64_t sends[SIM_EL_TOPICS];
+    uint64_t bytes;
+    uint64_t rejected;
+    uint64_t sleeps;
+    uint64_t wakes;
+    uint64_t resets;
+    double connectedSeconds;
+    double asleepSeconds;
+} modemStats;
+
+static void el_respond(const char *response)
+{
+    sim_uartReceive(uart0, (const uint8_t *)response, strlen(response));
+    sim_uartReceive(uart0, (const uint8_t *)"\r\n", 2);
+}
+
+static void el_publish(int topic, const char *message)
+{
+    if (!modem.connected)
+    {
+        modemStats.rejected++;
+        el_respond("ERR6 NO CONNECTION");
+        return;
+    }
+    if (topic > 0 && topic < SIM_EL_TOPICS)
+        modemStats.sends[topic]++;
+    modemStats.bytes += strlen(message);
+    const char *detected = topic == SIM_EL_ALERT_TOPIC ? strstr(message, "\"utc_ms\":") : NULL;
+    modem.alertUtcMs = detected ? atoll(detected + 9) : 0;
+    if (sim_options.publishLog)
+    {
+        time_t utc = sim_utc();
+        struct tm calendar;
+        gmtime_r(&utc, &calendar);
+        fprintf(sim_options.publishLog, "%04d-%02d-%02dT%02d:%02d:%02dZ\t%d\t%s\n",
+                calendar.tm_year + 1900, calendar.tm_mon + 1, calendar.tm_mday,
+                calendar.tm_hour, calendar.tm_min, calendar.tm_sec, topic, message);
+    }
+    // answered from the modem task
+    modem.sending = true;
+    modem.sendDone = sim_seconds() + (SIM_EL_SEND_MS + SIM_EL_SEND_SPREAD_MS * sim_random()) / 1000.0;
+    xTaskNotifyGive(modemTask);
+}
+
+static void el_sendDone(void)
+{
+    if (!modem.sending)
+        return; // the module was reset
+    modem.sending = false;
+    if (modem.alertUtcMs > 0 && alertLatencies < SIM_EL_ALERTS)
+    {
+        double nowMs = (sim_options.startUtc + sim_seconds()) * 1000.0;
+        alertLatencyMs[alertLatencies++] = (uint32_t)(nowMs - modem.alertUtcMs);
+    }
+    el_respond("OK");
+}
+
+static void sim_modemTask(void *parameter)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        double wait = modem.sendDone - sim_seconds();
+        if (wait > 0)
+            vTaskDelay(pdMS_TO_TICKS((uint32_t)(wait * 1000.0)) + 1);
+        el_sendDone();
+    }
+}
+
+static int compareLatency(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void el_command(char *command)
+{
+    modemStats.commands++;
+    if (modem.asleep)
+    {
+        double seconds = sim_seconds();
+        if (modem.wakeAt == 0 || seconds < modem.wakeAt)
+            return; // not listening
+        modem.asleep = false;
+    }
+
+    if (strcmp(command, "AT") == 0)
+    {
+        el_respond("OK");
+    }
+    else if (strncmp(command, "AT+SEND", 7) == 0)
+    {
+        char *message = strchr(command, ' ');
+        el_publish(atoi(&command[7]), message ? message + 1 : "");
+    }
+    else if (strcmp(command, "AT+CONNECT?") == 0)
+    {
+        el_respond(modem.connected ? "OK 1 CONNECTED" : "OK 0 DISCONNECTED");
+    }
+    else if (strcmp(command, "AT+CONNECT") == 0)
+    {
+        if (modem.connected)
+        {
+            el_respond("OK 1 CONNECTED");
+            return;
+        }
+        // answered from sim_expresslinkStep
+        modem.connecting = true;
+        modem.connectDone = sim_seconds() + (modem.linkUp ? SIM_EL_CONNECT_S * (1.0 + sim_random()) : SIM_EL_CONNECT_FAIL_S);
+    }
+    else if (strcmp(command, "AT+CONF? ThingName") == 0)
+    {
+        el_respond("OK " SIM_EL_THING_NAME);
+    }
+    else if (strncmp(command, "AT+CONF", 7) == 0)
+    {
+        el_respond("OK");
+    }
+    else if (strncmp(command, "AT+SLEEP", 8) == 0)
+    {
+        el_respond("OK");
+        modem.connected = false;
+        modem.asleep = true;
+        modem.wakeAt = 0;
+        modem.sleepUntil = sim_seconds() + atoi(&command[8]);
+        modemStats.sleeps++;
+    }
+    else if (strcasecmp(command, "AT+DISCONNECT") == 0)
+    {
+        modem.connected = false;
+        el_respond("OK");
+    }
+    else
+    {
+        el_respond("ERR3 COMMAND NOT FOUND");
+    }
+}
+
+static void el_transmit(uint8_t byte)
+{
+    if (byte == '\r')
+        return;
+    if (byte != '\n')
+    {
+        if (modem.length < sizeof(modem.line) - 1)
+            modem.line[modem.length++] = byte;
+        return;
+    }
+    modem.line[modem.length] = 0;
+    modem.length = 0;
+    el_command(modem.line);
+}
+
+static void el_pin(uint gpio, bool value)
+{
+    if (gpio == SIM_EL_WAKE_PIN && !value && modem.asleep && modem.wakeAt == 0)
+    {
+        modem.wakeAt = sim_seconds() + SIM_EL_WAKE_S + sim_random();
+        modemStats.wakes++;
+    }
+    else if (gpio == SIM_EL_RESET_PIN && !value)
+    {
+        // back up and answering by the time the firmware looks
+        bool linkUp = modem.linkUp;
+        memset(&modem, 0, sizeof(modem));
+        modem.linkUp = linkUp;
+        modemStats.resets++;
+    }
+}
+
+void sim_expresslinkStep(const struct sim_conditions_s *conditions)
+{
+    double seconds = sim_seconds();
+    modem.linkUp = conditions->linkUp;
+    if (!modem.linkUp)
+        modem.connected = false; // the broker connection drops with the network
+
+    if (modem.connecting && seconds >= modem.connectDone)
+    {
+        modem.connecting = false;
+        if (modem.linkUp)
+        {
+            modem.connected = true;
+            modemStats.connects++;
+            el_respond("OK 1 CONNECTED");
+        }
+        else
+        {
+            modemStats.connectFailures++;
+            el_respond("ERR14 UNABLE TO CONNECT");
+        }
+    }
+    if (modem.asleep && modem.wakeAt == 0 && seconds >= modem.sleepUntil)
+    {
+        modem.wakeAt = seconds; // the backstop
+    }
+
+    if (modem.connected)
+        modemStats.connectedSeconds += 1;
+    if (modem.asleep)
+        modemStats.asleepSeconds += 1;
+}
+
+void sim_expresslinkSummary(FILE *out)
+{
+    uint64_t sends = 0;
+    for (int topic = 0; topic < SIM_EL_TOPICS; topic++)
+    {
+        sends += modemStats.sends[topic];
+    }
+    fprintf(out, "sim: ExpressLink %llu commands, %llu connects, %llu connect failures, %llu resets\n",
+            (unsigned long long)modemStats.commands, (unsigned long long)modemStats.connects,
+            (unsigned long long)modemStats.connectFailures, (unsigned long long)modemStats.resets);
+    fprintf(out, "sim: published %llu messages (%llu raw, %llu scaled, %llu alerts), %llu bytes, %llu rejected\n",
+            (unsigned long long)sends, (unsigned long long)modemStats.sends[1],
+            (unsigned long long)(modemStats.sends[2] + modemStats.sends[3]), (unsigned long long)modemStats.sends[4],
+            (unsigned long long)modemStats.bytes, (unsigned long long)modemStats.rejected);
+    fprintf(out, "sim: connected %.1f%%, asleep %.1f%% in %llu sleeps and %llu wakes\n",
+            100.0 * modemStats.connectedSeconds / sim_seconds(), 100.0 * modemStats.asleepSeconds / sim_seconds(),
+            (unsigned long long)modemStats.sleeps, (unsigned long long)modemStats.wakes);
+    if (alertLatencies > 0)
+    {
+        qsort(alertLatencyMs, alertLatencies, sizeof(*alertLatencyMs), compareLatency);
+        fprintf(out, "sim: %lu alerts, detection to send median %lums, p95 %lums, max %lums\n", (unsigned long)alertLatencies,
+                (unsigned long)alertLatencyMs[alertLatencies / 2], (unsigned long)alertLatencyMs[alertLatencies * 95 / 100],
+                (unsigned long)alertLatencyMs[alertLatencies - 1]);
+    }
+}
+
+void sim_expresslinkInit(void)
+{
+    struct sim_conditions_s conditions;
+    sim_scenarioAt(0, &conditions);
+    modem.linkUp = conditions.linkUp;
+    sim_uartOnTransmit(uart0, el_transmit);
+    sim_gpioOnOutput(el_pin);
+    xTaskCreate(sim_modemTask, "sim modem", 4096, NULL, SIM_EL_PRIORITY, &modemTask);
+}
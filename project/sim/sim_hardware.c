@@ -0,0 +1,686 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim_hardware.h"
+
+/** Simulated RP2040 peripherals. Time is the FreeRTOS tick count, which the idle hook
+ * fast forwards, so every timestamp the firmware sees is simulated time.
+ * Interrupt handlers run in the task of the device model that raised them. That task has
+ * the highest priority, so a handler preempts the firmware tasks the way a real one does.
+ */
+#define SIM_IRQ_HANDLERS 4
+#define SIM_PIO_SMS 4
+#define SIM_PIO_FIFO_DEPTH 8 // the counting programs join the TX FIFO to the RX FIFO
+#define SIM_UART_BUFFER 4096
+#define SIM_I2C_DEVICES 4
+#define SIM_ADC_INPUTS 5
+
+/*********************************************************************************
+ * time
+ *********************************************************************************/
+uint64_t time_us_64(void)
+{
+    // extend the 32 bit tick count so long runs do not wrap the microseconds. The soak build
+    // starts the tick count short of its wrap, the timer still starts at zero
+    static uint32_t lastTick = configINITIAL_TICK_COUNT;
+    static uint64_t wraps;
+    TickType_t tick = xTaskGetTickCount();
+    if (tick < lastTick)
+        wraps += 1ull << 32;
+    lastTick = tick;
+    return (wraps + tick - (TickType_t)configINITIAL_TICK_COUNT) * (1000000ull / configTICK_RATE_HZ);
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)time_us_64();
+}
+
+void busy_wait_us_32(uint32_t delay_us)
+{
+}
+
+/*********************************************************************************
+ * interrupt masking
+ *********************************************************************************/
+uint32_t save_and_disable_interrupts(void)
+{
+    // the kernel trace hooks come here from inside the scheduler, so no kernel calls
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    return !sigismember(&previous, SIGALRM);
+}
+
+void restore_interrupts(uint32_t status)
+{
+    if (status)
+    {
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_UNBLOCK, &all, NULL);
+    }
+}
+
+bool stdio_init_all(void)
+{
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+int stdio_put_string(const char *s, int len, bool newline, bool cr_translation)
+{
+    fwrite(s, 1, len, stdout);
+    if (newline)
+        putchar('\n');
+    return len;
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    return PICO_ERROR_TIMEOUT;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param)
+{
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index)
+{
+    switch (clk_index)
+    {
+    case clk_ref:
+        return 12000000;
+    case clk_usb:
+    case clk_adc:
+        return 48000000;
+    case clk_rtc:
+        return 46875;
+    default:
+        return 125000000;
+    }
+}
+
+static uint32_t (*randomSource)(void);
+
+uint32_t get_rand_32(void)
+{
+    if (randomSource)
+        return randomSource();
+    return ((uint32_t)random() << 16) ^ (uint32_t)random();
+}
+
+void sim_randomSource(uint32_t (*source)(void))
+{
+    randomSource = source;
+}
+
+char *strnstr(const char *haystack, const char *needle, size_t length)
+{
+    size_t needleLength = strlen(needle);
+    for (size_t i = 0; i + needleLength <= length && haystack[i]; i++)
+    {
+        if (strncmp(&haystack[i], needle, needleLength) == 0)
+            return (char *)&haystack[i];
+    }
+    return needleLength == 0 ? (char *)haystack : NULL;
+}
+
+/*********************************************************************************
+ * interrupts
+ *********************************************************************************/
+static irq_handler_t irqHandlers[SIM_IRQ_COUNT][SIM_IRQ_HANDLERS];
+static bool irqEnabled[SIM_IRQ_COUNT];
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    memset(irqHandlers[num], 0, sizeof(irqHandlers[num]));
+    irqHandlers[num][0] = handler;
+}
+
+irq_handler_t irq_get_exclusive_handler(uint num)
+{
+    return irqHandlers[num][1] ? NULL : irqHandlers[num][0];
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+    for (int i = 0; i < SIM_IRQ_HANDLERS; i++)
+    {
+        if (irqHandlers[num][i] == NULL)
+        {
+            irqHandlers[num][i] = handler;
+            return;
+        }
+    }
+    fprintf(stderr, "sim: too many handlers for IRQ %u\n", num);
+    abort();
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    irqEnabled[num] = enabled;
+}
+
+static void sim_irqRaise(uint num)
+{
+    if (!irqEnabled[num])
+        return;
+    for (int i = 0; i < SIM_IRQ_HANDLERS && irqHandlers[num][i]; i++)
+    {
+        irqHandlers[num][i]();
+    }
+}
+
+/*********************************************************************************
+ * gpio
+ *********************************************************************************/
+struct sim_gpio_s
+{
+    bool output;
+    bool level;
+    uint32_t irqMask;
+    uint32_t events;
+    irq_handler_t handler;
+};
+
+static struct sim_gpio_s gpios[SIM_GPIO_COUNT];
+static void (*gpioOutputCallback)(uint gpio, bool value);
+
+void gpio_init(uint gpio)
+{
+    gpios[gpio].output = false;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    gpios[gpio].output = out;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    bool changed = gpios[gpio].level != value;
+    gpios[gpio].level = value;
+    if (changed && gpioOutputCallback)
+        gpioOutputCallback(gpio, value);
+}
+
+bool gpio_get(uint gpio)
+{
+    return gpios[gpio].level;
+}
+
+void gpio_pull_up(uint gpio)
+{
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled)
+{
+    if (enabled)
+        gpios[gpio].irqMask |= event_mask;
+    else
+        gpios[gpio].irqMask &= ~event_mask;
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler)
+{
+    gpios[gpio].handler = handler;
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio)
+{
+    return gpios[gpio].events;
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask)
+{
+    gpios[gpio].events &= ~event_mask;
+}
+
+void sim_gpioInput(uint gpio, bool value)
+{
+    struct sim_gpio_s *pin = &gpios[gpio];
+    if (pin->level == value)
+        return;
+    pin->level = value;
+    uint32_t event = value ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if (!(pin->irqMask & event))
+        return;
+    pin->events |= event;
+    if (irqEnabled[IO_IRQ_BANK0] && pin->handler)
+        pin->handler();
+}
+
+void sim_gpioOnOutput(void (*callback)(uint gpio, bool value))
+{
+    gpioOutputCallback = callback;
+}
+
+/*********************************************************************************
+ * pio
+ *********************************************************************************/
+struct sim_sm_s
+{
+    bool claimed;
+    bool attached;
+    uint pin;
+    uint32_t count;
+    uint32_t fifo[SIM_PIO_FIFO_DEPTH];
+    uint32_t head;
+    uint32_t tail;
+};
+
+pio_hw_t sim_pio0, sim_pio1;
+static struct sim_sm_s stateMachines[2][SIM_PIO_SMS];
+static uint32_t pioIrqSources[2][2]; // state machines with RX not empty enabled, per PIO and IRQ line
+
+static struct
+{
+    uint pin;
+    uint32_t count;
+} pioPresets[SIM_PIO_SMS];
+static int pioPresetCount;
+
+static int pioIndex(PIO pio)
+{
+    return pio == pio1 ? 1 : 0;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+    for (int sm = 0; sm < SIM_PIO_SMS; sm++)
+    {
+        if (!stateMachines[pioIndex(pio)][sm].claimed)
+        {
+            stateMachines[pioIndex(pio)][sm].claimed = true;
+            return sm;
+        }
+    }
+    if (required)
+    {
+        fprintf(stderr, "sim: no free state machine\n");
+        abort();
+    }
+    return -1;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program)
+{
+    return 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm)
+{
+    struct sim_sm_s *machine = &stateMachines[pioIndex(pio)][sm];
+    if (machine->head == machine->tail)
+        return true;
+    pio->rxf[sm] = machine->fifo[machine->tail++ % SIM_PIO_FIFO_DEPTH];
+    return false;
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm)
+{
+    pio_sm_is_rx_fifo_empty(pio, sm);
+    return pio->rxf[sm];
+}
+
+void pio_set_irqn_source_enabled(PIO pio, uint irq_index, enum pio_interrupt_source source, bool enabled)
+{
+    uint32_t bit = 1u << (source - pis_sm0_rx_fifo_not_empty);
+    if (enabled)
+        pioIrqSources[pioIndex(pio)][irq_index] |= bit;
+    else
+        pioIrqSources[pioIndex(pio)][irq_index] &= ~bit;
+    // the interrupt is a level, enabling it with words waiting raises it
+    struct sim_sm_s *machine = &stateMachines[pioIndex(pio)][source - pis_sm0_rx_fifo_not_empty];
+    if (enabled && machine->head != machine->tail)
+        sim_irqRaise((pio == pio1 ? PIO1_IRQ_0 : PIO0_IRQ_0) + irq_index);
+}
+
+void sim_pioAttach(PIO pio, uint sm, uint pin)
+{
+    struct sim_sm_s *machine = &stateMachines[pioIndex(pio)][sm];
+    machine->attached = true;
+    machine->pin = pin;
+    for (int i = 0; i < pioPresetCount; i++)
+    {
+        if (pioPresets[i].pin == pin)
+        {
+            // switch_inputs.pio pushes its count once as it starts
+            machine->count = pioPresets[i].count;
+            machine->fifo[machine->head++ % SIM_PIO_FIFO_DEPTH] = machine->count;
+        }
+    }
+}
+
+void sim_pioPreset(uint pin, uint32_t count)
+{
+    assert(pioPresetCount < SIM_PIO_SMS);
+    pioPresets[pioPresetCount].pin = pin;
+    pioPresets[pioPresetCount].count = count;
+    pioPresetCount++;
+}
+
+static void sim_pioPush(uint pin, bool counting, uint32_t value)
+{
+    for (int p = 0; p < 2; p++)
+    {
+        for (int sm = 0; sm < SIM_PIO_SMS; sm++)
+        {
+            struct sim_sm_s *machine = &stateMachines[p][sm];
+            if (!machine->attached || machine->pin != pin)
+                continue;
+            if (counting)
+            {
+                machine->count += value;
+                value = machine->count;
+            }
+            if (machine->head - machine->tail < SIM_PIO_FIFO_DEPTH) // a full FIFO stalls the program
+                machine->fifo[machine->head++ % SIM_PIO_FIFO_DEPTH] = value;
+            for (int line = 0; line < 2; line++)
+            {
+                if (pioIrqSources[p][line] & (1u << sm))
+                    sim_irqRaise((p ? PIO1_IRQ_0 : PIO0_IRQ_0) + line);
+            }
+            return;
+        }
+    }
+}
+
+void sim_pioCount(uint pin, uint32_t edges)
+{
+    sim_pioPush(pin, true, edges);
+}
+
+void sim_pioCapture(uint pin, uint32_t value)
+{
+    sim_pioPush(pin, false, value);
+}
+
+/*********************************************************************************
+ * adc
+ *********************************************************************************/
+static uint adcInput;
+static uint16_t adcCounts[SIM_ADC_INPUTS];
+static uint16_t (*adcSource)(uint input);
+
+void adc_init(void)
+{
+}
+
+void adc_gpio_init(uint gpio)
+{
+}
+
+void adc_select_input(uint input)
+{
+    adcInput = input;
+}
+
+uint16_t adc_read(void)
+{
+    if (adcSource)
+        return adcSource(adcInput) & 0x0FFF;
+    return adcInput < SIM_ADC_INPUTS ? adcCounts[adcInput] : 0;
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift)
+{
+}
+
+void sim_adcSet(uint input, uint16_t counts)
+{
+    if (input < SIM_ADC_INPUTS)
+        adcCounts[input] = counts & 0x0FFF;
+}
+
+void sim_adcSource(uint16_t (*read)(uint input))
+{
+    adcSource = read;
+}
+
+/*********************************************************************************
+ * i2c
+ *********************************************************************************/
+struct i2c_inst
+{
+    const struct sim_i2c_device_s *devices[SIM_I2C_DEVICES];
+};
+
+i2c_inst_t sim_i2c0;
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+    return baudrate;
+}
+
+static const struct sim_i2c_device_s *i2cFind(i2c_inst_t *i2c, uint8_t addr)
+{
+    for (int i = 0; i < SIM_I2C_DEVICES; i++)
+    {
+        if (i2c->devices[i] && i2c->devices[i]->address == addr)
+            return i2c->devices[i];
+    }
+    return NULL;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    const struct sim_i2c_device_s *device = i2cFind(i2c, addr);
+    if (device == NULL || !device->write(src, len))
+        return PICO_ERROR_GENERIC;
+    return len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    const struct sim_i2c_device_s *device = i2cFind(i2c, addr);
+    if (device == NULL || !device->read(dst, len))
+        return PICO_ERROR_GENERIC;
+    return len;
+}
+
+void sim_i2cAttach(const struct sim_i2c_device_s *device)
+{
+    for (int i = 0; i < SIM_I2C_DEVICES; i++)
+    {
+        if (sim_i2c0.devices[i] == NULL)
+        {
+            sim_i2c0.devices[i] = device;
+            return;
+        }
+    }
+}
+
+/*********************************************************************************
+ * uart
+ *********************************************************************************/
+struct uart_inst
+{
+    uint irq;
+    bool rxIrq;
+    uint8_t rx[SIM_UART_BUFFER];
+    uint32_t head;
+    uint32_t tail;
+    void (*transmit)(uint8_t byte);
+};
+
+uart_inst_t sim_uart0 = {.irq = UART0_IRQ};
+uart_inst_t sim_uart1 = {.irq = UART1_IRQ};
+
+uint uart_init(uart_inst_t *uart, uint baudrate)
+{
+    uart->head = uart->tail = 0;
+    return baudrate;
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts)
+{
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity)
+{
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled)
+{
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data)
+{
+    uart->rxIrq = rx_has_data;
+    // the RX interrupt is a level, data that is already waiting raises it at once
+    if (uart->rxIrq && uart_is_readable(uart))
+        sim_irqRaise(uart->irq);
+}
+
+bool uart_is_readable(uart_inst_t *uart)
+{
+    return uart->head != uart->tail;
+}
+
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us)
+{
+    return uart_is_readable(uart);
+}
+
+char uart_getc(uart_inst_t *uart)
+{
+    if (!uart_is_readable(uart))
+        return 0;
+    return uart->rx[uart->tail++ % SIM_UART_BUFFER];
+}
+
+void uart_putc_raw(uart_inst_t *uart, char c)
+{
+    if (uart->transmit)
+        uart->transmit((uint8_t)c);
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uart_putc_raw(uart, src[i]);
+    }
+}
+
+void uart_tx_wait_blocking(uart_inst_t *uart)
+{
+}
+
+void sim_uartReceive(uart_inst_t *uart, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (uart->head - uart->tail < SIM_UART_BUFFER) // overrun drops the newest byte
+            uart->rx[uart->head++ % SIM_UART_BUFFER] = data[i];
+    }
+    if (uart->rxIrq)
+        sim_irqRaise(uart->irq);
+}
+
+void sim_uartOnTransmit(uart_inst_t *uart, void (*callback)(uint8_t byte))
+{
+    uart->transmit = callback;
+}
+
+/*********************************************************************************
+ * rtc
+ *********************************************************************************/
+static bool rtcSet;
+static time_t rtcSeconds;
+static uint64_t rtcSetUs;
+
+void rtc_init(void)
+{
+}
+
+bool rtc_set_datetime(datetime_t *t)
+{
+    struct tm calendar = {
+        .tm_year = t->year - 1900,
+        .tm_mon = t->month - 1,
+        .tm_mday = t->day,
+        .tm_hour = t->hour,
+        .tm_min = t->min,
+        .tm_sec = t->sec,
+    };
+    rtcSeconds = timegm(&calendar);
+    rtcSetUs = time_us_64();
+    rtcSet = true;
+    return true;
+}
+
+bool rtc_get_datetime(datetime_t *t)
+{
+    if (!rtcSet)
+        return false;
+    time_t now = rtcSeconds + (time_us_64() - rtcSetUs) / 1000000;
+    struct tm calendar;
+    gmtime_r(&now, &calendar);
+    t->year = calendar.tm_year + 1900;
+    t->month = calendar.tm_mon + 1;
+    t->day = calendar.tm_mday;
+    t->dotw = calendar.tm_wday;
+    t->hour = calendar.tm_hour;
+    t->min = calendar.tm_min;
+    t->sec = calendar.tm_sec;
+    return true;
+}
+
+bool rtc_running(void)
+{
+    return rtcSet;
+}
+
+/*********************************************************************************
+ * flash
+ *********************************************************************************/
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    memset(&sim_flash[flash_offs], 0xFF, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    // programming can only clear bits
+    for (size_t i = 0; i < count; i++)
+    {
+        sim_flash[flash_offs + i] &= data[i];
+    }
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms)
+{
+    taskENTER_CRITICAL();
+    func(param);
+    taskEXIT_CRITICAL();
+    return PICO_OK;
+}
+
+void sim_hardwareInit(void)
+{
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+    for (int i = 0; i < SIM_GPIO_COUNT; i++)
+    {
+        gpios[i].level = true; // every input the firmware reads is pulled up
+    }
+}
@@ -0,0 +1,239 @@
+#ifndef _SIM_HARDWARE_
+#define _SIM_HARDWARE_
+
+/** The subset of the pico-sdk the firmware uses, backed by simulated peripherals.
+ * Every pico-sdk header in sim/include includes this one so the firmware sources
+ * build unchanged. Interrupts are raised by the device models from a FreeRTOS task.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC (-1)
+#define PICO_ERROR_TIMEOUT (-2)
+
+/* time */
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void busy_wait_us_32(uint32_t delay_us);
+bool stdio_init_all(void);
+int stdio_put_string(const char *s, int len, bool newline, bool cr_translation);
+/* the sim has no console input, the callback never runs */
+int getchar_timeout_us(uint32_t timeout_us);
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+
+/* cores and interrupt masking. One core, and handlers run in tasks, so masking blocks the
+ * tick signal the POSIX port switches tasks on, as its portDISABLE_INTERRUPTS does
+ */
+#define NUM_CORES 1
+static inline uint get_core_num(void)
+{
+    return 0;
+}
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+/* clocks */
+enum clock_index
+{
+    clk_gpout0 = 0,
+    clk_gpout1,
+    clk_gpout2,
+    clk_gpout3,
+    clk_ref,
+    clk_sys,
+    clk_peri,
+    clk_usb,
+    clk_adc,
+    clk_rtc,
+};
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+/* interrupts */
+typedef void (*irq_handler_t)(void);
+enum
+{
+    PIO0_IRQ_0 = 7,
+    PIO0_IRQ_1 = 8,
+    PIO1_IRQ_0 = 9,
+    PIO1_IRQ_1 = 10,
+    IO_IRQ_BANK0 = 13,
+    UART0_IRQ = 20,
+    UART1_IRQ = 21,
+    SIM_IRQ_COUNT = 32,
+};
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+irq_handler_t irq_get_exclusive_handler(uint num);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_set_enabled(uint num, bool enabled);
+
+/* gpio */
+#define SIM_GPIO_COUNT 30
+enum gpio_function
+{
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+};
+enum gpio_irq_level
+{
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+#define GPIO_OUT 1
+#define GPIO_IN 0
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask);
+
+/* pio, only the RX FIFOs of the counting programs are modelled */
+typedef struct
+{
+    volatile uint32_t rxf[4];
+    volatile uint32_t txf[4];
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+extern pio_hw_t sim_pio0, sim_pio1;
+#define pio0 (&sim_pio0)
+#define pio1 (&sim_pio1)
+typedef struct
+{
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+enum pio_interrupt_source
+{
+    pis_sm0_rx_fifo_not_empty = 0,
+};
+int pio_claim_unused_sm(PIO pio, bool required);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+/** true when empty. Otherwise the next word is latched into rxf[sm], as the hardware pops on the read */
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
+void pio_set_irqn_source_enabled(PIO pio, uint irq_index, enum pio_interrupt_source source, bool enabled);
+/** the generated program init functions record which pin a state machine watches */
+void sim_pioAttach(PIO pio, uint sm, uint pin);
+
+/* adc */
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read(void);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+
+/* i2c */
+typedef struct i2c_inst i2c_inst_t;
+extern i2c_inst_t sim_i2c0;
+#define i2c0 (&sim_i2c0)
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+/* uart */
+typedef struct uart_inst uart_inst_t;
+extern uart_inst_t sim_uart0, sim_uart1;
+#define uart0 (&sim_uart0)
+#define uart1 (&sim_uart1)
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD,
+} uart_parity_t;
+uint uart_init(uart_inst_t *uart, uint baudrate);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+bool uart_is_readable(uart_inst_t *uart);
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us);
+char uart_getc(uart_inst_t *uart);
+void uart_putc_raw(uart_inst_t *uart, char c);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+void uart_tx_wait_blocking(uart_inst_t *uart);
+
+/* rtc */
+typedef struct
+{
+    int16_t year;
+    int8_t month;
+    int8_t day;
+    int8_t dotw;
+    int8_t hour;
+    int8_t min;
+    int8_t sec;
+} datetime_t;
+void rtc_init(void);
+bool rtc_set_datetime(datetime_t *t);
+bool rtc_get_datetime(datetime_t *t);
+bool rtc_running(void);
+
+/* flash, the XIP window is a host array */
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+extern uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)sim_flash)
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+uint32_t get_rand_32(void);
+
+/* newlib has strnstr, glibc does not */
+char *strnstr(const char *haystack, const char *needle, size_t length);
+
+/*********************************************************************************
+ * Device side. The models in sim_devices.c and sim_expresslink.c drive these.
+ *********************************************************************************/
+void sim_hardwareInit(void);
+/** the counter that will watch pin starts at count and pushes it when the firmware starts it,
+ * as switch_inputs.pio does. Without a preset a state machine only pushes what it is given
+ */
+void sim_pioPreset(uint pin, uint32_t count);
+/** add edges to the PIO counter watching pin and raise its interrupt */
+void sim_pioCount(uint pin, uint32_t edges);
+/** push a captured value into the PIO state machine watching pin and raise its interrupt */
+void sim_pioCapture(uint pin, uint32_t value);
+/** drive an input pin. An enabled edge raises IO_IRQ_BANK0 */
+void sim_gpioInput(uint gpio, bool value);
+/** called when the firmware drives an output */
+void sim_gpioOnOutput(void (*callback)(uint gpio, bool value));
+void sim_adcSet(uint input, uint16_t counts);
+/** answer adc_read from a function instead of the values set with sim_adcSet */
+void sim_adcSource(uint16_t (*read)(uint input));
+/** answer get_rand_32 from a function instead of the seeded generator */
+void sim_randomSource(uint32_t (*source)(void));
+/** an I2C target. Returns false to NAK */
+struct sim_i2c_device_s
+{
+    uint8_t address;
+    bool (*write)(const uint8_t *src, size_t len);
+    bool (*read)(uint8_t *dst, size_t len);
+};
+void sim_i2cAttach(const struct sim_i2c_device_s *device);
+/** bytes the far end sends to the firmware, raising the RX interrupt while it is enabled */
+void sim_uartReceive(uart_inst_t *uart, const uint8_t *data, size_t len);
+/** called with each byte the firmware transmits */
+void sim_uartOnTransmit(uart_inst_t *uart, void (*callback)(uint8_t byte));
+
+#endif // _SIM_HARDWARE_
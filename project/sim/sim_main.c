@@ -0,0 +1,211 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "sim_hardware.h"
+
+/** The firmware main, renamed when main.c is built for the simulation */
+int firmware_main(void);
+
+struct sim_options_s sim_options = {
+#if SIM_SOAK
+    .days = 100, // three tick wraps
+#else
+    .days = 7,
+#endif
+    .startUtc = 1780272000, // 2026-06-01T00:00:00Z
+    .driftPpm = 12.5,
+    .latitude = 41.9779,
+    .longitude = -91.6656,
+    .altitudeM = 250,
+    .seed = 1,
+};
+
+static uint64_t randomState = 0x9E3779B97F4A7C15ull;
+
+double sim_seconds(void)
+{
+    return time_us_64() / 1e6;
+}
+
+time_t sim_utc(void)
+{
+    return sim_options.startUtc + (time_t)sim_seconds();
+}
+
+double sim_random(void)
+{
+    // xorshift64*, the same sequence for the same seed on every host
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return (randomState * 2685821657736338717ull >> 11) * 0x1p-53;
+}
+
+/** portSUPPRESS_TICKS_AND_SLEEP. When every task is blocked the idle task jumps the tick
+ * count straight to the next wake, so a simulated week takes as long as the work in it.
+ */
+void sim_skipTicks(uint32_t idleTicks)
+{
+    if (sim_options.realtime)
+        return;
+    portDISABLE_INTERRUPTS();
+    vTaskStepTick(idleTicks);
+    portENABLE_INTERRUPTS();
+}
+
+/** the sim's own tasks get at least a pthread sized stack, as KERNEL_STACK does for the
+ * firmware's static ones. glibc printf needs far more than an M0+ task.
+ */
+#define SIM_MINIMAL_STACK_SIZE configMINIMAL_STACK_SIZE
+
+BaseType_t __real_xTaskCreate(TaskFunction_t pxTaskCode, const char *const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+                              void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pxCreatedTask);
+
+BaseType_t __wrap_xTaskCreate(TaskFunction_t pxTaskCode, const char *const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+                              void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pxCreatedTask)
+{
+    configSTACK_DEPTH_TYPE depth = usStackDepth;
+    if (depth < SIM_MINIMAL_STACK_SIZE)
+        depth = SIM_MINIMAL_STACK_SIZE;
+    return __real_xTaskCreate(pxTaskCode, pcName, depth, pvParameters, uxPriority, pxCreatedTask);
+}
+
+static bool parseStart(const char *text, time_t *utc)
+{
+    struct tm calendar = {0};
+    if (sscanf(text, "%d-%d-%dT%d:%d:%d", &calendar.tm_year, &calendar.tm_mon, &calendar.tm_mday,
+               &calendar.tm_hour, &calendar.tm_min, &calendar.tm_sec) != 6)
+        return false;
+    calendar.tm_year -= 1900;
+    calendar.tm_mon -= 1;
+    *utc = timegm(&calendar);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --days N            simulated days to run (7, 100 in the soak build)\n"
+            "  --scenario FILE     weather and link keyframes, see sim_scenario.h (built-in week)\n"
+            "  --publish FILE      log every accepted publish with its UTC time and topic\n"
+            "  --start TIME        GPS time at the start, YYYY-MM-DDTHH:MM:SS (2026-06-01T00:00:00)\n"
+            "  --site LAT,LON,ALT  station position in degrees and metres\n"
+            "  --drift-ppm PPM     crystal error for the PPS servo (12.5)\n"
+            "  --seed N            gusts, noise and module timings (1)\n"
+            "  --realtime          run on the wall clock\n"
+            "  --trace             dump the kernel trace at the end, for weather_trace\n"
+            "  --stall MS          hold the CPU above every task for MS once an hour and check\n"
+            "                      the deadline monitor saw each one (1500 or more)\n"
+            "  --replay FILE       feed a capture (a USB log or a flash dump) through the firmware\n"
+            "  --replay-session N  which session in the capture to replay (the newest)\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option options[] = {
+        {"days", required_argument, NULL, 'd'},
+        {"scenario", required_argument, NULL, 'c'},
+        {"publish", required_argument, NULL, 'p'},
+        {"start", required_argument, NULL, 't'},
+        {"site", required_argument, NULL, 'l'},
+        {"drift-ppm", required_argument, NULL, 'f'},
+        {"seed", required_argument, NULL, 's'},
+        {"realtime", no_argument, NULL, 'r'},
+        {"trace", no_argument, NULL, 'k'},
+        {"stall", required_argument, NULL, 'x'},
+        {"replay", required_argument, NULL, 'y'},
+        {"replay-session", required_argument, NULL, 'n'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    const char *replay = NULL;
+    int replaySession = -1;
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'd':
+            sim_options.days = atof(optarg);
+            break;
+        case 'c':
+            if (!sim_scenarioLoad(optarg))
+                return 1;
+            break;
+        case 'p':
+            sim_options.publishLog = fopen(optarg, "w");
+            if (sim_options.publishLog == NULL)
+            {
+                perror(optarg);
+                return 1;
+            }
+            setvbuf(sim_options.publishLog, NULL, _IOLBF, 0);
+            break;
+        case 't':
+            if (!parseStart(optarg, &sim_options.startUtc))
+            {
+                fprintf(stderr, "bad start time %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'l':
+            if (sscanf(optarg, "%lf,%lf,%lf", &sim_options.latitude, &sim_options.longitude, &sim_options.altitudeM) != 3)
+            {
+                fprintf(stderr, "bad site %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'f':
+            sim_options.driftPpm = atof(optarg);
+            break;
+        case 's':
+            sim_options.seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            sim_options.realtime = true;
+            break;
+        case 'k':
+            sim_options.trace = true;
+            break;
+        case 'x':
+            sim_options.stallMs = strtoul(optarg, NULL, 0);
+            break;
+        case 'y':
+            replay = optarg;
+            break;
+        case 'n':
+            replaySession = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    randomState = (sim_options.seed + 1ull) * 0x9E3779B97F4A7C15ull; // never zero
+    srandom(sim_options.seed);
+
+    sim_hardwareInit();
+    if (replay)
+    {
+        if (!sim_replayLoad(replay, replaySession))
+            return 1;
+        sim_replayInit();
+        sim_replayStart();
+        return firmware_main();
+    }
+    sim_devicesInit();
+    sim_expresslinkInit();
+    sim_devicesStart();
+    return firmware_main();
+}
@@ -0,0 +1,566 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_hardware.h"
+#include "capture.h"
+#include "pinmap.h"
+
+/** Plays a capture from capture.c back through the firmware in place of the device models.
+ * Inputs that arrive on their own (PIO words, NMEA, ExpressLink responses, GPIO edges) are
+ * delivered on the tick they were captured on. Inputs the firmware asks for (ADC, I2C,
+ * get_rand_32) are answered in the order they were captured. Every line the firmware sends
+ * the ExpressLink is compared with the captured one, which covers every published report.
+ */
+#define SIM_REPLAY_PRIORITY (configMAX_PRIORITIES - 1)
+#define SIM_REPLAY_TAIL_MS 60000 // keep running after the last input for the commands it causes
+#define SIM_REPLAY_ADC_DISCARD 3 // convertPin in wind_task.c throws away 3 reads then adds up 256
+#define SIM_REPLAY_ADC_SAMPLES 256
+
+struct sim_replay_record_s
+{
+    uint32_t tick;
+    uint8_t type;
+    uint8_t source;
+    uint32_t value;
+    uint8_t address;
+    uint8_t reg;
+    uint16_t length;
+    const uint8_t *data;
+};
+
+struct sim_replay_queue_s
+{
+    struct sim_replay_record_s *records;
+    size_t count;
+    size_t capacity;
+    size_t next;
+};
+
+static struct sim_replay_queue_s timed;    // delivered on their tick
+static struct sim_replay_queue_s adc;      // answered in order
+static struct sim_replay_queue_s i2c;
+static struct sim_replay_queue_s randoms;
+static struct sim_replay_queue_s commands; // compared in order
+
+static struct
+{
+    uint64_t lost;
+    uint64_t adcMismatches;
+    uint64_t i2cMismatches;
+    uint64_t exhausted; // asked for more than was captured
+    uint64_t matched;
+    uint64_t differed;
+    uint64_t extra;
+    uint32_t firstDifference; // tick
+} replayStats;
+
+static const uint8_t *stream;
+static size_t streamLength;
+
+static bool getVarint(size_t *at, size_t end, uint32_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35 && *at < end; shift += 7)
+    {
+        uint8_t byte = stream[(*at)++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static void queueAdd(struct sim_replay_queue_s *queue, const struct sim_replay_record_s *record)
+{
+    if (queue->count == queue->capacity)
+    {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 1024;
+        queue->records = realloc(queue->records, queue->capacity * sizeof(*queue->records));
+    }
+    queue->records[queue->count++] = *record;
+}
+
+/** a copy that outlives the stream, NUL terminated for printing */
+static const uint8_t *keep(const void *data, size_t length)
+{
+    uint8_t *copy = malloc(length + 1);
+    memcpy(copy, data, length);
+    copy[length] = 0;
+    return copy;
+}
+
+/** the session header at this offset, or false */
+static bool sessionAt(size_t at, uint32_t *sequence)
+{
+    if (stream[at] != CAPTURE_SESSION)
+        return false;
+    uint32_t tick;
+    at++;
+    if (!getVarint(&at, streamLength, &tick) || at + 6 > streamLength)
+        return false;
+    if (memcmp(stream + at, CAPTURE_MAGIC, 5) != 0 || stream[at + 5] != CAPTURE_VERSION)
+        return false;
+    at += 6;
+    return getVarint(&at, streamLength, sequence);
+}
+
+/** a flash dump is whole pages with a session starting on one of them */
+static bool flashDump(void)
+{
+    uint32_t sequence;
+    if (streamLength == 0 || streamLength % CAPTURE_PAGE_SIZE != 0)
+        return false;
+    for (size_t at = 0; at < streamLength; at += CAPTURE_PAGE_SIZE)
+    {
+        if (sessionAt(at, &sequence))
+            return true;
+    }
+    return false;
+}
+
+/** decode records from start until a pad, the next session or the end */
+static bool sim_replayDecode(size_t start, size_t end)
+{
+    static uint32_t lastPioWord[CAPTURE_PIO_SOURCES];
+    static struct capture_nmea_history_s nmeaHistory;
+    uint32_t tick = 0;
+    size_t at = start;
+
+    while (at < end && stream[at] != 0xFF)
+    {
+        struct sim_replay_record_s record = {0};
+        uint32_t delta;
+        uint32_t length;
+        record.type = stream[at] & 0x0F;
+        record.source = stream[at] >> 4;
+        at++;
+        if (!getVarint(&at, end, &delta))
+            break;
+        tick += delta;
+        record.tick = tick;
+
+        switch (record.type)
+        {
+        case CAPTURE_SESSION:
+            at += 6;
+            getVarint(&at, end, &record.value);
+            getVarint(&at, end, &length);
+            if (length != configTICK_RATE_HZ)
+            {
+                fprintf(stderr, "replay: captured at %lu ticks a second, the simulation runs %lu\n",
+                        (unsigned long)length, (unsigned long)configTICK_RATE_HZ);
+                return false;
+            }
+            break;
+        case CAPTURE_PIO:
+            if (record.source >= CAPTURE_PIO_SOURCES || !getVarint(&at, end, &record.value))
+                return false;
+            lastPioWord[record.source] += (record.value >> 1) ^ -(record.value & 1);
+            record.value = lastPioWord[record.source];
+            queueAdd(&timed, &record);
+            break;
+        case CAPTURE_ADC:
+            if (!getVarint(&at, end, &record.value))
+                return false;
+            queueAdd(&adc, &record);
+            break;
+        case CAPTURE_NMEA:
+        {
+            char sentence[CAPTURE_NMEA_LENGTH];
+            if (!getVarint(&at, end, &length) || length >= sizeof(sentence))
+                return false;
+            if (record.source == 0)
+            {
+                if (at + length > end)
+                    return false;
+                memcpy(sentence, stream + at, length);
+                at += length;
+            }
+            else
+            {
+                // runs of (unchanged, changed, bytes) against the sentence in the slot
+                int slot = record.source - 1;
+                if (slot >= CAPTURE_NMEA_TYPES || nmeaHistory.length[slot] != length)
+                    return false;
+                uint32_t i = 0;
+                while (i < length)
+                {
+                    uint32_t same, changed;
+                    if (!getVarint(&at, end, &same) || !getVarint(&at, end, &changed) || i + same + changed > length || at + changed > end)
+                        return false;
+                    if (same)
+                        memcpy(sentence + i, nmeaHistory.sentence[slot] + i, same);
+                    memcpy(sentence + i + same, stream + at, changed);
+                    at += changed;
+                    i += same + changed;
+                }
+            }
+            capture_nmeaRemember(&nmeaHistory, capture_nmeaFind(&nmeaHistory, sentence, length), sentence, length);
+            record.length = length;
+            record.data = keep(sentence, length);
+            queueAdd(&timed, &record);
+            break;
+        }
+        case CAPTURE_I2C:
+            if (at + 2 > end)
+                return false;
+            record.address = stream[at++];
+            record.reg = stream[at++];
+            if (!getVarint(&at, end, &length) || at + length > end)
+                return false;
+            record.length = length;
+            record.data = stream + at;
+            at += length;
+            queueAdd(&i2c, &record);
+            break;
+        case CAPTURE_EL_RESPONSE:
+        case CAPTURE_EL_COMMAND:
+            if (!getVarint(&at, end, &length) || at + length > end)
+                return false;
+            record.length = length;
+            record.data = keep(stream + at, length);
+            at += length;
+            queueAdd(record.type == CAPTURE_EL_COMMAND ? &commands : &timed, &record);
+            break;
+        case CAPTURE_GPIO:
+            if (at + 2 > end)
+                return false;
+            record.address = stream[at++];
+            record.value = stream[at++];
+            queueAdd(&timed, &record);
+            break;
+        case CAPTURE_RANDOM:
+            if (!getVarint(&at, end, &record.value))
+                return false;
+            queueAdd(&randoms, &record);
+            break;
+        case CAPTURE_LOST:
+            if (!getVarint(&at, end, &record.value))
+                return false;
+            replayStats.lost += record.value;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/** pull the capture stream out of the USB frames in a console log */
+static size_t sim_replayUnframe(uint8_t *data, size_t length)
+{
+    size_t out = 0;
+    for (size_t i = 0; i + 5 <= length;)
+    {
+        size_t frameLength = data[i + 2] | data[i + 3] << 8;
+        if (data[i] != CAPTURE_FRAME_START || data[i + 1] != 'W' || frameLength > CAPTURE_FRAME_MAX || i + 5 + frameLength > length)
+        {
+            i++;
+            continue;
+        }
+        uint8_t sum = 0;
+        for (size_t j = 0; j < frameLength; j++)
+        {
+            sum += data[i + 4 + j];
+        }
+        if (sum != data[i + 4 + frameLength])
+        {
+            fprintf(stderr, "replay: bad frame at byte %zu\n", i);
+            i++;
+            continue;
+        }
+        memmove(data + out, data + i + 4, frameLength);
+        out += frameLength;
+        i += 5 + frameLength;
+    }
+    return out;
+}
+
+bool sim_replayLoad(const char *path, int session)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    rewind(file);
+    uint8_t *data = malloc(length + 1);
+    if (fread(data, 1, length, file) != (size_t)length)
+    {
+        perror(path);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    stream = data;
+    streamLength = length;
+    bool flash = flashDump();
+    if (!flash)
+        streamLength = sim_replayUnframe(data, length); // a console log
+
+    // a flash dump holds several sessions, each starting on a page, a console log one per boot.
+    // Without a choice play the highest numbered one, the last of those on a tie
+    size_t starts[256];
+    uint32_t sequences[256];
+    int sessions = 0;
+    for (size_t at = 0; at + 8 < streamLength && sessions < 256; at += flash ? CAPTURE_PAGE_SIZE : 1)
+    {
+        if (sessionAt(at, &sequences[sessions]))
+            starts[sessions++] = at;
+    }
+    if (sessions == 0)
+    {
+        fprintf(stderr, "replay: no capture session in %s\n", path);
+        return false;
+    }
+    int chosen = sessions - 1;
+    for (int s = 0; s < sessions; s++)
+    {
+        fprintf(stderr, "replay: session %d number %lu at byte %zu\n", s, (unsigned long)sequences[s], starts[s]);
+        if (session < 0 && sequences[s] > sequences[chosen])
+            chosen = s;
+    }
+    if (session >= 0)
+    {
+        if (session >= sessions)
+        {
+            fprintf(stderr, "replay: %s has %d sessions\n", path, sessions);
+            return false;
+        }
+        chosen = session;
+    }
+    size_t start = starts[chosen];
+    size_t end = chosen + 1 < sessions ? starts[chosen + 1] : streamLength;
+    if (flash && end == streamLength && starts[0] > 0)
+    {
+        // the last session in the region went on at its start, up to the first session there
+        uint8_t *unwrapped = malloc(streamLength - start + starts[0]);
+        memcpy(unwrapped, stream + start, streamLength - start);
+        memcpy(unwrapped + streamLength - start, stream, starts[0]);
+        stream = unwrapped;
+        streamLength += starts[0] - start;
+        start = 0;
+        end = streamLength;
+    }
+    if (!sim_replayDecode(start, end))
+        fprintf(stderr, "replay: the capture is damaged after %zu records, replaying up to there\n",
+                timed.count + adc.count + i2c.count + randoms.count + commands.count);
+    fprintf(stderr, "replay: session %d, %zu timed inputs, %zu ADC, %zu I2C, %zu commands\n",
+            chosen, timed.count, adc.count, i2c.count, commands.count);
+    if (replayStats.lost)
+        fprintf(stderr, "replay: the capture lost %llu records, expect the replay to differ\n", (unsigned long long)replayStats.lost);
+    return true;
+}
+
+/*********************************************************************************
+ * inputs the firmware asks for
+ *********************************************************************************/
+static uint16_t sim_replayAdc(uint input)
+{
+    static uint32_t reads;
+    if (adc.next >= adc.count)
+    {
+        replayStats.exhausted++;
+        return 0;
+    }
+    const struct sim_replay_record_s *record = &adc.records[adc.next];
+    if (record->source != input && reads == 0)
+        replayStats.adcMismatches++;
+    // the captured sum spread over the 256 reads so the firmware adds up the same total
+    uint32_t base = record->value / SIM_REPLAY_ADC_SAMPLES;
+    uint32_t extra = record->value % SIM_REPLAY_ADC_SAMPLES;
+    uint32_t sample = reads < SIM_REPLAY_ADC_DISCARD ? 0 : reads - SIM_REPLAY_ADC_DISCARD;
+    uint16_t value = base + (reads >= SIM_REPLAY_ADC_DISCARD && sample < extra);
+    if (++reads == SIM_REPLAY_ADC_DISCARD + SIM_REPLAY_ADC_SAMPLES)
+    {
+        reads = 0;
+        adc.next++;
+    }
+    return value;
+}
+
+static uint8_t i2cRegister[2];
+
+static bool sim_replayI2cWrite(int device, const uint8_t *src, size_t len)
+{
+    if (len > 0)
+        i2cRegister[device] = src[0];
+    return true;
+}
+
+static bool sim_replayI2cRead(int device, uint8_t address, uint8_t *dst, size_t len)
+{
+    if (i2c.next >= i2c.count)
+    {
+        replayStats.exhausted++;
+        memset(dst, 0, len);
+        return true;
+    }
+    const struct sim_replay_record_s *record = &i2c.records[i2c.next++];
+    if (record->address != address || record->reg != i2cRegister[device] || record->length != len)
+        replayStats.i2cMismatches++;
+    memset(dst, 0, len);
+    memcpy(dst, record->data, record->length < len ? record->length : len);
+    return true;
+}
+
+static bool tmp102Write(const uint8_t *src, size_t len)
+{
+    return sim_replayI2cWrite(0, src, len);
+}
+
+static bool tmp102Read(uint8_t *dst, size_t len)
+{
+    return sim_replayI2cRead(0, 0x48, dst, len);
+}
+
+static bool bmp388Write(const uint8_t *src, size_t len)
+{
+    return sim_replayI2cWrite(1, src, len);
+}
+
+static bool bmp388Read(uint8_t *dst, size_t len)
+{
+    return sim_replayI2cRead(1, 0x77, dst, len);
+}
+
+static const struct sim_i2c_device_s tmp102 = {0x48, tmp102Write, tmp102Read};
+static const struct sim_i2c_device_s bmp388 = {0x77, bmp388Write, bmp388Read};
+
+static uint32_t sim_replayRandom(void)
+{
+    if (randoms.next >= randoms.count)
+    {
+        replayStats.exhausted++;
+        return 0;
+    }
+    return randoms.records[randoms.next++].value;
+}
+
+/*********************************************************************************
+ * what the firmware sends the ExpressLink
+ *********************************************************************************/
+static void sim_replayCommand(const char *line, size_t length)
+{
+    if (commands.next >= commands.count)
+    {
+        replayStats.extra++;
+        return;
+    }
+    const struct sim_replay_record_s *record = &commands.records[commands.next++];
+    if (record->length == length && memcmp(record->data, line, length) == 0)
+    {
+        replayStats.matched++;
+        return;
+    }
+    if (replayStats.differed++ == 0)
+    {
+        replayStats.firstDifference = xTaskGetTickCount();
+        fprintf(stderr, "replay: first difference at tick %lu, captured at %lu\n  captured %.*s\n  replayed %.*s\n",
+                (unsigned long)replayStats.firstDifference, (unsigned long)record->tick,
+                (int)record->length, (const char *)record->data, (int)length, line);
+    }
+}
+
+static void sim_replayTransmit(uint8_t byte)
+{
+    static char line[1200];
+    static size_t length;
+    if (byte == '\r')
+        return;
+    if (byte != '\n')
+    {
+        if (length < sizeof(line))
+            line[length++] = byte;
+        return;
+    }
+    sim_replayCommand(line, length);
+    if (sim_options.publishLog && length > 7 && strncmp(line, "AT+SEND", 7) == 0)
+        fprintf(sim_options.publishLog, "%lu\t%.*s\n", (unsigned long)xTaskGetTickCount(), (int)length - 7, line + 7);
+    length = 0;
+}
+
+/*********************************************************************************
+ * inputs that arrive on their own
+ *********************************************************************************/
+static void sim_replayDeliver(const struct sim_replay_record_s *record)
+{
+    static const uint pioPins[CAPTURE_PIO_SOURCES] = {WIND_SPEED_PIN, RAIN_BUCKET_PIN, GPS_PPS_PIN};
+    switch (record->type)
+    {
+    case CAPTURE_PIO:
+        sim_pioCapture(pioPins[record->source], record->value);
+        break;
+    case CAPTURE_NMEA:
+        sim_uartReceive(uart1, record->data, record->length);
+        sim_uartReceive(uart1, (const uint8_t *)"\r\n", 2);
+        break;
+    case CAPTURE_EL_RESPONSE:
+        sim_uartReceive(uart0, record->data, record->length);
+        sim_uartReceive(uart0, (const uint8_t *)"\r\n", 2);
+        break;
+    case CAPTURE_GPIO:
+    {
+        // only the edge was captured. Go to the level before it, then make the edge
+        bool fall = record->value & GPIO_IRQ_EDGE_FALL;
+        sim_gpioInput(record->address, fall);
+        sim_gpioInput(record->address, !fall);
+        break;
+    }
+    }
+}
+
+static void sim_replaySummary(FILE *out)
+{
+    fprintf(out, "replay: %llu commands matched, %llu differed, %llu extra, %zu not sent\n",
+            (unsigned long long)replayStats.matched, (unsigned long long)replayStats.differed,
+            (unsigned long long)replayStats.extra, commands.count - commands.next);
+    fprintf(out, "replay: ADC %zu of %zu read, %llu on another channel. I2C %zu of %zu read, %llu at another register\n",
+            adc.next, adc.count, (unsigned long long)replayStats.adcMismatches,
+            i2c.next, i2c.count, (unsigned long long)replayStats.i2cMismatches);
+    if (replayStats.exhausted)
+        fprintf(out, "replay: the firmware asked for %llu inputs past the end of the capture\n", (unsigned long long)replayStats.exhausted);
+}
+
+static void sim_replayTask(void *parameter)
+{
+    while (timed.next < timed.count)
+    {
+        const struct sim_replay_record_s *record = &timed.records[timed.next];
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(record->tick - now) > 0)
+            vTaskDelay(record->tick - now);
+        sim_replayDeliver(record);
+        timed.next++;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SIM_REPLAY_TAIL_MS));
+
+    fflush(stdout);
+    sim_replaySummary(stderr);
+    bool identical = replayStats.differed == 0 && replayStats.extra == 0 && commands.next == commands.count;
+    fprintf(stderr, "replay: %s\n", identical ? "identical" : "DIFFERENT");
+    exit(identical ? 0 : 1);
+}
+
+void sim_replayInit(void)
+{
+    sim_i2cAttach(&tmp102);
+    sim_i2cAttach(&bmp388);
+    sim_adcSource(sim_replayAdc);
+    sim_randomSource(sim_replayRandom);
+    sim_uartOnTransmit(uart0, sim_replayTransmit);
+}
+
+void sim_replayStart(void)
+{
+    xTaskCreate(sim_replayTask, "sim replay", 4096, NULL, SIM_REPLAY_PRIORITY, NULL);
+}
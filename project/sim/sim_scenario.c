@@ -0,0 +1,143 @@
+#include "sim_scenario.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_SCENARIO_KEYFRAMES 1024
+
+struct sim_keyframe_s
+{
+    double hours;
+    struct sim_conditions_s conditions;
+};
+
+/** a week with something for every part of the firmware.
+ * Calm days with a temperature cycle, a front on day 3 with a pressure drop, gusts and a
+ * downpour, a hot afternoon on day 4 over the TMP102 alert limit and a link outage on day 5.
+ */
+static const struct sim_keyframe_s builtinWeek[] = {
+    {0, {12, 101800, 3, 6, 270, 0, true}},
+    {6, {9, 101820, 2, 4, 260, 0, true}},
+    {14, {20, 101780, 6, 11, 250, 0, true}},
+    {24, {11, 101760, 3, 6, 240, 0, true}},
+    {38, {21, 101700, 7, 12, 225, 0, true}},
+    {48, {13, 101600, 8, 14, 200, 0, true}},
+    {54, {14, 101300, 14, 26, 180, 0.05f, true}},
+    {57, {12, 100700, 28, 48, 160, 0.9f, true}},
+    {59, {10, 100500, 32, 55, 140, 1.4f, true}},
+    {62, {9, 100800, 18, 30, 300, 0.3f, true}},
+    {66, {8, 101200, 9, 15, 315, 0, true}},
+    {72, {10, 101500, 5, 9, 315, 0, true}},
+    {84, {35, 101600, 4, 8, 90, 0, true}},
+    {86, {41, 101580, 4, 8, 90, 0, true}},
+    {89, {30, 101560, 4, 8, 90, 0, true}},
+    {96, {16, 101550, 3, 6, 45, 0, true}},
+    {110, {22, 101500, 5, 9, 0, 0, true}},
+    {112, {22, 101500, 5, 9, 0, 0, false}},
+    {115, {19, 101480, 5, 9, 0, 0, true}},
+    {120, {14, 101450, 3, 6, 0, 0, true}},
+    {134, {21, 101400, 6, 10, 270, 0.02f, true}},
+    {144, {12, 101420, 3, 6, 270, 0, true}},
+    {158, {20, 101500, 5, 9, 270, 0, true}},
+    {168, {12, 101600, 3, 6, 270, 0, true}},
+};
+
+static const struct sim_keyframe_s *keyframes = builtinWeek;
+static int keyframeCount = sizeof(builtinWeek) / sizeof(*builtinWeek);
+
+bool sim_scenarioLoad(const char *path)
+{
+    static struct sim_keyframe_s loaded[SIM_SCENARIO_KEYFRAMES];
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    char line[256];
+    int count = 0;
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) && count < SIM_SCENARIO_KEYFRAMES)
+    {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+            continue;
+        struct sim_keyframe_s *frame = &loaded[count];
+        int link;
+        if (sscanf(line, "%lf,%f,%f,%f,%f,%f,%f,%d", &frame->hours, &frame->conditions.temperatureC,
+                   &frame->conditions.pressurePa, &frame->conditions.windMph, &frame->conditions.gustMph,
+                   &frame->conditions.directionDeg, &frame->conditions.rainInHr, &link) != 8 ||
+            (count > 0 && frame->hours <= loaded[count - 1].hours))
+        {
+            fprintf(stderr, "%s:%d: bad keyframe\n", path, lineNumber);
+            fclose(file);
+            return false;
+        }
+        frame->conditions.linkUp = link != 0;
+        count++;
+    }
+    fclose(file);
+    if (count == 0)
+    {
+        fprintf(stderr, "%s: no keyframes\n", path);
+        return false;
+    }
+    keyframes = loaded;
+    keyframeCount = count;
+    return true;
+}
+
+static float lerp(float a, float b, float fraction)
+{
+    return a + (b - a) * fraction;
+}
+
+void sim_scenarioAt(double hours, struct sim_conditions_s *conditions)
+{
+    // the scenario repeats when the run is longer
+    double length = keyframes[keyframeCount - 1].hours;
+    if (length > 0 && hours > length)
+        hours -= length * (int)(hours / length);
+
+    int next = 0;
+    while (next < keyframeCount && keyframes[next].hours <= hours)
+    {
+        next++;
+    }
+    if (next == 0 || next == keyframeCount)
+    {
+        *conditions = keyframes[next == 0 ? 0 : keyframeCount - 1].conditions;
+        return;
+    }
+
+    const struct sim_conditions_s *a = &keyframes[next - 1].conditions;
+    const struct sim_conditions_s *b = &keyframes[next].conditions;
+    float fraction = (float)((hours - keyframes[next - 1].hours) / (keyframes[next].hours - keyframes[next - 1].hours));
+
+    conditions->temperatureC = lerp(a->temperatureC, b->temperatureC, fraction);
+    conditions->pressurePa = lerp(a->pressurePa, b->pressurePa, fraction);
+    conditions->windMph = lerp(a->windMph, b->windMph, fraction);
+    conditions->gustMph = lerp(a->gustMph, b->gustMph, fraction);
+    conditions->rainInHr = lerp(a->rainInHr, b->rainInHr, fraction);
+    conditions->linkUp = a->linkUp;
+
+    // turn the short way round
+    float turn = b->directionDeg - a->directionDeg;
+    if (turn > 180)
+        turn -= 360;
+    if (turn < -180)
+        turn += 360;
+    float direction = a->directionDeg + turn * fraction;
+    if (direction < 0)
+        direction += 360;
+    if (direction >= 360)
+        direction -= 360;
+    conditions->directionDeg = direction;
+}
+
+double sim_scenarioHours(void)
+{
+    return keyframes[keyframeCount - 1].hours;
+}
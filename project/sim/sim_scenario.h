@@ -0,0 +1,29 @@
+#ifndef _SIM_SCENARIO_
+#define _SIM_SCENARIO_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** the weather and the network at one point of the simulated run */
+struct sim_conditions_s
+{
+    float temperatureC;
+    float pressurePa;
+    float windMph;
+    float gustMph;      // the fastest second in a gusty minute
+    float directionDeg;
+    float rainInHr;
+    bool linkUp;        // the ExpressLink can reach the broker
+};
+
+/** load keyframes from a CSV file, one per line:
+ * hours,temperature_c,pressure_pa,wind_mph,gust_mph,direction_deg,rain_in_hr,link
+ * hours from the start of the run in increasing order. Lines starting with # are ignored.
+ * Without a file the built-in week is used.
+ */
+bool sim_scenarioLoad(const char *path);
+/** linear between keyframes, the link holds its value until the next keyframe */
+void sim_scenarioAt(double hours, struct sim_conditions_s *conditions);
+double sim_scenarioHours(void);
+
+#endif // _SIM_SCENARIO_
@@ -0,0 +1,217 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "sim.h"
+#include "sim_hardware.h"
+#include "pinmap.h"
+
+/** Checks for the soak build (cmake -DSIM_SOAK=ON) that runs the station for months.
+ * The tick count starts SIM_SOAK_TICK_LEAD ticks short of its wrap (FreeRTOSConfig.h) and
+ * the wind and rain counters start a little short of theirs, so a run crosses both counter
+ * wraps early and the tick wrap every 49.7 days after the first.
+ * The firmware results are caught as they leave wind_task.c and rain_task.c, by wrapping the
+ * calls at link time, and compared with the edges and tips the device models produced.
+ */
+#define SIM_SOAK_WIND_LEAD 20000 // edges before the wind counter wraps, an hour or so of breeze
+#define SIM_SOAK_RAIN_LEAD 41    // edges before the rain counter wraps, odd so it wraps mid tip
+#define SIM_SOAK_MPH_PER_HZ 1.492
+#define SIM_SOAK_INCHES_PER_TIP 0.011
+#define SIM_SOAK_AVERAGE 120         // wind updates in the 2 minute average
+#define SIM_SOAK_GUST (9 * 60)       // wind updates in the gust at a report, the minute just started is empty
+#define SIM_SOAK_UPDATE_TICKS 1000   // WIND_DATA_UPDATE
+#define SIM_SOAK_HOUR_S 3600
+#define SIM_SOAK_FAILURES_SHOWN 20
+
+void __real_alerts_checkGust(float speedMph);
+void __real_alerts_checkRainTips(uint32_t tips);
+void __real_reportWINDScaledData(float avgSpeed_2m, int avgDirection_2m, float gustSpeed_10m, int gustDirection_10m);
+void __real_reportRainScaledData(float rain_hr, float rain_day);
+
+enum sim_soak_check_e
+{
+    SOAK_WIND_SPEED,
+    SOAK_WIND_REPORT,
+    SOAK_RAIN_TIPS,
+    SOAK_RAIN_HOUR,
+    SOAK_RAIN_DAY,
+    SOAK_CHECKS,
+};
+
+static const char *const checkNames[SOAK_CHECKS] = {"wind speeds", "wind reports", "rain alert tips", "rain hours", "rain days"};
+
+static struct
+{
+    uint64_t windEdges; // what the models put on the counters since boot
+    uint64_t rainTips;
+    TickType_t lastTick;
+    uint32_t tickWraps;
+
+    TickType_t windTick; // the last wind update
+    uint64_t windEdgesAtUpdate;
+    double speeds[SIM_SOAK_GUST]; // expected speed of each update, a ring
+    uint64_t updates;
+
+    uint64_t hourTips[24]; // tips at the end of each of the last 24 hours, a ring
+    uint64_t hours;
+    float rainDay;
+
+    uint64_t checks[SOAK_CHECKS];
+    uint64_t failures[SOAK_CHECKS];
+} soak;
+
+static void soak_fail(enum sim_soak_check_e check, const char *format, ...)
+{
+    soak.failures[check]++;
+    uint64_t total = 0;
+    for (int i = 0; i < SOAK_CHECKS; i++)
+    {
+        total += soak.failures[i];
+    }
+    if (total > SIM_SOAK_FAILURES_SHOWN)
+        return;
+    double seconds = sim_seconds();
+    fprintf(stderr, "soak: day %d %02d:%02d:%02d tick %lu %s: ", (int)(seconds / 86400), (int)fmod(seconds / 3600, 24),
+            (int)fmod(seconds / 60, 60), (int)fmod(seconds, 60), (unsigned long)xTaskGetTickCount(), checkNames[check]);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+static bool soak_close(double actual, double expected)
+{
+    // the firmware works in float
+    return fabs(actual - expected) <= 1e-3 + 1e-5 * fabs(expected);
+}
+
+uint32_t sim_soakCounterStart(unsigned int pin)
+{
+    return pin == WIND_SPEED_PIN ? (uint32_t)-SIM_SOAK_WIND_LEAD : (uint32_t)-SIM_SOAK_RAIN_LEAD;
+}
+
+void sim_soakInit(void)
+{
+    // the models step once before the firmware attaches the counters, those edges are lost
+    soak.windEdges = 0;
+    soak.rainTips = 0;
+    soak.lastTick = soak.windTick = configINITIAL_TICK_COUNT;
+}
+
+void sim_soakStep(uint32_t windEdges, uint32_t rainTips)
+{
+    soak.windEdges += windEdges;
+    soak.rainTips += rainTips;
+    TickType_t tick = xTaskGetTickCount();
+    if (tick < soak.lastTick)
+        soak.tickWraps++;
+    soak.lastTick = tick;
+}
+
+/*********************************************************************************
+ * the wrapped firmware calls
+ *********************************************************************************/
+/** every wind update, wind_task.c has its speed from the edges since the last one */
+void __wrap_alerts_checkGust(float speedMph)
+{
+    TickType_t tick = xTaskGetTickCount();
+    TickType_t ticks = tick - soak.windTick;
+    double expected = SIM_SOAK_MPH_PER_HZ * (soak.windEdges - soak.windEdgesAtUpdate) * configTICK_RATE_HZ / ticks;
+    soak.checks[SOAK_WIND_SPEED]++;
+    if (ticks != SIM_SOAK_UPDATE_TICKS || !soak_close(speedMph, expected))
+        soak_fail(SOAK_WIND_SPEED, "%.3f mph after %lu ticks, expected %.3f after %u", speedMph, (unsigned long)ticks,
+                  expected, SIM_SOAK_UPDATE_TICKS);
+    soak.windTick = tick;
+    soak.windEdgesAtUpdate = soak.windEdges;
+    soak.speeds[soak.updates++ % SIM_SOAK_GUST] = expected;
+    __real_alerts_checkGust(speedMph);
+}
+
+/** once a minute, the 2 minute average and the gust over the minutes before this one */
+void __wrap_reportWINDScaledData(float avgSpeed_2m, int avgDirection_2m, float gustSpeed_10m, int gustDirection_10m)
+{
+    double sum = 0;
+    double gust = 0;
+    for (uint64_t i = 1; i <= SIM_SOAK_GUST && i <= soak.updates; i++)
+    {
+        double speed = soak.speeds[(soak.updates - i) % SIM_SOAK_GUST];
+        if (i <= SIM_SOAK_AVERAGE)
+            sum += speed;
+        if (speed > gust)
+            gust = speed;
+    }
+    double average = sum / SIM_SOAK_AVERAGE; // the firmware starts with two minutes of zeros
+    soak.checks[SOAK_WIND_REPORT]++;
+    if (soak.updates % 60 != 0 || !soak_close(avgSpeed_2m, average) || !soak_close(gustSpeed_10m, gust))
+        soak_fail(SOAK_WIND_REPORT, "average %.3f gust %.3f after %llu updates, expected %.3f and %.3f", avgSpeed_2m,
+                  gustSpeed_10m, (unsigned long long)soak.updates, average, gust);
+    __real_reportWINDScaledData(avgSpeed_2m, avgDirection_2m, gustSpeed_10m, gustDirection_10m);
+}
+
+/** the rain rate alert counts tips since boot in 32 bits */
+void __wrap_alerts_checkRainTips(uint32_t tips)
+{
+    soak.checks[SOAK_RAIN_TIPS]++;
+    if (tips != (uint32_t)soak.rainTips)
+        soak_fail(SOAK_RAIN_TIPS, "%lu tips, expected %lu", (unsigned long)tips, (unsigned long)(uint32_t)soak.rainTips);
+    __real_alerts_checkRainTips(tips);
+}
+
+/** on the hour from boot, the tips in that hour and every 24th hour the tips in that day */
+void __wrap_reportRainScaledData(float rain_hr, float rain_day)
+{
+    uint64_t hour = ++soak.hours;
+    double late = sim_seconds() - (double)hour * SIM_SOAK_HOUR_S;
+    uint64_t lastHour = hour > 1 ? soak.hourTips[(hour - 1) % 24] : 0;
+    double expectedHour = (soak.rainTips - lastHour) * SIM_SOAK_INCHES_PER_TIP;
+    soak.checks[SOAK_RAIN_HOUR]++;
+    // the rain task looks at the time once a second
+    if (late < 0 || late > 1.001 || !soak_close(rain_hr, expectedHour))
+        soak_fail(SOAK_RAIN_HOUR, "hour %llu %.3f in %.3f s late, expected %.3f", (unsigned long long)hour, rain_hr, late,
+                  expectedHour);
+
+    double expectedDay = soak.rainDay;
+    if (hour % 24 == 0)
+    {
+        uint64_t lastDay = hour > 24 ? soak.hourTips[hour % 24] : 0;
+        expectedDay = (soak.rainTips - lastDay) * SIM_SOAK_INCHES_PER_TIP;
+        soak.checks[SOAK_RAIN_DAY]++;
+        if (!soak_close(rain_day, expectedDay))
+            soak_fail(SOAK_RAIN_DAY, "day %llu %.3f, expected %.3f", (unsigned long long)(hour / 24), rain_day, expectedDay);
+    }
+    else if (rain_day != soak.rainDay)
+    {
+        soak_fail(SOAK_RAIN_DAY, "changed to %.3f in hour %llu", rain_day, (unsigned long long)hour);
+    }
+    soak.rainDay = rain_day;
+    soak.hourTips[hour % 24] = soak.rainTips;
+    __real_reportRainScaledData(rain_hr, rain_day);
+}
+
+/*********************************************************************************
+ * the result
+ *********************************************************************************/
+bool sim_soakSummary(FILE *out)
+{
+    uint32_t windWraps = ((uint64_t)sim_soakCounterStart(WIND_SPEED_PIN) + soak.windEdges) >> 32;
+    uint32_t rainWraps = ((uint64_t)sim_soakCounterStart(RAIN_BUCKET_PIN) + 2 * soak.rainTips) >> 32;
+    fprintf(out, "soak: crossed %lu tick wraps, %lu wind counter wraps, %lu rain counter wraps\n",
+            (unsigned long)soak.tickWraps, (unsigned long)windWraps, (unsigned long)rainWraps);
+
+    bool passed = soak.tickWraps > 0 && windWraps > 0 && rainWraps > 0;
+    if (!passed)
+        fprintf(out, "soak: FAILED, the run ended before every counter wrapped\n");
+    for (int i = 0; i < SOAK_CHECKS; i++)
+    {
+        fprintf(out, "soak: %-16s %10llu checked %6llu failed\n", checkNames[i], (unsigned long long)soak.checks[i],
+                (unsigned long long)soak.failures[i]);
+        if (soak.checks[i] == 0 || soak.failures[i] != 0)
+            passed = false;
+    }
+    fprintf(out, "soak: %s\n", passed ? "passed" : "FAILED");
+    return passed;
+}
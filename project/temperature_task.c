@@ -1,35 +1,142 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "i2c_support.h"
-#include <stdio.h>
 #include "reporting_task.h"
+#include "scheduler.h"
+#include "capture.h"
+#include "deadline.h"
+#include "kernel_objects.h"
+#include "tmp102_conversion.h"
+#include "log.h"
+
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "pinmap.h"
 
 #define TMP_ADDRESS 0x48
 
+/** TMP102 registers */
+#define TEMPERATURE 0x00
+#define CONFIG 0x01
+#define T_LOW 0x02
+#define T_HIGH 0x03
+
+#ifndef TMP102_CONTINUOUS_MODE
+#define TMP102_CONTINUOUS_MODE 1 // 0 selects a 12 bit one-shot conversion every minute
+#endif
+
+/** continuous mode settings
+ * Conversion rate : CR1 CR0 00 = 0.25Hz, 01 = 1Hz, 10 = 4Hz, 11 = 8Hz
+ * The task averages TMP_AVERAGE_SAMPLES conversions when the scheduler asks for a sample.
+ * The ALERT pin (active low, interrupt mode) fires once when the temperature reaches TMP_ALERT_HIGH_C
+ * and once more when it falls back under TMP_ALERT_CLEAR_C. In interrupt mode T_LOW only re-arms the
+ * high alert after it has been read, the TMP102 has no alert of its own for the cold.
+ */
+#define TMP_CONVERSION_RATE 0b10
+#define TMP_CONVERSION_PERIOD_MS 250
+#define TMP_AVERAGE_SAMPLES 4
+#define TMP_SAMPLE_BUDGET_MS (TMP_AVERAGE_SAMPLES * TMP_CONVERSION_PERIOD_MS) // the averaging waits for three conversions
+#define TMP_ALERT_HIGH_C 40
+#define TMP_ALERT_CLEAR_C 38 // T_LOW, the hysteresis of the high alert
+
+#define TMP_NOTIFY_ALERT 0x00000001 // task notification bit from the ALERT pin
+
+static TaskHandle_t temperatureTask;
+static StackType_t temperatureStack[KERNEL_STACK(TEMPERATURE_STACK_WORDS)];
+static StaticTask_t temperatureTaskBuffer;
+
+static uint16_t readTemperatureRegister(void)
+{
+    uint16_t raw_data = i2c_readWideRegisterSensors(TMP_ADDRESS, TEMPERATURE);
+    return (raw_data >> 8) | (raw_data << 8); // the TMP102 sends the MSB first
+}
+
+#if TMP102_CONTINUOUS_MODE
+static void tmp_alert_irq_func(void)
+{
+    if (gpio_get_irq_event_mask(TMP_ALERT_PIN) & GPIO_IRQ_EDGE_FALL)
+    {
+        TRACE_ISR_ENTER(TRACE_ISR_TMP_ALERT);
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        gpio_acknowledge_irq(TMP_ALERT_PIN, GPIO_IRQ_EDGE_FALL);
+        capture_gpioFromISR(TMP_ALERT_PIN, GPIO_IRQ_EDGE_FALL);
+        xTaskNotifyFromISR(temperatureTask, TMP_NOTIFY_ALERT, eSetBits, &higherPriorityTaskWoken);
+        TRACE_ISR_EXIT(TRACE_ISR_TMP_ALERT);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+}
+
 void temperature_task(void *parameter)
 {
-    i2c_writeWideRegisterSensors(TMP_ADDRESS, 0x01, 0x6100); // Shutdown & Resolution bits set
+    // Continuous conversion, interrupt mode, active low ALERT after 2 faults, extended 13 bit mode
+    i2c_writeWideRegisterSensors(TMP_ADDRESS, CONFIG, 0x6A00 | (TMP_CONVERSION_RATE << 6) | 0x0010);
+    i2c_writeWideRegisterSensors(TMP_ADDRESS, T_HIGH, tmp102_fromCelsius(TMP_ALERT_HIGH_C));
+    i2c_writeWideRegisterSensors(TMP_ADDRESS, T_LOW, tmp102_fromCelsius(TMP_ALERT_CLEAR_C));
+    bool hot = false; // the alerts alternate, above T_HIGH and back under T_LOW
+
+    gpio_init(TMP_ALERT_PIN);
+    gpio_set_dir(TMP_ALERT_PIN, false);
+    gpio_pull_up(TMP_ALERT_PIN); // ALERT is open drain
+    gpio_add_raw_irq_handler(TMP_ALERT_PIN, tmp_alert_irq_func);
+    gpio_set_irq_enabled(TMP_ALERT_PIN, GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
 
     for (;;)
     {
-        i2c_writeWideRegisterSensors(TMP_ADDRESS, 0x01, 0xE000); // OS and Resolution bits for one-shot conversion
-        vTaskDelay(pdMS_TO_TICKS(26));                           // one converstion takes 26ms
-        uint16_t raw_data = i2c_readWideRegisterSensors(TMP_ADDRESS, 0x00);
-
-        raw_data = (raw_data >> 8) | (raw_data << 8);
+        uint32_t notification = 0;
+        xTaskNotifyWait(0, TMP_NOTIFY_ALERT | SCHEDULER_NOTIFY_SAMPLE, &notification, portMAX_DELAY);
 
-        if (raw_data & 0x8000) // check for a negative value
+        if (notification & TMP_NOTIFY_ALERT)
         {
-            raw_data = -((~raw_data) + 1);
+            // reading the temperature also clears the ALERT pin
+            float temperature = tmp102_toCelsius(readTemperatureRegister());
+            hot = !hot;
+            if (hot)
+                LOG_WARN("TMP102: %.2f C, above %d C", temperature, TMP_ALERT_HIGH_C);
+            else
+                LOG_INFO("TMP102: %.2f C, back under %d C", temperature, TMP_ALERT_CLEAR_C);
+            reportTMPData(temperature);
         }
-        float temperature = (float)raw_data / 256.0;
+        if (notification & SCHEDULER_NOTIFY_SAMPLE)
+        {
+            deadline_start(DEADLINE_TEMPERATURE);
+            float sum = 0;
+            for (int i = 0; i < TMP_AVERAGE_SAMPLES; i++)
+            {
+                if (i > 0)
+                {
+                    vTaskDelay(pdMS_TO_TICKS(TMP_CONVERSION_PERIOD_MS)); // wait for a fresh conversion
+                }
+                sum += tmp102_toCelsius(readTemperatureRegister());
+            }
+            reportTMPData(sum / TMP_AVERAGE_SAMPLES);
+            scheduler_sampleDone(SCHEDULER_TEMPERATURE);
+            deadline_end(DEADLINE_TEMPERATURE);
+        }
+    }
+}
+#else
+void temperature_task(void *parameter)
+{
+    i2c_writeWideRegisterSensors(TMP_ADDRESS, CONFIG, 0x6100); // Shutdown & Resolution bits set
+
+    for (;;)
+    {
+        scheduler_waitForSample();
+        deadline_start(DEADLINE_TEMPERATURE);
+        i2c_writeWideRegisterSensors(TMP_ADDRESS, CONFIG, 0xE100); // OS, Resolution and Shutdown bits for one-shot conversion
+        vTaskDelay(pdMS_TO_TICKS(26));                             // one converstion takes 26ms
 
-        reportTMPData(temperature);
-        vTaskDelay(pdMS_TO_TICKS(60000));
+        reportTMPData(tmp102_toCelsius(readTemperatureRegister()));
+        scheduler_sampleDone(SCHEDULER_TEMPERATURE);
+        deadline_end(DEADLINE_TEMPERATURE);
     }
 }
+#endif
 
 void init_temperature(void)
 {
-    xTaskCreate(temperature_task, "temperature", 1000, NULL, 10, NULL);
+    temperatureTask = kernel_createTask(temperature_task, "temperature", temperatureStack, KERNEL_WORDS(temperatureStack), NULL, 10, &temperatureTaskBuffer);
+    scheduler_register(SCHEDULER_TEMPERATURE, temperatureTask);
+    deadline_register(DEADLINE_TEMPERATURE, scheduler_intervalMs(SCHEDULER_TEMPERATURE), TMP_SAMPLE_BUDGET_MS);
 }
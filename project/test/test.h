@@ -0,0 +1,54 @@
+#ifndef _TEST_
+#define _TEST_
+
+#include <math.h>
+#include <stdio.h>
+
+/** Host tests of the firmware modules, one executable per module, run by ctest from the sim
+ * build. A failed check prints where and what, the test carries on and exits with 1.
+ */
+static int test_failures;
+
+#define CHECK(condition)                                                      \
+    do                                                                        \
+    {                                                                         \
+        if (!(condition))                                                     \
+        {                                                                     \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual)                                                              \
+    do                                                                                             \
+    {                                                                                              \
+        long long _expected = (long long)(expected);                                               \
+        long long _actual = (long long)(actual);                                                   \
+        if (_expected != _actual)                                                                  \
+        {                                                                                          \
+            printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, _actual, _expected); \
+            test_failures++;                                                                       \
+        }                                                                                          \
+    } while (0)
+
+#define CHECK_NEAR(expected, actual, tolerance)                                                           \
+    do                                                                                                    \
+    {                                                                                                     \
+        double _expected = (expected);                                                                    \
+        double _actual = (actual);                                                                        \
+        if (!(fabs(_expected - _actual) <= (tolerance)))                                                  \
+        {                                                                                                 \
+            printf("%s:%d: %s is %.6f, expected %.6f +/- %g\n", __FILE__, __LINE__, #actual, _actual, _expected, \
+                   (double)(tolerance));                                                                  \
+            test_failures++;                                                                              \
+        }                                                                                                 \
+    } while (0)
+
+/** the exit code, with a summary line */
+static int test_result(const char *name)
+{
+    printf("%s: %s\n", name, test_failures ? "FAILED" : "passed");
+    return test_failures ? 1 : 0;
+}
+
+#endif // _TEST_
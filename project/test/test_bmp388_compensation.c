@@ -0,0 +1,75 @@
+#include <stdint.h>
+
+#include "bmp388_compensation.h"
+#include "test.h"
+
+/** The integer compensation against the datasheet float compensation, over every 61st raw
+ * pressure of the 24 bit range that comes out within the sensor's 30 to 125 kPa and the raw
+ * temperatures from -40C to 85C. A failure stops checking that temperature so a broken path
+ * prints a line, not millions.
+ */
+#define RAW_PRESSURE_MIN 0x100000 // well under 30 kPa with either trim
+#define RAW_PRESSURE_MAX 0xFFFFFF
+#define TEMPERATURE_TOLERANCE_C 0.011 // the integer path truncates to 0.01C
+#define PRESSURE_TOLERANCE_PA 0.1 // the float path itself only has 24 bits, 0.008 Pa at 100 kPa
+
+/** a real BMP388 trim, the same as the bench's, and a second one with the signs of the small
+ * terms flipped so every term is exercised both ways
+ */
+static const struct bmp388_trim_s trims[] = {
+    {27570, 19045, -7, 3289, 1650, 37, 0, 25340, 30620, 5, -6, 11740, 32, -61},
+    {27198, 18840, -5, -3601, -2010, -31, 12, 24905, 31200, -6, 5, -10345, -28, 55},
+};
+
+static void checkTrim(const struct bmp388_trim_s *trim)
+{
+    struct bmp388_float_coefficients_s floatCoefficients;
+    struct bmp388_integer_coefficients_s integerCoefficients;
+    bmp388_floatCoefficients(trim, &floatCoefficients);
+    bmp388_integerCoefficients(trim, &integerCoefficients);
+
+    double worstTemperature = 0;
+    double worstPressure = 0;
+    uint32_t points = 0;
+    for (uint32_t temperatureRaw = 6000000; temperatureRaw <= 10000000; temperatureRaw += 50000)
+    {
+        float temperature = bmp388_compensateTemperatureFloat(&floatCoefficients, temperatureRaw);
+        if (temperature < -40 || temperature > 85)
+            continue;
+        int64_t t_lin;
+        int64_t centiCelsius = bmp388_compensateTemperatureInteger(&integerCoefficients, temperatureRaw, &t_lin);
+        double error = fabs(centiCelsius / 100.0 - temperature);
+        if (error > worstTemperature)
+            worstTemperature = error;
+        CHECK_NEAR(temperature, centiCelsius / 100.0, TEMPERATURE_TOLERANCE_C);
+
+        for (uint32_t pressureRaw = RAW_PRESSURE_MIN; pressureRaw <= RAW_PRESSURE_MAX; pressureRaw += 61)
+        {
+            float pressure = bmp388_compensatePressureFloat(&floatCoefficients, pressureRaw, temperature);
+            if (pressure < 30000 || pressure > 125000)
+                continue;
+            points++;
+            double pascal = bmp388_compensatePressureInteger(&integerCoefficients, pressureRaw, t_lin) / 100.0;
+            error = fabs(pascal - pressure);
+            if (error > worstPressure)
+                worstPressure = error;
+            if (error > PRESSURE_TOLERANCE_PA)
+            {
+                CHECK_NEAR(pressure, pascal, PRESSURE_TOLERANCE_PA);
+                printf("  raw temperature %lu, raw pressure %lu\n", (unsigned long)temperatureRaw, (unsigned long)pressureRaw);
+                break;
+            }
+        }
+    }
+    CHECK(points > 1000000);
+    printf("%lu points, worst difference %.4f C, %.4f Pa\n", (unsigned long)points, worstTemperature, worstPressure);
+}
+
+int main(void)
+{
+    for (int i = 0; i < sizeof(trims) / sizeof(*trims); i++)
+    {
+        checkTrim(&trims[i]);
+    }
+    return test_result("bmp388_compensation");
+}
@@ -0,0 +1,359 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "connection_manager.h"
+#include "test.h"
+
+/** A fake ExpressLink on a network that comes and goes. Every AT command is counted and takes
+ * the time the module would, the link is lost whenever the network is, and an attach only
+ * succeeds while the network is up. The publisher sends the reporter's three messages a
+ * minute, once through the connection manager as expresslinkReady() drives it and once
+ * through the loop it replaced: probe after a failed send, then attach every second with a
+ * reset after each failure and before every attempt past the fourth.
+ */
+#define COMMAND_MS 50
+#define SEND_MS 300
+#define CONNECT_MS 4000       // AT+CONNECT that attaches
+#define CONNECT_FAIL_MS 20000 // AT+CONNECT giving up on the network
+#define RESET_MS 3000         // the reset pulse, the startup event and the first AT
+#define SETUP_COMMANDS 5      // the thing name and four topics
+#define REPORT_MS 60000
+#define MESSAGES_PER_REPORT 3
+#define DAY_MS (24 * 3600000LL)
+#define DAYS 30
+#define MAX_OUTAGES 1024
+
+struct outage_s
+{
+    int64_t fromMs, toMs;
+};
+
+static struct
+{
+    struct outage_s outages[MAX_OUTAGES];
+    int count;
+} network;
+
+static struct
+{
+    int64_t nowMs;
+    int next;      // the first outage that has not ended
+    bool connected;
+    bool returned; // the network came back and the module has not attached since
+    int64_t returnedMs;
+    uint32_t commands, attaches, resets, probes;
+    uint32_t reconnects;
+    int64_t reconnectMs;
+    int64_t worstReconnectMs;
+} modem;
+
+static int compareOutages(const void *a, const void *b)
+{
+    const struct outage_s *x = a, *y = b;
+    return x->fromMs < y->fromMs ? -1 : x->fromMs > y->fromMs;
+}
+
+/** up for 1 to 5 hours, down for 5 to 25 minutes, and a 4 hour outage from 10:00 each day. Where
+ * the daily outage falls next to another one they are joined, so the network is always up for
+ * long enough to reconnect
+ */
+static void flappingNetwork(int days)
+{
+    uint32_t seed = 7;
+    network.count = 0;
+    for (int64_t t = 0; t < days * DAY_MS && network.count < MAX_OUTAGES;)
+    {
+        seed = seed * 1664525 + 1013904223;
+        t += 3600000 + (seed >> 8) % (4 * 3600000);
+        seed = seed * 1664525 + 1013904223;
+        int64_t down = 5 * 60000 + (seed >> 8) % (20 * 60000);
+        network.outages[network.count++] = (struct outage_s){t, t + down};
+        t += down;
+    }
+    for (int day = 0; day < days && network.count < MAX_OUTAGES; day++)
+        network.outages[network.count++] = (struct outage_s){day * DAY_MS + 10 * 3600000, day * DAY_MS + 14 * 3600000};
+    qsort(network.outages, network.count, sizeof(network.outages[0]), compareOutages);
+    int merged = 0;
+    for (int i = 1; i < network.count; i++)
+    {
+        if (network.outages[i].fromMs < network.outages[merged].toMs + 15 * 60000)
+        {
+            if (network.outages[i].toMs > network.outages[merged].toMs)
+                network.outages[merged].toMs = network.outages[i].toMs;
+        }
+        else
+        {
+            network.outages[++merged] = network.outages[i];
+        }
+    }
+    network.count = network.count ? merged + 1 : 0;
+}
+
+/** the times the network came back with long enough left to reconnect before endMs */
+static uint32_t networkReturns(int64_t endMs)
+{
+    uint32_t returns = 0;
+    for (int i = 0; i < network.count; i++)
+        returns += network.outages[i].toMs < endMs - 15 * 60000;
+    return returns;
+}
+
+static void steadyNetwork(void)
+{
+    network.count = 0;
+}
+
+static void modemReset(void)
+{
+    memset(&modem, 0, sizeof(modem));
+}
+
+static void advance(int64_t ms)
+{
+    int64_t to = modem.nowMs + ms;
+    while (modem.next < network.count && network.outages[modem.next].fromMs <= to)
+    {
+        modem.connected = false;
+        if (network.outages[modem.next].toMs > to)
+            break;
+        modem.returned = true;
+        modem.returnedMs = network.outages[modem.next].toMs;
+        modem.next++;
+    }
+    modem.nowMs = to;
+}
+
+static bool networkUp(void)
+{
+    return modem.next >= network.count || network.outages[modem.next].fromMs > modem.nowMs;
+}
+
+static void command(int64_t ms)
+{
+    modem.commands++;
+    advance(ms);
+}
+
+static bool probe(void)
+{
+    modem.probes++;
+    command(COMMAND_MS);
+    return modem.connected;
+}
+
+static bool attach(void)
+{
+    modem.attaches++;
+    for (int i = 0; i < SETUP_COMMANDS; i++)
+        command(COMMAND_MS);
+    if (!networkUp())
+    {
+        command(CONNECT_FAIL_MS);
+        return false;
+    }
+    command(CONNECT_MS);
+    modem.connected = networkUp();
+    if (modem.connected && modem.returned)
+    {
+        int64_t reconnect = modem.nowMs - modem.returnedMs;
+        modem.reconnects++;
+        modem.reconnectMs += reconnect;
+        if (reconnect > modem.worstReconnectMs)
+            modem.worstReconnectMs = reconnect;
+        modem.returned = false;
+    }
+    return modem.connected;
+}
+
+static void reset(void)
+{
+    modem.resets++;
+    modem.connected = false;
+    command(RESET_MS);
+}
+
+static bool send(void)
+{
+    command(SEND_MS);
+    return modem.connected;
+}
+
+/** expresslinkConnect() before the connection manager */
+static void oldConnect(void)
+{
+    for (int retry = 1;; retry++)
+    {
+        if (retry > 4)
+            reset();
+        if (attach())
+            return;
+        reset();
+        advance(1000);
+    }
+}
+
+static void oldPublish(void)
+{
+    if (!send() && !probe())
+        oldConnect();
+}
+
+static struct connection_manager_s manager;
+
+/** expresslinkReady() followed by the publisher's wait for the backoff */
+static void managerReady(void)
+{
+    for (;;)
+    {
+        uint32_t waitMs;
+        enum connection_action_e action = connection_managerNext(&manager, modem.nowMs, &waitMs);
+        if (action == CONNECTION_READY)
+            return;
+        if (action == CONNECTION_WAIT)
+        {
+            advance(waitMs);
+            continue;
+        }
+        bool connected;
+        if (action == CONNECTION_PROBE)
+        {
+            connected = probe();
+        }
+        else
+        {
+            if (action == CONNECTION_RESET)
+                reset();
+            connected = attach();
+        }
+        connection_managerResult(&manager, action, connected, modem.nowMs);
+    }
+}
+
+static void managerPublish(void)
+{
+    managerReady();
+    if (send())
+        connection_managerAlive(&manager, modem.nowMs);
+    else
+        connection_managerSuspect(&manager);
+}
+
+/** a report every reportMs, the ones that fall while the publisher is busy are skipped */
+static void publishFor(void (*publish)(void), int64_t ms, int64_t reportMs)
+{
+    for (int64_t dueMs = modem.nowMs; dueMs < ms;)
+    {
+        if (modem.nowMs < dueMs)
+            advance(dueMs - modem.nowMs);
+        for (int i = 0; i < MESSAGES_PER_REPORT; i++)
+            publish();
+        while (dueMs <= modem.nowMs)
+            dueMs += reportMs;
+    }
+}
+
+static void printRun(const char *name, int days)
+{
+    printf("%s, per day: %u AT commands, %u attaches, %u resets, %u probes, reconnect mean %llds worst %llds\n", name,
+           modem.commands / days, modem.attaches / days, modem.resets / days, modem.probes / days,
+           modem.reconnects ? (long long)(modem.reconnectMs / modem.reconnects / 1000) : 0LL,
+           (long long)(modem.worstReconnectMs / 1000));
+}
+
+/** a steady network and a report a minute: one attach, no probe, no reset */
+static void testSteady(void)
+{
+    steadyNetwork();
+    modemReset();
+    connection_managerInit(&manager, 1);
+    publishFor(managerPublish, DAY_MS, REPORT_MS);
+    CHECK_EQUAL(1, modem.attaches);
+    CHECK_EQUAL(0, modem.probes);
+    CHECK_EQUAL(0, modem.resets);
+    CHECK_EQUAL(SETUP_COMMANDS + 1 + 24 * 60 * MESSAGES_PER_REPORT, modem.commands);
+
+    // a report every 20 minutes has been silent for longer than the idle probe before each one
+    modemReset();
+    connection_managerInit(&manager, 1);
+    publishFor(managerPublish, DAY_MS, 20 * 60000);
+    CHECK_EQUAL(1, modem.attaches);
+    CHECK_EQUAL(3 * 24 - 1, modem.probes);
+}
+
+/** the network gone for good: attaches back off from 10 s to 10 minutes in the upper half of
+ * each window, every fifth attempt starts with a reset, and going offline on purpose attaches
+ * again without waiting
+ */
+static void testBackoff(void)
+{
+    network.count = 1;
+    network.outages[0] = (struct outage_s){0, INT64_MAX};
+    modemReset();
+    connection_managerInit(&manager, 12345);
+    int64_t lastEndMs = 0;
+    for (int attempt = 1; attempt <= 20; attempt++)
+    {
+        uint32_t waitMs = 0;
+        enum connection_action_e action = connection_managerNext(&manager, modem.nowMs, &waitMs);
+        if (action == CONNECTION_WAIT)
+        {
+            uint64_t window = (uint64_t)CONNECTION_BACKOFF_MS << (attempt - 2);
+            if (window > CONNECTION_BACKOFF_MAX_MS)
+                window = CONNECTION_BACKOFF_MAX_MS;
+            CHECK(waitMs >= window / 2);
+            CHECK(waitMs <= window);
+            advance(waitMs);
+            action = connection_managerNext(&manager, modem.nowMs, &waitMs);
+        }
+        else
+        {
+            CHECK_EQUAL(1, attempt);
+        }
+        CHECK_EQUAL(attempt % CONNECTION_RESET_ATTEMPTS == 1 && attempt > 1 ? CONNECTION_RESET : CONNECTION_ATTACH, action);
+        if (action == CONNECTION_RESET)
+            reset();
+        bool connected = attach();
+        connection_managerResult(&manager, action, connected, modem.nowMs);
+        lastEndMs = modem.nowMs;
+    }
+    CHECK_EQUAL(20, manager.stats.failedAttaches);
+    CHECK_EQUAL(4, manager.stats.resets);
+    CHECK_EQUAL(20, manager.failures);
+
+    uint32_t waitMs;
+    connection_managerOffline(&manager);
+    CHECK_EQUAL(CONNECTION_RESET, connection_managerNext(&manager, lastEndMs, &waitMs));
+}
+
+/** a month of a flapping network with a 4 hour outage a day, the old loop against the manager */
+static void testFlapping(void)
+{
+    flappingNetwork(DAYS);
+    modemReset();
+    publishFor(oldPublish, DAYS * DAY_MS, REPORT_MS);
+    printRun("old loop", DAYS);
+    uint32_t oldCommands = modem.commands, oldAttaches = modem.attaches, oldResets = modem.resets;
+    CHECK_EQUAL(networkReturns(DAYS * DAY_MS), modem.reconnects);
+
+    modemReset();
+    connection_managerInit(&manager, 99);
+    publishFor(managerPublish, DAYS * DAY_MS, REPORT_MS);
+    printRun("manager", DAYS);
+    CHECK_EQUAL(networkReturns(DAYS * DAY_MS), modem.reconnects);
+    CHECK(2 * modem.commands < oldCommands);
+    CHECK(4 * modem.attaches < oldAttaches);
+    CHECK(10 * modem.resets < oldResets);
+    // the link is back within the longest backoff and the attach it takes
+    CHECK(modem.worstReconnectMs <= CONNECTION_BACKOFF_MAX_MS + CONNECT_FAIL_MS + RESET_MS + 2 * 60000);
+    // one probe for each failed send that found the link down, the sends prove the link between
+    CHECK_EQUAL(manager.stats.drops, manager.stats.probes);
+}
+
+int main(void)
+{
+    testSteady();
+    testBackoff();
+    testFlapping();
+    return test_result("connection_manager");
+}
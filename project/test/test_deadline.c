@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "deadline.h"
+#include "test.h"
+
+/** A task with a 1 s period and a 200 ms budget, its passes placed on a microsecond clock */
+#define PERIOD_MS 1000
+#define PERIOD_US (PERIOD_MS * 1000ull)
+
+static struct deadline_s deadline;
+
+static void reset(void)
+{
+    memset(&deadline, 0, sizeof(deadline));
+    deadline.stats.periodMs = PERIOD_MS;
+    deadline.stats.budgetMs = 200;
+}
+
+static void pass(uint64_t startUs, uint64_t runUs)
+{
+    deadline_started(&deadline, startUs);
+    deadline_ended(&deadline, startUs + runUs);
+}
+
+static void testOnTime(void)
+{
+    reset();
+    for (int i = 0; i < 10; i++)
+        pass(i * PERIOD_US + (i % 2) * 3000, 50000);
+    CHECK_EQUAL(10, deadline.stats.passes);
+    CHECK_EQUAL(0, deadline.stats.overruns);
+    CHECK_EQUAL(0, deadline.stats.overBudget);
+    CHECK_EQUAL(50000, deadline.stats.wcetUs);
+    CHECK_EQUAL(3000, deadline.stats.jitterUs);
+}
+
+/** one pass of 2.5 periods is two overruns, the starts at 1 s and 2 s it held up, and it
+ * stays two whether the next pass starts as soon as it ends or on the next period
+ */
+static void testLongPass(void)
+{
+    reset();
+    pass(0, 2500000);
+    pass(2500000, 50000);
+    CHECK_EQUAL(2, deadline.stats.overruns);
+    CHECK_EQUAL(1, deadline.stats.overBudget);
+
+    reset();
+    pass(0, 2500000);
+    pass(3 * PERIOD_US, 50000);
+    pass(4 * PERIOD_US, 50000);
+    CHECK_EQUAL(2, deadline.stats.overruns);
+}
+
+/** a pass just over the period is one overrun, caught up at once or on the next period */
+static void testSlightlyLate(void)
+{
+    reset();
+    pass(0, 1200000);
+    pass(1200000, 50000);
+    pass(2 * PERIOD_US, 50000);
+    CHECK_EQUAL(1, deadline.stats.overruns);
+
+    reset();
+    pass(0, 1200000);
+    pass(2 * PERIOD_US, 50000);
+    pass(3 * PERIOD_US, 50000);
+    CHECK_EQUAL(1, deadline.stats.overruns);
+}
+
+/** periods with no pass at all count, a short pass then a gap of 3 periods is 2 */
+static void testSkipped(void)
+{
+    reset();
+    pass(0, 50000);
+    pass(3 * PERIOD_US, 50000);
+    CHECK_EQUAL(2, deadline.stats.overruns);
+    CHECK_EQUAL(0, deadline.stats.jitterUs);
+}
+
+/** a late pass before a period change still counts, though the next start is not measured */
+static void testPeriodChange(void)
+{
+    reset();
+    pass(0, 1500000);
+    deadline.anchored = false; // deadline_setPeriod
+    deadline.stats.periodMs = 5000;
+    pass(1500000, 50000);
+    pass(6500000, 50000);
+    CHECK_EQUAL(1, deadline.stats.overruns);
+}
+
+int main(void)
+{
+    testOnTime();
+    testLongPass();
+    testSlightlyLate();
+    testSkipped();
+    testPeriodChange();
+    return test_result("deadline");
+}
@@ -0,0 +1,136 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench/gps_trace.h"
+#include "nmea_filter.h"
+#include "test.h"
+
+/** feed text and keep the last sentence that came out, returns how many did */
+static int filterAll(struct nmea_filter_s *filter, const char *text, char *last)
+{
+    int passed = 0;
+    for (; *text; text++)
+    {
+        if (nmea_filterByte(filter, *text))
+        {
+            strcpy(last, filter->sentence);
+            CHECK_EQUAL(strlen(filter->sentence), filter->length);
+            passed++;
+        }
+    }
+    return passed;
+}
+
+/** a GGA padded to length characters up to and including the checksum */
+static const char *longSentence(size_t length)
+{
+    static char line[128];
+    uint8_t checksum = 0;
+    strcpy(line, "$GPGGA,");
+    while (strlen(line) < length - 3)
+        strcat(line, "0");
+    for (const char *c = &line[1]; *c; c++)
+        checksum ^= *c;
+    sprintf(&line[length - 3], "*%02X\r\n", checksum);
+    return line;
+}
+
+static void testWanted(void)
+{
+    struct nmea_filter_s filter;
+    char last[NMEA_SENTENCE_MAX] = "";
+    nmea_filterInit(&filter);
+
+    CHECK_EQUAL(1, filterAll(&filter, "$GPGGA,172814.00,4158.67280,N,09139.93840,W,1,08,0.92,250.3,M,-32.1,M,,*6A\r\n", last));
+    CHECK(strcmp("$GPGGA,172814.00,4158.67280,N,09139.93840,W,1,08,0.92,250.3,M,-32.1,M,,*6A", last) == 0);
+    CHECK_EQUAL(1, filterAll(&filter, "$GPRMC,172814.00,A,4158.67280,N,09139.93840,W,0.012,,190626,,,A*65\r\n", last));
+    CHECK_EQUAL(1, filterAll(&filter, "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n", last));
+    // the talker does not matter and the checksum may be lower case
+    CHECK_EQUAL(1, filterAll(&filter, "$GNGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*10\r\n", last));
+    CHECK_EQUAL(1, filterAll(&filter, "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0e\r\n", last));
+    CHECK_EQUAL(0, filter.dropped + filter.corrupt + filter.overlong);
+}
+
+static void testDropped(void)
+{
+    struct nmea_filter_s filter;
+    char last[NMEA_SENTENCE_MAX] = "";
+    nmea_filterInit(&filter);
+
+    CHECK_EQUAL(0, filterAll(&filter,
+                             "$GPVTG,,T,,M,0.012,N,0.022,K,A*20\r\n"
+                             "$GPGSV,3,3,10,28,08,178,,30,05,334,19*7E\r\n"
+                             "$GPGLL,4158.67280,N,09139.93840,W,172814.00,A,A*75\r\n",
+                             last));
+    CHECK_EQUAL(3, filter.dropped);
+    CHECK_EQUAL(0, filter.corrupt);
+}
+
+static void testCorrupt(void)
+{
+    struct nmea_filter_s filter;
+    char last[NMEA_SENTENCE_MAX] = "";
+    nmea_filterInit(&filter);
+
+    // a wrong checksum, a bad digit, no checksum and a sentence cut off by the next '$'
+    CHECK_EQUAL(0, filterAll(&filter, "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0F\r\n", last));
+    CHECK_EQUAL(0, filterAll(&filter, "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0G\r\n", last));
+    CHECK_EQUAL(0, filterAll(&filter, "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52\r\n", last));
+    CHECK_EQUAL(1, filterAll(&filter, "$GPGGA,1728$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E\r\n", last));
+    CHECK_EQUAL(4, filter.corrupt);
+    CHECK(strncmp("$GPGSA,", last, 7) == 0);
+
+    // the longest sentence that leaves room for the \r\n the task adds, and one longer
+    CHECK_EQUAL(1, filterAll(&filter, longSentence(NMEA_SENTENCE_MAX - 4), last));
+    CHECK_EQUAL(NMEA_SENTENCE_MAX - 4, strlen(last));
+    CHECK_EQUAL(0, filterAll(&filter, longSentence(NMEA_SENTENCE_MAX - 3), last));
+    CHECK_EQUAL(1, filter.overlong);
+
+    // and it picks up again at the next sentence
+    CHECK_EQUAL(1, filterAll(&filter, "$GPRMC,172814.00,A,4158.67280,N,09139.93840,W,0.012,,190626,,,A*65\r\n", last));
+}
+
+static void testEpoch(void)
+{
+    struct nmea_epoch_s epoch = {""};
+    CHECK(!nmea_newEpoch(&epoch, "$GPRMC,172814.00,A,4158.67280,N,09139.93840,W,0.012,,190626,,,A*65"));
+    CHECK(!nmea_newEpoch(&epoch, "$GPGSA,A,3,01,03,06,11,14,17,19,22,,,,,1.78,0.92,1.52*0E"));
+    CHECK(nmea_newEpoch(&epoch, "$GPGGA,172814.00,4158.67280,N,09139.93840,W,1,08,0.92,250.3,M,-32.1,M,,*6A"));
+    CHECK(!nmea_newEpoch(&epoch, "$GPGGA,172814.00,4158.67280,N,09139.93840,W,1,08,0.92,250.3,M,-32.1,M,,*6A"));
+    CHECK(nmea_newEpoch(&epoch, "$GNGGA,172815.00,4158.67400,N,09139.93600,W,1,08,0.92,250.3,M,-32.1,M,,*71"));
+    CHECK(!nmea_newEpoch(&epoch, "$GPGGA,,,,,,0,00,99.99,,,,,,*48"));
+    CHECK(!nmea_newEpoch(&epoch, "$GPGG"));
+
+    // the trace through the interrupt's filter: three sentences an epoch reach the task and
+    // the solution is counted once
+    struct nmea_filter_s filter;
+    nmea_filterInit(&filter);
+    epoch = (struct nmea_epoch_s){""};
+    int sentences = 0;
+    int epochs = 0;
+    for (int i = 0; i < GPS_TRACE_EPOCHS; i++)
+    {
+        for (const char *c = gpsTraceNmea[i]; *c; c++)
+        {
+            if (nmea_filterByte(&filter, *c))
+            {
+                sentences++;
+                epochs += nmea_newEpoch(&epoch, filter.sentence);
+            }
+        }
+    }
+    CHECK_EQUAL(3 * GPS_TRACE_EPOCHS, sentences);
+    CHECK_EQUAL(GPS_TRACE_EPOCHS, epochs);
+    CHECK_EQUAL(5 * GPS_TRACE_EPOCHS, filter.dropped);
+    CHECK_EQUAL(0, filter.corrupt);
+}
+
+int main(void)
+{
+    testWanted();
+    testDropped();
+    testCorrupt();
+    testEpoch();
+    return test_result("nmea_filter");
+}
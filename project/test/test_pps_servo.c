@@ -0,0 +1,139 @@
+#include <stdint.h>
+
+#include "pps_servo.h"
+#include "test.h"
+
+/** A model of the PPS capture: a GPS pulse on every UTC second, a PIO counter at half the
+ * system clock and the microsecond timer, both running off the same crystal, and the NMEA
+ * clock that lags the pulse it describes.
+ */
+#define MODEL_NOMINAL_COUNTS 62499998 // (125 MHz - 3 clocks the PIO program does not count) / 2
+#define MODEL_DRIFT_PPM 23.7
+#define MODEL_NMEA_LAG_MS 300
+#define MODEL_START_UTC_S 1782000000LL
+
+struct model_s
+{
+    double drift;       // ppm
+    uint32_t countBase; // counter at UTC second 0 of the run
+    uint64_t microsBase;
+    uint32_t seed;
+};
+
+static int jitter(struct model_s *model, int range)
+{
+    model->seed = model->seed * 1664525 + 1013904223;
+    return (int)(model->seed >> 16) % (2 * range + 1) - range;
+}
+
+/** the local clocks at a moment of the run, second is UTC seconds from the start */
+static uint32_t modelCount(const struct model_s *model, double second)
+{
+    return model->countBase + (uint32_t)(uint64_t)(second * MODEL_NOMINAL_COUNTS * (1 + model->drift * 1e-6));
+}
+
+static uint64_t modelMicros(const struct model_s *model, double second)
+{
+    return model->microsBase + (uint64_t)(second * 1e6 * (1 + model->drift * 1e-6));
+}
+
+/** an edge at second as the interrupt sees it: the count latched exactly, the timer read a few
+ * microseconds later
+ */
+static void modelPulse(struct model_s *model, struct pps_servo_s *servo, double second)
+{
+    int64_t utcEstimateMs = (MODEL_START_UTC_S + (int64_t)second) * 1000 - MODEL_NMEA_LAG_MS;
+    pps_servoUpdate(servo, modelCount(model, second) + jitter(model, 1),
+                    modelMicros(model, second) + 4 + jitter(model, 3), utcEstimateMs);
+}
+
+/** UTC of a timestamp in the middle of the second, against the model */
+static void checkUtc(struct model_s *model, struct pps_servo_s *servo, double second, double toleranceUs)
+{
+    int64_t utcMicros;
+    CHECK(pps_servoToUtc(servo, modelMicros(model, second), &utcMicros));
+    CHECK_NEAR((MODEL_START_UTC_S + second) * 1e6, (double)utcMicros, toleranceUs);
+}
+
+static void testLock(void)
+{
+    struct model_s model = {MODEL_DRIFT_PPM, 0xFFF00000u, 5000000, 1};
+    struct pps_servo_s servo;
+    pps_servoInit(&servo, MODEL_NOMINAL_COUNTS);
+    int64_t utcMicros;
+
+    for (int second = 0; second < 9; second++)
+    {
+        CHECK(!pps_servoLocked(&servo));
+        CHECK(!pps_servoToUtc(&servo, modelMicros(&model, second), &utcMicros));
+        modelPulse(&model, &servo, second);
+    }
+    CHECK(pps_servoLocked(&servo));
+    // the counter wrapped in the first seconds
+    CHECK_NEAR(MODEL_DRIFT_PPM, servo.driftPpm, 0.1);
+    for (int second = 9; second < 120; second++)
+        modelPulse(&model, &servo, second);
+    CHECK_NEAR(MODEL_DRIFT_PPM, servo.driftPpm, 0.05);
+    CHECK_EQUAL(0, servo.outliers);
+    // the timer jitter is 3 us, the drift over half a second is 12 us
+    checkUtc(&model, &servo, 119.5, 10);
+    checkUtc(&model, &servo, 119.999, 10);
+}
+
+static void testGlitch(void)
+{
+    struct model_s model = {-11.2, 123456, 77000000, 2};
+    struct pps_servo_s servo;
+    pps_servoInit(&servo, MODEL_NOMINAL_COUNTS);
+
+    for (int second = 0; second < 30; second++)
+        modelPulse(&model, &servo, second);
+    CHECK(pps_servoLocked(&servo));
+
+    // a spurious edge between two pulses
+    modelPulse(&model, &servo, 30.4);
+    for (int second = 31; second < 60; second++)
+    {
+        modelPulse(&model, &servo, second);
+        // it may drop the lock for a while but never holds it with a wrong drift
+        if (pps_servoLocked(&servo))
+            CHECK_NEAR(-11.2, servo.driftPpm, 0.5);
+    }
+    CHECK(servo.outliers >= 1);
+    CHECK(pps_servoLocked(&servo));
+    CHECK_NEAR(-11.2, servo.driftPpm, 0.1);
+    checkUtc(&model, &servo, 59.5, 10);
+
+    // a missed pulse, the next one is two seconds on
+    for (int second = 61; second < 70; second++)
+        modelPulse(&model, &servo, second);
+    CHECK(pps_servoLocked(&servo));
+    CHECK_NEAR(-11.2, servo.driftPpm, 0.1);
+    checkUtc(&model, &servo, 69.5, 10);
+}
+
+static void testGap(void)
+{
+    struct model_s model = {5.0, 0, 1000, 3};
+    struct pps_servo_s servo;
+    pps_servoInit(&servo, MODEL_NOMINAL_COUNTS);
+
+    for (int second = 0; second < 20; second++)
+        modelPulse(&model, &servo, second);
+    CHECK(pps_servoLocked(&servo));
+    // the receiver in backup for longer than the counter can measure, it starts over
+    modelPulse(&model, &servo, 3600);
+    CHECK(!pps_servoLocked(&servo));
+    for (int second = 3601; second < 3620; second++)
+        modelPulse(&model, &servo, second);
+    CHECK(pps_servoLocked(&servo));
+    checkUtc(&model, &servo, 3619.25, 10);
+}
+
+int main(void)
+{
+    testLock();
+    testGlitch();
+    testGap();
+    return test_result("pps_servo");
+}
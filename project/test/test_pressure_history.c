@@ -0,0 +1,166 @@
+#include <math.h>
+#include <stdint.h>
+
+#include "pressure_history.h"
+#include "test.h"
+
+/** the ICAO standard atmosphere: the pressure and temperature at a height, which the
+ * reduction to sea level has to take back to 1013.25 hPa
+ */
+static double isaPascal(double meters)
+{
+    return 101325.0 * pow(1.0 - 2.25577e-5 * meters, 5.25588);
+}
+
+static double isaCelsius(double meters)
+{
+    return 15.0 - 0.0065 * meters;
+}
+
+static void testSeaLevel(void)
+{
+    CHECK_NEAR(100000.0, pressure_seaLevel(100000.0f, 20.0f, 0.0f), 0.01);
+
+    // the standard atmosphere table, WMO-No. 8 / ICAO Doc 7488. The mean column temperature
+    // comes out a little under the exact integral as the station gets higher, 0.15 hPa at 3000 m
+    static const struct
+    {
+        double meters;
+        double tolerancePa;
+    } heights[] = {{100, 1}, {250, 1}, {500, 1}, {1000, 1}, {1500, 3}, {2000, 5}, {3000, 20}};
+    for (int i = 0; i < sizeof(heights) / sizeof(*heights); i++)
+    {
+        double station = isaPascal(heights[i].meters);
+        CHECK_NEAR(101325.0, pressure_seaLevel(station, isaCelsius(heights[i].meters), heights[i].meters), heights[i].tolerancePa);
+    }
+    CHECK_NEAR(89874.6, isaPascal(1000), 1.0); // the table itself, 898.75 hPa at 1000 m
+
+    // a warm station has a lighter column below it, a cold one a heavier
+    float standard = pressure_seaLevel(95000.0f, isaCelsius(500), 500.0f);
+    CHECK(pressure_seaLevel(95000.0f, isaCelsius(500) + 20.0f, 500.0f) < standard);
+    CHECK(pressure_seaLevel(95000.0f, isaCelsius(500) - 20.0f, 500.0f) > standard);
+    // 20 K off at 500 m is about 4 hPa, the size of the error a fixed temperature would make
+    CHECK_NEAR(standard, pressure_seaLevel(95000.0f, isaCelsius(500) + 20.0f, 500.0f), 450.0);
+}
+
+/** the WMO code table 0200 classes of the 3 hour change, in Pa */
+static void testTendencyClasses(void)
+{
+    static const struct
+    {
+        int32_t change;
+        enum pressure_tendency_e tendency;
+    } cases[] = {
+        {0, PRESSURE_STEADY},
+        {9, PRESSURE_STEADY},
+        {-9, PRESSURE_STEADY},
+        {10, PRESSURE_RISING_SLOWLY},
+        {150, PRESSURE_RISING_SLOWLY},
+        {151, PRESSURE_RISING},
+        {350, PRESSURE_RISING},
+        {351, PRESSURE_RISING_QUICKLY},
+        {600, PRESSURE_RISING_QUICKLY},
+        {601, PRESSURE_RISING_VERY_RAPIDLY},
+        {-10, PRESSURE_FALLING_SLOWLY},
+        {-150, PRESSURE_FALLING_SLOWLY},
+        {-151, PRESSURE_FALLING},
+        {-351, PRESSURE_FALLING_QUICKLY},
+        {-601, PRESSURE_FALLING_VERY_RAPIDLY},
+    };
+    for (int i = 0; i < sizeof(cases) / sizeof(*cases); i++)
+    {
+        struct pressure_history_s history;
+        pressure_historyInit(&history);
+        // a steady ramp over exactly 3 hours
+        for (int minute = 0; minute <= PRESSURE_HISTORY_MINUTES; minute++)
+        {
+            pressure_historyAdd(&history, 100000.0f + (float)cases[i].change * minute / PRESSURE_HISTORY_MINUTES);
+        }
+        CHECK_EQUAL(cases[i].change, history.tendency);
+        CHECK_EQUAL(cases[i].tendency, history.tendencyClass);
+    }
+}
+
+static void testHistory(void)
+{
+    struct pressure_history_s history;
+    pressure_historyInit(&history);
+    CHECK_EQUAL(PRESSURE_TENDENCY_UNKNOWN, history.tendencyClass);
+
+    // unknown until a full 3 hours is stored
+    for (int minute = 0; minute < PRESSURE_HISTORY_MINUTES; minute++)
+    {
+        pressure_historyAdd(&history, 101000.0f - minute);
+    }
+    CHECK_EQUAL(PRESSURE_TENDENCY_UNKNOWN, history.tendencyClass);
+    CHECK_EQUAL(-30, pressure_historyChange(&history, 30));
+    CHECK_EQUAL(0, pressure_historyChange(&history, PRESSURE_HISTORY_MINUTES));
+    pressure_historyAdd(&history, 101000.0f - PRESSURE_HISTORY_MINUTES);
+    CHECK_EQUAL(-PRESSURE_HISTORY_MINUTES, history.tendency);
+    CHECK_EQUAL(PRESSURE_FALLING, history.tendencyClass);
+
+    // the ring keeps the last 3 hours only, many times round
+    for (int minute = 0; minute < 5 * PRESSURE_HISTORY_MINUTES + 7; minute++)
+    {
+        pressure_historyAdd(&history, 100000.0f + 3 * minute);
+    }
+    CHECK_EQUAL(3 * PRESSURE_HISTORY_MINUTES, history.tendency);
+    CHECK_EQUAL(PRESSURE_RISING_QUICKLY, history.tendencyClass);
+    CHECK_EQUAL(3, pressure_historyChange(&history, 1));
+
+    // outside 500 to 1155 hPa the samples are clamped rather than wrapped
+    pressure_historyInit(&history);
+    pressure_historyAdd(&history, 40000.0f);
+    pressure_historyAdd(&history, 120000.0f);
+    CHECK_EQUAL(UINT16_MAX, pressure_historyChange(&history, 1));
+}
+
+/** a longer sampling interval fills the minutes in between on a line and flags them */
+static void testFilled(void)
+{
+    struct pressure_history_s history;
+    pressure_historyInit(&history);
+    pressure_historyAddAfter(&history, 101000.0f, 5); // the first sample has nothing to fill from
+    CHECK_EQUAL(1, history.count);
+    CHECK_EQUAL(0, history.filledCount);
+
+    // falling 2 Pa a minute sampled every 5 minutes: the slope survives, no flat steps
+    for (int minute = 5; minute <= PRESSURE_HISTORY_MINUTES; minute += 5)
+    {
+        pressure_historyAddAfter(&history, 101000.0f - 2 * minute, 5);
+        CHECK_EQUAL(-2, pressure_historyChange(&history, 1));
+    }
+    CHECK_EQUAL(PRESSURE_HISTORY_MINUTES + 1, history.count);
+    CHECK_EQUAL(-2 * PRESSURE_HISTORY_MINUTES, history.tendency);
+    CHECK_EQUAL(-60, pressure_historyChange(&history, 30));
+    CHECK_EQUAL(4 * PRESSURE_HISTORY_MINUTES / 5, history.filledCount);
+
+    // 10 Pa over 4 minutes is 2.5 a minute, the filled minutes round to the nearest Pa
+    pressure_historyAddAfter(&history, 101000.0f - 2 * PRESSURE_HISTORY_MINUTES + 10, 4);
+    CHECK_EQUAL(2, pressure_historyChange(&history, 1));
+    CHECK_EQUAL(5, pressure_historyChange(&history, 2));
+    CHECK_EQUAL(7, pressure_historyChange(&history, 3));
+    CHECK_EQUAL(10, pressure_historyChange(&history, 4));
+
+    // the flags leave with their samples, every minute measured again clears them
+    for (int minute = 0; minute < PRESSURE_HISTORY_MINUTES - 10; minute++)
+    {
+        pressure_historyAdd(&history, 100800.0f);
+    }
+    CHECK(history.filledCount > 0);
+    for (int minute = 0; minute < 11; minute++)
+    {
+        pressure_historyAdd(&history, 100800.0f);
+    }
+    CHECK_EQUAL(0, history.filledCount);
+    CHECK_EQUAL(PRESSURE_STEADY, history.tendencyClass);
+}
+
+int main(void)
+{
+    testSeaLevel();
+    testTendencyClasses();
+    testHistory();
+    testFilled();
+    return test_result("pressure_history");
+}
@@ -0,0 +1,256 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "publish_policy.h"
+#include "test.h"
+
+/** The publisher modelled on a 10 ms step against an ExpressLink that fails the sends it is
+ * told to. Every send is checked to be the highest class message that was due, the oldest of
+ * its class, and the latency of each class is kept.
+ */
+#define STEP_MS 10
+#define MESSAGES 4096
+
+static struct publish_policy_s policy;
+static struct pool_block_s blocks[MESSAGES];
+static int nextBlock;
+static struct pool_block_s *lastEvicted;
+
+struct link_s
+{
+    uint32_t sendMs;              // an AT+SEND round trip
+    uint32_t downFromMs, downToMs; // every send completing in between fails
+    uint32_t failEvery;           // and every so many others, 0 for none
+};
+
+static struct
+{
+    uint32_t nowMs;
+    bool sending;
+    int slot;
+    struct publish_slot_s entry;
+    uint32_t doneMs;
+    uint32_t sends;
+    uint32_t failures;
+    uint32_t outOfOrder;
+    uint32_t order[MESSAGES]; // the blocks sent, in order
+    uint32_t sentCount;
+} model;
+
+static void reset(void)
+{
+    publish_policyInit(&policy);
+    memset(&model, 0, sizeof(model));
+    nextBlock = 0;
+}
+
+/** the block index stands for the message */
+static int enqueue(enum publish_class_e publishClass)
+{
+    int id = nextBlock++ % MESSAGES;
+    return publish_policyEnqueue(&policy, publishClass, publishClass + 2, &blocks[id], model.nowMs, &lastEvicted) < 0 ? -1 : id;
+}
+
+/** no due message outranks the one chosen */
+static bool isNext(int chosen)
+{
+    const struct publish_slot_s *best = &policy.slots[chosen];
+    for (int i = 0; i < PUBLISH_SLOTS; i++)
+    {
+        const struct publish_slot_s *slot = &policy.slots[i];
+        if (i == chosen || !slot->used || (int32_t)(slot->nextAttemptMs - model.nowMs) > 0)
+            continue;
+        if (slot->publishClass < best->publishClass ||
+            (slot->publishClass == best->publishClass && (int32_t)(slot->sequence - best->sequence) < 0))
+            return false;
+    }
+    return true;
+}
+
+static void step(const struct link_s *link)
+{
+    if (model.sending && model.nowMs >= model.doneMs)
+    {
+        bool down = model.nowMs >= link->downFromMs && model.nowMs < link->downToMs;
+        bool sent = !down && !(link->failEvery && ++model.sends % link->failEvery == 0);
+        model.failures += !sent;
+        if (sent && model.sentCount < MESSAGES)
+            model.order[model.sentCount++] = model.entry.block - blocks;
+        publish_policySent(&policy, model.slot, &model.entry, sent, model.nowMs);
+        model.sending = false;
+    }
+    if (!model.sending)
+    {
+        uint32_t waitMs;
+        int slot = publish_policyNextDue(&policy, model.nowMs, &waitMs);
+        if (slot >= 0)
+        {
+            model.outOfOrder += !isNext(slot);
+            model.slot = slot;
+            model.entry = policy.slots[slot];
+            model.sending = true;
+            model.doneMs = model.nowMs + link->sendMs;
+        }
+    }
+    model.nowMs += STEP_MS;
+}
+
+static void run(const struct link_s *link, uint32_t ms)
+{
+    for (uint32_t end = model.nowMs + ms; (int32_t)(model.nowMs - end) < 0;)
+        step(link);
+}
+
+static void testOrder(void)
+{
+    static const struct link_s link = {500, 0, 0, 0};
+    reset();
+    int diag = enqueue(PUBLISH_DIAG);
+    int live1 = enqueue(PUBLISH_LIVE);
+    int live2 = enqueue(PUBLISH_LIVE);
+    int alert = enqueue(PUBLISH_ALERT);
+    run(&link, 10000);
+    CHECK_EQUAL(4, model.sentCount);
+    CHECK_EQUAL(alert, model.order[0]);
+    CHECK_EQUAL(live1, model.order[1]);
+    CHECK_EQUAL(live2, model.order[2]);
+    CHECK_EQUAL(diag, model.order[3]);
+    CHECK_EQUAL(0, model.outOfOrder);
+    CHECK_EQUAL(500, policy.stats[PUBLISH_ALERT].maxLatencyMs);
+    CHECK_EQUAL(2000, policy.stats[PUBLISH_DIAG].maxLatencyMs);
+}
+
+/** an alert raised while a report is being sent goes next, the failed report is retried
+ * after it with a 1 s backoff
+ */
+static void testRetry(void)
+{
+    static const struct link_s link = {500, 0, 1000, 0};
+    reset();
+    int live = enqueue(PUBLISH_LIVE);
+    run(&link, 200);
+    int alert = enqueue(PUBLISH_ALERT);
+    run(&link, 20000);
+    CHECK_EQUAL(2, model.sentCount);
+    CHECK_EQUAL(alert, model.order[0]);
+    CHECK_EQUAL(live, model.order[1]);
+    CHECK_EQUAL(0, policy.stats[PUBLISH_ALERT].retries);
+    CHECK_EQUAL(1, policy.stats[PUBLISH_LIVE].retries);
+    // the alert waited out the report's send, the report its backoff from 0.5 s
+    CHECK_EQUAL(800, policy.stats[PUBLISH_ALERT].maxLatencyMs);
+    CHECK_EQUAL(2000, policy.stats[PUBLISH_LIVE].maxLatencyMs);
+    CHECK_EQUAL(0, model.outOfOrder);
+
+    // while an alert backs off the lower classes still go out
+    static const struct link_s outage = {500, 0, 3000, 0};
+    reset();
+    live = enqueue(PUBLISH_LIVE);
+    run(&outage, 200);
+    alert = enqueue(PUBLISH_ALERT);
+    run(&outage, 20000);
+    CHECK_EQUAL(live, model.order[0]);
+    CHECK_EQUAL(alert, model.order[1]);
+    CHECK_EQUAL(4800, policy.stats[PUBLISH_ALERT].maxLatencyMs);
+    CHECK_EQUAL(0, model.outOfOrder);
+}
+
+/** a live report gives up after 4 sends, diagnostics after 3 */
+static void testAttempts(void)
+{
+    static const struct link_s link = {500, 0, UINT32_MAX, 0};
+    reset();
+    enqueue(PUBLISH_LIVE);
+    enqueue(PUBLISH_DIAG);
+    run(&link, 60000);
+    CHECK_EQUAL(3, policy.stats[PUBLISH_LIVE].retries);
+    CHECK_EQUAL(1, policy.stats[PUBLISH_LIVE].dropped);
+    CHECK_EQUAL(2, policy.stats[PUBLISH_DIAG].retries);
+    CHECK_EQUAL(1, policy.stats[PUBLISH_DIAG].dropped);
+    uint32_t waitMs;
+    CHECK_EQUAL(-1, publish_policyNextDue(&policy, model.nowMs, &waitMs));
+    CHECK_EQUAL(UINT32_MAX, waitMs);
+}
+
+/** with the link down the slots fill up. Alerts keep their reservation and evict the lower
+ * classes, a newer live report supersedes the oldest and diagnostics are turned away
+ */
+static void testFull(void)
+{
+    reset();
+    for (int i = 0; i < PUBLISH_SLOTS; i++)
+        CHECK(enqueue(i < 3 ? PUBLISH_DIAG : PUBLISH_LIVE) >= 0);
+    // the last 2 live reports found only the alert reservation free and evicted diagnostics
+    CHECK_EQUAL(2, policy.stats[PUBLISH_DIAG].dropped);
+    CHECK_EQUAL(-1, enqueue(PUBLISH_DIAG));
+    CHECK_EQUAL(3, policy.stats[PUBLISH_DIAG].dropped);
+    CHECK(enqueue(PUBLISH_ALERT) >= 0);
+    CHECK(enqueue(PUBLISH_ALERT) >= 0);
+    CHECK(enqueue(PUBLISH_LIVE) >= 0);
+    CHECK(lastEvicted == &blocks[2]);
+    CHECK_EQUAL(4, policy.stats[PUBLISH_DIAG].dropped);
+    int used[PUBLISH_CLASSES] = {0};
+    for (int i = 0; i < PUBLISH_SLOTS; i++)
+        used[policy.slots[i].publishClass] += policy.slots[i].used;
+    CHECK_EQUAL(2, used[PUBLISH_ALERT]);
+    CHECK_EQUAL(6, used[PUBLISH_LIVE]);
+
+    // a live report with no diagnostics left to evict supersedes the oldest live one
+    CHECK(enqueue(PUBLISH_LIVE) >= 0);
+    CHECK(lastEvicted == &blocks[3]);
+    CHECK_EQUAL(1, policy.stats[PUBLISH_LIVE].dropped);
+    CHECK_EQUAL(0, policy.stats[PUBLISH_ALERT].dropped);
+
+    // alerts evict every live report and then keep what they have
+    for (int i = 0; i < 6; i++)
+        CHECK(enqueue(PUBLISH_ALERT) >= 0);
+    CHECK_EQUAL(-1, enqueue(PUBLISH_ALERT));
+    CHECK_EQUAL(1, policy.stats[PUBLISH_ALERT].dropped);
+    CHECK_EQUAL(7, policy.stats[PUBLISH_LIVE].dropped);
+}
+
+/** a day of reports with an alert every 7 minutes, a send in 25 failing and an outage of 10 minutes.
+ * The report pattern is the reporter's: the live report to two topics every minute and the raw
+ * report on diagnostics with it
+ */
+static void testDay(void)
+{
+    static const struct link_s link = {800, 6 * 3600000, 6 * 3600000 + 600000, 25};
+    reset();
+    for (uint32_t minute = 0; minute < 24 * 60; minute++)
+    {
+        enqueue(PUBLISH_LIVE);
+        enqueue(PUBLISH_LIVE);
+        enqueue(PUBLISH_DIAG);
+        for (int second = 0; second < 60; second++)
+        {
+            if (second == 30 && minute % 7 == 0)
+                enqueue(PUBLISH_ALERT);
+            run(&link, 1000);
+        }
+    }
+    run(&link, 120000);
+    printf("day: %u failed sends\n", model.failures);
+    for (int i = 0; i < PUBLISH_CLASSES; i++)
+    {
+        const struct publish_stats_s *stats = &policy.stats[i];
+        printf("  %-5s queued %u, sent %u, retries %u, dropped %u, max latency %ums\n", i == PUBLISH_ALERT ? "alert" : i == PUBLISH_LIVE ? "live" : "diag",
+               stats->queued, stats->sent, stats->retries, stats->dropped, stats->maxLatencyMs);
+    }
+    CHECK_EQUAL(0, model.outOfOrder);
+    // every alert goes out, the outage included, and none waits for more than its backoff
+    CHECK_EQUAL(policy.stats[PUBLISH_ALERT].queued, policy.stats[PUBLISH_ALERT].sent);
+    CHECK(policy.stats[PUBLISH_ALERT].maxLatencyMs <= 600000 + 64000 + 1000);
+    // outside the outage the live reports keep up
+    CHECK(policy.stats[PUBLISH_LIVE].sent >= 2 * (24 * 60 - 12));
+    CHECK(policy.stats[PUBLISH_DIAG].dropped > 0);
+}
+
+int main(void)
+{
+    testOrder();
+    testRetry();
+    testAttempts();
+    testFull();
+    testDay();
+    return test_result("publish_policy");
+}
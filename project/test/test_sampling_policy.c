@@ -0,0 +1,181 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pressure_history.h"
+#include "sampling_policy.h"
+#include "sim_scenario.h"
+#include "test.h"
+
+/** The policy over a run of weather on the scheduler's 15 s epochs, the simulation's built-in
+ * week and a day of slowly falling pressure in light wind.
+ * Each stream samples on the epochs that are multiples of its interval, the pressure history
+ * takes the minute aligned samples as pressure_task does. A second history sampled every
+ * minute is the reference for the tendency and the 30 minute change.
+ */
+#define EPOCH_MS 15000
+#define REPORT_BYTES 2400     // the raw diagnostics, DEADLINE and the scaled report on both topics
+#define REPORT_BYTES_MOST 3000 // long counters and a long thing name
+#define FIXED_SAMPLES_PER_DAY (24 * 60)
+
+struct run_s
+{
+    uint32_t samples[SAMPLING_STREAMS];
+    uint32_t levelEpochs[SAMPLING_LEVELS];
+    uint32_t budgetLimited;
+    double tendencyError2;
+    double changeError2;
+    uint32_t compared;
+    int32_t worstTendencyError;
+    int32_t worstChangeError;
+    int32_t worstRingError; // any minute of the 3 hours against the reference
+    uint16_t mostFilled;
+};
+
+typedef void conditions_t(double hours, struct sim_conditions_s *conditions);
+
+/** just under the calm threshold of 20 Pa in 30 minutes, the longest interval the policy picks */
+#define SLOW_FALL_PA_PER_MINUTE 0.6
+
+static void slowFall(double hours, struct sim_conditions_s *conditions)
+{
+    struct sim_conditions_s calm = {15, 101500 - SLOW_FALL_PA_PER_MINUTE * 60 * hours, 3, 6, 270, 0, true};
+    *conditions = calm;
+}
+
+/** steady pressure and a light breeze, neither calm nor active */
+static void steadyNormal(double hours, struct sim_conditions_s *conditions)
+{
+    struct sim_conditions_s normal = {15, 101500, 6, 12, 270, 0, true};
+    *conditions = normal;
+}
+
+static void simulate(conditions_t *weather, double hours, uint32_t reportBytes, struct run_s *run)
+{
+    memset(run, 0, sizeof(*run));
+    struct sampling_policy_s policy;
+    struct pressure_history_s history;
+    struct pressure_history_s reference;
+    sampling_policyInit(&policy, 0);
+    pressure_historyInit(&history);
+    pressure_historyInit(&reference);
+
+    int64_t historyEpochMs = -1;
+    for (int64_t epochMs = 0; epochMs < (int64_t)(hours * 3600000.0); epochMs += EPOCH_MS)
+    {
+        struct sim_conditions_s conditions;
+        weather(epochMs / 3600000.0, &conditions);
+        run->levelEpochs[policy.level]++;
+
+        if (epochMs % 60000 == 0)
+            pressure_historyAdd(&reference, conditions.pressurePa);
+        for (int stream = 0; stream < SAMPLING_STREAMS; stream++)
+        {
+            if (epochMs % policy.intervalMs[stream] == 0)
+                run->samples[stream]++;
+        }
+        if (epochMs % policy.intervalMs[SAMPLING_PRESSURE] == 0 && epochMs % 60000 == 0)
+        {
+            pressure_historyAddAfter(&history, conditions.pressurePa, historyEpochMs < 0 ? 1 : (epochMs - historyEpochMs) / 60000);
+            historyEpochMs = epochMs;
+            if (history.filledCount > run->mostFilled)
+                run->mostFilled = history.filledCount;
+            if (reference.tendencyClass != PRESSURE_TENDENCY_UNKNOWN)
+            {
+                int32_t error = history.tendency - reference.tendency;
+                run->tendencyError2 += (double)error * error;
+                if (abs(error) > abs(run->worstTendencyError))
+                    run->worstTendencyError = error;
+                int32_t change = pressure_historyChange(&history, 30) - pressure_historyChange(&reference, 30);
+                run->changeError2 += (double)change * change;
+                if (abs(change) > abs(run->worstChangeError))
+                    run->worstChangeError = change;
+                for (uint16_t minutes = 1; minutes <= PRESSURE_HISTORY_MINUTES; minutes++)
+                {
+                    int32_t ring = pressure_historyChange(&history, minutes) - pressure_historyChange(&reference, minutes);
+                    if (abs(ring) > abs(run->worstRingError))
+                        run->worstRingError = ring;
+                }
+                run->compared++;
+            }
+        }
+        if (epochMs % policy.intervalMs[SAMPLING_REPORT] == 0)
+        {
+            // the gust is the fastest second, the 10 minute gust the fastest 3 s average below it
+            struct sampling_inputs_s inputs = {pressure_historyChange(&history, 30), conditions.rainInHr, conditions.windMph,
+                                               conditions.windMph + 0.8f * (conditions.gustMph - conditions.windMph)};
+            sampling_policyUpdate(&policy, &inputs, epochMs, reportBytes);
+        }
+    }
+    run->budgetLimited = policy.budgetLimited;
+}
+
+static void printRun(const char *name, double hours, const struct run_s *run)
+{
+    printf("%s, %.0f hours: temperature %u, pressure %u, reports %u against %u each at 1 a minute\n", name, hours,
+           run->samples[SAMPLING_TEMPERATURE], run->samples[SAMPLING_PRESSURE], run->samples[SAMPLING_REPORT],
+           (unsigned)(hours * 60));
+    printf("  levels %u calm, %u normal, %u active, %u storm epochs, %u updates held down by the budget\n",
+           run->levelEpochs[SAMPLING_CALM], run->levelEpochs[SAMPLING_NORMAL], run->levelEpochs[SAMPLING_ACTIVE],
+           run->levelEpochs[SAMPLING_STORM], run->budgetLimited);
+    printf("  against 1 minute sampling: 3 hour tendency RMS %.2f Pa worst %d, 30 minute change RMS %.2f Pa worst %d, any minute worst %d, up to %u minutes filled\n",
+           sqrt(run->tendencyError2 / run->compared), run->worstTendencyError, sqrt(run->changeError2 / run->compared),
+           run->worstChangeError, run->worstRingError, run->mostFilled);
+}
+
+static void testWeek(void)
+{
+    struct run_s run;
+    double hours = sim_scenarioHours();
+    simulate(sim_scenarioAt, hours, REPORT_BYTES, &run);
+    printRun("built-in week", hours, &run);
+    double days = hours / 24.0;
+    double tendencyRms = sqrt(run.tendencyError2 / run.compared);
+    double changeRms = sqrt(run.changeError2 / run.compared);
+
+    // calm days sample less than once a minute, the front on day 3 samples faster
+    CHECK(run.levelEpochs[SAMPLING_CALM] > 0);
+    CHECK(run.levelEpochs[SAMPLING_STORM] > 0);
+    CHECK(run.samples[SAMPLING_PRESSURE] < days * FIXED_SAMPLES_PER_DAY);
+    CHECK(run.samples[SAMPLING_REPORT] < days * FIXED_SAMPLES_PER_DAY);
+    // the filled minutes follow the pressure rather than holding it flat
+    CHECK(run.mostFilled > 0);
+    CHECK(tendencyRms < 2.0);
+    CHECK(abs(run.worstTendencyError) <= 5);
+    CHECK(changeRms < 2.0);
+    CHECK(abs(run.worstRingError) <= 2);
+}
+
+/** the policy holds the pressure at 5 minutes here, every minute in between is filled */
+static void testSlowFall(void)
+{
+    struct run_s run;
+    simulate(slowFall, 24, REPORT_BYTES, &run);
+    printRun("slow fall", 24, &run);
+    CHECK(run.levelEpochs[SAMPLING_CALM] > 20 * 240);
+    CHECK_EQUAL(4 * PRESSURE_HISTORY_MINUTES / 5, run.mostFilled);
+    CHECK(abs(run.worstChangeError) <= 1);
+    CHECK(abs(run.worstTendencyError) <= 1);
+    // repeating the last sample would leave the minutes in between up to 4 minutes of the fall behind, 2.4 Pa
+    CHECK(abs(run.worstRingError) <= 1);
+}
+
+/** the budget pays for NORMAL's report a minute at the largest reports, it only holds back storms */
+static void testNormalBudget(void)
+{
+    struct run_s run;
+    simulate(steadyNormal, 48, REPORT_BYTES_MOST, &run);
+    printRun("steady normal", 48, &run);
+    CHECK_EQUAL(0, run.budgetLimited);
+    CHECK_EQUAL(48 * 240, run.levelEpochs[SAMPLING_NORMAL]);
+    CHECK_EQUAL(48 * 60, run.samples[SAMPLING_REPORT]);
+}
+
+int main(void)
+{
+    testWeek();
+    testSlowFall();
+    testNormalBudget();
+    return test_result("sampling_policy");
+}
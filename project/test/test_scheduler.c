@@ -0,0 +1,75 @@
+#include <stdint.h>
+
+#include "scheduler.h"
+#include "test.h"
+
+#define HOUR_MS 3600000LL
+
+/** the epochs land on the wall clock grid of their period and the trigger is never in the past */
+static void testAlignment(void)
+{
+    static const int64_t periods[] = {10000, 30000, 60000, 120000, 300000, 600000, 900000, HOUR_MS};
+    const int64_t start = 1782000000000LL; // 2026-06-21T00:00:00Z
+    for (int p = 0; p < sizeof(periods) / sizeof(*periods); p++)
+    {
+        int64_t period = periods[p];
+        for (int64_t now = start - 2 * period; now < start + 2 * period; now += 997)
+        {
+            int64_t epoch = scheduler_nextEpochMs(now, period, SCHEDULER_LEAD_MS);
+            CHECK_EQUAL(0, epoch % period);
+            CHECK(epoch - SCHEDULER_LEAD_MS > now);
+            // and it is the first one, the one before would have triggered already
+            CHECK(epoch - period - SCHEDULER_LEAD_MS <= now);
+            // every period divides the hour, so the epochs of all of them meet on the hour
+            CHECK_EQUAL(0, HOUR_MS % period);
+        }
+    }
+}
+
+static void testBoundaries(void)
+{
+    const int64_t minute = 1782000060000LL;
+    // a trigger exactly now has passed, the next one is a period on
+    CHECK_EQUAL(minute + 60000, scheduler_nextEpochMs(minute - SCHEDULER_LEAD_MS, 60000, SCHEDULER_LEAD_MS));
+    CHECK_EQUAL(minute, scheduler_nextEpochMs(minute - SCHEDULER_LEAD_MS - 1, 60000, SCHEDULER_LEAD_MS));
+    // the epoch itself is inside the lead, so it is the next one
+    CHECK_EQUAL(minute + 60000, scheduler_nextEpochMs(minute, 60000, SCHEDULER_LEAD_MS));
+    // without a lead, the report countdown
+    CHECK_EQUAL(minute, scheduler_nextEpochMs(minute - 1, 60000, 0));
+    CHECK_EQUAL(minute + 60000, scheduler_nextEpochMs(minute, 60000, 0));
+    // before the GPS time the epochs count from boot
+    CHECK_EQUAL(60000, scheduler_nextEpochMs(0, 60000, SCHEDULER_LEAD_MS));
+    CHECK_EQUAL(120000, scheduler_nextEpochMs(58000, 60000, SCHEDULER_LEAD_MS));
+}
+
+/** the timer re-arms from the clock each time it fires. Firing late or a GPS correction either
+ * way must neither skip an epoch nor repeat one
+ */
+static void testSequence(void)
+{
+    const int64_t period = 60000;
+    int64_t now = 1782000000000LL + 12345;
+    int64_t previous = scheduler_nextEpochMs(now, period, SCHEDULER_LEAD_MS);
+    static const int lateMs[] = {0, 1, 15, 250, 0, 999, 3, 40, 1500, 0};
+    for (int i = 0; i < 1000; i++)
+    {
+        // the timer fires at the trigger, a little late, and the clock may have been corrected
+        now = previous - SCHEDULER_LEAD_MS + lateMs[i % 10] + (i % 7 == 0 ? -300 : 0);
+        int64_t next = scheduler_followingEpochMs(now, previous, period);
+        CHECK_EQUAL(previous + period, next);
+        previous = next;
+    }
+    // a step back over a whole period still does not repeat, a step forward skips
+    CHECK_EQUAL(previous + period, scheduler_followingEpochMs(previous - 2 * period, previous, period));
+    CHECK_EQUAL(previous + 3 * period, scheduler_followingEpochMs(previous + 2 * period - SCHEDULER_LEAD_MS, previous, period));
+    // when an interval change makes the period longer the next epoch is on the new grid
+    CHECK_EQUAL(0, scheduler_followingEpochMs(previous - SCHEDULER_LEAD_MS, previous, 300000) % 300000);
+}
+
+int main(void)
+{
+    testAlignment();
+    testBoundaries();
+    testSequence();
+    return test_result("scheduler");
+}
@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "test.h"
+#include "timebase.h"
+
+static int64_t epochMs(int year, int month, int day, int hour, int minute, int second)
+{
+    struct utc_time_s utc = {year, month, day, hour, minute, second, 0};
+    return timebase_toEpochMs(&utc);
+}
+
+static void testCalendar(void)
+{
+    // values from date -u +%s
+    CHECK_EQUAL(0, epochMs(1970, 1, 1, 0, 0, 0));
+    CHECK_EQUAL(951782400000LL, epochMs(2000, 2, 29, 0, 0, 0));
+    CHECK_EQUAL(1709208000000LL, epochMs(2024, 2, 29, 12, 0, 0));
+    CHECK_EQUAL(1782000000000LL, epochMs(2026, 6, 21, 0, 0, 0));
+    CHECK_EQUAL(4107542400000LL, epochMs(2100, 3, 1, 0, 0, 0));
+    CHECK_EQUAL(epochMs(2100, 2, 28, 0, 0, 0) + 86400000, epochMs(2100, 3, 1, 0, 0, 0));
+
+    // every day to 2400 against the C library, both ways
+    for (int64_t day = 0; day < 157000; day++)
+    {
+        time_t seconds = (time_t)(day * 86400 + 45296);
+        struct tm calendar;
+        gmtime_r(&seconds, &calendar);
+        struct utc_time_s utc;
+        timebase_fromEpochMs(seconds * 1000LL + 789, &utc);
+        if (utc.year != calendar.tm_year + 1900 || utc.month != calendar.tm_mon + 1 || utc.day != calendar.tm_mday ||
+            utc.hour != 12 || utc.minute != 34 || utc.second != 56 || utc.millisecond != 789)
+        {
+            CHECK_EQUAL(calendar.tm_year + 1900, utc.year);
+            CHECK_EQUAL(calendar.tm_mon + 1, utc.month);
+            CHECK_EQUAL(calendar.tm_mday, utc.day);
+            break;
+        }
+        CHECK_EQUAL(seconds * 1000LL + 789, timebase_toEpochMs(&utc));
+    }
+}
+
+static void testParse(void)
+{
+    struct utc_time_s utc;
+    CHECK(timebase_parseIso8601("2024-02-29T23:59:60.5Z", &utc));
+    CHECK_EQUAL(2024, utc.year);
+    CHECK_EQUAL(2, utc.month);
+    CHECK_EQUAL(29, utc.day);
+    CHECK_EQUAL(60, utc.second);
+    CHECK_EQUAL(500, utc.millisecond);
+    CHECK(timebase_parseIso8601("2000-02-29T00:00:00Z", &utc));
+    CHECK(timebase_parseIso8601("2026-06-19T17:28:14.0001Z", &utc));
+    CHECK_EQUAL(0, utc.millisecond);
+
+    CHECK(!timebase_parseIso8601("2026-02-29T00:00:00Z", &utc));
+    CHECK(!timebase_parseIso8601("2100-02-29T00:00:00Z", &utc));
+    CHECK(!timebase_parseIso8601("2026-04-31T00:00:00Z", &utc));
+    CHECK(!timebase_parseIso8601("2026-06-19T24:00:00Z", &utc));
+    CHECK(!timebase_parseIso8601("2026-06-19T17:28:14", &utc));
+    CHECK(!timebase_parseIso8601("2026-6-19T17:28:14Z", &utc));
+}
+
+static void testFormat(void)
+{
+    char text[32];
+    CHECK_EQUAL(24, timebase_format(epochMs(2024, 2, 29, 23, 59, 59) + 7, text, sizeof(text)));
+    CHECK(strcmp("2024-02-29T23:59:59.007Z", text) == 0);
+    timebase_format(-1, text, sizeof(text));
+    CHECK(strcmp("1969-12-31T23:59:59.999Z", text) == 0);
+}
+
+/** the tick count wraps every 49.7 days at 1 kHz, the clock has to carry on across it */
+static void testTicks(void)
+{
+    int64_t converted;
+    CHECK(!timebase_isValid());
+    CHECK(!timebase_tickToUtcMs(0, &converted));
+
+    const TickType_t anchor = 0xFFFF0000u;
+    struct utc_time_s utc = {2028, 2, 28, 23, 0, 0, 0};
+    int64_t anchorMs = timebase_toEpochMs(&utc);
+    timebase_gpsTime(&utc, anchor);
+    CHECK(timebase_isValid());
+
+    CHECK(timebase_tickToUtcMs(anchor, &converted));
+    CHECK_EQUAL(anchorMs, converted);
+    // across the wrap
+    CHECK(timebase_tickToUtcMs(anchor + 0x20000u, &converted));
+    CHECK_EQUAL(anchorMs + 0x20000, converted);
+    // ticks taken just before the anchor
+    CHECK(timebase_tickToUtcMs(anchor - 5000, &converted));
+    CHECK_EQUAL(anchorMs - 5000, converted);
+    // 30 days without a GPS time, past the 24.8 days a signed difference holds. The clock goes
+    // through the leap day
+    const TickType_t days30 = 30u * 86400000u;
+    CHECK(timebase_tickToUtcMs(anchor + days30, &converted));
+    CHECK_EQUAL(epochMs(2028, 3, 29, 23, 0, 0), converted);
+    // 49 days, the longest the anchor can be left
+    CHECK(timebase_tickToUtcMs(anchor + 49u * 86400000u, &converted));
+    CHECK_EQUAL(anchorMs + 49LL * 86400000, converted);
+
+    // a discipline 30 days later moves the anchor and records the tick drift
+    utc = (struct utc_time_s){2028, 3, 29, 23, 0, 0, 250};
+    timebase_gpsTime(&utc, anchor + days30);
+    CHECK_EQUAL(250, timebase_lastCorrectionMs());
+    CHECK(timebase_tickToUtcMs(anchor + days30 + 1000, &converted));
+    CHECK_EQUAL(timebase_toEpochMs(&utc) + 1000, converted);
+}
+
+int main(void)
+{
+    testCalendar();
+    testParse();
+    testFormat();
+    testTicks();
+    return test_result("timebase");
+}
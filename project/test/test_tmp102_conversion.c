@@ -0,0 +1,62 @@
+#include <stdint.h>
+
+#include "test.h"
+#include "tmp102_conversion.h"
+
+/** the digital output examples of the TMP102 datasheet, tables 5 and 6 */
+static const struct
+{
+    float celsius;
+    uint16_t digital; // 12 or 13 bit value before it is left justified in the register
+} extended[] = {
+    {150, 0x0960}, {128, 0x0800}, {127.9375f, 0x07FF}, {100, 0x0640}, {80, 0x0500}, {75, 0x04B0},
+    {50, 0x0320}, {25, 0x0190}, {0.25f, 0x0004}, {0, 0x0000}, {-0.25f, 0x1FFC}, {-25, 0x1E70}, {-55, 0x1C90},
+}, normal[] = {
+    {127.9375f, 0x7FF}, {100, 0x640}, {80, 0x500}, {75, 0x4B0}, {50, 0x320}, {25, 0x190},
+    {0.25f, 0x004}, {0, 0x000}, {-0.25f, 0xFFC}, {-25, 0xE70}, {-55, 0xC90},
+};
+
+static void testToCelsius(void)
+{
+    // 13 bit extended mode, left justified to bit 3 with the EM flag in bit 0
+    for (int i = 0; i < sizeof(extended) / sizeof(*extended); i++)
+    {
+        CHECK_NEAR(extended[i].celsius, tmp102_toCelsius(extended[i].digital << 3 | 1), 0);
+        // the unused bits 1 and 2 read as 0 but must not matter
+        CHECK_NEAR(extended[i].celsius, tmp102_toCelsius(extended[i].digital << 3 | 7), 0);
+    }
+    // 12 bit normal mode, left justified to bit 4 with bit 0 clear
+    for (int i = 0; i < sizeof(normal) / sizeof(*normal); i++)
+    {
+        CHECK_NEAR(normal[i].celsius, tmp102_toCelsius(normal[i].digital << 4), 0);
+        CHECK_NEAR(normal[i].celsius, tmp102_toCelsius(normal[i].digital << 4 | 0xE), 0);
+    }
+    // every 13 bit code is 1/16 C apart and in order
+    float previous = tmp102_toCelsius(0x1000 << 3 | 1); // -256C, the most negative code
+    for (uint32_t code = 0x1001; code != 0x1000; code = (code + 1) & 0x1FFF)
+    {
+        float celsius = tmp102_toCelsius(code << 3 | 1);
+        CHECK_NEAR(previous + 0.0625f, celsius, 0);
+        previous = celsius;
+    }
+}
+
+static void testFromCelsius(void)
+{
+    // the alert limits the task writes, in the same 13 bit format
+    CHECK_EQUAL(0x0000, tmp102_fromCelsius(0));
+    CHECK_EQUAL(0x1400, tmp102_fromCelsius(40));
+    CHECK_EQUAL(0x0640 << 3, tmp102_fromCelsius(100));
+    CHECK_EQUAL((0x1E70 << 3) & 0xFFFF, tmp102_fromCelsius(-25));
+    for (int celsius = -55; celsius <= 150; celsius++)
+    {
+        CHECK_NEAR(celsius, tmp102_toCelsius(tmp102_fromCelsius(celsius) | 1), 0);
+    }
+}
+
+int main(void)
+{
+    testToCelsius();
+    testFromCelsius();
+    return test_result("tmp102_conversion");
+}
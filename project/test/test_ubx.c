@@ -0,0 +1,154 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "test.h"
+#include "ubx.h"
+
+/** feed bytes and count the frames that came out complete */
+static int parseAll(struct ubx_parser_s *parser, const uint8_t *bytes, size_t length)
+{
+    int complete = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        complete += ubx_parse(parser, bytes[i]);
+    }
+    return complete;
+}
+
+static size_t navPvtFrame(uint8_t *frame, size_t frameLength)
+{
+    uint8_t payload[UBX_NAV_PVT_LENGTH] = {0};
+    payload[4] = 2026 & 0xFF;
+    payload[5] = 2026 >> 8;
+    payload[6] = 6;
+    payload[7] = 19;
+    payload[8] = 17;
+    payload[9] = 28;
+    payload[10] = 14;
+    payload[11] = 0x07;
+    const int32_t nano = -1234567;
+    memcpy(&payload[16], &nano, 4); // the host is little endian like the receiver
+    payload[20] = UBX_3D_FIX;
+    payload[23] = 11;
+    const int32_t position[] = {-916656000, 419779000, 0, 250300}; // lon, lat, height, hMSL
+    memcpy(&payload[24], position, sizeof(position));
+    const uint32_t accuracy[] = {1800, 2600};
+    memcpy(&payload[40], accuracy, sizeof(accuracy));
+    return ubx_frame(UBX_CLASS_NAV, UBX_NAV_PVT, payload, sizeof(payload), frame, frameLength);
+}
+
+static void testFrame(void)
+{
+    // CFG-MSG turning NAV-PVT on, as published in the u-blox examples
+    static const uint8_t expected[] = {0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x07, 0x01, 0x13, 0x51};
+    uint8_t frame[32];
+    CHECK_EQUAL(sizeof(expected), ubx_configureMessage(UBX_CLASS_NAV, UBX_NAV_PVT, 1, frame, sizeof(frame)));
+    CHECK(memcmp(expected, frame, sizeof(expected)) == 0);
+    CHECK_EQUAL(0, ubx_configureMessage(UBX_CLASS_NAV, UBX_NAV_PVT, 1, frame, sizeof(expected) - 1));
+
+    struct ubx_parser_s parser;
+    ubx_parserInit(&parser);
+    CHECK_EQUAL(1, parseAll(&parser, expected, sizeof(expected)));
+    CHECK_EQUAL(UBX_CLASS_CFG, parser.msgClass);
+    CHECK_EQUAL(UBX_CFG_MSG, parser.msgId);
+    CHECK_EQUAL(3, parser.length);
+    CHECK_EQUAL(UBX_NAV_PVT, parser.payload[1]);
+}
+
+static void testNavPvt(void)
+{
+    uint8_t frame[UBX_NAV_PVT_LENGTH + UBX_FRAME_OVERHEAD];
+    CHECK_EQUAL(sizeof(frame), navPvtFrame(frame, sizeof(frame)));
+
+    struct ubx_parser_s parser;
+    ubx_parserInit(&parser);
+    CHECK_EQUAL(1, parseAll(&parser, frame, sizeof(frame)));
+    struct ubx_nav_pvt_s pvt;
+    CHECK(ubx_decodeNavPvt(parser.payload, parser.length, &pvt));
+    CHECK_EQUAL(2026, pvt.year);
+    CHECK_EQUAL(6, pvt.month);
+    CHECK_EQUAL(19, pvt.day);
+    CHECK_EQUAL(17, pvt.hour);
+    CHECK_EQUAL(28, pvt.minute);
+    CHECK_EQUAL(14, pvt.second);
+    CHECK_EQUAL(0x07, pvt.valid);
+    CHECK_EQUAL(-1234567, pvt.nano);
+    CHECK_EQUAL(UBX_3D_FIX, pvt.fixType);
+    CHECK_EQUAL(11, pvt.numSV);
+    CHECK_EQUAL(-916656000, pvt.longitude);
+    CHECK_EQUAL(419779000, pvt.latitude);
+    CHECK_EQUAL(250300, pvt.heightMSL);
+    CHECK_EQUAL(1800, pvt.hAcc);
+    CHECK_EQUAL(2600, pvt.vAcc);
+    CHECK(!ubx_decodeNavPvt(parser.payload, UBX_NAV_PVT_LENGTH - 1, &pvt));
+}
+
+static void testResync(void)
+{
+    uint8_t frame[UBX_NAV_PVT_LENGTH + UBX_FRAME_OVERHEAD];
+    size_t length = navPvtFrame(frame, sizeof(frame));
+    uint8_t stream[3 * sizeof(frame)];
+    struct ubx_parser_s parser;
+
+    // a stray sync byte in front of a frame
+    ubx_parserInit(&parser);
+    stream[0] = UBX_SYNC_1;
+    memcpy(&stream[1], frame, length);
+    CHECK_EQUAL(1, parseAll(&parser, stream, length + 1));
+
+    // a frame cut off before its checksum, the next one's sync lands where CK_A should be
+    CHECK(frame[length - 2] != UBX_SYNC_1);
+    ubx_parserInit(&parser);
+    memcpy(stream, frame, length - 2);
+    memcpy(&stream[length - 2], frame, length);
+    CHECK_EQUAL(1, parseAll(&parser, stream, 2 * length - 2));
+    CHECK_EQUAL(1, parser.checksumErrors);
+
+    // the same with only CK_B missing, unless CK_A happens to match the sync byte
+    ubx_parserInit(&parser);
+    memcpy(stream, frame, length - 1);
+    memcpy(&stream[length - 1], frame, length);
+    CHECK_EQUAL(1, parseAll(&parser, stream, 2 * length - 1));
+    CHECK_EQUAL(1, parser.checksumErrors);
+
+    // a corrupted payload byte fails the checksum and the next frame still comes through
+    ubx_parserInit(&parser);
+    memcpy(stream, frame, length);
+    stream[30] ^= 0x10;
+    memcpy(&stream[length], frame, length);
+    CHECK_EQUAL(1, parseAll(&parser, stream, 2 * length));
+    CHECK_EQUAL(1, parser.checksumErrors);
+
+    // NMEA text in between frames is skipped
+    static const char text[] = "$GPTXT,01,01,02,ANTSTATUS=OK*3B\r\n";
+    ubx_parserInit(&parser);
+    memcpy(stream, frame, length);
+    memcpy(&stream[length], text, sizeof(text) - 1);
+    memcpy(&stream[length + sizeof(text) - 1], frame, length);
+    CHECK_EQUAL(2, parseAll(&parser, stream, 2 * length + sizeof(text) - 1));
+    CHECK_EQUAL(0, parser.checksumErrors);
+}
+
+static void testTooLong(void)
+{
+    // a valid frame longer than the payload buffer is counted and not returned
+    uint8_t payload[UBX_MAX_PAYLOAD + 8];
+    for (size_t i = 0; i < sizeof(payload); i++)
+        payload[i] = (uint8_t)i;
+    uint8_t frame[sizeof(payload) + UBX_FRAME_OVERHEAD];
+    size_t length = ubx_frame(UBX_CLASS_NAV, 0x35, payload, sizeof(payload), frame, sizeof(frame));
+    struct ubx_parser_s parser;
+    ubx_parserInit(&parser);
+    CHECK_EQUAL(0, parseAll(&parser, frame, length));
+    CHECK_EQUAL(1, parser.skipped);
+    CHECK_EQUAL(0, parser.checksumErrors);
+}
+
+int main(void)
+{
+    testFrame();
+    testNavPvt();
+    testResync();
+    testTooLong();
+    return test_result("ubx");
+}
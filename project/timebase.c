@@ -0,0 +1,263 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hardware/rtc.h"
+#include "pico/util/datetime.h"
+
+#include <stdio.h>
+
+#include "timebase.h"
+
+/** GPS disciplined wall clock.
+ * The clock is an anchor pair (UTC ms, tick count). UTC for any tick is the anchor
+ * plus the elapsed ticks. Each discipline moves the anchor to the latest GPS time and
+ * records how far the tick count had drifted. The RTC is set on the first fix and
+ * corrected whenever it is a second or more away from the GPS.
+ */
+
+#define TIMEBASE_DISCIPLINE_PERIOD_MS (10 * 60 * 1000) // re-anchor to the GPS every 10 minutes
+#define TIMEBASE_RTC_CHECK_PERIOD_MS (60 * 60 * 1000)  // compare the RTC to the GPS every hour
+#define TIMEBASE_EARLIER_MS TIMEBASE_DISCIPLINE_PERIOD_MS // ticks this far before the anchor are in its past
+
+static bool valid = false;
+static int64_t anchorUtcMs;
+static TickType_t anchorTick;
+static TickType_t lastRtcCheck;
+static int32_t lastCorrectionMs;
+
+void init_timebase(void)
+{
+    valid = false;
+}
+
+static int parseDigits(const char **text, int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; i++)
+    {
+        char ch = **text;
+        if (ch < '0' || ch > '9')
+            return -1;
+        value = value * 10 + (ch - '0');
+        (*text)++;
+    }
+    return value;
+}
+
+static bool expect(const char **text, char ch)
+{
+    if (**text != ch)
+        return false;
+    (*text)++;
+    return true;
+}
+
+static bool isLeapYear(int year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int daysInMonth(int year, int month)
+{
+    static const int8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+bool timebase_parseIso8601(const char *text, struct utc_time_s *utc)
+{
+    int year = parseDigits(&text, 4);
+    if (year < 0 || !expect(&text, '-'))
+        return false;
+    int month = parseDigits(&text, 2);
+    if (month < 1 || month > 12 || !expect(&text, '-'))
+        return false;
+    int day = parseDigits(&text, 2);
+    if (day < 1 || day > daysInMonth(year, month) || !expect(&text, 'T'))
+        return false;
+    int hour = parseDigits(&text, 2);
+    if (hour < 0 || hour > 23 || !expect(&text, ':'))
+        return false;
+    int minute = parseDigits(&text, 2);
+    if (minute < 0 || minute > 59 || !expect(&text, ':'))
+        return false;
+    int second = parseDigits(&text, 2);
+    if (second < 0 || second > 60) // 60 is a leap second
+        return false;
+
+    int millisecond = 0;
+    if (expect(&text, '.'))
+    {
+        // keep the first three fractional digits and skip the rest
+        int scale = 100;
+        while (*text >= '0' && *text <= '9')
+        {
+            millisecond += (*text - '0') * scale;
+            scale /= 10;
+            text++;
+        }
+    }
+    if (!expect(&text, 'Z'))
+        return false;
+
+    utc->year = year;
+    utc->month = month;
+    utc->day = day;
+    utc->hour = hour;
+    utc->minute = minute;
+    utc->second = second;
+    utc->millisecond = millisecond;
+    return true;
+}
+
+/** days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant days_from_civil) */
+static int32_t daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yearOfEra = (uint32_t)(year - era * 400);
+    uint32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+static void civilFromDays(int32_t days, struct utc_time_s *utc)
+{
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t dayOfEra = (uint32_t)(days - era * 146097);
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint32_t monthPrime = (5 * dayOfYear + 2) / 153;
+    utc->day = dayOfYear - (153 * monthPrime + 2) / 5 + 1;
+    utc->month = monthPrime < 10 ? monthPrime + 3 : monthPrime - 9;
+    utc->year = (int32_t)yearOfEra + era * 400 + (utc->month <= 2);
+}
+
+int64_t timebase_toEpochMs(const struct utc_time_s *utc)
+{
+    int64_t seconds = (int64_t)daysFromCivil(utc->year, utc->month, utc->day) * 86400;
+    seconds += utc->hour * 3600 + utc->minute * 60 + utc->second;
+    return seconds * 1000 + utc->millisecond;
+}
+
+void timebase_fromEpochMs(int64_t epochMs, struct utc_time_s *utc)
+{
+    int64_t days = epochMs / 86400000;
+    int32_t msOfDay = (int32_t)(epochMs % 86400000);
+    if (msOfDay < 0)
+    {
+        msOfDay += 86400000;
+        days--;
+    }
+    civilFromDays((int32_t)days, utc);
+    utc->hour = msOfDay / 3600000;
+    utc->minute = (msOfDay / 60000) % 60;
+    utc->second = (msOfDay / 1000) % 60;
+    utc->millisecond = msOfDay % 1000;
+}
+
+size_t timebase_format(int64_t epochMs, char *buffer, size_t bufferLen)
+{
+    struct utc_time_s utc;
+    timebase_fromEpochMs(epochMs, &utc);
+    int length = snprintf(buffer, bufferLen, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                          utc.year, utc.month, utc.day, utc.hour, utc.minute, utc.second, utc.millisecond);
+    return length < 0 ? 0 : (size_t)length;
+}
+
+static void setRtc(const struct utc_time_s *utc)
+{
+    datetime_t rtc_time;
+    rtc_time.year = utc->year;
+    rtc_time.month = utc->month;
+    rtc_time.day = utc->day;
+    rtc_time.dotw = (daysFromCivil(utc->year, utc->month, utc->day) + 4) % 7; // 1970-01-01 was a Thursday
+    rtc_time.hour = utc->hour;
+    rtc_time.min = utc->minute;
+    rtc_time.sec = utc->second;
+    rtc_set_datetime(&rtc_time);
+}
+
+static bool rtcMatches(const struct utc_time_s *utc)
+{
+    datetime_t rtc_time;
+    if (!rtc_get_datetime(&rtc_time))
+        return false;
+    struct utc_time_s rtcUtc = {rtc_time.year, rtc_time.month, rtc_time.day, rtc_time.hour, rtc_time.min, rtc_time.sec, 0};
+    int64_t difference = timebase_toEpochMs(&rtcUtc) - (timebase_toEpochMs(utc) - utc->millisecond);
+    return difference > -1000 && difference < 1000;
+}
+
+void timebase_gpsTime(const struct utc_time_s *utc, TickType_t tickCount)
+{
+    int64_t gpsMs = timebase_toEpochMs(utc);
+
+    if (!valid)
+    {
+        rtc_init();
+        setRtc(utc);
+        lastRtcCheck = tickCount;
+        taskENTER_CRITICAL();
+        anchorUtcMs = gpsMs;
+        anchorTick = tickCount;
+        valid = true;
+        taskEXIT_CRITICAL();
+        printf("Timebase: set from GPS %04d-%02d-%02dT%02d:%02d:%02dZ\n", utc->year, utc->month, utc->day, utc->hour, utc->minute, utc->second);
+        return;
+    }
+
+    if (tickCount - anchorTick >= pdMS_TO_TICKS(TIMEBASE_DISCIPLINE_PERIOD_MS))
+    {
+        int64_t tickMs;
+        timebase_tickToUtcMs(tickCount, &tickMs);
+        taskENTER_CRITICAL();
+        lastCorrectionMs = (int32_t)(gpsMs - tickMs);
+        anchorUtcMs = gpsMs;
+        anchorTick = tickCount;
+        taskEXIT_CRITICAL();
+    }
+
+    if (tickCount - lastRtcCheck >= pdMS_TO_TICKS(TIMEBASE_RTC_CHECK_PERIOD_MS))
+    {
+        lastRtcCheck = tickCount;
+        if (!rtcMatches(utc))
+        {
+            puts("Timebase: RTC corrected from GPS");
+            setRtc(utc);
+        }
+    }
+}
+
+bool timebase_isValid(void)
+{
+    return valid;
+}
+
+bool timebase_tickToUtcMs(TickType_t tickCount, int64_t *epochMs)
+{
+    if (!valid)
+        return false;
+    taskENTER_CRITICAL();
+    // unsigned so that an anchor up to 49.7 days old converts across the tick wrap. A tick
+    // captured a little before the anchor moved comes out as a small negative offset
+    TickType_t earlierTicks = anchorTick - tickCount;
+    TickType_t elapsedTicks = tickCount - anchorTick;
+    if (earlierTicks <= pdMS_TO_TICKS(TIMEBASE_EARLIER_MS))
+        *epochMs = anchorUtcMs - (int64_t)earlierTicks * portTICK_PERIOD_MS;
+    else
+        *epochMs = anchorUtcMs + (int64_t)elapsedTicks * portTICK_PERIOD_MS;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+int64_t timebase_nowMs(void)
+{
+    int64_t epochMs = 0;
+    timebase_tickToUtcMs(xTaskGetTickCount(), &epochMs);
+    return epochMs;
+}
+
+int32_t timebase_lastCorrectionMs(void)
+{
+    return lastCorrectionMs;
+}
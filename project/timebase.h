@@ -0,0 +1,43 @@
+#ifndef _TIMEBASE_
+#define _TIMEBASE_
+
+#include "FreeRTOS.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** UTC wall clock time broken into calendar fields */
+struct utc_time_s
+{
+    int16_t year;
+    int8_t month; // 1-12
+    int8_t day;   // 1-31
+    int8_t hour;
+    int8_t minute;
+    int8_t second;
+    int16_t millisecond;
+};
+
+void init_timebase(void);
+
+/** parse "YYYY-MM-DDTHH:MM:SS[.fff]Z" without any allocation or sscanf */
+bool timebase_parseIso8601(const char *text, struct utc_time_s *utc);
+/** milliseconds since 1970-01-01T00:00:00Z */
+int64_t timebase_toEpochMs(const struct utc_time_s *utc);
+void timebase_fromEpochMs(int64_t epochMs, struct utc_time_s *utc);
+/** write "YYYY-MM-DDTHH:MM:SS.fffZ", returns the length */
+size_t timebase_format(int64_t epochMs, char *buffer, size_t bufferLen);
+
+/** hand a GPS time from a 3D fix that was received at tickCount to the timebase */
+void timebase_gpsTime(const struct utc_time_s *utc, TickType_t tickCount);
+
+/** true once the clock has been set from the GPS */
+bool timebase_isValid(void);
+/** UTC in ms for a tick count. Returns false before the first GPS time */
+bool timebase_tickToUtcMs(TickType_t tickCount, int64_t *epochMs);
+/** UTC in ms now or 0 before the first GPS time */
+int64_t timebase_nowMs(void);
+/** the correction applied at the last discipline, GPS time minus tick time in ms */
+int32_t timebase_lastCorrectionMs(void);
+
+#endif // _TIMEBASE_
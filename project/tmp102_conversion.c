@@ -0,0 +1,16 @@
+#include "tmp102_conversion.h"
+
+/** masking and dividing the signed register keeps the sign without any shifting */
+float tmp102_toCelsius(uint16_t raw_data)
+{
+    if (raw_data & 0x0001)
+    {
+        return (float)(int16_t)(raw_data & 0xFFF8) / 128.0f;
+    }
+    return (float)(int16_t)(raw_data & 0xFFF0) / 256.0f;
+}
+
+uint16_t tmp102_fromCelsius(int celsius)
+{
+    return (uint16_t)(int16_t)(celsius * 16 * 8);
+}
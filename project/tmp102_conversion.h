@@ -0,0 +1,13 @@
+#ifndef _TMP102_CONVERSION_
+#define _TMP102_CONVERSION_
+
+#include <stdint.h>
+
+/** convert a byte swapped temperature register to C.
+ * bit 0 is the EM flag. 13 bit data is left justified to bit 3, 12 bit data to bit 4.
+ */
+float tmp102_toCelsius(uint16_t raw_data);
+/** convert C to the 13 bit extended limit register format */
+uint16_t tmp102_fromCelsius(int celsius);
+
+#endif // _TMP102_CONVERSION_
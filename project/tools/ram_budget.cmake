@@ -0,0 +1,60 @@
+# Static RAM of each module in the firmware, run after every link (CMakeLists.txt).
+#   cmake -DSIZE=arm-none-eabi-size -DOBJECTS=a.obj|b.obj -DELF=weather.elf -DBUDGET=bytes -P ram_budget.cmake
+# A module's RAM is its .data and .bss, which since kernel_objects.h includes its task stacks
+# and queues. The table goes out largest first with the total for the whole image, and the
+# build fails when the image is over BUDGET.
+
+cmake_minimum_required(VERSION 3.13)
+
+string(REPLACE "|" ";" OBJECTS "${OBJECTS}")
+execute_process(COMMAND ${SIZE} -B ${OBJECTS} OUTPUT_VARIABLE table RESULT_VARIABLE failed)
+if(failed)
+    message(FATAL_ERROR "ram_budget: ${SIZE} failed")
+endif()
+
+# text data bss dec hex filename, one object a line after the heading
+string(REPLACE "\n" ";" lines "${table}")
+set(rows "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^ *([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)[ \t]+[0-9]+[ \t]+[0-9a-f]+[ \t]+(.+)$")
+        set(data ${CMAKE_MATCH_2})
+        set(bss ${CMAKE_MATCH_3})
+        set(file "${CMAKE_MATCH_4}")
+        math(EXPR ram "${data} + ${bss}")
+        if(ram GREATER 0)
+            get_filename_component(module "${file}" NAME)
+            string(REGEX REPLACE "\\.(c|S|cpp)\\.(obj|o)$" "" module "${module}")
+            # zero padded in front so the list sorts by size
+            string(LENGTH "${ram}" digits)
+            math(EXPR pad "10 - ${digits}")
+            string(REPEAT "0" ${pad} zeros)
+            list(APPEND rows "${zeros}${ram}|${data}|${bss}|${module}")
+        endif()
+    endif()
+endforeach()
+list(SORT rows ORDER DESCENDING)
+
+message("RAM budget, bytes of .data + .bss per module")
+foreach(row IN LISTS rows)
+    string(REPLACE "|" ";" fields "${row}")
+    list(GET fields 0 ram)
+    list(GET fields 1 data)
+    list(GET fields 2 bss)
+    list(GET fields 3 module)
+    string(REGEX REPLACE "^0+([0-9])" "\\1" ram "${ram}")
+    string(LENGTH "${ram}" width)
+    math(EXPR pad "8 - ${width}")
+    string(REPEAT " " ${pad} spaces)
+    message("  ${spaces}${ram}  ${module} (data ${data}, bss ${bss})")
+endforeach()
+
+# the image, with the SDK's libraries and the linker's own sections
+execute_process(COMMAND ${SIZE} -B ${ELF} OUTPUT_VARIABLE image)
+if(image MATCHES "\n *[0-9]+[ \t]+([0-9]+)[ \t]+([0-9]+)")
+    math(EXPR total "${CMAKE_MATCH_1} + ${CMAKE_MATCH_2}")
+    math(EXPR left "${BUDGET} - ${total}")
+    message("  total ${total} of the ${BUDGET} byte budget, ${left} left for the C heap and main stack")
+    if(total GREATER BUDGET)
+        message(FATAL_ERROR "ram_budget: ${total} bytes of static RAM is over the ${BUDGET} byte budget")
+    endif()
+endif()
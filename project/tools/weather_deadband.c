@@ -0,0 +1,156 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "deadband.h"
+#include "pressure_history.h"
+#include "report_format.h"
+#include "sim_scenario.h"
+
+/** Replays a run of weather through the scaled report and through its deadband encoding, see
+ * REPORT_DEADBAND_MODE, and counts the bytes each publishes.
+ *   weather_deadband [SCENARIO.csv]
+ * The scenario is a keyframe file as the simulation reads, tools/deadband_week.csv is a synthetic
+ * week with every field moving. Without one the simulation's built-in week is used. There is a
+ * report a minute with the sensors' noise and resolution on top of the scenario, a fixed site
+ * sent once a day and the field table and message formats from report_format.c.
+ */
+#define REPORT_MS 60000
+#define KEYFRAME_MS (60 * 60000) // REPORT_KEYFRAME_MS
+#define SITE_REPEAT 1440         // REPORTING_SITE_REPEAT
+#define THING_NAME "weather-station-00112233445566778899aa"
+#define ALTITUDE_M 250.3f
+#define START_UTC 1781827200 // 2026-06-19T00:00:00Z
+#define RAIN_TIP_IN 0.011f
+
+static uint32_t seed = 12345;
+
+/** roughly normal noise from the sum of four uniforms */
+static float noise(float sigma)
+{
+    float sum = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        sum += (float)(seed >> 8) / (1 << 24) - 0.5f;
+    }
+    return sum * sigma * 1.732f;
+}
+
+static float wrapDegrees(float degrees)
+{
+    degrees = fmodf(degrees, 360.0f);
+    return degrees < 0 ? degrees + 360.0f : degrees;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !sim_scenarioLoad(argv[1]))
+        return 1;
+
+    static struct deadband_field_s fields[SCALED_FIELDS];
+    report_deadbandFields(fields);
+    struct deadband_s deadband;
+    deadband_init(&deadband, fields, SCALED_FIELDS, KEYFRAME_MS);
+    struct pressure_history_s history;
+    pressure_historyInit(&history);
+
+    static uint8_t tips[24 * 60]; // per minute, for the hour and the day totals
+    float rainDue = 0;
+    uint32_t tipsHour = 0;
+    uint32_t tipsDay = 0;
+
+    uint64_t scaledBytes = 0;
+    uint64_t deadbandBytes = 0;
+    uint32_t reports = 0;
+    uint32_t keyframes = 0;
+    int64_t runMs = (int64_t)(sim_scenarioHours() * 3600000.0);
+    for (int64_t nowMs = 0; nowMs < runMs; nowMs += REPORT_MS, reports++)
+    {
+        struct sim_conditions_s conditions;
+        sim_scenarioAt(nowMs / 3600000.0, &conditions);
+
+        float pressure = conditions.pressurePa + noise(2.0f); // BMP388 without oversampling
+        pressure_historyAdd(&history, pressure);
+
+        // the gauge tips every 0.011 in, the hour and day totals are over whole tips
+        rainDue += conditions.rainInHr / 60.0f;
+        uint8_t tipped = 0;
+        while (rainDue >= RAIN_TIP_IN)
+        {
+            rainDue -= RAIN_TIP_IN;
+            tipped++;
+        }
+        int minute = reports % (24 * 60);
+        tipsDay += tipped - tips[minute];
+        tipsHour += tipped - tips[(minute + 24 * 60 - 60) % (24 * 60)];
+        tips[minute] = tipped;
+
+        float windSpeed = fmaxf(0, conditions.windMph + noise(0.6f));
+        float gustSpeed = fmaxf(windSpeed, conditions.gustMph + noise(1.5f));
+        struct report_scaled_s report = {
+            4.10f + noise(0.01f),
+            conditions.temperatureC + 2.0f + noise(0.05f), // the BMP388 is inside the enclosure
+            pressure,
+            pressure_seaLevel(pressure, conditions.temperatureC, ALTITUDE_M),
+            history.tendency,
+            pressure_tendencyName(history.tendencyClass),
+            history.filledCount,
+            roundf((conditions.temperatureC + noise(0.05f)) * 16) / 16, // TMP102 12 bit
+            "",
+            windSpeed,
+            (int)wrapDegrees(conditions.directionDeg + noise(12.0f)),
+            gustSpeed,
+            (int)wrapDegrees(conditions.directionDeg + noise(20.0f)),
+            tipsHour * RAIN_TIP_IN,
+            tipsDay * RAIN_TIP_IN,
+            (unsigned int)nowMs,
+        };
+
+        char utc[32];
+        time_t seconds = START_UTC + nowMs / 1000;
+        strftime(utc, sizeof(utc), "%Y-%m-%dT%H:%M:%S.000Z", gmtime(&seconds));
+        report.utc = utc;
+        char site[96] = "";
+        if (reports % SITE_REPEAT == 0)
+            snprintf(site, sizeof(site), "\"SITE\":{\"latitude\":%.7f,\"longitude\":%.7f,\"altitude\":%.3f},", 41.9779010,
+                     -91.6656020, ALTITUDE_M);
+        report.gps = site;
+
+        char message[1024];
+        scaledBytes += report_formatScaled(message, sizeof(message), THING_NAME, &report);
+
+        // a fixed site has no deadband fields
+        struct deadband_value_s values[SCALED_FIELDS] = {
+            [FIELD_VOLTS] = {true, report.volts},
+            [FIELD_BMP_TEMPERATURE] = {true, report.bmpTemperature},
+            [FIELD_BMP_PRESSURE] = {true, report.bmpPressure},
+            [FIELD_BMP_SEA_LEVEL] = {true, report.seaLevelPressure},
+            [FIELD_BMP_TENDENCY_3H] = {true, report.tendency_3h},
+            [FIELD_BMP_TENDENCY] = {true, 0, report.tendency},
+            [FIELD_BMP_FILLED] = {true, report.tendencyFilled},
+            [FIELD_TMP_TEMPERATURE] = {true, report.tmpTemperature},
+            [FIELD_WIND_SPEED] = {true, report.windSpeed_2m},
+            [FIELD_WIND_DIRECTION] = {true, report.windDirection_2m},
+            [FIELD_GUST_SPEED] = {true, report.gustSpeed_10m},
+            [FIELD_GUST_DIRECTION] = {true, report.gustDirection_10m},
+            [FIELD_RAIN_HOUR] = {true, report.rain_in_hr},
+            [FIELD_RAIN_DAY] = {true, report.rain_in_day},
+        };
+        char changed[512];
+        bool keyframe;
+        deadband_encode(&deadband, values, nowMs, changed, sizeof(changed), &keyframe);
+        deadbandBytes += report_formatDeadband(message, sizeof(message), THING_NAME, site, changed, keyframe, report.timeMs, utc);
+        keyframes += keyframe;
+    }
+
+    printf("%u reports over %.1f days, %u keyframes\n", reports, runMs / 86400000.0, keyframes);
+    printf("scaled %llu bytes, deadband %llu bytes, %.1f%% of the scaled\n", (unsigned long long)scaledBytes,
+           (unsigned long long)deadbandBytes, 100.0 * deadbandBytes / scaledBytes);
+    printf("%u fields sent, %u suppressed, %u raw reports not sent between keyframes\n", deadband.fieldsSent,
+           deadband.fieldsSuppressed, reports - keyframes);
+    return 0;
+}
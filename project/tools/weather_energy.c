@@ -0,0 +1,105 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "publish_queue.h"
+#include "wake_lead.h"
+
+/** Models the ExpressLink's energy per report against the report interval, awake between
+ * reports and with PUBLISH_SLEEP_MODE.
+ *   weather_energy
+ * The module is an assumed cellular one. Kept awake it idles connected between publishes.
+ * Asleep it is woken the wake lead from wake_lead.c ahead of each window, takes a lognormal
+ * time to answer and attach, and idles connected for what is left of the lead. A wake that
+ * takes longer than the lead makes its window late. The sleep column sleeps through every
+ * gap the lead fits in, the firmware column follows publish_sleepUntilWindow().
+ */
+#define VOLTS 3.8
+#define IDLE_MA 8.0   // connected, nothing to send
+#define SLEEP_MA 0.05
+#define WAKE_MA 90.0  // from WAKE asserted to attached
+#define SEND_MA 150.0
+#define SEND_MS 1500  // the report's three messages
+#define WAKE_MEDIAN_MS 11000.0
+#define WAKE_SIGMA 0.35      // of the log of the wake time
+#define REATTACH_BYTES 10000 // the TLS handshake and subscriptions of each attach
+#define REPORTS 10000
+
+static uint32_t seed = 12345;
+
+static double uniform(void)
+{
+    seed = seed * 1664525 + 1013904223;
+    return ((seed >> 8) + 0.5) / (1 << 24);
+}
+
+/** Box-Muller */
+static uint32_t wakeMs(void)
+{
+    double normal = sqrt(-2 * log(uniform())) * cos(2 * M_PI * uniform());
+    return (uint32_t)(WAKE_MEDIAN_MS * exp(WAKE_SIGMA * normal));
+}
+
+struct run_s
+{
+    double millijoules; // per report
+    uint32_t sleeps;
+    uint32_t late;
+    uint32_t worstLateMs;
+};
+
+/** REPORTS windows intervalMs apart, sleeping the gaps longer than minimumMs */
+static void simulate(uint32_t intervalMs, uint32_t minimumMs, struct run_s *run)
+{
+    struct wake_lead_s lead;
+    wake_leadInit(&lead);
+    double mAms = 0;
+    *run = (struct run_s){0};
+    for (int report = 0; report < REPORTS; report++)
+    {
+        mAms += SEND_MA * SEND_MS;
+        uint32_t untilReport = intervalMs - SEND_MS;
+        uint32_t leadMs = wake_leadMs(&lead);
+        if (untilReport <= minimumMs || untilReport <= leadMs)
+        {
+            mAms += IDLE_MA * untilReport;
+            continue;
+        }
+        uint32_t wake = wakeMs();
+        run->sleeps++;
+        mAms += SLEEP_MA * (untilReport - leadMs) + WAKE_MA * wake;
+        if (wake <= leadMs)
+        {
+            mAms += IDLE_MA * (leadMs - wake);
+        }
+        else
+        {
+            run->late++;
+            if (wake - leadMs > run->worstLateMs)
+                run->worstLateMs = wake - leadMs;
+        }
+        wake_leadAdd(&lead, wake);
+    }
+    run->millijoules = VOLTS * mAms / 1000 / REPORTS;
+}
+
+int main(void)
+{
+    static const uint32_t intervalsS[] = {60, 90, 120, 150, 180, 240, 300, 600};
+    printf("interval_s,awake_mJ,sleep_mJ,sleep_saving_pct,late_pct,worst_late_ms,firmware,firmware_mJ,reattach_kB_day\n");
+    for (unsigned i = 0; i < sizeof(intervalsS) / sizeof(intervalsS[0]); i++)
+    {
+        uint32_t intervalMs = intervalsS[i] * 1000;
+        struct run_s awake, sleep, firmware;
+        simulate(intervalMs, UINT32_MAX, &awake);
+        simulate(intervalMs, 0, &sleep);
+        simulate(intervalMs, PUBLISH_SLEEP_MIN_MS, &firmware);
+        double reportsPerDay = 86400.0 / intervalsS[i];
+        printf("%u,%.0f,%.0f,%.1f,%.2f,%u,%s,%.0f,%.0f\n", intervalsS[i], awake.millijoules, sleep.millijoules,
+               100 * (1 - sleep.millijoules / awake.millijoules), 100.0 * sleep.late / REPORTS, sleep.worstLateMs,
+               firmware.sleeps ? "sleeps" : "awake", firmware.millijoules,
+               reportsPerDay * firmware.sleeps / REPORTS * REATTACH_BYTES / 1000);
+    }
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <elf.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "log.h"
+
+/** Expands the deferred log records in a console stream, see log.h.
+ *   weather_log FIRMWARE.elf [CONSOLE]
+ * The format strings come from the logfmt section of the ELF the station runs. Console text
+ * passes through, log frames become lines and capture frames are left out. Reads the
+ * console from stdin without a file, so it can sit behind a terminal program or the sim.
+ */
+static char *formats;
+static size_t formatsLength;
+
+static const char levels[] = "?EWID";
+
+/** name, file offset and size from a section header */
+static void readSection(const uint8_t *elf, bool wide, uint64_t at, uint32_t *name, uint64_t *offset, uint64_t *length)
+{
+    if (wide)
+    {
+        const Elf64_Shdr *header = (const Elf64_Shdr *)(elf + at);
+        *name = header->sh_name;
+        *offset = header->sh_offset;
+        *length = header->sh_size;
+    }
+    else
+    {
+        const Elf32_Shdr *header = (const Elf32_Shdr *)(elf + at);
+        *name = header->sh_name;
+        *offset = header->sh_offset;
+        *length = header->sh_size;
+    }
+}
+
+/** the logfmt section of a 32 or 64 bit little endian ELF */
+static bool loadFormats(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    uint8_t *elf = malloc(size);
+    bool read = elf && fread(elf, 1, size, file) == (size_t)size;
+    fclose(file);
+    if (!read || size < EI_NIDENT || memcmp(elf, ELFMAG, SELFMAG) != 0)
+    {
+        fprintf(stderr, "%s: not an ELF file\n", path);
+        free(elf);
+        return false;
+    }
+
+    bool wide = elf[EI_CLASS] == ELFCLASS64;
+    uint64_t sectionsAt;
+    unsigned int sectionSize, sections, names;
+    if (wide)
+    {
+        const Elf64_Ehdr *header = (const Elf64_Ehdr *)elf;
+        sectionsAt = header->e_shoff;
+        sectionSize = header->e_shentsize;
+        sections = header->e_shnum;
+        names = header->e_shstrndx;
+    }
+    else
+    {
+        const Elf32_Ehdr *header = (const Elf32_Ehdr *)elf;
+        sectionsAt = header->e_shoff;
+        sectionSize = header->e_shentsize;
+        sections = header->e_shnum;
+        names = header->e_shstrndx;
+    }
+    if (sectionsAt + (uint64_t)sections * sectionSize > (uint64_t)size || names >= sections)
+    {
+        fprintf(stderr, "%s: bad section table\n", path);
+        free(elf);
+        return false;
+    }
+
+    uint64_t namesAt, offset, length;
+    uint32_t name;
+    readSection(elf, wide, sectionsAt + (uint64_t)names * sectionSize, &name, &namesAt, &length);
+    for (unsigned int i = 0; i < sections; i++)
+    {
+        readSection(elf, wide, sectionsAt + (uint64_t)i * sectionSize, &name, &offset, &length);
+        if (namesAt + name < (uint64_t)size && strcmp((const char *)elf + namesAt + name, LOG_SECTION) == 0 &&
+            offset + length <= (uint64_t)size)
+        {
+            formats = malloc(length + 1);
+            memcpy(formats, elf + offset, length);
+            formats[length] = 0;
+            formatsLength = length;
+            free(elf);
+            return true;
+        }
+    }
+    fprintf(stderr, "%s: no " LOG_SECTION " section, built with LOG_DEFERRED 0?\n", path);
+    free(elf);
+    return false;
+}
+
+/** the records of one frame, one line each */
+static void decodeFrame(const uint8_t *payload, size_t length)
+{
+    static uint64_t lastUs[8]; // per core, across frames for the drop check
+    if (length < 2)
+        return;
+    unsigned int core = payload[0] & 7;
+    uint64_t us;
+    size_t at = 1;
+    size_t n = log_getVarint(payload + at, length - at, &us);
+    if (n == 0)
+        return;
+    at += n;
+    if (us < lastUs[core])
+        printf("[log: core %u restarted]\n", core);
+    while (at < length)
+    {
+        size_t recordLength = payload[at];
+        const uint8_t *record = payload + at + 1;
+        at += 1 + recordLength;
+        if (at > length)
+        {
+            printf("[log: frame cut short]\n");
+            break;
+        }
+        uint64_t format, delta;
+        size_t formatLength = log_getVarint(record, recordLength, &format);
+        size_t deltaLength = formatLength ? log_getVarint(record + formatLength, recordLength - formatLength, &delta) : 0;
+        if (deltaLength == 0 || format >= formatsLength)
+        {
+            printf("[log: bad record]\n");
+            continue;
+        }
+        us += delta;
+        const char *text = formats + format;
+        char line[512];
+        size_t header = formatLength + deltaLength;
+        log_format(line, sizeof(line), text + 1, record + header, recordLength - header);
+        printf("[%6llu.%06llu %u %c] %s\n", (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000), core,
+               text[0] > 0 && text[0] < (char)sizeof(levels) - 1 ? levels[(int)text[0]] : '?', line);
+    }
+    lastUs[core] = us;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "usage: %s FIRMWARE.elf [CONSOLE]\n", argv[0]);
+        return 2;
+    }
+    if (!loadFormats(argv[1]))
+        return 1;
+    FILE *in = argc == 3 ? fopen(argv[2], "rb") : stdin;
+    if (in == NULL)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    int c;
+    uint8_t payload[CAPTURE_FRAME_MAX];
+    while ((c = getc(in)) != EOF)
+    {
+        if (c != CAPTURE_FRAME_START)
+        {
+            putchar(c);
+            continue;
+        }
+        int type = getc(in);
+        int lo = getc(in);
+        int hi = getc(in);
+        if (hi == EOF)
+            break;
+        size_t length = lo | hi << 8;
+        if (length > sizeof(payload) || fread(payload, 1, length, in) != length)
+        {
+            printf("[log: frame too long or cut short]\n");
+            continue;
+        }
+        uint8_t sum = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            sum += payload[i];
+        }
+        if (getc(in) != sum)
+        {
+            printf("[log: bad frame sum]\n");
+            continue;
+        }
+        if (type == LOG_FRAME)
+            decodeFrame(payload, length);
+        fflush(stdout);
+    }
+    return 0;
+}
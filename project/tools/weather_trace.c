@@ -0,0 +1,339 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "trace.h"
+
+/** Turns a kernel trace dump, see trace.h, into the JSON trace event format that
+ * ui.perfetto.dev and chrome://tracing open.
+ *   weather_trace [CONSOLE] > trace.json
+ * The console comes from stdin without a file. The last whole dump in it is converted. Each
+ * core gets a track with the running task and the ISRs nested in it, each task a track with
+ * the time it ran and the time it waited to run after it was made ready, and the queue and
+ * semaphore operations are marks on the core they happened on.
+ */
+#define DUMP_MAX (64 * 1024)
+
+static const char *const queueTypes[] = {"queue", "mutex", "semaphore", "semaphore", "mutex"}; // queueQUEUE_TYPE_x
+static const char *const isrNames[TRACE_ISR_SOURCES] = {"wind PIO", "rain PIO", "GPS UART", "ExpressLink UART", "PPS", "TMP102 alert"};
+
+struct event_s
+{
+    uint64_t time;
+    uint32_t order; // core and position, to keep the order of equal times
+    uint8_t core;
+    uint8_t type;
+    uint8_t object;
+    uint16_t detail;
+};
+
+static struct
+{
+    uint8_t cores;
+    uint64_t now;
+    int tasks;
+    uint8_t taskNumbers[256];
+    uint8_t taskPriorities[256];
+    char taskNames[256][TRACE_NAME_MAX + 1];
+    int queues;
+    uint8_t queueTypes[256];
+    size_t events;
+    struct event_s *all; // every core, in time order
+} dump;
+
+static bool first = true;
+
+static const char *taskName(uint8_t number)
+{
+    static char unknown[16];
+    for (int i = 0; i < dump.tasks; i++)
+    {
+        if (dump.taskNumbers[i] == number)
+            return dump.taskNames[i];
+    }
+    snprintf(unknown, sizeof(unknown), "task %u", number);
+    return unknown;
+}
+
+static const char *queueName(uint8_t number)
+{
+    static char name[32];
+    const char *type = number >= 1 && number <= dump.queues && dump.queueTypes[number - 1] < 5 ? queueTypes[dump.queueTypes[number - 1]] : "queue";
+    snprintf(name, sizeof(name), "%s %u", type, number);
+    return name;
+}
+
+static bool isQueue(uint8_t number)
+{
+    return !(number >= 1 && number <= dump.queues && dump.queueTypes[number - 1] != 0);
+}
+
+/** one trace event, the caller adds the fields after the common ones */
+static void begin(const char *phase, int pid, int tid, uint64_t time)
+{
+    printf("%s\n{\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%llu", first ? "" : ",", phase, pid, tid, (unsigned long long)time);
+    first = false;
+}
+
+static void slice(int pid, int tid, uint64_t start, uint64_t end, const char *name, const char *category)
+{
+    begin("X", pid, tid, start);
+    printf(",\"dur\":%llu,\"name\":\"%s\",\"cat\":\"%s\"}", (unsigned long long)(end - start), name, category);
+}
+
+static void mark(int tid, uint64_t time, const char *name)
+{
+    begin("i", 1, tid, time);
+    printf(",\"s\":\"t\",\"name\":\"%s\",\"cat\":\"kernel\"}", name);
+}
+
+static void metadata(int pid, int tid, const char *what, const char *name)
+{
+    begin("M", pid, tid, 0);
+    printf(",\"name\":\"%s\",\"args\":{\"name\":\"%s\"}}", what, name);
+}
+
+static int compareEvents(const void *a, const void *b)
+{
+    const struct event_s *x = a;
+    const struct event_s *y = b;
+    if (x->time != y->time)
+        return x->time < y->time ? -1 : 1;
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+/** the dump at data, false when it is cut short */
+static bool parse(const uint8_t *data, size_t length)
+{
+    size_t at = 5;
+#define NEED(n)                 \
+    do                          \
+    {                           \
+        if (at + (n) > length)  \
+            return false;       \
+    } while (0)
+    NEED(10);
+    if (data[at++] != TRACE_VERSION)
+        return false;
+    dump.cores = data[at++];
+    if (dump.cores == 0 || dump.cores > 8)
+        return false;
+    dump.now = 0;
+    dump.events = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        dump.now |= (uint64_t)data[at++] << (8 * i);
+    }
+    NEED(1);
+    dump.tasks = data[at++];
+    for (int i = 0; i < dump.tasks; i++)
+    {
+        NEED(3);
+        dump.taskNumbers[i] = data[at++];
+        dump.taskPriorities[i] = data[at++];
+        size_t nameLength = data[at++];
+        NEED(nameLength);
+        if (nameLength > TRACE_NAME_MAX)
+            return false;
+        memcpy(dump.taskNames[i], data + at, nameLength);
+        dump.taskNames[i][nameLength] = 0;
+        at += nameLength;
+    }
+    NEED(1);
+    dump.queues = data[at++];
+    for (int i = 0; i < dump.queues; i++)
+    {
+        NEED(2);
+        at++; // the numbers go 1 up
+        dump.queueTypes[i] = data[at++];
+    }
+    for (int c = 0; c < dump.cores; c++)
+    {
+        NEED(3);
+        unsigned int core = data[at];
+        size_t count = data[at + 1] | data[at + 2] << 8;
+        at += 3;
+        NEED(count * 8);
+        if (core >= dump.cores)
+            return false;
+        dump.all = realloc(dump.all, (dump.events + count + 1) * sizeof(struct event_s));
+        for (size_t i = 0; i < count; i++, at += 8)
+        {
+            uint32_t time = data[at] | data[at + 1] << 8 | data[at + 2] << 16 | (uint32_t)data[at + 3] << 24;
+            struct event_s *event = &dump.all[dump.events++];
+            event->core = core;
+            event->order = core << 16 | i;
+            // every event is within 71 minutes of the dump, the 32 bit times do not need unwrapping
+            event->time = dump.now - (uint32_t)((uint32_t)dump.now - time);
+            event->type = data[at + 4];
+            event->object = data[at + 5];
+            event->detail = data[at + 6] | data[at + 7] << 8;
+        }
+    }
+    NEED(1);
+    if (data[at] != TRACE_END)
+        return false;
+    qsort(dump.all, dump.events, sizeof(*dump.all), compareEvents);
+    return true;
+#undef NEED
+}
+
+static void convert(void)
+{
+    uint64_t running[256] = {0}; // per task, when it started on its core
+    uint64_t ready[256] = {0};   // per task, when it was made ready
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    metadata(1, 0, "process_name", "cores");
+    metadata(2, 0, "process_name", "tasks");
+    for (int core = 0; core < dump.cores; core++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "core %d", core);
+        metadata(1, core, "thread_name", name);
+    }
+    for (int i = 0; i < dump.tasks; i++)
+    {
+        char name[TRACE_NAME_MAX + 16];
+        snprintf(name, sizeof(name), "%s (%u)", dump.taskNames[i], dump.taskPriorities[i]);
+        metadata(2, dump.taskNumbers[i], "thread_name", name);
+    }
+
+    int task[8];
+    uint64_t taskStart[8];
+    uint64_t isrStart[8][TRACE_ISR_SOURCES];
+    bool inIsr[8][TRACE_ISR_SOURCES] = {{false}};
+    for (int core = 0; core < dump.cores; core++)
+    {
+        task[core] = -1;
+    }
+    char text[64];
+    for (size_t i = 0; i < dump.events; i++)
+    {
+        const struct event_s *event = &dump.all[i];
+        int core = event->core;
+        switch (event->type)
+        {
+        case TRACE_TASK_SWITCH:
+            if (event->object == task[core])
+                break;
+            if (task[core] >= 0)
+            {
+                slice(1, core, taskStart[core], event->time, taskName(task[core]), "task");
+                slice(2, task[core], running[task[core]], event->time, "running", "task");
+            }
+            task[core] = event->object;
+            taskStart[core] = running[event->object] = event->time;
+            if (ready[event->object])
+                slice(2, event->object, ready[event->object], event->time, "ready", "wait");
+            ready[event->object] = 0;
+            break;
+        case TRACE_TASK_READY:
+            if (ready[event->object] == 0)
+                ready[event->object] = event->time;
+            break;
+        case TRACE_ISR_ENTER:
+            if (event->object < TRACE_ISR_SOURCES)
+            {
+                isrStart[core][event->object] = event->time;
+                inIsr[core][event->object] = true;
+            }
+            break;
+        case TRACE_ISR_EXIT:
+            if (event->object < TRACE_ISR_SOURCES && inIsr[core][event->object])
+            {
+                slice(1, core, isrStart[core][event->object], event->time, isrNames[event->object], "isr");
+                inIsr[core][event->object] = false;
+            }
+            break;
+        case TRACE_QUEUE_SEND:
+        case TRACE_QUEUE_RECEIVE:
+        case TRACE_QUEUE_BLOCK_SEND:
+        case TRACE_QUEUE_BLOCK_RECEIVE:
+        case TRACE_QUEUE_SEND_FAILED:
+        case TRACE_QUEUE_RECEIVE_FAILED:
+        {
+            static const char *const queueVerbs[] = {"send", "receive", "block on send", "block on receive", "send failed", "receive failed"};
+            static const char *const semaphoreVerbs[] = {"give", "take", "block on give", "block on take", "give failed", "take failed"};
+            const char *verb = (isQueue(event->object) ? queueVerbs : semaphoreVerbs)[event->type - TRACE_QUEUE_SEND];
+            snprintf(text, sizeof(text), "%s %s (%u waiting)", verb, queueName(event->object), event->detail);
+            mark(core, event->time, text);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    for (int core = 0; core < dump.cores; core++)
+    {
+        if (task[core] >= 0)
+        {
+            slice(1, core, taskStart[core], dump.now, taskName(task[core]), "task");
+            slice(2, task[core], running[task[core]], dump.now, "running", "task");
+        }
+    }
+    printf("\n]}\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2)
+    {
+        fprintf(stderr, "usage: %s [CONSOLE] > trace.json\n", argv[0]);
+        return 2;
+    }
+    FILE *in = argc == 2 ? fopen(argv[1], "rb") : stdin;
+    if (in == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    // the T frames joined up, then the last dump in them
+    static uint8_t stream[DUMP_MAX];
+    static uint8_t last[DUMP_MAX];
+    size_t length = 0;
+    size_t lastLength = 0;
+    int c;
+    uint8_t payload[CAPTURE_FRAME_MAX];
+    while ((c = getc(in)) != EOF)
+    {
+        if (c != CAPTURE_FRAME_START)
+            continue;
+        int type = getc(in);
+        int lo = getc(in);
+        int hi = getc(in);
+        if (hi == EOF)
+            break;
+        size_t frameLength = lo | hi << 8;
+        if (frameLength > sizeof(payload) || fread(payload, 1, frameLength, in) != frameLength)
+            continue;
+        uint8_t sum = 0;
+        for (size_t i = 0; i < frameLength; i++)
+        {
+            sum += payload[i];
+        }
+        if (getc(in) != sum || type != TRACE_FRAME)
+            continue;
+        if (frameLength >= 5 && memcmp(payload, TRACE_MAGIC, 5) == 0)
+            length = 0; // a new dump, the frames before belong to an older one
+        if (length + frameLength > sizeof(stream))
+            continue;
+        memcpy(stream + length, payload, frameLength);
+        length += frameLength;
+        if (length >= 5 && memcmp(stream, TRACE_MAGIC, 5) == 0 && parse(stream, length))
+        {
+            memcpy(last, stream, length);
+            lastLength = length;
+        }
+    }
+    if (lastLength == 0 || !parse(last, lastLength))
+    {
+        fprintf(stderr, "no whole trace dump found\n");
+        return 1;
+    }
+    convert();
+    return 0;
+}
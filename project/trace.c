@@ -0,0 +1,174 @@
+#include "FreeRTOS.h"
+
+#if TRACE_ENABLED
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "pico/stdio.h"
+#include "pico/stdlib.h"
+
+#include "capture.h"
+
+struct trace_event_s
+{
+    uint32_t time; // time_us_32
+    uint8_t type;
+    uint8_t object;
+    uint16_t detail;
+};
+
+/** One ring per core, written with that core's interrupts off like log.c. The kernel hooks
+ * already run in its critical sections and the scheduler, where nothing else may be taken.
+ * Old events are overwritten, a dump is the last TRACE_EVENTS on each core.
+ */
+struct trace_ring_s
+{
+    struct trace_event_s events[TRACE_EVENTS];
+    uint32_t head; // free running
+};
+
+static struct trace_ring_s rings[NUM_CORES];
+static volatile bool recording = true;
+
+static struct
+{
+    uint8_t number;
+    uint8_t priority;
+    char name[TRACE_NAME_MAX];
+} tasks[TRACE_TASKS];
+static uint8_t taskCount;
+
+static uint8_t queueTypes[TRACE_QUEUES]; // by number - 1
+static uint8_t queueCount;
+
+void trace_event(uint8_t type, uint8_t object, uint16_t detail)
+{
+    if (!recording)
+        return;
+    uint32_t interrupts = save_and_disable_interrupts();
+    struct trace_ring_s *ring = &rings[get_core_num()];
+    struct trace_event_s *event = &ring->events[ring->head++ & (TRACE_EVENTS - 1)];
+    event->time = time_us_32();
+    event->type = type;
+    event->object = object;
+    event->detail = detail;
+    restore_interrupts(interrupts);
+}
+
+/** tasks are only created by tasks and main, the kernel holds its own lock around this */
+void trace_taskCreate(uint32_t number, const char *name, uint32_t priority)
+{
+    if (taskCount == TRACE_TASKS)
+        return;
+    tasks[taskCount].number = number;
+    tasks[taskCount].priority = priority;
+    strncpy(tasks[taskCount].name, name, TRACE_NAME_MAX);
+    taskCount++;
+}
+
+/** the number the queue goes by in the events, 0 when the table is full */
+uint32_t trace_queueCreate(uint8_t queueType)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    uint32_t number = 0;
+    if (queueCount < TRACE_QUEUES)
+    {
+        queueTypes[queueCount] = queueType;
+        number = ++queueCount;
+    }
+    restore_interrupts(interrupts);
+    return number;
+}
+
+/*********************************************************************************
+ * dump
+ *********************************************************************************/
+static uint8_t frame[CAPTURE_FRAME_MAX];
+static size_t frameLength;
+
+static void dump_flush(void)
+{
+    if (frameLength == 0)
+        return;
+    uint8_t sum = 0;
+    for (size_t i = 4; i < 4 + frameLength; i++)
+    {
+        sum += frame[i];
+    }
+    frame[0] = CAPTURE_FRAME_START;
+    frame[1] = TRACE_FRAME;
+    frame[2] = frameLength & 0xFF;
+    frame[3] = frameLength >> 8;
+    frame[4 + frameLength] = sum;
+    stdio_put_string((const char *)frame, 5 + frameLength, false, false);
+    frameLength = 0;
+}
+
+static void dump_put(const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (frameLength == CAPTURE_FRAME_MAX - 5)
+            dump_flush();
+        frame[4 + frameLength++] = bytes[i];
+    }
+}
+
+static void dump_putLittle(uint64_t value, size_t length)
+{
+    uint8_t bytes[8];
+    for (size_t i = 0; i < length; i++)
+    {
+        bytes[i] = value >> (8 * i);
+    }
+    dump_put(bytes, length);
+}
+
+void trace_dump(void)
+{
+    // the rings stay still while they go out, the USB writes are not recorded either
+    recording = false;
+    uint64_t now = time_us_64();
+
+    dump_put(TRACE_MAGIC, 5);
+    dump_putLittle(TRACE_VERSION, 1);
+    dump_putLittle(NUM_CORES, 1);
+    dump_putLittle(now, 8);
+
+    dump_putLittle(taskCount, 1);
+    for (int i = 0; i < taskCount; i++)
+    {
+        size_t length = strnlen(tasks[i].name, TRACE_NAME_MAX);
+        dump_putLittle(tasks[i].number, 1);
+        dump_putLittle(tasks[i].priority, 1);
+        dump_putLittle(length, 1);
+        dump_put(tasks[i].name, length);
+    }
+    dump_putLittle(queueCount, 1);
+    for (int i = 0; i < queueCount; i++)
+    {
+        dump_putLittle(i + 1, 1);
+        dump_putLittle(queueTypes[i], 1);
+    }
+
+    for (unsigned int core = 0; core < NUM_CORES; core++)
+    {
+        struct trace_ring_s *ring = &rings[core];
+        uint32_t count = ring->head < TRACE_EVENTS ? ring->head : TRACE_EVENTS;
+        dump_putLittle(core, 1);
+        dump_putLittle(count, 2);
+        for (uint32_t i = ring->head - count; i != ring->head; i++)
+        {
+            const struct trace_event_s *event = &ring->events[i & (TRACE_EVENTS - 1)];
+            dump_putLittle(event->time, 4);
+            dump_putLittle(event->type, 1);
+            dump_putLittle(event->object, 1);
+            dump_putLittle(event->detail, 2);
+        }
+    }
+    dump_putLittle(TRACE_END, 1);
+    dump_flush();
+    recording = true;
+}
+#endif // TRACE_ENABLED
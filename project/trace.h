@@ -0,0 +1,96 @@
+#ifndef _TRACE_
+#define _TRACE_
+
+/** Kernel trace recorder, included at the end of FreeRTOSConfig.h.
+ * The FreeRTOS trace macros and the ISRs put 8 byte events into a RAM ring per core that keeps
+ * the newest TRACE_EVENTS. The console command "trace" stops the recording, sends the rings
+ * and the task and queue tables to USB in frames between the console text and starts again.
+ * weather_trace turns a dump into a Perfetto timeline with a track per core.
+ *
+ * The dump, cut into frames
+ *   CAPTURE_FRAME_START 'T' length-lo length-hi data sum-of-data-bytes
+ * is
+ *   TRACE_MAGIC, version byte, cores byte, 8 byte time_us_64 when the dump started
+ *   tasks byte, then for each: number, priority, name length, name
+ *   queues byte, then for each: number, queueQUEUE_TYPE_x
+ *   for each core: core byte, 2 byte event count, the events oldest first
+ *   TRACE_END
+ * with every multi byte field little endian. An event is a 32 bit time_us_32, a type, an
+ * object (task number, queue number or trace_isr_e) and 16 bits of detail.
+ */
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1 // 0 leaves the kernel hooks empty and frees the rings
+#endif
+
+#define TRACE_VERSION 1
+#define TRACE_MAGIC "WXTRC"
+#define TRACE_END 0xFF
+#define TRACE_FRAME 'T'
+#define TRACE_EVENTS 512 // per core, a power of two
+#define TRACE_TASKS 32
+#define TRACE_QUEUES 32
+#define TRACE_NAME_MAX 16 // configMAX_TASK_NAME_LEN
+
+enum trace_type_e
+{
+    TRACE_TASK_SWITCH,      // object is the task switched in
+    TRACE_ISR_ENTER,        // object is the trace_isr_e
+    TRACE_ISR_EXIT,
+    TRACE_QUEUE_SEND,       // a give for a semaphore or mutex. Detail is the messages waiting before
+    TRACE_QUEUE_RECEIVE,    // a take for a semaphore or mutex
+    TRACE_QUEUE_BLOCK_SEND, // the running task blocks on the queue
+    TRACE_QUEUE_BLOCK_RECEIVE,
+    TRACE_QUEUE_SEND_FAILED,
+    TRACE_QUEUE_RECEIVE_FAILED,
+    TRACE_TASK_READY, // object is the task made ready, from a task or an ISR
+    TRACE_TYPES,
+};
+
+/** the interrupt handlers that mark themselves */
+enum trace_isr_e
+{
+    TRACE_ISR_PIO_WIND,
+    TRACE_ISR_PIO_RAIN,
+    TRACE_ISR_GPS_UART,
+    TRACE_ISR_EL_UART,
+    TRACE_ISR_PPS,
+    TRACE_ISR_TMP_ALERT,
+    TRACE_ISR_SOURCES,
+};
+
+#if TRACE_ENABLED && !defined(__ASSEMBLER__)
+#include <stdint.h>
+
+void trace_event(uint8_t type, uint8_t object, uint16_t detail);
+void trace_taskCreate(uint32_t number, const char *name, uint32_t priority);
+uint32_t trace_queueCreate(uint8_t queueType);
+/** send the dump to USB, for the console and the sim at exit */
+void trace_dump(void);
+
+#define TRACE_ISR_ENTER(source) trace_event(TRACE_ISR_ENTER, source, 0)
+#define TRACE_ISR_EXIT(source) trace_event(TRACE_ISR_EXIT, source, 0)
+
+/* the kernel hooks. They expand inside tasks.c and queue.c where the TCB and queue
+ * structures are visible; configUSE_TRACE_FACILITY gives both a number to go by
+ */
+#define traceTASK_CREATE(pxNewTCB) trace_taskCreate((pxNewTCB)->uxTCBNumber, (pxNewTCB)->pcTaskName, (pxNewTCB)->uxPriority)
+#define traceTASK_SWITCHED_IN() trace_event(TRACE_TASK_SWITCH, pxCurrentTCB->uxTCBNumber, 0)
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB) trace_event(TRACE_TASK_READY, (pxTCB)->uxTCBNumber, 0)
+
+#define traceQUEUE_CREATE(pxNewQueue) (pxNewQueue)->uxQueueNumber = trace_queueCreate((pxNewQueue)->ucQueueType)
+#define TRACE_QUEUE(type, pxQueue) trace_event(type, (pxQueue)->uxQueueNumber, (pxQueue)->uxMessagesWaiting)
+#define traceQUEUE_SEND(pxQueue) TRACE_QUEUE(TRACE_QUEUE_SEND, pxQueue)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) TRACE_QUEUE(TRACE_QUEUE_SEND, pxQueue)
+#define traceQUEUE_RECEIVE(pxQueue) TRACE_QUEUE(TRACE_QUEUE_RECEIVE, pxQueue)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) TRACE_QUEUE(TRACE_QUEUE_RECEIVE, pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) TRACE_QUEUE(TRACE_QUEUE_BLOCK_SEND, pxQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) TRACE_QUEUE(TRACE_QUEUE_BLOCK_RECEIVE, pxQueue)
+#define traceQUEUE_SEND_FAILED(pxQueue) TRACE_QUEUE(TRACE_QUEUE_SEND_FAILED, pxQueue)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue) TRACE_QUEUE(TRACE_QUEUE_RECEIVE_FAILED, pxQueue)
+#else
+#define TRACE_ISR_ENTER(source)
+#define TRACE_ISR_EXIT(source)
+#define trace_dump()
+#endif
+
+#endif // _TRACE_
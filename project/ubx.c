@@ -0,0 +1,213 @@
+#include "ubx.h"
+
+/** UBX frame: 0xB5 0x62 class id length(LE16) payload ck_a ck_b
+ * The 8 bit Fletcher checksum covers class, id, length and payload.
+ */
+
+enum ubx_state_e
+{
+    UBX_WAIT_SYNC_1,
+    UBX_WAIT_SYNC_2,
+    UBX_CLASS,
+    UBX_ID,
+    UBX_LENGTH_1,
+    UBX_LENGTH_2,
+    UBX_PAYLOAD,
+    UBX_CK_A,
+    UBX_CK_B,
+};
+
+static inline void checksum(struct ubx_parser_s *parser, uint8_t byte)
+{
+    parser->ck_a += byte;
+    parser->ck_b += parser->ck_a;
+}
+
+/** after a byte that does not fit the frame, that byte may be the start of the next one */
+static inline void resync(struct ubx_parser_s *parser, uint8_t byte)
+{
+    parser->state = byte == UBX_SYNC_1 ? UBX_WAIT_SYNC_2 : UBX_WAIT_SYNC_1;
+}
+
+void ubx_parserInit(struct ubx_parser_s *parser)
+{
+    parser->state = UBX_WAIT_SYNC_1;
+    parser->checksumErrors = 0;
+    parser->skipped = 0;
+}
+
+bool ubx_parse(struct ubx_parser_s *parser, uint8_t byte)
+{
+    bool complete = false;
+
+    switch (parser->state)
+    {
+    case UBX_WAIT_SYNC_1:
+        if (byte == UBX_SYNC_1)
+            parser->state = UBX_WAIT_SYNC_2;
+        break;
+    case UBX_WAIT_SYNC_2:
+        if (byte == UBX_SYNC_2)
+            parser->state = UBX_CLASS;
+        else
+            resync(parser, byte);
+        parser->ck_a = 0;
+        parser->ck_b = 0;
+        break;
+    case UBX_CLASS:
+        parser->msgClass = byte;
+        checksum(parser, byte);
+        parser->state = UBX_ID;
+        break;
+    case UBX_ID:
+        parser->msgId = byte;
+        checksum(parser, byte);
+        parser->state = UBX_LENGTH_1;
+        break;
+    case UBX_LENGTH_1:
+        parser->length = byte;
+        checksum(parser, byte);
+        parser->state = UBX_LENGTH_2;
+        break;
+    case UBX_LENGTH_2:
+        parser->length |= (uint16_t)byte << 8;
+        checksum(parser, byte);
+        parser->position = 0;
+        parser->state = parser->length > 0 ? UBX_PAYLOAD : UBX_CK_A;
+        break;
+    case UBX_PAYLOAD:
+        // frames longer than the buffer are checksummed and counted but not kept
+        if (parser->position < sizeof(parser->payload))
+            parser->payload[parser->position] = byte;
+        checksum(parser, byte);
+        if (++parser->position >= parser->length)
+            parser->state = UBX_CK_A;
+        break;
+    case UBX_CK_A:
+        if (byte == parser->ck_a)
+        {
+            parser->state = UBX_CK_B;
+        }
+        else
+        {
+            parser->checksumErrors++;
+            resync(parser, byte);
+        }
+        break;
+    case UBX_CK_B:
+        parser->state = UBX_WAIT_SYNC_1;
+        if (byte != parser->ck_b)
+        {
+            parser->checksumErrors++;
+            resync(parser, byte);
+        }
+        else if (parser->length > sizeof(parser->payload))
+        {
+            parser->skipped++;
+        }
+        else
+        {
+            complete = true;
+        }
+        break;
+    default:
+        parser->state = UBX_WAIT_SYNC_1;
+        break;
+    }
+    return complete;
+}
+
+static uint16_t u16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | (uint16_t)p[1] << 8;
+}
+
+static uint32_t u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool ubx_decodeNavPvt(const uint8_t *payload, uint16_t length, struct ubx_nav_pvt_s *pvt)
+{
+    if (length != UBX_NAV_PVT_LENGTH)
+        return false;
+
+    // offsets from the UBX-NAV-PVT payload description
+    pvt->year = u16(&payload[4]);
+    pvt->month = payload[6];
+    pvt->day = payload[7];
+    pvt->hour = payload[8];
+    pvt->minute = payload[9];
+    pvt->second = payload[10];
+    pvt->valid = payload[11];
+    pvt->nano = (int32_t)u32(&payload[16]);
+    pvt->fixType = payload[20];
+    pvt->numSV = payload[23];
+    pvt->longitude = (int32_t)u32(&payload[24]);
+    pvt->latitude = (int32_t)u32(&payload[28]);
+    pvt->heightMSL = (int32_t)u32(&payload[36]);
+    pvt->hAcc = u32(&payload[40]);
+    pvt->vAcc = u32(&payload[44]);
+    return true;
+}
+
+size_t ubx_frame(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length, uint8_t *frame, size_t frameLength)
+{
+    struct ubx_parser_s sum = {0};
+
+    if (frameLength < (size_t)length + UBX_FRAME_OVERHEAD)
+        return 0;
+
+    frame[0] = UBX_SYNC_1;
+    frame[1] = UBX_SYNC_2;
+    frame[2] = msgClass;
+    frame[3] = msgId;
+    frame[4] = length & 0xFF;
+    frame[5] = length >> 8;
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = payload[i];
+    for (uint16_t i = 2; i < length + 6; i++)
+        checksum(&sum, frame[i]);
+    frame[length + 6] = sum.ck_a;
+    frame[length + 7] = sum.ck_b;
+    return length + UBX_FRAME_OVERHEAD;
+}
+
+size_t ubx_configurePort(uint32_t baud, uint8_t *frame, size_t frameLength)
+{
+    const uint32_t mode = 0x000008D0; // 8 bits, no parity, 1 stop bit
+    uint8_t payload[20] = {
+        1, // portID UART1
+        0,
+        0, 0, // txReady disabled
+        mode & 0xFF, (mode >> 8) & 0xFF, (mode >> 16) & 0xFF, mode >> 24,
+        baud & 0xFF, (baud >> 8) & 0xFF, (baud >> 16) & 0xFF, baud >> 24,
+        0x03, 0x00, // inProtoMask UBX + NMEA
+        0x01, 0x00, // outProtoMask UBX
+        0, 0,       // flags
+        0, 0};
+    return ubx_frame(UBX_CLASS_CFG, UBX_CFG_PRT, payload, sizeof(payload), frame, frameLength);
+}
+
+size_t ubx_configureRate(uint16_t measurementMs, uint8_t *frame, size_t frameLength)
+{
+    uint8_t payload[6] = {
+        measurementMs & 0xFF, measurementMs >> 8,
+        1, 0,  // one navigation solution per measurement
+        1, 0}; // aligned to GPS time
+    return ubx_frame(UBX_CLASS_CFG, UBX_CFG_RATE, payload, sizeof(payload), frame, frameLength);
+}
+
+size_t ubx_configureMessage(uint8_t msgClass, uint8_t msgId, uint8_t rate, uint8_t *frame, size_t frameLength)
+{
+    uint8_t payload[3] = {msgClass, msgId, rate};
+    return ubx_frame(UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload), frame, frameLength);
+}
+
+size_t ubx_powerBackup(uint32_t durationMs, uint8_t *frame, size_t frameLength)
+{
+    uint8_t payload[8] = {
+        durationMs & 0xFF, (durationMs >> 8) & 0xFF, (durationMs >> 16) & 0xFF, durationMs >> 24,
+        0x02, 0, 0, 0}; // flags: backup
+    return ubx_frame(UBX_CLASS_RXM, UBX_RXM_PMREQ, payload, sizeof(payload), frame, frameLength);
+}
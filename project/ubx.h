@@ -0,0 +1,90 @@
+#ifndef _UBX_
+#define _UBX_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** u-blox UBX binary protocol (u-blox 8 / M8 receiver description) */
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+#define UBX_FRAME_OVERHEAD 8 // sync, class, id, length and checksum
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_NAV_PVT 0x07
+#define UBX_NAV_PVT_LENGTH 92
+
+#define UBX_CLASS_CFG 0x06
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+
+#define UBX_CLASS_RXM 0x02
+#define UBX_RXM_PMREQ 0x41
+
+#define UBX_MAX_PAYLOAD UBX_NAV_PVT_LENGTH // the only message the parser keeps
+
+enum ubx_fix_type_e
+{
+    UBX_NO_FIX = 0,
+    UBX_DEAD_RECKONING = 1,
+    UBX_2D_FIX = 2,
+    UBX_3D_FIX = 3,
+    UBX_GNSS_DEAD_RECKONING = 4,
+    UBX_TIME_ONLY = 5,
+};
+
+struct ubx_parser_s
+{
+    uint8_t state;
+    uint8_t msgClass;
+    uint8_t msgId;
+    uint8_t ck_a;
+    uint8_t ck_b;
+    uint16_t length;
+    uint16_t position;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+    uint32_t checksumErrors; // frames discarded for a bad checksum
+    uint32_t skipped;        // frames discarded for being too long to keep
+};
+
+/** the NAV-PVT fields the station uses */
+struct ubx_nav_pvt_s
+{
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t valid; // bit 0 validDate, bit 1 validTime, bit 2 fullyResolved
+    int32_t nano;
+    uint8_t fixType;
+    uint8_t numSV;
+    int32_t longitude; // 1e-7 degrees
+    int32_t latitude;  // 1e-7 degrees
+    int32_t heightMSL; // mm
+    uint32_t hAcc;     // mm
+    uint32_t vAcc;     // mm
+};
+
+void ubx_parserInit(struct ubx_parser_s *parser);
+/** feed one received byte. Returns true when a complete frame with a valid checksum is in parser->payload */
+bool ubx_parse(struct ubx_parser_s *parser, uint8_t byte);
+/** decode a NAV-PVT payload using the fixed field offsets */
+bool ubx_decodeNavPvt(const uint8_t *payload, uint16_t length, struct ubx_nav_pvt_s *pvt);
+
+/** build a complete frame. returns the frame length or 0 if it does not fit */
+size_t ubx_frame(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length, uint8_t *frame, size_t frameLength);
+/** CFG-PRT for the receiver UART1: UBX+NMEA in, UBX only out */
+size_t ubx_configurePort(uint32_t baud, uint8_t *frame, size_t frameLength);
+/** CFG-RATE: one navigation solution every measurementMs */
+size_t ubx_configureRate(uint16_t measurementMs, uint8_t *frame, size_t frameLength);
+/** CFG-MSG: output msgClass/msgId once every rate solutions on the current port (0 disables) */
+size_t ubx_configureMessage(uint8_t msgClass, uint8_t msgId, uint8_t rate, uint8_t *frame, size_t frameLength);
+/** RXM-PMREQ: enter backup mode for durationMs then restart on its own. The receiver keeps its
+ * ephemeris and RTC in backup RAM so the restart is a hot start. Accepted in NMEA mode as well.
+ */
+size_t ubx_powerBackup(uint32_t durationMs, uint8_t *frame, size_t frameLength);
+
+#endif // _UBX_
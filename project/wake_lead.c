@@ -0,0 +1,19 @@
+#include "wake_lead.h"
+
+void wake_leadInit(struct wake_lead_s *lead)
+{
+    lead->readyMs = WAKE_LEAD_INITIAL_MS;
+    lead->deviationMs = WAKE_LEAD_INITIAL_MS / 4;
+}
+
+void wake_leadAdd(struct wake_lead_s *lead, uint32_t measuredMs)
+{
+    int32_t error = (int32_t)measuredMs - (int32_t)lead->readyMs;
+    lead->readyMs += error / 8;
+    lead->deviationMs += ((error < 0 ? -error : error) - (int32_t)lead->deviationMs) / 4;
+}
+
+uint32_t wake_leadMs(const struct wake_lead_s *lead)
+{
+    return lead->readyMs + 4 * lead->deviationMs + WAKE_LEAD_MARGIN_MS;
+}
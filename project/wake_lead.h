@@ -0,0 +1,24 @@
+#ifndef _WAKE_LEAD_
+#define _WAKE_LEAD_
+
+#include <stdint.h>
+
+/** How long before a report window to wake the sleeping ExpressLink. The wake-to-ready time,
+ * WAKE asserted to attached, is kept as a running mean and mean deviation the way TCP keeps
+ * its retransmit timer, and the lead is the mean with four deviations and a margin on top.
+ */
+#define WAKE_LEAD_INITIAL_MS 15000 // the wake-to-ready estimate before the first wake
+#define WAKE_LEAD_MARGIN_MS 2000
+
+struct wake_lead_s
+{
+    uint32_t readyMs;     // mean wake-to-ready
+    uint32_t deviationMs; // mean deviation from it
+};
+
+void wake_leadInit(struct wake_lead_s *lead);
+/** fold in a measured wake-to-ready time. Leave out wakes that needed more than one attach */
+void wake_leadAdd(struct wake_lead_s *lead, uint32_t measuredMs);
+uint32_t wake_leadMs(const struct wake_lead_s *lead);
+
+#endif // _WAKE_LEAD_
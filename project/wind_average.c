@@ -0,0 +1,82 @@
+#include "wind_average.h"
+
+#include <stdlib.h>
+
+struct dir_counts_s
+{
+    uint32_t counts;
+    int degrees;
+};
+// pointed the arrow in each direction and recorded the counts
+static const struct dir_counts_s direction_map[] = {
+    {4400, 0},
+    {1400, 45},
+    {420, 90},
+    {600, 135},
+    {840, 180},
+    {2400, 225},
+    {12600, 270},
+    {7900, 315}};
+
+int wind_directionFromCounts(uint32_t counts)
+{
+    int closest_index = 0; // assume the first index is the closest
+    // find closest counts in the map
+    for (int map_index = 0; map_index < sizeof(direction_map) / sizeof(*direction_map); map_index++)
+    {
+        int difference = abs(counts - direction_map[map_index].counts);
+        int closest_difference = abs(counts - direction_map[closest_index].counts);
+        if (difference < closest_difference)
+        {
+            closest_index = map_index;
+        }
+    }
+
+    return direction_map[closest_index].degrees;
+}
+
+void wind_average(const struct wind_data *samples, int count, struct wind_data *average)
+{
+    float speed = 0;
+    int sum = samples[0].direction;
+    int D = sum;
+    for (int x = 0; x < count; x++)
+    {
+        int delta = samples[x].direction - D;
+        if (delta < -180)
+        {
+            D += delta + 360;
+        }
+        else if (delta > 180)
+        {
+            D += delta - 360;
+        }
+        else
+        {
+            D += delta;
+        }
+        sum += D;
+        speed += samples[x].speed;
+    }
+    average->speed = speed / count;
+    average->direction = sum / count;
+    if (average->direction >= 360)
+        average->direction -= 360;
+    if (average->direction < 0)
+        average->direction += 360;
+}
+
+void wind_gust(const struct wind_data *samples, int count, struct wind_data *gust)
+{
+    gust->direction = 0;
+    gust->speed = 0.0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (samples[i].speed > gust->speed)
+        {
+            gust->speed = samples[i].speed;
+            gust->direction = samples[i].direction;
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef _WIND_AVERAGE_
+#define _WIND_AVERAGE_
+
+#include <stdint.h>
+
+#define WIND_AVERAGE_SAMPLES 120 // two minutes of data for every second
+
+struct wind_data
+{
+    int direction;
+    float speed;
+};
+
+/** the nearest vane position to an oversampled ADC reading */
+int wind_directionFromCounts(uint32_t counts);
+/** mean speed and direction. The direction is unwrapped sample to sample so an average
+ * across north does not come out south
+ */
+void wind_average(const struct wind_data *samples, int count, struct wind_data *average);
+/** the fastest sample and its direction */
+void wind_gust(const struct wind_data *samples, int count, struct wind_data *gust);
+
+#endif // _WIND_AVERAGE_
@@ -2,16 +2,34 @@
 #include "task.h"
 #include "queue.h"
 #include "hardware/pio.h"
+#include "pico/time.h"
 #include "hardware/adc.h"
 
 #include <stdio.h>
 #include <pinmap.h>
 #include "reporting_task.h"
+#include "alerts.h"
+#include "wind_average.h"
+#include "capture.h"
+#include "isr_stats.h"
+#include "deadline.h"
+#include "kernel_objects.h"
+#include "log.h"
 #include <stdlib.h>
 #include <stdint.h>
 #include <limits.h>
 
+struct wind_capture_s
+{
+    uint32_t count;
+    uint64_t micros; // when the interrupt took the count, for the PPS timebase
+};
+
 static QueueHandle_t windQueue;
+static StaticQueue_t windQueueBuffer;
+static uint8_t windQueueStorage[WIND_QUEUE_LENGTH * sizeof(struct wind_capture_s)];
+static StackType_t windStack[KERNEL_STACK(WIND_STACK_WORDS)];
+static StaticTask_t windTaskBuffer;
 unsigned int wind_sm;
 
 extern PIO pio;
@@ -20,32 +38,22 @@ extern PIO pio;
 
 void wind_irq_func(void)
 {
+    TRACE_ISR_ENTER(TRACE_ISR_PIO_WIND);
+    uint32_t isrStart = isr_enter();
     BaseType_t higherPriorityTaskWoken = pdFALSE;
     uint32_t c; // empty the fifo and keep the last value
     while (!pio_sm_is_rx_fifo_empty(pio, wind_sm))
     {
         c = pio->rxf[wind_sm];
     }
-    xQueueSendFromISR(windQueue, &c, &higherPriorityTaskWoken);
+    capture_pioFromISR(CAPTURE_PIO_WIND, c);
+    struct wind_capture_s capture = {c, time_us_64()};
+    xQueueSendFromISR(windQueue, &capture, &higherPriorityTaskWoken);
+    isr_exit(ISR_WIND, isrStart, true);
+    TRACE_ISR_EXIT(TRACE_ISR_PIO_WIND);
     portYIELD_FROM_ISR(higherPriorityTaskWoken);
 }
 
-struct dir_counts_s
-{
-    uint32_t counts;
-    int degrees;
-};
-// pointed the arrow in each direction and recorded the counts
-const struct dir_counts_s direction_map[] = {
-    {4400, 0},
-    {1400, 45},
-    {420, 90},
-    {600, 135},
-    {840, 180},
-    {2400, 225},
-    {12600, 270},
-    {7900, 315}};
-
 uint32_t convertPin(int pin)
 {
     assert(pin >= 26 && pin <= 29);
@@ -67,34 +75,16 @@ uint32_t convertPin(int pin)
         uint16_t r = adc_read();
         counts += r;
     }
+    capture_adc(adc_channel, counts);
     counts /= 16;
     return counts;
 }
 
 int measureDirection()
 {
-    uint32_t counts = convertPin(WIND_DIR_PIN);
-    int closest_index = 0; // assume the first index is the closest
-    // find closest counts in the map
-    for (int map_index = 0; map_index < sizeof(direction_map) / sizeof(*direction_map); map_index++)
-    {
-        int difference = abs(counts - direction_map[map_index].counts);
-        int closest_difference = abs(counts - direction_map[closest_index].counts);
-        if (difference < closest_difference)
-        {
-            closest_index = map_index;
-        }
-    }
-
-    return direction_map[closest_index].degrees;
+    return wind_directionFromCounts(convertPin(WIND_DIR_PIN));
 }
 
-struct wind_data
-{
-    int direction;
-    float speed;
-};
-
 void measureBattery()
 {
     // go ahead and measure the battery voltage here so I don't have to share the ADC with another task.
@@ -116,21 +106,26 @@ void measureBattery()
 // Total rain over date (store one per day)
 
 #define WIND_DATA_UPDATE (1000U)
+#define WIND_UPDATE_BUDGET_MS 50 // the vane ADC read, the averages and the reports
+#define WIND_QUIET_SECONDS 60 // updates without an edge before the console hears about it
 
 static void wind_task(void *parameter)
 {
     bool transmitRawData = false;
+    bool started = false;
     int seconds_2m = 0;
     int minutes_10m = 0;
-    unsigned int lastWindCheck = 0;
-    unsigned int count = 0;
-    unsigned int lastCounts = 0;
-    unsigned int lastUpdate = 0;
+    int quietSeconds = 0;
+    TickType_t lastWindCheck = 0;
+    TickType_t lastUpdate = 0;
+    uint32_t count = 0;
+    uint64_t countMicros = 0;
+    uint32_t lastCounts = 0;
     unsigned int lastRawTransmission = 0;
     int logIndex = 0;
     int seconds = 0;
     int minutes = 0;
-    struct wind_data windavg_2m[120] = {{0.0, 0}};  // two minutes of data for every second
+    struct wind_data windavg_2m[WIND_AVERAGE_SAMPLES] = {{0.0, 0}}; // two minutes of data for every second
     struct wind_data windgust_10m[10] = {{0.0, 0}}; // last 10 minutes of wind gusts
     struct wind_data windgust;                      // daily gust data
     struct wind_data windavg2m;
@@ -138,117 +133,91 @@ static void wind_task(void *parameter)
 
     for (;;)
     {
-        if (pdTRUE == xQueueReceive(windQueue, &count, pdMS_TO_TICKS(60000))) // wait up to 1min for counts data
+        // a calm second has no edges and so no sample, the timeout still moves the averages on
+        struct wind_capture_s capture;
+        if (pdTRUE == xQueueReceive(windQueue, &capture, pdMS_TO_TICKS(WIND_DATA_UPDATE)))
         {
-            unsigned int now = xTaskGetTickCount() / portTICK_RATE_MS; // get the up-time in ms
-            int currentDirection = measureDirection();                 // collect the current wind direction
-
-            if (now - lastUpdate > WIND_DATA_UPDATE)
+            isr_taskRunning(ISR_WIND);
+            count = capture.count;
+            countMicros = capture.micros;
+            quietSeconds = 0;
+            if (!started)
             {
-                lastUpdate += WIND_DATA_UPDATE;
+                // the PIO pushes its count as it starts, the edges before that are not wind
+                started = true;
+                lastCounts = count;
+                lastUpdate = lastWindCheck = xTaskGetTickCount();
+            }
+        }
+        else if (++quietSeconds % WIND_QUIET_SECONDS == 0)
+        {
+            LOG_WARN("No wind data in 1 minute");
+        }
 
-                if (++seconds_2m > 119)
-                    seconds_2m = 0;
+        // tick differences are modular so they stay right when the tick count wraps after 49 days
+        TickType_t now = xTaskGetTickCount();
+        if (started && now - lastUpdate >= pdMS_TO_TICKS(WIND_DATA_UPDATE))
+        {
+            deadline_start(DEADLINE_WIND);
+            int currentDirection = measureDirection(); // collect the current wind direction
 
-                float deltaTime = (float)(now - lastWindCheck);
-                lastWindCheck = now;
-                deltaTime /= 1000.0;
+            lastUpdate += pdMS_TO_TICKS(WIND_DATA_UPDATE);
+            if (now - lastUpdate >= pdMS_TO_TICKS(WIND_DATA_UPDATE))
+                lastUpdate = now; // stalled for more than an update, do not try to catch up
 
-                /* care care of the count rollover since the PIO code is a monotonic count */
-                uint32_t deltaCounts = count - lastCounts;
-                if (deltaCounts > lastCounts)
-                    deltaCounts += UINT_MAX;
-                /* scale into actual MPH wind speed */
-                float currentSpeed = 1.492 * ((float)deltaCounts) / deltaTime;
-                lastCounts = count;
+            if (++seconds_2m > 119)
+                seconds_2m = 0;
 
-                windavg_2m[seconds_2m].speed = currentSpeed;
-                windavg_2m[seconds_2m].direction = currentDirection;
+            float deltaTime = (float)(now - lastWindCheck) / configTICK_RATE_HZ;
+            lastWindCheck = now;
 
-                if (currentSpeed > windgust_10m[minutes_10m].speed)
-                {
-                    windgust_10m[minutes_10m].speed = currentSpeed;
-                    windgust_10m[minutes_10m].direction = currentDirection;
-                }
+            /* the PIO count is a free running 32 bit edge count, the modular difference is right across its wrap */
+            uint32_t deltaCounts = count - lastCounts;
+            /* scale into actual MPH wind speed */
+            float currentSpeed = 1.492 * ((float)deltaCounts) / deltaTime;
+            lastCounts = count;
+            alerts_checkGust(currentSpeed);
 
-                if (currentSpeed > windgust.speed)
-                {
-                    windgust.speed = currentSpeed;
-                    windgust.direction = currentDirection;
-                }
+            windavg_2m[seconds_2m].speed = currentSpeed;
+            windavg_2m[seconds_2m].direction = currentDirection;
 
-                if (++seconds > 59)
-                {
-                    seconds = 0;
-                    transmitRawData = true;
+            if (currentSpeed > windgust_10m[minutes_10m].speed)
+            {
+                windgust_10m[minutes_10m].speed = currentSpeed;
+                windgust_10m[minutes_10m].direction = currentDirection;
+            }
 
-                    if (++minutes > 59)
-                    {
-                        minutes = 0;
-                    }
-                    if (++minutes_10m > 9)
-                        minutes_10m = 0;
+            if (currentSpeed > windgust.speed)
+            {
+                windgust.speed = currentSpeed;
+                windgust.direction = currentDirection;
+            }
 
-                    windgust_10m[minutes_10m].speed = 0; // Zero out this minute's gust
-                }
+            if (++seconds > 59)
+            {
+                seconds = 0;
+                transmitRawData = true;
 
-                // computing the average speed & direction
+                if (++minutes > 59)
                 {
-                    float avgspeed_2m = 0;
-                    int sum = windavg_2m[0].direction;
-                    int D = sum;
-                    for (int x = 0; x < 120; x++)
-                    {
-                        int delta = windavg_2m[x].direction - D;
-                        if (delta < -180)
-                        {
-                            D += delta + 360;
-                        }
-                        else if (delta > 180)
-                        {
-                            D += delta - 360;
-                        }
-                        else
-                        {
-                            D += delta;
-                        }
-                        sum += D;
-                        avgspeed_2m += windavg_2m[x].speed;
-                    }
-                    windavg2m.speed = avgspeed_2m / 120.0;
-                    windavg2m.direction = sum / 120;
-                    if (windavg2m.direction >= 360)
-                        windavg2m.direction -= 360;
-                    if (windavg2m.direction < 0)
-                        windavg2m.direction += 360;
+                    minutes = 0;
                 }
+                if (++minutes_10m > 9)
+                    minutes_10m = 0;
 
-                // calculate the 10 minute gust speed & direction
-                {
-                    gust_10m.direction = 0;
-                    gust_10m.speed = 0.0;
+                windgust_10m[minutes_10m].speed = 0; // Zero out this minute's gust
+            }
 
-                    for (int i = 0; i < 10; i++)
-                    {
-                        if (windgust_10m[i].speed > gust_10m.speed)
-                        {
-                            gust_10m.speed = windgust_10m[i].speed;
-                            gust_10m.direction = windgust_10m[i].direction;
-                        }
-                    }
-                }
+            wind_average(windavg_2m, WIND_AVERAGE_SAMPLES, &windavg2m);
+            wind_gust(windgust_10m, 10, &gust_10m);
 
-                if (transmitRawData) // raw data every minute
-                {
-                    transmitRawData = false;
-                    reportWINDData(count, currentDirection); // send the data
-                    reportWINDScaledData(windavg2m.speed, windavg2m.direction, gust_10m.speed, gust_10m.direction);
-                }
+            if (transmitRawData) // raw data every minute
+            {
+                transmitRawData = false;
+                reportWINDData(count, currentDirection, countMicros); // send the data
+                reportWINDScaledData(windavg2m.speed, windavg2m.direction, gust_10m.speed, gust_10m.direction);
             }
-        }
-        else
-        {
-            puts("No wind data in 1 minute");
+            deadline_end(DEADLINE_WIND);
         }
         measureBattery();
     }
@@ -256,9 +225,10 @@ static void wind_task(void *parameter)
 
 void init_wind()
 {
-    windQueue = xQueueCreate(10, sizeof(int));
+    windQueue = xQueueCreateStatic(WIND_QUEUE_LENGTH, sizeof(struct wind_capture_s), windQueueStorage, &windQueueBuffer);
 
     assert(windQueue);
 
-    xTaskCreate(wind_task, "Wind", 1000, NULL, WIND_PRIORITY, NULL);
+    deadline_register(DEADLINE_WIND, WIND_DATA_UPDATE, WIND_UPDATE_BUDGET_MS);
+    kernel_createTask(wind_task, "Wind", windStack, KERNEL_WORDS(windStack), NULL, WIND_PRIORITY, &windTaskBuffer);
 }